@@ -0,0 +1,587 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _aio.c
+//    Date: 2024-09-10
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#endif
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+#endif
+
+#define _DTHREAD_AIO_QUEUE_DEPTH 256
+#define _DTHREAD_AIO_NUM_THREADS 4
+
+// the kernel never transfers more in a single read or write
+#define _DTHREAD_AIO_MAX_LENGTH 0x7ffff000u
+
+static dthread_define_routine(_dthread_aio_finish)
+{
+    DThreadAIOOp* op = (DThreadAIOOp*)data;
+    DThreadAIO* aio = op->aio;
+
+    // the operation may be released by its callback
+    if (op->callback)
+        op->callback(op);
+
+    if (dthread_atomic_fetch_add_i64(&aio->pending, -1) == 1)
+    {
+        dthread_mutex_lock(&aio->mutex);
+        dthread_cond_broadcast(&aio->idle);
+        dthread_mutex_unlock(&aio->mutex);
+    }
+
+    return NULL;
+}
+
+static void _dthread_aio_complete(DThreadAIO* aio, DThreadAIOOp* op, int64_t result)
+{
+    op->result = result;
+
+    if (aio->config.pool && dthread_pool_submit(aio->config.pool, _dthread_aio_finish, op) == 0)
+        return;
+
+    _dthread_aio_finish(op);
+}
+
+/*
+ * Thread backend
+ */
+
+static int64_t _dthread_aio_execute(DThreadAIOOp* op)
+{
+    size_t length = op->length > _DTHREAD_AIO_MAX_LENGTH ? _DTHREAD_AIO_MAX_LENGTH : op->length;
+
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE file = (HANDLE)_get_osfhandle(op->fd);
+    OVERLAPPED overlapped;
+    DWORD transferred = 0;
+
+    if (file == INVALID_HANDLE_VALUE)
+        return -(int64_t)ERROR_INVALID_HANDLE;
+
+    if (op->opcode == DTHREAD_AIO_FSYNC)
+        return FlushFileBuffers(file) ? 0 : -(int64_t)GetLastError();
+
+    // a synchronous call with an explicit offset, like pread/pwrite
+    memset(&overlapped, 0, sizeof(overlapped));
+    overlapped.Offset = (DWORD)op->offset;
+    overlapped.OffsetHigh = (DWORD)(op->offset >> 32);
+
+    BOOL ok = op->opcode == DTHREAD_AIO_READ ? ReadFile(file, op->buffer, (DWORD)length, &transferred, &overlapped)
+                                             : WriteFile(file, op->buffer, (DWORD)length, &transferred, &overlapped);
+
+    if (!ok && GetLastError() != ERROR_HANDLE_EOF)
+        return -(int64_t)GetLastError();
+
+    return (int64_t)transferred;
+#else
+    ssize_t result;
+
+    do
+    {
+        if (op->opcode == DTHREAD_AIO_READ)
+            result = pread(op->fd, op->buffer, length, (off_t)op->offset);
+        else if (op->opcode == DTHREAD_AIO_WRITE)
+            result = pwrite(op->fd, op->buffer, length, (off_t)op->offset);
+        else
+            result = fsync(op->fd);
+    } while (result < 0 && errno == EINTR);
+
+    return result < 0 ? -(int64_t)errno : (int64_t)result;
+#endif
+}
+
+static dthread_define_routine(_dthread_aio_thread_main)
+{
+    DThreadAIO* aio = (DThreadAIO*)data;
+
+    for (;;)
+    {
+        dthread_mutex_lock(&aio->mutex);
+
+        while (!aio->head && !aio->stop)
+            dthread_cond_wait(&aio->cond, &aio->mutex);
+
+        DThreadAIOOp* op = aio->head;
+        if (op)
+        {
+            aio->head = op->next;
+            if (!aio->head)
+                aio->tail = NULL;
+        }
+
+        dthread_mutex_unlock(&aio->mutex);
+
+        if (!op)
+            break;
+
+        _dthread_aio_complete(aio, op, _dthread_aio_execute(op));
+    }
+
+    return NULL;
+}
+
+/*
+ * io_uring backend
+ */
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+
+static int _dthread_aio_uring_enter(_DThreadAIORing* ring, unsigned int to_submit, unsigned int min_complete, unsigned int flags)
+{
+    long result;
+
+    do
+    {
+        result = syscall(__NR_io_uring_enter, ring->fd, to_submit, min_complete, flags, NULL, 0);
+    } while (result < 0 && errno == EINTR);
+
+    return result < 0 ? -1 : (int)result;
+}
+
+static void _dthread_aio_uring_close(_DThreadAIORing* ring)
+{
+    if (ring->sqes)
+        munmap(ring->sqes, ring->sqes_size);
+    if (ring->cq_map && ring->cq_map != ring->sq_map)
+        munmap(ring->cq_map, ring->cq_map_size);
+    if (ring->sq_map)
+        munmap(ring->sq_map, ring->sq_map_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+
+    memset(ring, 0, sizeof(*ring));
+    ring->fd = -1;
+}
+
+static int _dthread_aio_uring_open(_DThreadAIORing* ring, unsigned int entries)
+{
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    memset(ring, 0, sizeof(*ring));
+
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+    if (ring->fd < 0)
+        return 1;
+
+    // a single mapping for both rings and plain read/write opcodes (5.7+ has both)
+    if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_FAST_POLL))
+    {
+        _dthread_aio_uring_close(ring);
+        return 1;
+    }
+
+    ring->sq_entries = params.sq_entries;
+    ring->cq_entries = params.cq_entries;
+
+    size_t sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+    size_t cq_size = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+    ring->sq_map_size = sq_size > cq_size ? sq_size : cq_size;
+    ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_map == MAP_FAILED)
+    {
+        ring->sq_map = NULL;
+        _dthread_aio_uring_close(ring);
+        return 1;
+    }
+
+    ring->cq_map = ring->sq_map;
+    ring->cq_map_size = ring->sq_map_size;
+
+    ring->sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+    ring->sqes = mmap(NULL, ring->sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+    {
+        ring->sqes = NULL;
+        _dthread_aio_uring_close(ring);
+        return 1;
+    }
+
+    char* sq = (char*)ring->sq_map;
+    ring->sq_head = (unsigned int*)(sq + params.sq_off.head);
+    ring->sq_tail = (unsigned int*)(sq + params.sq_off.tail);
+    ring->sq_mask = (unsigned int*)(sq + params.sq_off.ring_mask);
+    ring->sq_array = (unsigned int*)(sq + params.sq_off.array);
+
+    char* cq = (char*)ring->cq_map;
+    ring->cq_head = (unsigned int*)(cq + params.cq_off.head);
+    ring->cq_tail = (unsigned int*)(cq + params.cq_off.tail);
+    ring->cq_mask = (unsigned int*)(cq + params.cq_off.ring_mask);
+    ring->cqes = cq + params.cq_off.cqes;
+
+    return 0;
+}
+
+// must be called with the mutex held, non-zero when the ring has no room for the operation
+static int _dthread_aio_uring_push(DThreadAIO* aio, DThreadAIOOp* op)
+{
+    _DThreadAIORing* ring = &aio->ring;
+
+    // never more in flight than completions the ring can hold
+    if (op && aio->inflight >= (int64_t)ring->cq_entries)
+        return 1;
+
+    unsigned int tail = *ring->sq_tail;
+    if (tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE) >= ring->sq_entries)
+        return 1;
+
+    unsigned int index = tail & *ring->sq_mask;
+    struct io_uring_sqe* sqe = &((struct io_uring_sqe*)ring->sqes)[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    if (!op)
+    {
+        // wakes the completion thread up
+        sqe->opcode = IORING_OP_NOP;
+    }
+    else if (op->opcode == DTHREAD_AIO_FSYNC)
+    {
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->fd = op->fd;
+    }
+    else
+    {
+        int write = op->opcode == DTHREAD_AIO_WRITE;
+
+        if (op->fixed)
+        {
+            sqe->opcode = write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+            sqe->buf_index = (uint16_t)op->buffer_index;
+        }
+        else
+        {
+            sqe->opcode = write ? IORING_OP_WRITE : IORING_OP_READ;
+        }
+
+        sqe->fd = op->fd;
+        sqe->addr = (uint64_t)(uintptr_t)op->buffer;
+        sqe->len = (uint32_t)(op->length > _DTHREAD_AIO_MAX_LENGTH ? _DTHREAD_AIO_MAX_LENGTH : op->length);
+        sqe->off = op->offset;
+    }
+
+    sqe->user_data = (uint64_t)(uintptr_t)op;
+    ring->sq_array[index] = index;
+
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (op)
+        aio->inflight++;
+
+    return 0;
+}
+
+// must be called with the mutex held, entries in the ring the kernel has not consumed yet
+static unsigned int _dthread_aio_uring_unsubmitted(_DThreadAIORing* ring)
+{
+    return *ring->sq_tail - __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+}
+
+// must be called with the mutex held, moves waiting operations into the ring
+static unsigned int _dthread_aio_uring_flush(DThreadAIO* aio)
+{
+    unsigned int pushed = 0;
+
+    while (aio->head && _dthread_aio_uring_push(aio, aio->head) == 0)
+    {
+        aio->head = aio->head->next;
+        if (!aio->head)
+            aio->tail = NULL;
+
+        pushed++;
+    }
+
+    return pushed;
+}
+
+static dthread_define_routine(_dthread_aio_uring_main)
+{
+    DThreadAIO* aio = (DThreadAIO*)data;
+    _DThreadAIORing* ring = &aio->ring;
+
+    for (;;)
+    {
+        // the mutex also orders the submitter's writes before the reaping and the callbacks
+        dthread_mutex_lock(&aio->mutex);
+
+        unsigned int head = *ring->cq_head;
+        unsigned int tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        DThreadAIOOp* done = NULL;
+        DThreadAIOOp** last = &done;
+        int64_t reaped = 0;
+
+        for (; head != tail; ++head)
+        {
+            struct io_uring_cqe* cqe = &((struct io_uring_cqe*)ring->cqes)[head & *ring->cq_mask];
+            DThreadAIOOp* op = (DThreadAIOOp*)(uintptr_t)cqe->user_data;
+
+            if (!op)
+                continue;
+
+            // `next` is free while the operation is in flight
+            op->result = cqe->res;
+            *last = op;
+            last = &op->next;
+            reaped++;
+        }
+
+        *last = NULL;
+        __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+
+        aio->inflight -= reaped;
+
+        // entries left behind by a failed submission go out with this round
+        _dthread_aio_uring_flush(aio);
+        unsigned int pushed = _dthread_aio_uring_unsubmitted(ring);
+        int exit = aio->stop && aio->inflight == 0 && !aio->head;
+
+        dthread_mutex_unlock(&aio->mutex);
+
+        while (done)
+        {
+            DThreadAIOOp* op = done;
+            done = op->next;
+            _dthread_aio_complete(aio, op, op->result);
+        }
+
+        if (exit)
+            break;
+
+        if (_dthread_aio_uring_enter(ring, pushed, 1, IORING_ENTER_GETEVENTS) < 0)
+            break;
+    }
+
+    return NULL;
+}
+
+#endif
+
+int dthread_aio_init(DThreadAIO* aio, DThreadAIOConfig* config)
+{
+    dthread_debug("dthread_aio_init");
+
+    assert(aio && "`aio` cannot be NULL in dthread_aio_init");
+
+    memset(aio, 0, sizeof(*aio));
+
+    DThreadAIOConfig cfg = config ? *config : (DThreadAIOConfig){0};
+
+    if (cfg.queue_depth == 0)
+        cfg.queue_depth = _DTHREAD_AIO_QUEUE_DEPTH;
+    if (cfg.num_threads <= 0)
+        cfg.num_threads = _DTHREAD_AIO_NUM_THREADS;
+
+    aio->config = cfg;
+    aio->ring.fd = -1;
+    aio->backend = DTHREAD_AIO_BACKEND_THREADS;
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+    // older kernels or seccomp filters refuse io_uring, the threads take over
+    if (!cfg.force_threads && _dthread_aio_uring_open(&aio->ring, cfg.queue_depth) == 0)
+        aio->backend = DTHREAD_AIO_BACKEND_URING;
+#endif
+
+    int num_threads = aio->backend == DTHREAD_AIO_BACKEND_URING ? 1 : cfg.num_threads;
+
+    aio->threads = (DThread*)calloc((size_t)num_threads, sizeof(DThread));
+    if (!aio->threads)
+    {
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+        _dthread_aio_uring_close(&aio->ring);
+#endif
+        return 1;
+    }
+
+    dthread_mutex_init(&aio->mutex, NULL);
+    dthread_cond_init(&aio->cond, NULL);
+    dthread_cond_init(&aio->idle, NULL);
+
+    DThreadRoutine routine = _dthread_aio_thread_main;
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+    if (aio->backend == DTHREAD_AIO_BACKEND_URING)
+        routine = _dthread_aio_uring_main;
+#endif
+
+    for (int i = 0; i < num_threads; ++i)
+    {
+        aio->threads[i] = dthread_init_thread(routine, aio);
+
+        if (dthread_create(&aio->threads[i], NULL) != 0)
+        {
+            dthread_aio_destroy(aio);
+            return 1;
+        }
+
+        aio->num_threads = i + 1;
+    }
+
+    return 0;
+}
+
+int dthread_aio_destroy(DThreadAIO* aio)
+{
+    dthread_debug("dthread_aio_destroy");
+
+    assert(aio && "`aio` cannot be NULL in dthread_aio_destroy");
+
+    dthread_aio_wait(aio);
+
+    dthread_mutex_lock(&aio->mutex);
+    aio->stop = 1;
+    dthread_cond_broadcast(&aio->cond);
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+    if (aio->backend == DTHREAD_AIO_BACKEND_URING && aio->num_threads > 0 && _dthread_aio_uring_push(aio, NULL) == 0)
+        _dthread_aio_uring_enter(&aio->ring, _dthread_aio_uring_unsubmitted(&aio->ring), 0, 0);
+#endif
+
+    dthread_mutex_unlock(&aio->mutex);
+
+    int result = 0;
+
+    for (int i = 0; i < aio->num_threads; ++i)
+    {
+        if (dthread_join(&aio->threads[i]) != 0)
+            result = 1;
+    }
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+    if (aio->backend == DTHREAD_AIO_BACKEND_URING)
+        _dthread_aio_uring_close(&aio->ring);
+#endif
+
+    free(aio->threads);
+    aio->threads = NULL;
+    aio->num_threads = 0;
+
+    dthread_cond_destroy(&aio->idle);
+    dthread_cond_destroy(&aio->cond);
+    dthread_mutex_destroy(&aio->mutex);
+
+    return result;
+}
+
+int dthread_aio_register_buffers(DThreadAIO* aio, void** buffers, size_t* lengths, int count)
+{
+    dthread_debug("dthread_aio_register_buffers");
+
+    assert(aio && buffers && lengths && "`aio`, `buffers` and `lengths` cannot be NULL in dthread_aio_register_buffers");
+
+    if (aio->num_buffers > 0 || count <= 0)
+        return 1;
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+    if (aio->backend == DTHREAD_AIO_BACKEND_URING)
+    {
+        struct iovec* iovecs = (struct iovec*)malloc((size_t)count * sizeof(struct iovec));
+        if (!iovecs)
+            return 1;
+
+        for (int i = 0; i < count; ++i)
+        {
+            iovecs[i].iov_base = buffers[i];
+            iovecs[i].iov_len = lengths[i];
+        }
+
+        // pins the pages once instead of for every operation
+        long result = syscall(__NR_io_uring_register, aio->ring.fd, IORING_REGISTER_BUFFERS, iovecs, (unsigned int)count);
+        free(iovecs);
+
+        if (result < 0)
+            return 1;
+    }
+#endif
+
+    aio->num_buffers = count;
+
+    return 0;
+}
+
+int dthread_aio_submit(DThreadAIO* aio, DThreadAIOOp** ops, int count)
+{
+    dthread_debug("dthread_aio_submit");
+
+    assert(aio && (ops || count == 0) && "`aio` and `ops` cannot be NULL in dthread_aio_submit");
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (ops[i]->fixed && (ops[i]->buffer_index < 0 || ops[i]->buffer_index >= aio->num_buffers))
+            return 1;
+    }
+
+    dthread_atomic_fetch_add_i64(&aio->pending, count);
+
+    dthread_mutex_lock(&aio->mutex);
+
+    // queued behind the ones already waiting, the order of submission is kept
+    for (int i = 0; i < count; ++i)
+    {
+        DThreadAIOOp* op = ops[i];
+
+        op->aio = aio;
+        op->result = 0;
+        op->next = NULL;
+
+        if (aio->tail)
+            aio->tail->next = op;
+        else
+            aio->head = op;
+        aio->tail = op;
+    }
+
+    int result = 0;
+
+#ifdef DTHREAD_AIO_URING_AVAILABLE
+    if (aio->backend == DTHREAD_AIO_BACKEND_URING)
+    {
+        _dthread_aio_uring_flush(aio);
+        unsigned int pushed = _dthread_aio_uring_unsubmitted(&aio->ring);
+
+        // the entries are published already, the operations cannot be handed back
+        if (pushed && _dthread_aio_uring_enter(&aio->ring, pushed, 0, 0) < 0)
+            result = DTHREAD_AIO_QUEUED;
+    }
+    else
+#endif
+    {
+        dthread_cond_broadcast(&aio->cond);
+    }
+
+    dthread_mutex_unlock(&aio->mutex);
+
+    return result;
+}
+
+int dthread_aio_wait(DThreadAIO* aio)
+{
+    dthread_debug("dthread_aio_wait");
+
+    assert(aio && "`aio` cannot be NULL in dthread_aio_wait");
+
+    dthread_mutex_lock(&aio->mutex);
+
+    while (dthread_atomic_load_i64(&aio->pending) > 0)
+        dthread_cond_wait(&aio->idle, &aio->mutex);
+
+    dthread_mutex_unlock(&aio->mutex);
+
+    return 0;
+}
@@ -0,0 +1,263 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _bsp.c
+//    Date: 2024-08-26
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+// outboxes are laid out as [phase][src][dest]
+#define _dthread_bsp_outbox(BSP, PHASE, SRC, DEST) \
+    (&(BSP)->outboxes[((size_t)(PHASE) * (BSP)->num_workers + (SRC)) * (BSP)->num_workers + (DEST)])
+
+static void _dthread_bsp_superstep_loop(DThreadBSP* bsp, DThreadBSPContext* ctx)
+{
+    int n = bsp->num_workers;
+
+    for (size_t s = 0;; ++s)
+    {
+        int phase = (int)(s & 1);
+
+        for (int dest = 0; dest < n; ++dest)
+            _dthread_bsp_outbox(bsp, phase, ctx->worker, dest)->count = 0;
+
+        ctx->superstep = s;
+        ctx->_recv_src = 0;
+        ctx->_recv_index = 0;
+        ctx->_sent = 0;
+
+        bsp->votes[phase * n + ctx->worker] = bsp->step(ctx) != 0;
+        bsp->sent[phase * n + ctx->worker] = ctx->_sent;
+
+        dthread_barrier_wait(&bsp->barrier);
+
+        // every worker takes the same decision out of the same (double-buffered) votes
+        int go_on = 0;
+        for (int w = 0; w < n && !go_on; ++w)
+            go_on = bsp->votes[phase * n + w] || bsp->sent[phase * n + w];
+
+        if (!go_on || (bsp->max_supersteps && s + 1 >= bsp->max_supersteps))
+        {
+            if (ctx->worker == 0)
+                bsp->supersteps = s + 1;
+
+            return;
+        }
+    }
+}
+
+static dthread_define_routine(_dthread_bsp_worker)
+{
+    DThreadBSPContext* ctx = (DThreadBSPContext*)data;
+    DThreadBSP* bsp = ctx->bsp;
+    unsigned int seen = 0;
+
+    if (bsp->pin)
+        dthread_affinity_set(ctx->worker % dthread_cpu_count());
+
+    for (;;)
+    {
+        dthread_mutex_lock(&bsp->mutex);
+        while (bsp->generation == seen && !bsp->stop)
+            dthread_cond_wait(&bsp->cond, &bsp->mutex);
+
+        if (bsp->stop)
+        {
+            dthread_mutex_unlock(&bsp->mutex);
+            return NULL;
+        }
+
+        seen = bsp->generation;
+        ctx->data = bsp->data;
+        dthread_mutex_unlock(&bsp->mutex);
+
+        _dthread_bsp_superstep_loop(bsp, ctx);
+
+        dthread_mutex_lock(&bsp->mutex);
+        if (++bsp->finished == bsp->num_workers)
+            dthread_cond_broadcast(&bsp->cond);
+        dthread_mutex_unlock(&bsp->mutex);
+    }
+}
+
+int dthread_bsp_init(DThreadBSP* bsp, DThreadBSPConfig* config)
+{
+    dthread_debug("dthread_bsp_init");
+
+    assert(bsp && "`bsp` cannot be NULL in dthread_bsp_init");
+
+    memset(bsp, 0, sizeof(*bsp));
+
+    int n = (config && config->num_workers > 0) ? config->num_workers : dthread_cpu_count();
+
+    bsp->num_workers = n;
+    bsp->num_items = config ? config->num_items : 0;
+    bsp->message_size = config ? config->message_size : 0;
+    bsp->max_supersteps = config ? config->max_supersteps : 0;
+    bsp->pin = config ? config->pin : 0;
+    bsp->chunk = (bsp->num_items + (size_t)n - 1) / (size_t)n;
+    if (bsp->chunk == 0)
+        bsp->chunk = 1;
+
+    bsp->workers = (DThread*)calloc((size_t)n, sizeof(DThread));
+    bsp->contexts = (DThreadBSPContext*)calloc((size_t)n, sizeof(DThreadBSPContext));
+    bsp->outboxes = (_DThreadBSPBuffer*)calloc(2 * (size_t)n * (size_t)n, sizeof(_DThreadBSPBuffer));
+    bsp->votes = (int*)calloc(2 * (size_t)n, sizeof(int));
+    bsp->sent = (size_t*)calloc(2 * (size_t)n, sizeof(size_t));
+
+    if (!bsp->workers || !bsp->contexts || !bsp->outboxes || !bsp->votes || !bsp->sent)
+    {
+        free(bsp->workers);
+        free(bsp->contexts);
+        free(bsp->outboxes);
+        free(bsp->votes);
+        free(bsp->sent);
+        return 1;
+    }
+
+    dthread_barrier_init(&bsp->barrier, n);
+    dthread_mutex_init(&bsp->mutex, NULL);
+    dthread_cond_init(&bsp->cond, NULL);
+
+    for (int w = 0; w < n; ++w)
+    {
+        DThreadBSPContext* ctx = &bsp->contexts[w];
+
+        ctx->bsp = bsp;
+        ctx->worker = w;
+        ctx->num_workers = n;
+        ctx->begin = (size_t)w * bsp->chunk;
+        ctx->end = ctx->begin + bsp->chunk;
+        if (ctx->begin > bsp->num_items)
+            ctx->begin = bsp->num_items;
+        if (ctx->end > bsp->num_items)
+            ctx->end = bsp->num_items;
+
+        bsp->workers[w] = dthread_init_thread(_dthread_bsp_worker, ctx);
+        if (dthread_create(&bsp->workers[w], NULL) != 0)
+        {
+            // the barrier can never trip with a partial team, shut down what we have
+            bsp->num_workers = w;
+            dthread_bsp_destroy(bsp);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+int dthread_bsp_run(DThreadBSP* bsp, DThreadBSPStep step, void* data)
+{
+    dthread_debug("dthread_bsp_run");
+
+    assert(bsp && step && "`bsp` and `step` cannot be NULL in dthread_bsp_run");
+
+    size_t total = 2 * (size_t)bsp->num_workers * (size_t)bsp->num_workers;
+    for (size_t i = 0; i < total; ++i)
+        bsp->outboxes[i].count = 0;
+
+    dthread_mutex_lock(&bsp->mutex);
+
+    bsp->step = step;
+    bsp->data = data;
+    bsp->finished = 0;
+    bsp->supersteps = 0;
+    bsp->generation++;
+    dthread_cond_broadcast(&bsp->cond);
+
+    while (bsp->finished < bsp->num_workers)
+        dthread_cond_wait(&bsp->cond, &bsp->mutex);
+
+    dthread_mutex_unlock(&bsp->mutex);
+
+    return 0;
+}
+
+int dthread_bsp_send(DThreadBSPContext* ctx, int dest, const void* message)
+{
+    DThreadBSP* bsp = ctx->bsp;
+
+    if (bsp->message_size == 0 || dest < 0 || dest >= bsp->num_workers)
+        return 1;
+
+    _DThreadBSPBuffer* box = _dthread_bsp_outbox(bsp, ctx->superstep & 1, ctx->worker, dest);
+
+    if (box->count == box->capacity)
+    {
+        size_t capacity = box->capacity ? box->capacity * 2 : 64;
+        char* grown = (char*)realloc(box->data, capacity * bsp->message_size);
+        if (!grown)
+            return 1;
+
+        box->data = grown;
+        box->capacity = capacity;
+    }
+
+    memcpy(box->data + box->count * bsp->message_size, message, bsp->message_size);
+    box->count++;
+    ctx->_sent++;
+
+    return 0;
+}
+
+const void* dthread_bsp_recv(DThreadBSPContext* ctx)
+{
+    DThreadBSP* bsp = ctx->bsp;
+
+    if (ctx->superstep == 0)
+        return NULL;
+
+    int phase = (int)((ctx->superstep - 1) & 1);
+
+    while (ctx->_recv_src < bsp->num_workers)
+    {
+        _DThreadBSPBuffer* box = _dthread_bsp_outbox(bsp, phase, ctx->_recv_src, ctx->worker);
+
+        if (ctx->_recv_index < box->count)
+            return box->data + (ctx->_recv_index++) * bsp->message_size;
+
+        ctx->_recv_src++;
+        ctx->_recv_index = 0;
+    }
+
+    return NULL;
+}
+
+void dthread_bsp_destroy(DThreadBSP* bsp)
+{
+    dthread_debug("dthread_bsp_destroy");
+
+    dthread_mutex_lock(&bsp->mutex);
+    bsp->stop = 1;
+    dthread_cond_broadcast(&bsp->cond);
+    dthread_mutex_unlock(&bsp->mutex);
+
+    for (int w = 0; w < bsp->num_workers; ++w)
+        dthread_join(&bsp->workers[w]);
+
+    size_t total = 2 * (size_t)bsp->num_workers * (size_t)bsp->num_workers;
+    for (size_t i = 0; i < total; ++i)
+        free(bsp->outboxes[i].data);
+
+    dthread_cond_destroy(&bsp->cond);
+    dthread_mutex_destroy(&bsp->mutex);
+    dthread_barrier_destroy(&bsp->barrier);
+
+    free(bsp->workers);
+    free(bsp->contexts);
+    free(bsp->outboxes);
+    free(bsp->votes);
+    free(bsp->sent);
+
+    memset(bsp, 0, sizeof(*bsp));
+}
@@ -0,0 +1,203 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _clock.c
+//    Date: 2024-09-11
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#ifdef DTHREAD_CLOCK_TSC_AVAILABLE
+// CLOCK_MONOTONIC time the counter is calibrated over
+#define _DTHREAD_CLOCK_CALIBRATION_NS 100000000ull
+
+#define _DTHREAD_CLOCK_UNKNOWN 0
+#define _DTHREAD_CLOCK_PROBING 1
+#define _DTHREAD_CLOCK_MEASURING 2
+#define _DTHREAD_CLOCK_CALIBRATING 3
+#define _DTHREAD_CLOCK_TSC 4
+#define _DTHREAD_CLOCK_SYSTEM 5
+
+__extension__ typedef unsigned __int128 _dthread_clock_u128;
+
+static int32_t _dthread_clock_state = _DTHREAD_CLOCK_UNKNOWN;
+
+static uint64_t _dthread_clock_start_tsc;
+static uint64_t _dthread_clock_start_ns;
+
+// nanoseconds = base_ns + (tsc - base_tsc) * mult >> 32
+static uint64_t _dthread_clock_base_tsc;
+static uint64_t _dthread_clock_base_ns;
+static uint64_t _dthread_clock_mult;
+#endif
+
+// how late the kernel wakes a sleeping thread, the sleeps spin this long
+static int64_t _dthread_clock_slack_ns = DTHREAD_SLEEP_SPIN_NS;
+
+static uint64_t _dthread_clock_system_ns(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    static LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    if (frequency.QuadPart == 0)
+        QueryPerformanceFrequency(&frequency);
+
+    QueryPerformanceCounter(&counter);
+
+    return (uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000000ull +
+           (uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000000ull / (uint64_t)frequency.QuadPart;
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef DTHREAD_CLOCK_TSC_AVAILABLE
+
+static int _dthread_clock_tsc_trusted(void)
+{
+    char name[32] = {0};
+    FILE* file = fopen("/sys/devices/system/clocksource/clocksource0/current_clocksource", "r");
+
+    if (!file)
+        return 0;
+
+    // the kernel only picks the TSC when it is invariant and synchronized across cores
+    int trusted = fgets(name, sizeof(name), file) && strncmp(name, "tsc", 3) == 0;
+    fclose(file);
+
+    return trusted;
+}
+
+// the first calls probe and start measuring, a call after the calibration window computes the
+// rate, until then CLOCK_MONOTONIC is used
+static uint64_t _dthread_clock_calibrate(int32_t state)
+{
+    uint64_t now = _dthread_clock_system_ns();
+
+    if (state == _DTHREAD_CLOCK_UNKNOWN && dthread_atomic_cas_i32(&_dthread_clock_state, &state, _DTHREAD_CLOCK_PROBING))
+    {
+        if (!_dthread_clock_tsc_trusted())
+        {
+            dthread_atomic_store_i32(&_dthread_clock_state, _DTHREAD_CLOCK_SYSTEM);
+            return now;
+        }
+
+        _dthread_clock_start_tsc = __builtin_ia32_rdtsc();
+        _dthread_clock_start_ns = _dthread_clock_system_ns();
+        dthread_atomic_store_i32(&_dthread_clock_state, _DTHREAD_CLOCK_MEASURING);
+    }
+    else if (state == _DTHREAD_CLOCK_MEASURING && now - _dthread_clock_start_ns >= _DTHREAD_CLOCK_CALIBRATION_NS &&
+             dthread_atomic_cas_i32(&_dthread_clock_state, &state, _DTHREAD_CLOCK_CALIBRATING))
+    {
+        uint64_t tsc = __builtin_ia32_rdtsc();
+        uint64_t ns = _dthread_clock_system_ns();
+
+        _dthread_clock_mult = (uint64_t)(((_dthread_clock_u128)(ns - _dthread_clock_start_ns) << 32) / (tsc - _dthread_clock_start_tsc));
+        _dthread_clock_base_tsc = tsc;
+        _dthread_clock_base_ns = ns;
+
+        dthread_atomic_store_i32(&_dthread_clock_state, _DTHREAD_CLOCK_TSC);
+        return ns;
+    }
+
+    return now;
+}
+
+#endif
+
+uint64_t dthread_now_ns(void)
+{
+#ifdef DTHREAD_CLOCK_TSC_AVAILABLE
+    int32_t state = dthread_atomic_load_i32(&_dthread_clock_state);
+
+    if (state == _DTHREAD_CLOCK_TSC)
+    {
+        uint64_t ticks = __builtin_ia32_rdtsc() - _dthread_clock_base_tsc;
+        return _dthread_clock_base_ns + (uint64_t)(((_dthread_clock_u128)ticks * _dthread_clock_mult) >> 32);
+    }
+
+    if (state != _DTHREAD_CLOCK_SYSTEM)
+        return _dthread_clock_calibrate(state);
+#endif
+
+    return _dthread_clock_system_ns();
+}
+
+int dthread_sleep_ns(uint64_t ns)
+{
+    dthread_debug("dthread_sleep_ns");
+
+    return dthread_sleep_until(dthread_now_ns() + ns);
+}
+
+int dthread_sleep_until(uint64_t deadline_ns)
+{
+    dthread_debug("dthread_sleep_until");
+
+    uint64_t now = dthread_now_ns();
+    int64_t slack = dthread_atomic_load_i64(&_dthread_clock_slack_ns);
+    uint64_t margin = (uint64_t)(slack + slack / 4);
+
+    if (deadline_ns > now + margin)
+    {
+        uint64_t duration = deadline_ns - now - margin;
+
+#if defined(_WIN32) || defined(_WIN64)
+        // high resolution waitable timers exist since Windows 10 1803
+        HANDLE timer = CreateWaitableTimerExW(NULL, NULL, 0x00000002 /* CREATE_WAITABLE_TIMER_HIGH_RESOLUTION */, TIMER_ALL_ACCESS);
+        LARGE_INTEGER due;
+        due.QuadPart = -(LONGLONG)(duration / 100);
+
+        if (timer && SetWaitableTimer(timer, &due, 0, NULL, NULL, FALSE))
+            WaitForSingleObject(timer, INFINITE);
+        else
+            Sleep((DWORD)(duration / 1000000));
+
+        if (timer)
+            CloseHandle(timer);
+#elif defined(__APPLE__)
+        struct timespec ts = {(time_t)(duration / 1000000000ull), (long)(duration % 1000000000ull)};
+
+        while (nanosleep(&ts, &ts) != 0 && errno == EINTR)
+            ;
+#else
+        // an absolute CLOCK_MONOTONIC target, interruptions do not stretch the sleep
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+
+        uint64_t target = (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec + duration;
+        ts.tv_sec = (time_t)(target / 1000000000ull);
+        ts.tv_nsec = (long)(target % 1000000000ull);
+
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+            ;
+#endif
+
+        // follows the wakeup latency of the system, growing faster than it shrinks
+        int64_t late = (int64_t)(dthread_now_ns() - (deadline_ns - margin));
+        if (late < 1000)
+            late = 1000;
+
+        slack += late > slack ? (late - slack) / 2 : (late - slack) / 8;
+        dthread_atomic_store_i64(&_dthread_clock_slack_ns, slack > 2000000 ? 2000000 : slack);
+    }
+
+    while (dthread_now_ns() < deadline_ns)
+        dthread_atomic_pause();
+
+    return 0;
+}
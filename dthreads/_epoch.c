@@ -0,0 +1,225 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _epoch.c
+//    Date: 2024-09-18
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+// retired pointers kept by a thread before it tries to release them
+#define _DTHREAD_EPOCH_BATCH 64
+
+// records are cache line sized, the chunk must start on a line for them not to share one
+static _DThreadEpochRecord* _dthread_epoch_alloc_chunk(void)
+{
+    size_t size = _DTHREAD_EPOCH_CHUNK * sizeof(_DThreadEpochRecord);
+    void* chunk = NULL;
+
+#if (defined(_WIN32) || defined(_WIN64))
+    chunk = _aligned_malloc(size, sizeof(_DThreadEpochRecord));
+#else
+    if (posix_memalign(&chunk, sizeof(_DThreadEpochRecord), size) != 0)
+        chunk = NULL;
+#endif
+
+    if (chunk)
+        memset(chunk, 0, size);
+
+    return (_DThreadEpochRecord*)chunk;
+}
+
+static void _dthread_epoch_free_chunk(_DThreadEpochRecord* chunk)
+{
+#if (defined(_WIN32) || defined(_WIN64))
+    _aligned_free(chunk);
+#else
+    free(chunk);
+#endif
+}
+
+static _DThreadEpochRecord* _dthread_epoch_record(DThreadEpoch* domain)
+{
+    int index = dthread_index();
+
+    assert(index >= 0 && index < DTHREAD_EPOCH_MAX_THREADS && "too many threads in an epoch domain");
+
+    _DThreadEpochRecord** chunk = &domain->chunks[index / _DTHREAD_EPOCH_CHUNK];
+    _DThreadEpochRecord* records = (_DThreadEpochRecord*)dthread_atomic_load_ptr((void**)chunk);
+
+    if (!records)
+    {
+        _DThreadEpochRecord* fresh = _dthread_epoch_alloc_chunk();
+        void* expected = NULL;
+
+        assert(fresh && "out of memory in an epoch domain");
+
+        // another thread of the same chunk may have won the race
+        if (dthread_atomic_cas_ptr((void**)chunk, &expected, fresh))
+            records = fresh;
+        else
+        {
+            _dthread_epoch_free_chunk(fresh);
+            records = (_DThreadEpochRecord*)expected;
+        }
+    }
+
+    return &records[index % _DTHREAD_EPOCH_CHUNK];
+}
+
+// the epoch moves on once every thread inside the domain has seen the current one
+static void _dthread_epoch_try_advance(DThreadEpoch* domain)
+{
+    int64_t epoch = dthread_atomic_load_i64(&domain->epoch);
+
+    for (int c = 0; c < DTHREAD_EPOCH_MAX_THREADS / _DTHREAD_EPOCH_CHUNK; ++c)
+    {
+        _DThreadEpochRecord* records = (_DThreadEpochRecord*)dthread_atomic_load_ptr((void**)&domain->chunks[c]);
+
+        if (!records)
+            continue;
+
+        for (int i = 0; i < _DTHREAD_EPOCH_CHUNK; ++i)
+        {
+            int64_t active = dthread_atomic_load_i64(&records[i].active);
+
+            if (active != 0 && active != epoch)
+                return;
+        }
+    }
+
+    dthread_atomic_cas_i64(&domain->epoch, &epoch, epoch + 1);
+}
+
+static void _dthread_epoch_collect(DThreadEpoch* domain, _DThreadEpochRecord* record)
+{
+    _dthread_epoch_try_advance(domain);
+
+    int64_t safe = dthread_atomic_load_i64(&domain->epoch) - 2;
+    int kept = 0;
+
+    for (int i = 0; i < record->num_retired; ++i)
+    {
+        _DThreadEpochRetired* retired = &record->retired[i];
+
+        if (retired->epoch <= safe)
+            retired->reclaim(retired->ptr);
+        else
+            record->retired[kept++] = *retired;
+    }
+
+    record->num_retired = kept;
+}
+
+int dthread_epoch_init(DThreadEpoch* domain)
+{
+    dthread_debug("dthread_epoch_init");
+
+    assert(domain && "`domain` cannot be NULL in dthread_epoch_init");
+
+    memset(domain, 0, sizeof(*domain));
+
+    // 0 marks the threads outside of the domain
+    domain->epoch = 1;
+
+    return 0;
+}
+
+void dthread_epoch_destroy(DThreadEpoch* domain)
+{
+    dthread_debug("dthread_epoch_destroy");
+
+    assert(domain && "`domain` cannot be NULL in dthread_epoch_destroy");
+
+    for (int c = 0; c < DTHREAD_EPOCH_MAX_THREADS / _DTHREAD_EPOCH_CHUNK; ++c)
+    {
+        _DThreadEpochRecord* records = domain->chunks[c];
+
+        if (!records)
+            continue;
+
+        for (int i = 0; i < _DTHREAD_EPOCH_CHUNK; ++i)
+        {
+            for (int r = 0; r < records[i].num_retired; ++r)
+                records[i].retired[r].reclaim(records[i].retired[r].ptr);
+
+            free(records[i].retired);
+        }
+
+        _dthread_epoch_free_chunk(records);
+        domain->chunks[c] = NULL;
+    }
+}
+
+void dthread_epoch_enter(DThreadEpoch* domain)
+{
+    assert(domain && "`domain` cannot be NULL in dthread_epoch_enter");
+
+    _DThreadEpochRecord* record = _dthread_epoch_record(domain);
+
+    if (record->depth++ > 0)
+        return;
+
+    // the announcement must be visible before any shared pointer is read
+    dthread_atomic_store_i64(&record->active, dthread_atomic_load_i64(&domain->epoch));
+    dthread_atomic_fence();
+}
+
+void dthread_epoch_exit(DThreadEpoch* domain)
+{
+    assert(domain && "`domain` cannot be NULL in dthread_epoch_exit");
+
+    _DThreadEpochRecord* record = _dthread_epoch_record(domain);
+
+    assert(record->depth > 0 && "dthread_epoch_exit without dthread_epoch_enter");
+
+    if (--record->depth == 0)
+        dthread_atomic_store_i64(&record->active, 0);
+}
+
+void dthread_epoch_retire(DThreadEpoch* domain, void* ptr, DThreadReclaimFunc reclaim)
+{
+    dthread_debug("dthread_epoch_retire");
+
+    assert(domain && "`domain` cannot be NULL in dthread_epoch_retire");
+    assert(reclaim && "`reclaim` cannot be NULL in dthread_epoch_retire");
+
+    _DThreadEpochRecord* record = _dthread_epoch_record(domain);
+
+    if (record->num_retired == record->cap_retired)
+    {
+        int cap = record->cap_retired ? record->cap_retired * 2 : _DTHREAD_EPOCH_BATCH;
+        _DThreadEpochRetired* retired = (_DThreadEpochRetired*)realloc(record->retired, (size_t)cap * sizeof(_DThreadEpochRetired));
+
+        if (!retired)
+        {
+            _dthread_epoch_collect(domain, record);
+
+            assert(record->num_retired < record->cap_retired && "out of memory in dthread_epoch_retire");
+        }
+        else
+        {
+            record->retired = retired;
+            record->cap_retired = cap;
+        }
+    }
+
+    dthread_atomic_fence();
+
+    record->retired[record->num_retired].ptr = ptr;
+    record->retired[record->num_retired].reclaim = reclaim;
+    record->retired[record->num_retired].epoch = dthread_atomic_load_i64(&domain->epoch);
+    record->num_retired++;
+
+    if (record->num_retired % _DTHREAD_EPOCH_BATCH == 0)
+        _dthread_epoch_collect(domain, record);
+}
@@ -0,0 +1,1047 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _fiber.c
+//    Date: 2024-09-07
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#define _DTHREAD_FIBER_STACK_SIZE (64 * 1024)
+#define _DTHREAD_FIBER_MAX_CACHED 1024
+#define _DTHREAD_FIBER_SPINS 64
+
+#define _DTHREAD_FIBER_READY 0
+#define _DTHREAD_FIBER_BLOCKED 1
+#define _DTHREAD_FIBER_DONE 2
+
+#if defined(_MSC_VER)
+#define _DTHREAD_FIBER_NOINLINE __declspec(noinline)
+#else
+#define _DTHREAD_FIBER_NOINLINE __attribute__((noinline))
+#endif
+
+static DTHREAD_THREAD_LOCAL _DThreadFiberCarrier* _dthread_fiber_carrier = NULL;
+
+// a fiber may resume on another carrier, the compiler must not keep the address of the
+// thread-local variable across a switch
+static _DTHREAD_FIBER_NOINLINE _DThreadFiberCarrier* _dthread_fiber_self(void)
+{
+    return _dthread_fiber_carrier;
+}
+
+static void _dthread_fiber_spin_lock(int32_t* lock)
+{
+    while (dthread_atomic_exchange_i32(lock, 1))
+    {
+        while (dthread_atomic_load_relaxed_i32(lock))
+            dthread_atomic_pause();
+    }
+}
+
+static void _dthread_fiber_spin_unlock(int32_t* lock)
+{
+    dthread_atomic_store_i32(lock, 0);
+}
+
+/*
+ * Context switch
+ */
+
+#if defined(_DTHREAD_FIBER_ASM)
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+    void _dthread_fiber_main(_DThreadFiber* fiber);
+    void _dthread_fiber_switch_asm(void** from_sp, void* to_sp);
+    void _dthread_fiber_start_asm(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#if defined(__APPLE__)
+#define _DTHREAD_FIBER_SYM(NAME) "_" #NAME
+#define _DTHREAD_FIBER_CALL(NAME) "_" #NAME
+#else
+#define _DTHREAD_FIBER_SYM(NAME) #NAME
+#define _DTHREAD_FIBER_CALL(NAME) #NAME "@PLT"
+#endif
+
+#if defined(__x86_64__)
+
+// saves the callee-saved registers, MXCSR and the x87 control word on the current stack
+__asm__(".text\n"
+        ".globl " _DTHREAD_FIBER_SYM(_dthread_fiber_switch_asm) "\n"
+        _DTHREAD_FIBER_SYM(_dthread_fiber_switch_asm) ":\n"
+        "    pushq %rbp\n"
+        "    pushq %rbx\n"
+        "    pushq %r12\n"
+        "    pushq %r13\n"
+        "    pushq %r14\n"
+        "    pushq %r15\n"
+        "    subq $8, %rsp\n"
+        "    stmxcsr (%rsp)\n"
+        "    fnstcw 4(%rsp)\n"
+        "    movq %rsp, (%rdi)\n"
+        "    movq %rsi, %rsp\n"
+        "    ldmxcsr (%rsp)\n"
+        "    fldcw 4(%rsp)\n"
+        "    addq $8, %rsp\n"
+        "    popq %r15\n"
+        "    popq %r14\n"
+        "    popq %r13\n"
+        "    popq %r12\n"
+        "    popq %rbx\n"
+        "    popq %rbp\n"
+        "    ret\n"
+        ".globl " _DTHREAD_FIBER_SYM(_dthread_fiber_start_asm) "\n"
+        _DTHREAD_FIBER_SYM(_dthread_fiber_start_asm) ":\n"
+        "    movq %rbx, %rdi\n"
+        "    call " _DTHREAD_FIBER_CALL(_dthread_fiber_main) "\n"
+        "    ud2\n");
+
+static void _dthread_fiber_prepare(_DThreadFiber* fiber, char* base, size_t size)
+{
+    uintptr_t top = ((uintptr_t)base + size) & ~(uintptr_t)15;
+
+    // [csr] r15 r14 r13 r12 rbx rbp [return address], the return lands 16 bytes aligned
+    uint64_t* frame = (uint64_t*)(top - 80);
+    memset(frame, 0, 80);
+
+    frame[0] = 0x1F80ull | (0x037Full << 32);
+    frame[5] = (uint64_t)(uintptr_t)fiber;
+    frame[7] = (uint64_t)(uintptr_t)_dthread_fiber_start_asm;
+
+    fiber->ctx.sp = frame;
+}
+
+#else
+
+// saves x19-x30 and d8-d15 on the current stack
+__asm__(".text\n"
+        ".globl " _DTHREAD_FIBER_SYM(_dthread_fiber_switch_asm) "\n"
+        _DTHREAD_FIBER_SYM(_dthread_fiber_switch_asm) ":\n"
+        "    sub sp, sp, #176\n"
+        "    stp x19, x20, [sp, #0]\n"
+        "    stp x21, x22, [sp, #16]\n"
+        "    stp x23, x24, [sp, #32]\n"
+        "    stp x25, x26, [sp, #48]\n"
+        "    stp x27, x28, [sp, #64]\n"
+        "    stp x29, x30, [sp, #80]\n"
+        "    stp d8, d9, [sp, #96]\n"
+        "    stp d10, d11, [sp, #112]\n"
+        "    stp d12, d13, [sp, #128]\n"
+        "    stp d14, d15, [sp, #144]\n"
+        "    mov x2, sp\n"
+        "    str x2, [x0]\n"
+        "    mov sp, x1\n"
+        "    ldp x19, x20, [sp, #0]\n"
+        "    ldp x21, x22, [sp, #16]\n"
+        "    ldp x23, x24, [sp, #32]\n"
+        "    ldp x25, x26, [sp, #48]\n"
+        "    ldp x27, x28, [sp, #64]\n"
+        "    ldp x29, x30, [sp, #80]\n"
+        "    ldp d8, d9, [sp, #96]\n"
+        "    ldp d10, d11, [sp, #112]\n"
+        "    ldp d12, d13, [sp, #128]\n"
+        "    ldp d14, d15, [sp, #144]\n"
+        "    add sp, sp, #176\n"
+        "    ret\n"
+        ".globl " _DTHREAD_FIBER_SYM(_dthread_fiber_start_asm) "\n"
+        _DTHREAD_FIBER_SYM(_dthread_fiber_start_asm) ":\n"
+        "    mov x0, x19\n"
+        "    bl " _DTHREAD_FIBER_SYM(_dthread_fiber_main) "\n"
+        "    brk #0\n");
+
+static void _dthread_fiber_prepare(_DThreadFiber* fiber, char* base, size_t size)
+{
+    uintptr_t top = ((uintptr_t)base + size) & ~(uintptr_t)15;
+
+    // x19 holds the fiber and x30 (the link register) the entry point
+    uint64_t* frame = (uint64_t*)(top - 176);
+    memset(frame, 0, 176);
+
+    frame[0] = (uint64_t)(uintptr_t)fiber;
+    frame[11] = (uint64_t)(uintptr_t)_dthread_fiber_start_asm;
+
+    fiber->ctx.sp = frame;
+}
+
+#endif
+
+#define _dthread_fiber_switch(FROM, TO) _dthread_fiber_switch_asm(&(FROM)->sp, (TO)->sp)
+
+#elif defined(_DTHREAD_FIBER_WINDOWS)
+
+static void _dthread_fiber_main(_DThreadFiber* fiber);
+
+static VOID CALLBACK _dthread_fiber_start_windows(LPVOID data)
+{
+    _dthread_fiber_main((_DThreadFiber*)data);
+}
+
+#define _dthread_fiber_switch(FROM, TO) ((void)(FROM), SwitchToFiber((TO)->handle))
+
+#else
+
+static void _dthread_fiber_main(_DThreadFiber* fiber);
+
+// makecontext only passes int arguments
+static void _dthread_fiber_start_ucontext(unsigned int high, unsigned int low)
+{
+    _dthread_fiber_main((_DThreadFiber*)(uintptr_t)(((uint64_t)high << 32) | (uint64_t)low));
+}
+
+static void _dthread_fiber_prepare(_DThreadFiber* fiber, char* base, size_t size)
+{
+    uint64_t address = (uint64_t)(uintptr_t)fiber;
+
+    getcontext(&fiber->ctx.uc);
+    fiber->ctx.uc.uc_stack.ss_sp = base;
+    fiber->ctx.uc.uc_stack.ss_size = size;
+    fiber->ctx.uc.uc_link = NULL;
+
+    makecontext(&fiber->ctx.uc, (void (*)(void))_dthread_fiber_start_ucontext, 2, (unsigned int)(address >> 32),
+                (unsigned int)address);
+}
+
+#define _dthread_fiber_switch(FROM, TO) swapcontext(&(FROM)->uc, &(TO)->uc)
+
+#endif
+
+/*
+ * Stacks
+ */
+
+static size_t _dthread_fiber_page_size(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (size_t)info.dwPageSize;
+#else
+    long size = sysconf(_SC_PAGESIZE);
+    return size > 0 ? (size_t)size : 4096;
+#endif
+}
+
+static _DThreadFiber* _dthread_fiber_alloc(DThreadFiberScheduler* sched)
+{
+    _dthread_fiber_spin_lock(&sched->cache_lock);
+
+    _DThreadFiber* fiber = sched->cache;
+    if (fiber)
+    {
+        sched->cache = fiber->next;
+        sched->num_cached--;
+    }
+
+    _dthread_fiber_spin_unlock(&sched->cache_lock);
+
+    if (fiber)
+        return fiber;
+
+#if defined(_DTHREAD_FIBER_WINDOWS)
+    fiber = (_DThreadFiber*)calloc(1, sizeof(_DThreadFiber));
+    if (!fiber)
+        return NULL;
+
+    // the stack is reserved by the system and committed as it grows
+    fiber->ctx.handle = CreateFiberEx(0, sched->config.stack_size, 0, _dthread_fiber_start_windows, fiber);
+    if (!fiber->ctx.handle)
+    {
+        free(fiber);
+        return NULL;
+    }
+#else
+    size_t guard = sched->config.unguarded ? 0 : sched->page_size;
+    size_t size = sched->config.stack_size + guard;
+
+    char* stack = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (stack == MAP_FAILED)
+        return NULL;
+
+    // stacks grow down, an overflow hits the guard page instead of the neighbour
+    if (guard && mprotect(stack, guard, PROT_NONE) != 0)
+    {
+        munmap(stack, size);
+        return NULL;
+    }
+
+    fiber = (_DThreadFiber*)(((uintptr_t)stack + size - sizeof(_DThreadFiber)) & ~(uintptr_t)63);
+    fiber->stack = stack;
+    fiber->stack_size = size;
+#endif
+
+    return fiber;
+}
+
+static void _dthread_fiber_release(DThreadFiberScheduler* sched, _DThreadFiber* fiber)
+{
+    _dthread_fiber_spin_lock(&sched->cache_lock);
+
+    if (sched->num_cached < sched->config.max_cached)
+    {
+        fiber->next = sched->cache;
+        sched->cache = fiber;
+        sched->num_cached++;
+        fiber = NULL;
+    }
+
+    _dthread_fiber_spin_unlock(&sched->cache_lock);
+
+    if (!fiber)
+        return;
+
+#if defined(_DTHREAD_FIBER_WINDOWS)
+    DeleteFiber(fiber->ctx.handle);
+    free(fiber);
+#else
+    munmap(fiber->stack, fiber->stack_size);
+#endif
+}
+
+static void _dthread_fiber_setup(_DThreadFiber* fiber)
+{
+#if !defined(_DTHREAD_FIBER_WINDOWS)
+    size_t guard = fiber->sched->config.unguarded ? 0 : fiber->sched->page_size;
+
+    // the usable stack ends where the fiber itself starts
+    _dthread_fiber_prepare(fiber, (char*)fiber->stack + guard, (size_t)((char*)fiber - (char*)fiber->stack) - guard);
+#else
+    (void)fiber;
+#endif
+}
+
+/*
+ * Scheduling
+ */
+
+static void _dthread_fiber_push(_DThreadFiberCarrier* carrier, _DThreadFiber* fiber)
+{
+    fiber->next = NULL;
+
+    _dthread_fiber_spin_lock(&carrier->lock);
+
+    if (carrier->tail)
+        carrier->tail->next = fiber;
+    else
+        carrier->head = fiber;
+    carrier->tail = fiber;
+
+    dthread_atomic_fetch_add_i64(&carrier->count, 1);
+
+    _dthread_fiber_spin_unlock(&carrier->lock);
+}
+
+static _DThreadFiber* _dthread_fiber_pop(_DThreadFiberCarrier* carrier)
+{
+    if (dthread_atomic_load_relaxed_i64(&carrier->count) == 0)
+        return NULL;
+
+    _dthread_fiber_spin_lock(&carrier->lock);
+
+    _DThreadFiber* fiber = carrier->head;
+    if (fiber)
+    {
+        carrier->head = fiber->next;
+        if (!carrier->head)
+            carrier->tail = NULL;
+
+        dthread_atomic_fetch_add_i64(&carrier->count, -1);
+    }
+
+    _dthread_fiber_spin_unlock(&carrier->lock);
+
+    return fiber;
+}
+
+static int _dthread_fiber_has_work(DThreadFiberScheduler* sched)
+{
+    for (int i = 0; i < sched->num_carriers; ++i)
+    {
+        if (dthread_atomic_load_i64(&sched->carriers[i].count) > 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+// queues a runnable fiber on the carrier of the caller (round robin from other threads)
+static void _dthread_fiber_ready(DThreadFiberScheduler* sched, _DThreadFiber* fiber)
+{
+    _DThreadFiberCarrier* carrier = _dthread_fiber_self();
+
+    if (!carrier || carrier->sched != sched)
+    {
+        int64_t next = dthread_atomic_fetch_add_i64(&sched->next_carrier, 1);
+        carrier = &sched->carriers[next % sched->num_carriers];
+    }
+
+    _dthread_fiber_push(carrier, fiber);
+
+    // pairs with the fence in `_dthread_fiber_idle`, either we see the sleeper or it sees the fiber
+    dthread_atomic_fence();
+
+    if (dthread_atomic_load_i64(&sched->sleepers) == 0)
+        return;
+
+    dthread_mutex_lock(&sched->mutex);
+    dthread_cond_signal(&sched->cond);
+    dthread_mutex_unlock(&sched->mutex);
+}
+
+static _DThreadFiber* _dthread_fiber_next(_DThreadFiberCarrier* carrier)
+{
+    DThreadFiberScheduler* sched = carrier->sched;
+
+    _DThreadFiber* fiber = _dthread_fiber_pop(carrier);
+
+    for (int i = 1; !fiber && i < sched->num_carriers; ++i)
+        fiber = _dthread_fiber_pop(&sched->carriers[(carrier->index + i) % sched->num_carriers]);
+
+    return fiber;
+}
+
+// returns non-zero when the carrier must exit
+static int _dthread_fiber_idle(DThreadFiberScheduler* sched)
+{
+    int exit;
+
+    dthread_mutex_lock(&sched->mutex);
+
+    dthread_atomic_fetch_add_i64(&sched->sleepers, 1);
+    dthread_atomic_fence();
+
+    exit = sched->stop;
+    if (!exit && !_dthread_fiber_has_work(sched))
+        dthread_cond_wait(&sched->cond, &sched->mutex);
+
+    dthread_atomic_fetch_add_i64(&sched->sleepers, -1);
+
+    exit = sched->stop && !_dthread_fiber_has_work(sched);
+
+    dthread_mutex_unlock(&sched->mutex);
+
+    return exit;
+}
+
+static void _dthread_fiber_finish(DThreadFiberScheduler* sched, _DThreadFiber* fiber)
+{
+    _dthread_fiber_release(sched, fiber);
+
+    if (dthread_atomic_fetch_add_i64(&sched->pending, -1) == 1)
+    {
+        dthread_mutex_lock(&sched->mutex);
+        dthread_cond_broadcast(&sched->idle);
+        dthread_mutex_unlock(&sched->mutex);
+    }
+}
+
+static dthread_define_routine(_dthread_fiber_carrier_main)
+{
+    _DThreadFiberCarrier* carrier = (_DThreadFiberCarrier*)data;
+    DThreadFiberScheduler* sched = carrier->sched;
+
+    _dthread_fiber_carrier = carrier;
+
+#if defined(_DTHREAD_FIBER_WINDOWS)
+    carrier->ctx.handle = ConvertThreadToFiber(NULL);
+    if (!carrier->ctx.handle)
+        return (void*)1;
+#endif
+
+    for (;;)
+    {
+        _DThreadFiber* fiber = NULL;
+
+        for (int spin = 0; !fiber && spin < _DTHREAD_FIBER_SPINS; ++spin)
+        {
+            fiber = _dthread_fiber_next(carrier);
+            if (!fiber)
+                dthread_atomic_pause();
+        }
+
+        if (!fiber)
+        {
+            if (_dthread_fiber_idle(sched))
+                break;
+
+            continue;
+        }
+
+        carrier->current = fiber;
+        _dthread_fiber_switch(&carrier->ctx, &fiber->ctx);
+        carrier->current = NULL;
+
+        // the fiber is switched out, only now others may touch it
+        if (fiber->state == _DTHREAD_FIBER_READY)
+        {
+            _dthread_fiber_push(carrier, fiber);
+        }
+        else if (fiber->state == _DTHREAD_FIBER_BLOCKED)
+        {
+            _dthread_fiber_spin_unlock(carrier->release);
+            carrier->release = NULL;
+        }
+        else
+        {
+            _dthread_fiber_finish(sched, fiber);
+        }
+    }
+
+#if defined(_DTHREAD_FIBER_WINDOWS)
+    ConvertFiberToThread();
+#endif
+
+    _dthread_fiber_carrier = NULL;
+
+    return NULL;
+}
+
+#if defined(_DTHREAD_FIBER_ASM)
+void _dthread_fiber_main(_DThreadFiber* fiber)
+#else
+static void _dthread_fiber_main(_DThreadFiber* fiber)
+#endif
+{
+    // the same fiber object runs again when its stack is reused from the cache
+    for (;;)
+    {
+        fiber->func(fiber->data);
+
+        _DThreadFiberCarrier* carrier = _dthread_fiber_self();
+
+        fiber->state = _DTHREAD_FIBER_DONE;
+        _dthread_fiber_switch(&fiber->ctx, &carrier->ctx);
+
+#if !defined(_DTHREAD_FIBER_WINDOWS)
+        // stacks are prepared again before reuse, this point is never reached
+        break;
+#endif
+    }
+}
+
+// suspends the current fiber, `lock` is released by the carrier once the fiber is switched out
+static void _dthread_fiber_block(int32_t* lock)
+{
+    _DThreadFiberCarrier* carrier = _dthread_fiber_self();
+    _DThreadFiber* fiber = carrier->current;
+
+    fiber->state = _DTHREAD_FIBER_BLOCKED;
+    carrier->release = lock;
+
+    _dthread_fiber_switch(&fiber->ctx, &carrier->ctx);
+}
+
+static _DThreadFiber* _dthread_fiber_current(void)
+{
+    _DThreadFiberCarrier* carrier = _dthread_fiber_self();
+    return carrier ? carrier->current : NULL;
+}
+
+static void _dthread_fiber_enqueue(_DThreadFiber** head, _DThreadFiber** tail, _DThreadFiber* fiber)
+{
+    fiber->next = NULL;
+
+    if (*tail)
+        (*tail)->next = fiber;
+    else
+        *head = fiber;
+    *tail = fiber;
+}
+
+static _DThreadFiber* _dthread_fiber_dequeue(_DThreadFiber** head, _DThreadFiber** tail)
+{
+    _DThreadFiber* fiber = *head;
+
+    if (fiber)
+    {
+        *head = fiber->next;
+        if (!*head)
+            *tail = NULL;
+    }
+
+    return fiber;
+}
+
+/*
+ * Scheduler
+ */
+
+int dthread_fiber_scheduler_init(DThreadFiberScheduler* sched, DThreadFiberConfig* config)
+{
+    dthread_debug("dthread_fiber_scheduler_init");
+
+    assert(sched && "`sched` cannot be NULL in dthread_fiber_scheduler_init");
+
+    memset(sched, 0, sizeof(*sched));
+
+    DThreadFiberConfig cfg = config ? *config : (DThreadFiberConfig){0};
+
+    if (cfg.num_carriers <= 0)
+        cfg.num_carriers = dthread_cpu_count();
+    if (cfg.stack_size == 0)
+        cfg.stack_size = _DTHREAD_FIBER_STACK_SIZE;
+    if (cfg.max_cached == 0)
+        cfg.max_cached = _DTHREAD_FIBER_MAX_CACHED;
+    else if (cfg.max_cached < 0)
+        cfg.max_cached = 0;
+
+    sched->page_size = _dthread_fiber_page_size();
+    cfg.stack_size = (cfg.stack_size + sched->page_size - 1) & ~(sched->page_size - 1);
+
+    sched->config = cfg;
+
+    sched->carriers = (_DThreadFiberCarrier*)calloc((size_t)cfg.num_carriers, sizeof(_DThreadFiberCarrier));
+    if (!sched->carriers)
+        return 1;
+
+    dthread_mutex_init(&sched->mutex, NULL);
+    dthread_cond_init(&sched->cond, NULL);
+    dthread_cond_init(&sched->idle, NULL);
+
+    // the slots are complete before the first carrier starts, running carriers scan all of them
+    // and the queues of slots that never start stay empty
+    for (int i = 0; i < cfg.num_carriers; ++i)
+    {
+        _DThreadFiberCarrier* carrier = &sched->carriers[i];
+
+        carrier->sched = sched;
+        carrier->index = i;
+        carrier->thread = dthread_init_thread(_dthread_fiber_carrier_main, carrier);
+    }
+
+    sched->num_carriers = cfg.num_carriers;
+
+    for (int i = 0; i < cfg.num_carriers; ++i)
+    {
+        if (dthread_create(&sched->carriers[i].thread, NULL) != 0)
+        {
+            dthread_fiber_scheduler_destroy(sched);
+            return 1;
+        }
+
+        sched->num_started = i + 1;
+    }
+
+    return 0;
+}
+
+int dthread_fiber_scheduler_wait(DThreadFiberScheduler* sched)
+{
+    dthread_debug("dthread_fiber_scheduler_wait");
+
+    assert(sched && "`sched` cannot be NULL in dthread_fiber_scheduler_wait");
+
+    dthread_mutex_lock(&sched->mutex);
+
+    while (dthread_atomic_load_i64(&sched->pending) > 0)
+        dthread_cond_wait(&sched->idle, &sched->mutex);
+
+    dthread_mutex_unlock(&sched->mutex);
+
+    return 0;
+}
+
+int dthread_fiber_scheduler_destroy(DThreadFiberScheduler* sched)
+{
+    dthread_debug("dthread_fiber_scheduler_destroy");
+
+    assert(sched && "`sched` cannot be NULL in dthread_fiber_scheduler_destroy");
+
+    dthread_fiber_scheduler_wait(sched);
+
+    dthread_mutex_lock(&sched->mutex);
+    sched->stop = 1;
+    dthread_cond_broadcast(&sched->cond);
+    dthread_mutex_unlock(&sched->mutex);
+
+    int result = 0;
+
+    for (int i = 0; i < sched->num_started; ++i)
+    {
+        if (dthread_join(&sched->carriers[i].thread) != 0)
+            result = 1;
+    }
+
+    // nothing runs anymore, the cache can be emptied for good
+    sched->config.max_cached = 0;
+
+    while (sched->cache)
+    {
+        _DThreadFiber* fiber = sched->cache;
+        sched->cache = fiber->next;
+        sched->num_cached--;
+
+        _dthread_fiber_release(sched, fiber);
+    }
+
+    free(sched->carriers);
+    sched->carriers = NULL;
+    sched->num_carriers = 0;
+    sched->num_started = 0;
+
+    dthread_cond_destroy(&sched->idle);
+    dthread_cond_destroy(&sched->cond);
+    dthread_mutex_destroy(&sched->mutex);
+
+    return result;
+}
+
+int dthread_fiber_spawn(DThreadFiberScheduler* sched, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_fiber_spawn");
+
+    assert(sched && func && "`sched` and `func` cannot be NULL in dthread_fiber_spawn");
+
+    _DThreadFiber* fiber = _dthread_fiber_alloc(sched);
+    if (!fiber)
+        return 1;
+
+    fiber->func = func;
+    fiber->data = data;
+    fiber->sched = sched;
+    fiber->state = _DTHREAD_FIBER_READY;
+    _dthread_fiber_setup(fiber);
+
+    dthread_atomic_fetch_add_i64(&sched->pending, 1);
+
+    _dthread_fiber_ready(sched, fiber);
+
+    return 0;
+}
+
+void dthread_fiber_yield(void)
+{
+    dthread_debug("dthread_fiber_yield");
+
+    _DThreadFiberCarrier* carrier = _dthread_fiber_self();
+
+    if (!carrier || !carrier->current)
+    {
+#if defined(_WIN32) || defined(_WIN64)
+        SwitchToThread();
+#else
+        sched_yield();
+#endif
+        return;
+    }
+
+    _DThreadFiber* fiber = carrier->current;
+
+    fiber->state = _DTHREAD_FIBER_READY;
+    _dthread_fiber_switch(&fiber->ctx, &carrier->ctx);
+}
+
+int dthread_fiber_active(void)
+{
+    dthread_debug("dthread_fiber_active");
+
+    return _dthread_fiber_current() != NULL;
+}
+
+/*
+ * Mutex
+ */
+
+int dthread_fiber_mutex_init(DThreadFiberMutex* mutex)
+{
+    dthread_debug("dthread_fiber_mutex_init");
+
+    assert(mutex && "`mutex` cannot be NULL in dthread_fiber_mutex_init");
+
+    memset(mutex, 0, sizeof(*mutex));
+
+    return 0;
+}
+
+int dthread_fiber_mutex_lock(DThreadFiberMutex* mutex)
+{
+    dthread_debug("dthread_fiber_mutex_lock");
+
+    assert(mutex && "`mutex` cannot be NULL in dthread_fiber_mutex_lock");
+
+    _DThreadFiber* self = _dthread_fiber_current();
+    assert(self && "dthread_fiber_mutex_lock must be called from a fiber");
+
+    _dthread_fiber_spin_lock(&mutex->lock);
+
+    if (!mutex->locked)
+    {
+        mutex->locked = 1;
+        _dthread_fiber_spin_unlock(&mutex->lock);
+        return 0;
+    }
+
+    // the unlocking fiber hands the mutex over, nothing to retry once woken
+    _dthread_fiber_enqueue(&mutex->head, &mutex->tail, self);
+    _dthread_fiber_block(&mutex->lock);
+
+    return 0;
+}
+
+int dthread_fiber_mutex_unlock(DThreadFiberMutex* mutex)
+{
+    dthread_debug("dthread_fiber_mutex_unlock");
+
+    assert(mutex && "`mutex` cannot be NULL in dthread_fiber_mutex_unlock");
+
+    _dthread_fiber_spin_lock(&mutex->lock);
+
+    _DThreadFiber* next = _dthread_fiber_dequeue(&mutex->head, &mutex->tail);
+    if (!next)
+        mutex->locked = 0;
+
+    _dthread_fiber_spin_unlock(&mutex->lock);
+
+    if (next)
+        _dthread_fiber_ready(next->sched, next);
+
+    return 0;
+}
+
+int dthread_fiber_mutex_destroy(DThreadFiberMutex* mutex)
+{
+    dthread_debug("dthread_fiber_mutex_destroy");
+
+    assert(mutex && "`mutex` cannot be NULL in dthread_fiber_mutex_destroy");
+
+    return mutex->head ? 1 : 0;
+}
+
+/*
+ * Condition variable
+ */
+
+int dthread_fiber_cond_init(DThreadFiberCond* cond)
+{
+    dthread_debug("dthread_fiber_cond_init");
+
+    assert(cond && "`cond` cannot be NULL in dthread_fiber_cond_init");
+
+    memset(cond, 0, sizeof(*cond));
+
+    return 0;
+}
+
+int dthread_fiber_cond_wait(DThreadFiberCond* cond, DThreadFiberMutex* mutex)
+{
+    dthread_debug("dthread_fiber_cond_wait");
+
+    assert(cond && mutex && "`cond` and `mutex` cannot be NULL in dthread_fiber_cond_wait");
+
+    _DThreadFiber* self = _dthread_fiber_current();
+    assert(self && "dthread_fiber_cond_wait must be called from a fiber");
+
+    _dthread_fiber_spin_lock(&cond->lock);
+    _dthread_fiber_enqueue(&cond->head, &cond->tail, self);
+
+    // queued before the mutex is released, a signal in between can not be lost
+    dthread_fiber_mutex_unlock(mutex);
+    _dthread_fiber_block(&cond->lock);
+
+    return dthread_fiber_mutex_lock(mutex);
+}
+
+int dthread_fiber_cond_signal(DThreadFiberCond* cond)
+{
+    dthread_debug("dthread_fiber_cond_signal");
+
+    assert(cond && "`cond` cannot be NULL in dthread_fiber_cond_signal");
+
+    _dthread_fiber_spin_lock(&cond->lock);
+    _DThreadFiber* next = _dthread_fiber_dequeue(&cond->head, &cond->tail);
+    _dthread_fiber_spin_unlock(&cond->lock);
+
+    if (next)
+        _dthread_fiber_ready(next->sched, next);
+
+    return 0;
+}
+
+int dthread_fiber_cond_broadcast(DThreadFiberCond* cond)
+{
+    dthread_debug("dthread_fiber_cond_broadcast");
+
+    assert(cond && "`cond` cannot be NULL in dthread_fiber_cond_broadcast");
+
+    _dthread_fiber_spin_lock(&cond->lock);
+    _DThreadFiber* waiters = cond->head;
+    cond->head = cond->tail = NULL;
+    _dthread_fiber_spin_unlock(&cond->lock);
+
+    while (waiters)
+    {
+        _DThreadFiber* next = waiters->next;
+        _dthread_fiber_ready(waiters->sched, waiters);
+        waiters = next;
+    }
+
+    return 0;
+}
+
+int dthread_fiber_cond_destroy(DThreadFiberCond* cond)
+{
+    dthread_debug("dthread_fiber_cond_destroy");
+
+    assert(cond && "`cond` cannot be NULL in dthread_fiber_cond_destroy");
+
+    return cond->head ? 1 : 0;
+}
+
+/*
+ * Channel
+ */
+
+int dthread_fiber_channel_init(DThreadFiberChannel* chan, size_t capacity)
+{
+    dthread_debug("dthread_fiber_channel_init");
+
+    assert(chan && "`chan` cannot be NULL in dthread_fiber_channel_init");
+
+    memset(chan, 0, sizeof(*chan));
+
+    chan->capacity = capacity ? capacity : 1;
+    chan->items = (void**)malloc(chan->capacity * sizeof(void*));
+
+    return chan->items ? 0 : 1;
+}
+
+int dthread_fiber_channel_send(DThreadFiberChannel* chan, void* item)
+{
+    dthread_debug("dthread_fiber_channel_send");
+
+    assert(chan && "`chan` cannot be NULL in dthread_fiber_channel_send");
+
+    _DThreadFiber* self = _dthread_fiber_current();
+    assert(self && "dthread_fiber_channel_send must be called from a fiber");
+
+    _dthread_fiber_spin_lock(&chan->lock);
+
+    while (chan->count == chan->capacity && !chan->closed)
+    {
+        _dthread_fiber_enqueue(&chan->senders_head, &chan->senders_tail, self);
+        _dthread_fiber_block(&chan->lock);
+        _dthread_fiber_spin_lock(&chan->lock);
+    }
+
+    if (chan->closed)
+    {
+        _dthread_fiber_spin_unlock(&chan->lock);
+        return 1;
+    }
+
+    chan->items[(chan->first + chan->count) % chan->capacity] = item;
+    chan->count++;
+
+    _DThreadFiber* receiver = _dthread_fiber_dequeue(&chan->receivers_head, &chan->receivers_tail);
+
+    _dthread_fiber_spin_unlock(&chan->lock);
+
+    if (receiver)
+        _dthread_fiber_ready(receiver->sched, receiver);
+
+    return 0;
+}
+
+int dthread_fiber_channel_recv(DThreadFiberChannel* chan, void** item)
+{
+    dthread_debug("dthread_fiber_channel_recv");
+
+    assert(chan && item && "`chan` and `item` cannot be NULL in dthread_fiber_channel_recv");
+
+    _DThreadFiber* self = _dthread_fiber_current();
+    assert(self && "dthread_fiber_channel_recv must be called from a fiber");
+
+    _dthread_fiber_spin_lock(&chan->lock);
+
+    while (chan->count == 0 && !chan->closed)
+    {
+        _dthread_fiber_enqueue(&chan->receivers_head, &chan->receivers_tail, self);
+        _dthread_fiber_block(&chan->lock);
+        _dthread_fiber_spin_lock(&chan->lock);
+    }
+
+    if (chan->count == 0)
+    {
+        _dthread_fiber_spin_unlock(&chan->lock);
+        return 1;
+    }
+
+    *item = chan->items[chan->first];
+    chan->first = (chan->first + 1) % chan->capacity;
+    chan->count--;
+
+    _DThreadFiber* sender = _dthread_fiber_dequeue(&chan->senders_head, &chan->senders_tail);
+
+    _dthread_fiber_spin_unlock(&chan->lock);
+
+    if (sender)
+        _dthread_fiber_ready(sender->sched, sender);
+
+    return 0;
+}
+
+int dthread_fiber_channel_close(DThreadFiberChannel* chan)
+{
+    dthread_debug("dthread_fiber_channel_close");
+
+    assert(chan && "`chan` cannot be NULL in dthread_fiber_channel_close");
+
+    _dthread_fiber_spin_lock(&chan->lock);
+
+    chan->closed = 1;
+
+    _DThreadFiber* senders = chan->senders_head;
+    _DThreadFiber* receivers = chan->receivers_head;
+    chan->senders_head = chan->senders_tail = NULL;
+    chan->receivers_head = chan->receivers_tail = NULL;
+
+    _dthread_fiber_spin_unlock(&chan->lock);
+
+    // every waiter checks the channel again and sees it closed
+    while (senders)
+    {
+        _DThreadFiber* next = senders->next;
+        _dthread_fiber_ready(senders->sched, senders);
+        senders = next;
+    }
+
+    while (receivers)
+    {
+        _DThreadFiber* next = receivers->next;
+        _dthread_fiber_ready(receivers->sched, receivers);
+        receivers = next;
+    }
+
+    return 0;
+}
+
+int dthread_fiber_channel_destroy(DThreadFiberChannel* chan)
+{
+    dthread_debug("dthread_fiber_channel_destroy");
+
+    assert(chan && "`chan` cannot be NULL in dthread_fiber_channel_destroy");
+
+    if (chan->senders_head || chan->receivers_head)
+        return 1;
+
+    free(chan->items);
+    chan->items = NULL;
+
+    return 0;
+}
@@ -0,0 +1,349 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _graph.c
+//    Date: 2024-09-15
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#define _DTHREAD_GRAPH_CAPACITY 16
+
+static int _dthread_graph_before(DThreadGraph* graph, int a, int b)
+{
+    uint64_t rank_a = graph->nodes[a].rank, rank_b = graph->nodes[b].rank;
+
+    return rank_a > rank_b || (rank_a == rank_b && a < b);
+}
+
+// must be called with the mutex held
+static void _dthread_graph_push(DThreadGraph* graph, int node)
+{
+    int i = graph->num_ready++;
+
+    for (; i > 0 && _dthread_graph_before(graph, node, graph->ready[(i - 1) / 2]); i = (i - 1) / 2)
+        graph->ready[i] = graph->ready[(i - 1) / 2];
+
+    graph->ready[i] = node;
+}
+
+// must be called with the mutex held, -1 when no node is ready
+static int _dthread_graph_pop(DThreadGraph* graph)
+{
+    if (graph->num_ready == 0)
+        return -1;
+
+    int top = graph->ready[0];
+    int last = graph->ready[--graph->num_ready];
+    int i = 0;
+
+    for (;;)
+    {
+        int child = 2 * i + 1;
+        if (child >= graph->num_ready)
+            break;
+
+        if (child + 1 < graph->num_ready && _dthread_graph_before(graph, graph->ready[child + 1], graph->ready[child]))
+            child++;
+
+        if (!_dthread_graph_before(graph, graph->ready[child], last))
+            break;
+
+        graph->ready[i] = graph->ready[child];
+        i = child;
+    }
+
+    graph->ready[i] = last;
+
+    return top;
+}
+
+// ranks the nodes by their costliest path to the end of the graph, non-zero on a cycle
+static int _dthread_graph_prepare(DThreadGraph* graph)
+{
+    int n = graph->num_nodes;
+
+    int* ready = (int*)realloc(graph->ready, (size_t)(n ? n : 1) * sizeof(int));
+    if (!ready)
+        return 1;
+    graph->ready = ready;
+
+    // a topological order from Kahn's algorithm, walked backwards
+    int* order = (int*)malloc((size_t)(n ? n : 1) * sizeof(int));
+    if (!order)
+        return 1;
+
+    int head = 0, tail = 0;
+
+    for (int i = 0; i < n; ++i)
+    {
+        graph->nodes[i].pending = graph->nodes[i].num_predecessors;
+
+        if (graph->nodes[i].pending == 0)
+            order[tail++] = i;
+    }
+
+    while (head < tail)
+    {
+        DThreadGraphNode* node = &graph->nodes[order[head++]];
+
+        for (int s = 0; s < node->num_successors; ++s)
+        {
+            if (--graph->nodes[node->successors[s]].pending == 0)
+                order[tail++] = node->successors[s];
+        }
+    }
+
+    if (tail < n)
+    {
+        free(order);
+        return 1;
+    }
+
+    for (int i = n - 1; i >= 0; --i)
+    {
+        DThreadGraphNode* node = &graph->nodes[order[i]];
+        uint64_t longest = 0;
+
+        for (int s = 0; s < node->num_successors; ++s)
+        {
+            if (graph->nodes[node->successors[s]].rank > longest)
+                longest = graph->nodes[node->successors[s]].rank;
+        }
+
+        node->rank = node->cost + longest;
+    }
+
+    free(order);
+    graph->dirty = 0;
+
+    return 0;
+}
+
+static dthread_define_routine(_dthread_graph_runner)
+{
+    DThreadGraph* graph = (DThreadGraph*)data;
+
+    dthread_mutex_lock(&graph->mutex);
+    int current = _dthread_graph_pop(graph);
+    dthread_mutex_unlock(&graph->mutex);
+
+    // more runners than ready nodes are started, a runner finding no node simply leaves
+    while (current >= 0)
+    {
+        DThreadGraphNode* node = &graph->nodes[current];
+        node->func(node->data);
+
+        int released = 0;
+
+        for (int s = 0; s < node->num_successors; ++s)
+        {
+            DThreadGraphNode* successor = &graph->nodes[node->successors[s]];
+
+            if (dthread_atomic_fetch_add_i32(&successor->pending, -1) == 1)
+            {
+                dthread_mutex_lock(&graph->mutex);
+                _dthread_graph_push(graph, node->successors[s]);
+                dthread_mutex_unlock(&graph->mutex);
+
+                released++;
+            }
+        }
+
+        // this runner goes on with the best ready node, the others get a runner each
+        for (int i = 1; graph->pool && i < released; ++i)
+        {
+            dthread_atomic_fetch_add_i64(&graph->runners, 1);
+
+            if (dthread_pool_submit(graph->pool, _dthread_graph_runner, graph) != 0)
+                dthread_atomic_fetch_add_i64(&graph->runners, -1);
+        }
+
+        dthread_mutex_lock(&graph->mutex);
+        current = _dthread_graph_pop(graph);
+        dthread_mutex_unlock(&graph->mutex);
+    }
+
+    // every node has completed once the last runner leaves
+    if (dthread_atomic_fetch_add_i64(&graph->runners, -1) == 1)
+    {
+        dthread_mutex_lock(&graph->mutex);
+        dthread_cond_broadcast(&graph->cond);
+        dthread_mutex_unlock(&graph->mutex);
+    }
+
+    return NULL;
+}
+
+int dthread_graph_init(DThreadGraph* graph)
+{
+    dthread_debug("dthread_graph_init");
+
+    assert(graph && "`graph` cannot be NULL in dthread_graph_init");
+
+    memset(graph, 0, sizeof(*graph));
+
+    if (dthread_mutex_init(&graph->mutex, NULL) != 0)
+        return 1;
+
+    if (dthread_cond_init(&graph->cond, NULL) != 0)
+    {
+        dthread_mutex_destroy(&graph->mutex);
+        return 1;
+    }
+
+    return 0;
+}
+
+int dthread_graph_add_node(DThreadGraph* graph, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_graph_add_node");
+
+    assert(graph && func && "`graph` and `func` cannot be NULL in dthread_graph_add_node");
+
+    if (graph->num_nodes == graph->capacity)
+    {
+        int capacity = graph->capacity ? graph->capacity * 2 : _DTHREAD_GRAPH_CAPACITY;
+        DThreadGraphNode* nodes = (DThreadGraphNode*)realloc(graph->nodes, (size_t)capacity * sizeof(DThreadGraphNode));
+
+        if (!nodes)
+            return -1;
+
+        graph->nodes = nodes;
+        graph->capacity = capacity;
+    }
+
+    DThreadGraphNode* node = &graph->nodes[graph->num_nodes];
+    memset(node, 0, sizeof(*node));
+    node->func = func;
+    node->data = data;
+    node->cost = 1;
+
+    graph->dirty = 1;
+
+    return graph->num_nodes++;
+}
+
+int dthread_graph_add_edge(DThreadGraph* graph, int from, int to)
+{
+    dthread_debug("dthread_graph_add_edge");
+
+    assert(graph && "`graph` cannot be NULL in dthread_graph_add_edge");
+
+    if (from < 0 || from >= graph->num_nodes || to < 0 || to >= graph->num_nodes || from == to)
+        return 1;
+
+    DThreadGraphNode* node = &graph->nodes[from];
+
+    if (node->num_successors == node->successors_capacity)
+    {
+        int capacity = node->successors_capacity ? node->successors_capacity * 2 : 4;
+        int* successors = (int*)realloc(node->successors, (size_t)capacity * sizeof(int));
+
+        if (!successors)
+            return 1;
+
+        node->successors = successors;
+        node->successors_capacity = capacity;
+    }
+
+    node->successors[node->num_successors++] = to;
+    graph->nodes[to].num_predecessors++;
+    graph->dirty = 1;
+
+    return 0;
+}
+
+int dthread_graph_set_cost(DThreadGraph* graph, int node, uint64_t cost)
+{
+    dthread_debug("dthread_graph_set_cost");
+
+    assert(graph && "`graph` cannot be NULL in dthread_graph_set_cost");
+
+    if (node < 0 || node >= graph->num_nodes)
+        return 1;
+
+    graph->nodes[node].cost = cost;
+    graph->dirty = 1;
+
+    return 0;
+}
+
+int dthread_graph_run(DThreadGraph* graph, DThreadPool* pool)
+{
+    dthread_debug("dthread_graph_run");
+
+    assert(graph && "`graph` cannot be NULL in dthread_graph_run");
+
+    if (graph->dirty && _dthread_graph_prepare(graph) != 0)
+        return 1;
+
+    if (graph->num_nodes == 0)
+        return 0;
+
+    graph->pool = pool;
+    graph->num_ready = 0;
+
+    for (int i = 0; i < graph->num_nodes; ++i)
+    {
+        graph->nodes[i].pending = graph->nodes[i].num_predecessors;
+
+        if (graph->nodes[i].pending == 0)
+            _dthread_graph_push(graph, i);
+    }
+
+    int roots = graph->num_ready;
+
+    // one runner per root, the runners are counted before any of them can leave
+    graph->runners = pool ? roots : 1;
+
+    if (!pool)
+    {
+        _dthread_graph_runner(graph);
+    }
+    else
+    {
+        for (int i = 0; i < roots; ++i)
+        {
+            if (dthread_pool_submit(pool, _dthread_graph_runner, graph) != 0)
+                _dthread_graph_runner(graph);
+        }
+
+        dthread_mutex_lock(&graph->mutex);
+        while (dthread_atomic_load_i64(&graph->runners) > 0)
+            dthread_cond_wait(&graph->cond, &graph->mutex);
+        dthread_mutex_unlock(&graph->mutex);
+    }
+
+    graph->runs++;
+
+    return 0;
+}
+
+void dthread_graph_destroy(DThreadGraph* graph)
+{
+    dthread_debug("dthread_graph_destroy");
+
+    assert(graph && "`graph` cannot be NULL in dthread_graph_destroy");
+
+    for (int i = 0; i < graph->num_nodes; ++i)
+        free(graph->nodes[i].successors);
+
+    free(graph->nodes);
+    free(graph->ready);
+
+    dthread_cond_destroy(&graph->cond);
+    dthread_mutex_destroy(&graph->mutex);
+
+    memset(graph, 0, sizeof(*graph));
+}
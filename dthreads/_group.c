@@ -0,0 +1,211 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _group.c
+//    Date: 2024-08-31
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+static dthread_define_routine(_dthread_group_trampoline)
+{
+    _DThreadGroupEntry* entry = (_DThreadGroupEntry*)data;
+    DThreadGroup* group = entry->group;
+
+    void* result = entry->thread->_func(entry->thread->_data);
+    entry->thread->_result = result;
+
+    dthread_mutex_lock(&group->mutex);
+
+    // the creator mirrors the native handle into `thread` first, once queued the entry can be
+    // reaped and `thread` reused at any time
+    while (!entry->published)
+        dthread_cond_wait(&group->cond, &group->mutex);
+
+    entry->next = NULL;
+    if (group->tail)
+        group->tail->next = entry;
+    else
+        group->head = entry;
+    group->tail = entry;
+
+    // the condition is shared with the trampolines waiting on `published`
+    dthread_cond_broadcast(&group->cond);
+    dthread_mutex_unlock(&group->mutex);
+
+    return result;
+}
+
+// must be called with the group mutex held and a non-empty queue
+static DThread* _dthread_group_pop(DThreadGroup* group)
+{
+    _DThreadGroupEntry* entry = group->head;
+
+    group->head = entry->next;
+    if (!group->head)
+        group->tail = NULL;
+    group->pending--;
+
+    dthread_mutex_unlock(&group->mutex);
+
+    // the routine has returned already, this only reaps the native thread
+    int failed = dthread_join(&entry->inner) != 0;
+    DThread* thread = entry->thread;
+
+    dthread_mutex_lock(&group->mutex);
+
+    group->failures += (size_t)failed;
+
+    entry->next = group->free_entries;
+    group->free_entries = entry;
+
+    return thread;
+}
+
+int dthread_group_init(DThreadGroup* group)
+{
+    dthread_debug("dthread_group_init");
+
+    assert(group && "`group` cannot be NULL in dthread_group_init");
+
+    memset(group, 0, sizeof(*group));
+
+    if (dthread_mutex_init(&group->mutex, NULL) != 0)
+        return 1;
+
+    return dthread_cond_init(&group->cond, NULL);
+}
+
+int dthread_group_create(DThreadGroup* group, DThread* thread, DThreadAttr* attr)
+{
+    dthread_debug("dthread_group_create");
+
+    assert(group && thread && "`group` and `thread` cannot be NULL in dthread_group_create");
+
+    dthread_mutex_lock(&group->mutex);
+
+    _DThreadGroupEntry* entry = group->free_entries;
+    if (entry)
+        group->free_entries = entry->next;
+
+    dthread_mutex_unlock(&group->mutex);
+
+    if (!entry)
+    {
+        entry = (_DThreadGroupEntry*)malloc(sizeof(_DThreadGroupEntry));
+        if (!entry)
+            return 1;
+    }
+
+    entry->thread = thread;
+    entry->group = group;
+    entry->next = NULL;
+    entry->published = 0;
+    entry->inner = dthread_init_thread(_dthread_group_trampoline, entry);
+
+    thread->_result = NULL;
+
+    dthread_mutex_lock(&group->mutex);
+    group->pending++;
+    dthread_mutex_unlock(&group->mutex);
+
+    if (dthread_create(&entry->inner, attr) != 0)
+    {
+        dthread_mutex_lock(&group->mutex);
+        group->pending--;
+        entry->next = group->free_entries;
+        group->free_entries = entry;
+        dthread_mutex_unlock(&group->mutex);
+
+        return 1;
+    }
+
+    dthread_mutex_lock(&group->mutex);
+    thread->handle = entry->inner.handle;
+    entry->published = 1;
+    dthread_cond_broadcast(&group->cond);
+    dthread_mutex_unlock(&group->mutex);
+
+    return 0;
+}
+
+DThread* dthread_group_join_any(DThreadGroup* group)
+{
+    dthread_debug("dthread_group_join_any");
+
+    DThread* thread = NULL;
+
+    dthread_mutex_lock(&group->mutex);
+
+    while (!group->head && group->pending > 0)
+        dthread_cond_wait(&group->cond, &group->mutex);
+
+    if (group->head)
+        thread = _dthread_group_pop(group);
+
+    dthread_mutex_unlock(&group->mutex);
+
+    return thread;
+}
+
+DThread* dthread_group_poll(DThreadGroup* group)
+{
+    dthread_debug("dthread_group_poll");
+
+    DThread* thread = NULL;
+
+    dthread_mutex_lock(&group->mutex);
+
+    if (group->head)
+        thread = _dthread_group_pop(group);
+
+    dthread_mutex_unlock(&group->mutex);
+
+    return thread;
+}
+
+int dthread_group_join_all(DThreadGroup* group)
+{
+    dthread_debug("dthread_group_join_all");
+
+    dthread_mutex_lock(&group->mutex);
+    size_t failures = group->failures;
+    dthread_mutex_unlock(&group->mutex);
+
+    while (dthread_group_join_any(group) != NULL)
+    {
+    }
+
+    dthread_mutex_lock(&group->mutex);
+    failures = group->failures - failures;
+    dthread_mutex_unlock(&group->mutex);
+
+    return failures != 0;
+}
+
+void dthread_group_destroy(DThreadGroup* group)
+{
+    dthread_debug("dthread_group_destroy");
+
+    _DThreadGroupEntry* entry = group->free_entries;
+    while (entry)
+    {
+        _DThreadGroupEntry* next = entry->next;
+        free(entry);
+        entry = next;
+    }
+
+    dthread_cond_destroy(&group->cond);
+    dthread_mutex_destroy(&group->mutex);
+
+    memset(group, 0, sizeof(*group));
+}
@@ -0,0 +1,621 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _hashmap.c
+//    Date: 2024-09-18
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#if (defined(__x86_64__) && defined(__SSE2__)) || defined(_M_X64)
+#include <emmintrin.h>
+#define _DTHREAD_HASHMAP_SSE2
+#endif
+
+#define _DTHREAD_HASHMAP_CAPACITY 64
+#define _DTHREAD_HASHMAP_GROUP_SLOTS 16
+
+// metadata bytes, a full slot holds the low 7 bits of its hash
+#define _DTHREAD_HASHMAP_EMPTY 0x80
+#define _DTHREAD_HASHMAP_DELETED 0xFE
+#define _DTHREAD_HASHMAP_EMPTY_WORD 0x8080808080808080ll
+
+// groups moved by every write during a resize, on top of the ones holding its own key
+#define _DTHREAD_HASHMAP_MIGRATE_GROUPS 4
+
+#define _DTHREAD_HASHMAP_FOUND 0
+#define _DTHREAD_HASHMAP_ABSENT 1
+#define _DTHREAD_HASHMAP_MOVED 2
+#define _DTHREAD_HASHMAP_FULL 3
+
+// the hash, then the key and the value, 8 bytes aligned
+typedef struct
+{
+    uint64_t hash;
+} _DThreadHashMapNode;
+
+#define _dthread_hashmap_node_key(NODE) ((unsigned char*)(NODE) + sizeof(_DThreadHashMapNode))
+#define _dthread_hashmap_node_value(MAP, NODE) (_dthread_hashmap_node_key(NODE) + (MAP)->key_stride)
+
+typedef struct
+{
+    int64_t ctrl[2];
+    int32_t lock;
+    // set once the entries are in the next table, the group is never written again
+    int32_t moved;
+    _DThreadHashMapNode* slots[_DTHREAD_HASHMAP_GROUP_SLOTS];
+} _DThreadHashMapGroup;
+
+typedef struct _DThreadHashMapTable
+{
+    _DThreadHashMapGroup* groups;
+    size_t mask;
+
+    // slots ever filled, tombstones included
+    int64_t used;
+
+    // resize progress while this table is the old one
+    int64_t cursor;
+    int64_t migrated;
+} _DThreadHashMapTable;
+
+static void _dthread_hashmap_lock(int32_t* lock)
+{
+    int spins = 0;
+
+    while (dthread_atomic_exchange_i32(lock, 1))
+    {
+        while (dthread_atomic_load_relaxed_i32(lock))
+        {
+            // the holder may have been preempted
+            if (++spins % 64 == 0)
+                _dthread_pool_relax();
+            else
+                dthread_atomic_pause();
+        }
+    }
+}
+
+static void _dthread_hashmap_unlock(int32_t* lock)
+{
+    dthread_atomic_store_i32(lock, 0);
+}
+
+static uint64_t _dthread_hashmap_hash(DThreadHashMap* map, const void* key)
+{
+    uint64_t hash = map->config.hash ? map->config.hash(key, map->config.key_size) : _dthread_map_hash_bytes(key, map->config.key_size);
+
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash;
+}
+
+// one bit per slot of the group whose metadata byte is `byte`
+static uint32_t _dthread_hashmap_match(int64_t ctrl0, int64_t ctrl1, unsigned char byte)
+{
+#ifdef _DTHREAD_HASHMAP_SSE2
+    __m128i ctrl = _mm_set_epi64x(ctrl1, ctrl0);
+
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)byte)));
+#else
+    uint32_t mask = 0;
+
+    for (int i = 0; i < 8; ++i)
+    {
+        mask |= (uint32_t)((((uint64_t)ctrl0 >> (8 * i)) & 0xFF) == byte) << i;
+        mask |= (uint32_t)((((uint64_t)ctrl1 >> (8 * i)) & 0xFF) == byte) << (i + 8);
+    }
+
+    return mask;
+#endif
+}
+
+// only the holder of the group lock writes the metadata
+static void _dthread_hashmap_set_ctrl(_DThreadHashMapGroup* group, int slot, unsigned char byte)
+{
+    int64_t* word = &group->ctrl[slot / 8];
+    int shift = 8 * (slot % 8);
+    uint64_t ctrl = (uint64_t)dthread_atomic_load_relaxed_i64(word);
+
+    ctrl = (ctrl & ~(0xFFull << shift)) | ((uint64_t)byte << shift);
+    dthread_atomic_store_i64(word, (int64_t)ctrl);
+}
+
+static _DThreadHashMapTable* _dthread_hashmap_table_new(size_t capacity)
+{
+    // groups are at most 7/8 full, their number is a power of two
+    size_t num_groups = 1;
+    while (num_groups * _DTHREAD_HASHMAP_GROUP_SLOTS * 7 / 8 < capacity)
+        num_groups *= 2;
+
+    _DThreadHashMapTable* table = (_DThreadHashMapTable*)calloc(1, sizeof(_DThreadHashMapTable) + num_groups * sizeof(_DThreadHashMapGroup));
+    if (!table)
+        return NULL;
+
+    table->groups = (_DThreadHashMapGroup*)(table + 1);
+    table->mask = num_groups - 1;
+
+    for (size_t g = 0; g < num_groups; ++g)
+        table->groups[g].ctrl[0] = table->groups[g].ctrl[1] = _DTHREAD_HASHMAP_EMPTY_WORD;
+
+    return table;
+}
+
+static size_t _dthread_hashmap_capacity(_DThreadHashMapTable* table)
+{
+    return (table->mask + 1) * _DTHREAD_HASHMAP_GROUP_SLOTS;
+}
+
+/*
+ * Probing, the groups of a key are visited quadratically from its home group until one still
+ * has an empty slot
+ */
+
+static int _dthread_hashmap_probe(DThreadHashMap* map, _DThreadHashMapTable* table, uint64_t hash, const void* key,
+                                  void* value, int old)
+{
+    unsigned char tag = (unsigned char)(hash & 0x7F);
+    size_t g = (size_t)(hash >> 7) & table->mask;
+
+    for (size_t step = 1; step <= table->mask + 1; ++step)
+    {
+        _DThreadHashMapGroup* group = &table->groups[g];
+
+        int moved = dthread_atomic_load_i32(&group->moved);
+
+        if (moved && !old)
+            return _DTHREAD_HASHMAP_MOVED;
+
+        int64_t ctrl0 = dthread_atomic_load_i64(&group->ctrl[0]);
+        int64_t ctrl1 = dthread_atomic_load_i64(&group->ctrl[1]);
+
+        // the entries of a moved group may already be replaced and released, its metadata never
+        // changes again so an empty slot still ends the probe
+        if (!moved)
+        {
+            for (uint32_t match = _dthread_hashmap_match(ctrl0, ctrl1, tag), i = 0; match; match >>= 1, ++i)
+            {
+                if (!(match & 1))
+                    continue;
+
+                _DThreadHashMapNode* node = (_DThreadHashMapNode*)dthread_atomic_load_ptr((void**)&group->slots[i]);
+
+                if (!node || node->hash != hash || memcmp(_dthread_hashmap_node_key(node), key, map->config.key_size) != 0)
+                    continue;
+
+                // moved meanwhile, a newer value may be in the next table
+                if (dthread_atomic_load_i32(&group->moved))
+                    return old ? _DTHREAD_HASHMAP_ABSENT : _DTHREAD_HASHMAP_MOVED;
+
+                if (value)
+                    memcpy(value, _dthread_hashmap_node_value(map, node), map->config.value_size);
+
+                return _DTHREAD_HASHMAP_FOUND;
+            }
+        }
+
+        if (_dthread_hashmap_match(ctrl0, ctrl1, _DTHREAD_HASHMAP_EMPTY))
+            return _DTHREAD_HASHMAP_ABSENT;
+
+        g = (g + step) & table->mask;
+    }
+
+    return _DTHREAD_HASHMAP_ABSENT;
+}
+
+// finds the slot of a key, its writer holds the stripe so it cannot move meanwhile
+static int _dthread_hashmap_locate(DThreadHashMap* map, _DThreadHashMapTable* table, uint64_t hash, const void* key,
+                                   _DThreadHashMapGroup** found, int* slot)
+{
+    unsigned char tag = (unsigned char)(hash & 0x7F);
+    size_t g = (size_t)(hash >> 7) & table->mask;
+
+    for (size_t step = 1; step <= table->mask + 1; ++step)
+    {
+        _DThreadHashMapGroup* group = &table->groups[g];
+
+        if (dthread_atomic_load_i32(&group->moved))
+            return _DTHREAD_HASHMAP_MOVED;
+
+        int64_t ctrl0 = dthread_atomic_load_i64(&group->ctrl[0]);
+        int64_t ctrl1 = dthread_atomic_load_i64(&group->ctrl[1]);
+
+        for (uint32_t match = _dthread_hashmap_match(ctrl0, ctrl1, tag), i = 0; match; match >>= 1, ++i)
+        {
+            if (!(match & 1))
+                continue;
+
+            _DThreadHashMapNode* node = (_DThreadHashMapNode*)dthread_atomic_load_ptr((void**)&group->slots[i]);
+
+            if (node && node->hash == hash && memcmp(_dthread_hashmap_node_key(node), key, map->config.key_size) == 0)
+            {
+                *found = group;
+                *slot = (int)i;
+                return _DTHREAD_HASHMAP_FOUND;
+            }
+        }
+
+        if (_dthread_hashmap_match(ctrl0, ctrl1, _DTHREAD_HASHMAP_EMPTY))
+            return _DTHREAD_HASHMAP_ABSENT;
+
+        g = (g + step) & table->mask;
+    }
+
+    return _DTHREAD_HASHMAP_ABSENT;
+}
+
+// puts a node known to be missing in the first free slot of its groups
+static int _dthread_hashmap_insert_node(_DThreadHashMapTable* table, _DThreadHashMapNode* node)
+{
+    unsigned char tag = (unsigned char)(node->hash & 0x7F);
+    size_t g = (size_t)(node->hash >> 7) & table->mask;
+
+    for (size_t step = 1; step <= table->mask + 1; ++step)
+    {
+        _DThreadHashMapGroup* group = &table->groups[g];
+
+        _dthread_hashmap_lock(&group->lock);
+
+        if (group->moved)
+        {
+            _dthread_hashmap_unlock(&group->lock);
+            return _DTHREAD_HASHMAP_MOVED;
+        }
+
+        int64_t ctrl0 = dthread_atomic_load_relaxed_i64(&group->ctrl[0]);
+        int64_t ctrl1 = dthread_atomic_load_relaxed_i64(&group->ctrl[1]);
+        uint32_t empty = _dthread_hashmap_match(ctrl0, ctrl1, _DTHREAD_HASHMAP_EMPTY);
+        uint32_t free_slots = empty | _dthread_hashmap_match(ctrl0, ctrl1, _DTHREAD_HASHMAP_DELETED);
+
+        if (free_slots)
+        {
+            int i = 0;
+            while (!(free_slots & (1u << i)))
+                ++i;
+
+            if (empty & (1u << i))
+                dthread_atomic_fetch_add_i64(&table->used, 1);
+
+            // the node is visible before the metadata pointing readers at it
+            dthread_atomic_store_ptr((void**)&group->slots[i], node);
+            _dthread_hashmap_set_ctrl(group, i, tag);
+
+            _dthread_hashmap_unlock(&group->lock);
+            return _DTHREAD_HASHMAP_FOUND;
+        }
+
+        _dthread_hashmap_unlock(&group->lock);
+
+        g = (g + step) & table->mask;
+    }
+
+    return _DTHREAD_HASHMAP_FULL;
+}
+
+/*
+ * Resize
+ */
+
+static void _dthread_hashmap_migrate_group(DThreadHashMap* map, _DThreadHashMapTable* old, _DThreadHashMapTable* table, size_t g)
+{
+    _DThreadHashMapGroup* group = &old->groups[g];
+
+    _dthread_hashmap_lock(&group->lock);
+
+    if (group->moved)
+    {
+        _dthread_hashmap_unlock(&group->lock);
+        return;
+    }
+
+    // the new table cannot be resized before this one is done
+    for (int i = 0; i < _DTHREAD_HASHMAP_GROUP_SLOTS; ++i)
+    {
+        if (group->slots[i])
+            _dthread_hashmap_insert_node(table, group->slots[i]);
+    }
+
+    dthread_atomic_store_i32(&group->moved, 1);
+    _dthread_hashmap_unlock(&group->lock);
+
+    if (dthread_atomic_fetch_add_i64(&old->migrated, 1) + 1 == (int64_t)(old->mask + 1))
+    {
+        dthread_atomic_store_ptr((void**)&map->old, NULL);
+        dthread_epoch_retire(&map->epoch, old, free);
+    }
+}
+
+// moves the groups of a key, then a few more, so that a resize ends after a bounded number of writes
+static void _dthread_hashmap_help(DThreadHashMap* map, _DThreadHashMapTable* old, _DThreadHashMapTable* table, uint64_t hash)
+{
+    size_t g = (size_t)(hash >> 7) & old->mask;
+
+    for (size_t step = 1; step <= old->mask + 1; ++step)
+    {
+        _DThreadHashMapGroup* group = &old->groups[g];
+
+        _dthread_hashmap_migrate_group(map, old, table, g);
+
+        // the metadata of a moved group never changes again
+        if (_dthread_hashmap_match(dthread_atomic_load_i64(&group->ctrl[0]), dthread_atomic_load_i64(&group->ctrl[1]),
+                                   _DTHREAD_HASHMAP_EMPTY))
+            break;
+
+        g = (g + step) & old->mask;
+    }
+
+    for (int i = 0; i < _DTHREAD_HASHMAP_MIGRATE_GROUPS; ++i)
+    {
+        int64_t next = dthread_atomic_fetch_add_i64(&old->cursor, 1);
+
+        if (next > (int64_t)old->mask)
+            break;
+
+        _dthread_hashmap_migrate_group(map, old, table, (size_t)next);
+    }
+}
+
+static void _dthread_hashmap_grow(DThreadHashMap* map, _DThreadHashMapTable* table)
+{
+    int32_t expected = 0;
+
+    if (!dthread_atomic_cas_i32(&map->resizing, &expected, 1))
+        return;
+
+    if (dthread_atomic_load_ptr((void**)&map->table) == table && !dthread_atomic_load_ptr((void**)&map->old))
+    {
+        // doubles when more than half the slots are live, otherwise only drops the tombstones
+        size_t capacity = _dthread_hashmap_capacity(table) * 7 / 8;
+        if ((size_t)dthread_atomic_load_i64(&map->count) * 2 > _dthread_hashmap_capacity(table))
+            capacity *= 2;
+
+        _DThreadHashMapTable* next = _dthread_hashmap_table_new(capacity);
+
+        // readers load the table before the old one, they can never miss both
+        if (next)
+        {
+            dthread_atomic_store_ptr((void**)&map->old, table);
+            dthread_atomic_store_ptr((void**)&map->table, next);
+        }
+    }
+
+    dthread_atomic_store_i32(&map->resizing, 0);
+}
+
+int dthread_hashmap_init(DThreadHashMap* map, DThreadHashMapConfig* config)
+{
+    dthread_debug("dthread_hashmap_init");
+
+    assert(map && "`map` cannot be NULL in dthread_hashmap_init");
+    assert(config && config->key_size > 0 && "`config->key_size` cannot be 0 in dthread_hashmap_init");
+
+    memset(map, 0, sizeof(*map));
+
+    map->config = *config;
+
+    if (map->config.capacity == 0)
+        map->config.capacity = _DTHREAD_HASHMAP_CAPACITY;
+
+    map->key_stride = (map->config.key_size + 7) & ~(size_t)7;
+    map->table = _dthread_hashmap_table_new(map->config.capacity);
+
+    if (!map->table)
+        return 1;
+
+    return dthread_epoch_init(&map->epoch);
+}
+
+void dthread_hashmap_destroy(DThreadHashMap* map)
+{
+    dthread_debug("dthread_hashmap_destroy");
+
+    assert(map && "`map` cannot be NULL in dthread_hashmap_destroy");
+
+    // the entries of the moved groups belong to the new table
+    _DThreadHashMapTable* tables[2] = {map->table, map->old};
+
+    for (int t = 0; t < 2; ++t)
+    {
+        if (!tables[t])
+            continue;
+
+        for (size_t g = 0; g <= tables[t]->mask; ++g)
+        {
+            if (tables[t]->groups[g].moved)
+                continue;
+
+            for (int i = 0; i < _DTHREAD_HASHMAP_GROUP_SLOTS; ++i)
+                free(tables[t]->groups[g].slots[i]);
+        }
+
+        free(tables[t]);
+    }
+
+    dthread_epoch_destroy(&map->epoch);
+
+    map->table = map->old = NULL;
+    map->count = 0;
+}
+
+int dthread_hashmap_get(DThreadHashMap* map, const void* key, void* value)
+{
+    dthread_debug("dthread_hashmap_get");
+
+    assert(map && "`map` cannot be NULL in dthread_hashmap_get");
+    assert(key && "`key` cannot be NULL in dthread_hashmap_get");
+
+    uint64_t hash = _dthread_hashmap_hash(map, key);
+    int result;
+
+    dthread_epoch_enter(&map->epoch);
+
+    do
+    {
+        _DThreadHashMapTable* table = (_DThreadHashMapTable*)dthread_atomic_load_ptr((void**)&map->table);
+        _DThreadHashMapTable* old = (_DThreadHashMapTable*)dthread_atomic_load_ptr((void**)&map->old);
+
+        // the groups not moved yet are still authoritative
+        if (old && old != table && _dthread_hashmap_probe(map, old, hash, key, value, 1) == _DTHREAD_HASHMAP_FOUND)
+        {
+            result = _DTHREAD_HASHMAP_FOUND;
+            break;
+        }
+
+        result = _dthread_hashmap_probe(map, table, hash, key, value, 0);
+    } while (result == _DTHREAD_HASHMAP_MOVED);
+
+    dthread_epoch_exit(&map->epoch);
+
+    return result != _DTHREAD_HASHMAP_FOUND;
+}
+
+int dthread_hashmap_put(DThreadHashMap* map, const void* key, const void* value)
+{
+    dthread_debug("dthread_hashmap_put");
+
+    assert(map && "`map` cannot be NULL in dthread_hashmap_put");
+    assert(key && "`key` cannot be NULL in dthread_hashmap_put");
+
+    uint64_t hash = _dthread_hashmap_hash(map, key);
+    _DThreadHashMapNode* node = (_DThreadHashMapNode*)malloc(sizeof(_DThreadHashMapNode) + map->key_stride + map->config.value_size);
+
+    if (!node)
+        return 1;
+
+    node->hash = hash;
+    memcpy(_dthread_hashmap_node_key(node), key, map->config.key_size);
+    if (map->config.value_size)
+        memcpy(_dthread_hashmap_node_value(map, node), value, map->config.value_size);
+
+    int32_t* stripe = &map->stripes[(hash >> 32) % DTHREAD_HASHMAP_STRIPES].lock;
+    _DThreadHashMapNode* previous = NULL;
+    _DThreadHashMapTable* table;
+    int result;
+
+    _dthread_hashmap_lock(stripe);
+    dthread_epoch_enter(&map->epoch);
+
+    do
+    {
+        table = (_DThreadHashMapTable*)dthread_atomic_load_ptr((void**)&map->table);
+        _DThreadHashMapTable* old = (_DThreadHashMapTable*)dthread_atomic_load_ptr((void**)&map->old);
+
+        if (old && old != table)
+            _dthread_hashmap_help(map, old, table, hash);
+
+        _DThreadHashMapGroup* group;
+        int slot;
+
+        result = _dthread_hashmap_locate(map, table, hash, key, &group, &slot);
+
+        if (result == _DTHREAD_HASHMAP_FOUND)
+        {
+            _dthread_hashmap_lock(&group->lock);
+
+            if (group->moved)
+                result = _DTHREAD_HASHMAP_MOVED;
+            else
+            {
+                previous = group->slots[slot];
+                dthread_atomic_store_ptr((void**)&group->slots[slot], node);
+            }
+
+            _dthread_hashmap_unlock(&group->lock);
+        }
+        else if (result == _DTHREAD_HASHMAP_ABSENT)
+            result = _dthread_hashmap_insert_node(table, node);
+    } while (result == _DTHREAD_HASHMAP_MOVED);
+
+    if (result == _DTHREAD_HASHMAP_FOUND && !previous)
+    {
+        dthread_atomic_fetch_add_i64(&map->count, 1);
+
+        if ((size_t)dthread_atomic_load_i64(&table->used) * 8 > _dthread_hashmap_capacity(table) * 7)
+            _dthread_hashmap_grow(map, table);
+    }
+
+    if (previous)
+        dthread_epoch_retire(&map->epoch, previous, free);
+
+    dthread_epoch_exit(&map->epoch);
+    _dthread_hashmap_unlock(stripe);
+
+    if (result != _DTHREAD_HASHMAP_FOUND)
+    {
+        free(node);
+        return 1;
+    }
+
+    return 0;
+}
+
+int dthread_hashmap_remove(DThreadHashMap* map, const void* key)
+{
+    dthread_debug("dthread_hashmap_remove");
+
+    assert(map && "`map` cannot be NULL in dthread_hashmap_remove");
+    assert(key && "`key` cannot be NULL in dthread_hashmap_remove");
+
+    uint64_t hash = _dthread_hashmap_hash(map, key);
+    int32_t* stripe = &map->stripes[(hash >> 32) % DTHREAD_HASHMAP_STRIPES].lock;
+    _DThreadHashMapNode* previous = NULL;
+    int result;
+
+    _dthread_hashmap_lock(stripe);
+    dthread_epoch_enter(&map->epoch);
+
+    do
+    {
+        _DThreadHashMapTable* table = (_DThreadHashMapTable*)dthread_atomic_load_ptr((void**)&map->table);
+        _DThreadHashMapTable* old = (_DThreadHashMapTable*)dthread_atomic_load_ptr((void**)&map->old);
+
+        if (old && old != table)
+            _dthread_hashmap_help(map, old, table, hash);
+
+        _DThreadHashMapGroup* group;
+        int slot;
+
+        result = _dthread_hashmap_locate(map, table, hash, key, &group, &slot);
+
+        if (result == _DTHREAD_HASHMAP_FOUND)
+        {
+            _dthread_hashmap_lock(&group->lock);
+
+            // a tombstone keeps the probe sequences of the other keys going
+            if (group->moved)
+                result = _DTHREAD_HASHMAP_MOVED;
+            else
+            {
+                previous = group->slots[slot];
+                _dthread_hashmap_set_ctrl(group, slot, _DTHREAD_HASHMAP_DELETED);
+                dthread_atomic_store_ptr((void**)&group->slots[slot], NULL);
+            }
+
+            _dthread_hashmap_unlock(&group->lock);
+        }
+    } while (result == _DTHREAD_HASHMAP_MOVED);
+
+    if (previous)
+    {
+        dthread_atomic_fetch_add_i64(&map->count, -1);
+        dthread_epoch_retire(&map->epoch, previous, free);
+    }
+
+    dthread_epoch_exit(&map->epoch);
+    _dthread_hashmap_unlock(stripe);
+
+    return previous ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: aio.h
+//    Date: 2024-09-10
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Asynchronous file I/O header file for dthreads library, this is not to be
+// *               used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_AIO_H_
+#define DTHREAD_AIO_H_
+
+#include "api.h"
+#include "atomic.h"
+
+#include <stddef.h>
+
+// io_uring is used through raw system calls, only the kernel header is needed
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#define DTHREAD_AIO_URING_AVAILABLE
+#endif
+#endif
+
+#define DTHREAD_AIO_READ 0
+#define DTHREAD_AIO_WRITE 1
+#define DTHREAD_AIO_FSYNC 2
+
+#define DTHREAD_AIO_BACKEND_URING 1
+#define DTHREAD_AIO_BACKEND_THREADS 2
+
+// returned by `dthread_aio_submit` when the operations are queued but the kernel did not take them
+#define DTHREAD_AIO_QUEUED 2
+
+struct DThreadAIOOp;
+
+/**
+ * @typedef DThreadAIOCallback
+ * @brief Called once an operation has completed, `op->result` holds the result.
+ */
+typedef void (*DThreadAIOCallback)(struct DThreadAIOOp* op);
+
+/**
+ * @struct DThreadAIOOp
+ * @brief An asynchronous file operation, it must stay alive until its callback has been called.
+ *
+ * - `opcode`: `DTHREAD_AIO_READ`, `DTHREAD_AIO_WRITE` or `DTHREAD_AIO_FSYNC`.
+ * - `fd`, `buffer`, `length`, `offset`: like `pread`/`pwrite`, only `fd` is used by fsync.
+ * - `fixed`, `buffer_index`: `buffer` lies within the registered buffer `buffer_index`, the
+ *   kernel skips mapping it for every operation.
+ * - `callback`, `data`: optional completion routine and its data.
+ * - `result`: the number of bytes transferred or a negative error code (`-errno` on POSIX,
+ *   `-GetLastError()` on Windows).
+ */
+typedef struct DThreadAIOOp
+{
+    int opcode;
+    int fd;
+    void* buffer;
+    size_t length;
+    uint64_t offset;
+
+    int fixed;
+    int buffer_index;
+
+    DThreadAIOCallback callback;
+    void* data;
+
+    int64_t result;
+
+    struct DThreadAIO* aio;
+    struct DThreadAIOOp* next;
+} DThreadAIOOp;
+
+/**
+ * @struct DThreadAIOConfig
+ * @brief Configuration of an asynchronous file I/O engine.
+ *
+ * - `queue_depth`: io_uring submission queue entries, 0 means 256.
+ * - `num_threads`: threads of the fallback backend, 0 means 4.
+ * - `pool`: optional pool running the callbacks, NULL runs them on the completion thread.
+ * - `force_threads`: uses the thread backend even where io_uring is available.
+ */
+typedef struct DThreadAIOConfig
+{
+    unsigned int queue_depth;
+    int num_threads;
+    DThreadPool* pool;
+    int force_threads;
+} DThreadAIOConfig;
+
+typedef struct _DThreadAIORing
+{
+    int fd;
+    unsigned int sq_entries;
+    unsigned int cq_entries;
+
+    void* sq_map;
+    size_t sq_map_size;
+    void* cq_map;
+    size_t cq_map_size;
+    void* sqes;
+    size_t sqes_size;
+
+    unsigned int* sq_head;
+    unsigned int* sq_tail;
+    unsigned int* sq_mask;
+    unsigned int* sq_array;
+    unsigned int* cq_head;
+    unsigned int* cq_tail;
+    unsigned int* cq_mask;
+    void* cqes;
+} _DThreadAIORing;
+
+/**
+ * @struct DThreadAIO
+ * @brief Asynchronous file I/O engine, io_uring where the kernel has it, a set of threads
+ *        running blocking calls elsewhere.
+ */
+typedef struct DThreadAIO
+{
+    DThreadAIOConfig config;
+    int backend;
+
+    _DThreadAIORing ring;
+
+    DThreadMutex mutex;
+    DThreadCond cond;
+    DThreadCond idle;
+
+    // queued for the threads, or waiting for room in the ring
+    DThreadAIOOp* head;
+    DThreadAIOOp* tail;
+
+    int64_t inflight;
+    int64_t pending;
+    int32_t stop;
+
+    DThread* threads;
+    int num_threads;
+
+    int num_buffers;
+} DThreadAIO;
+
+/**
+ * @brief Starts an asynchronous file I/O engine.
+ *
+ * @param aio A pointer to the engine to initialize.
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_aio_init(DThreadAIO* aio, DThreadAIOConfig* config);
+
+/**
+ * @brief Waits for the submitted operations and releases the engine.
+ *
+ * @param aio A pointer to the engine to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_aio_destroy(DThreadAIO* aio);
+
+/**
+ * @brief Registers buffers for `fixed` operations, it can be called once before any submission.
+ *
+ * @param aio A pointer to the engine.
+ * @param buffers The buffers to register.
+ * @param lengths The length of every buffer.
+ * @param count The number of buffers.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_aio_register_buffers(DThreadAIO* aio, void** buffers, size_t* lengths, int count);
+
+/**
+ * @brief Submits a batch of operations with a single system call.
+ *
+ * `DTHREAD_AIO_QUEUED` means io_uring refused the system call after the operations were queued:
+ * they still belong to the engine, complete through their callbacks and must stay alive. They go
+ * to the kernel with the next submission, a call with `count` 0 retries on its own.
+ *
+ * @param aio A pointer to the engine.
+ * @param ops The operations to submit.
+ * @param count The number of operations.
+ * @return 0 on success, `DTHREAD_AIO_QUEUED` as described above, 1 when nothing was queued.
+ */
+DTHREAD_API int dthread_aio_submit(DThreadAIO* aio, DThreadAIOOp** ops, int count);
+
+/**
+ * @brief Waits until every submitted operation has completed and its callback has returned.
+ *
+ * @param aio A pointer to the engine.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_aio_wait(DThreadAIO* aio);
+
+/**
+ * @macro dthread_aio_backend
+ * @brief gets the backend of the engine, `DTHREAD_AIO_BACKEND_URING` or `DTHREAD_AIO_BACKEND_THREADS`
+ *
+ * @param AIO_PTR The reference (pointer) to the engine.
+ */
+#define dthread_aio_backend(AIO_PTR) ((AIO_PTR)->backend)
+
+#endif // DTHREAD_AIO_H_
@@ -0,0 +1,162 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: atomic.h
+//    Date: 2024-09-01
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Portable atomic operations for dthreads library, GCC/Clang builtins or
+// *               MSVC intrinsics. Plain loads/stores are acquire/release, `_relaxed`
+// *               variants have no ordering, read-modify-write operations are sequentially
+// *               consistent. This is not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_ATOMIC_H_
+#define DTHREAD_ATOMIC_H_
+
+#include <stdint.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+
+#include <intrin.h>
+
+#define DTHREAD_THREAD_LOCAL __declspec(thread)
+
+static __inline int32_t dthread_atomic_load_i32(volatile int32_t* p)
+{
+    int32_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static __inline int64_t dthread_atomic_load_i64(volatile int64_t* p)
+{
+    int64_t v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+static __inline void* dthread_atomic_load_ptr(void* volatile* p)
+{
+    void* v = *p;
+    _ReadWriteBarrier();
+    return v;
+}
+
+#define dthread_atomic_load_relaxed_i32(P) (*(volatile int32_t*)(P))
+#define dthread_atomic_load_relaxed_i64(P) (*(volatile int64_t*)(P))
+#define dthread_atomic_load_relaxed_ptr(P) (*(void* volatile*)(P))
+
+static __inline void dthread_atomic_store_i32(volatile int32_t* p, int32_t v)
+{
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+static __inline void dthread_atomic_store_i64(volatile int64_t* p, int64_t v)
+{
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+static __inline void dthread_atomic_store_ptr(void* volatile* p, void* v)
+{
+    _ReadWriteBarrier();
+    *p = v;
+}
+
+#define dthread_atomic_store_relaxed_i32(P, V) (*(volatile int32_t*)(P) = (V))
+#define dthread_atomic_store_relaxed_i64(P, V) (*(volatile int64_t*)(P) = (V))
+#define dthread_atomic_store_relaxed_ptr(P, V) (*(void* volatile*)(P) = (V))
+
+static __inline int dthread_atomic_cas_i32(volatile int32_t* p, int32_t* expected, int32_t desired)
+{
+    int32_t old = (int32_t)_InterlockedCompareExchange((volatile long*)p, desired, *expected);
+    if (old == *expected)
+        return 1;
+    *expected = old;
+    return 0;
+}
+
+static __inline int dthread_atomic_cas_i64(volatile int64_t* p, int64_t* expected, int64_t desired)
+{
+    int64_t old = _InterlockedCompareExchange64(p, desired, *expected);
+    if (old == *expected)
+        return 1;
+    *expected = old;
+    return 0;
+}
+
+static __inline int dthread_atomic_cas_ptr(void* volatile* p, void** expected, void* desired)
+{
+    void* old = _InterlockedCompareExchangePointer(p, desired, *expected);
+    if (old == *expected)
+        return 1;
+    *expected = old;
+    return 0;
+}
+
+#define dthread_atomic_fetch_add_i32(P, V) ((int32_t)_InterlockedExchangeAdd((volatile long*)(P), (V)))
+#define dthread_atomic_fetch_add_i64(P, V) _InterlockedExchangeAdd64((P), (V))
+#define dthread_atomic_exchange_i32(P, V) ((int32_t)_InterlockedExchange((volatile long*)(P), (V)))
+#define dthread_atomic_exchange_i64(P, V) _InterlockedExchange64((P), (V))
+#define dthread_atomic_exchange_ptr(P, V) _InterlockedExchangePointer((P), (V))
+#define dthread_atomic_fence() MemoryBarrier()
+#define dthread_atomic_pause() YieldProcessor()
+
+#else
+
+#if defined(__cplusplus)
+#define DTHREAD_THREAD_LOCAL thread_local
+#elif defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define DTHREAD_THREAD_LOCAL _Thread_local
+#else
+#define DTHREAD_THREAD_LOCAL __thread
+#endif
+
+#define dthread_atomic_load_i32(P) __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define dthread_atomic_load_i64(P) __atomic_load_n((P), __ATOMIC_ACQUIRE)
+#define dthread_atomic_load_ptr(P) __atomic_load_n((P), __ATOMIC_ACQUIRE)
+
+#define dthread_atomic_load_relaxed_i32(P) __atomic_load_n((P), __ATOMIC_RELAXED)
+#define dthread_atomic_load_relaxed_i64(P) __atomic_load_n((P), __ATOMIC_RELAXED)
+#define dthread_atomic_load_relaxed_ptr(P) __atomic_load_n((P), __ATOMIC_RELAXED)
+
+#define dthread_atomic_store_i32(P, V) __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#define dthread_atomic_store_i64(P, V) __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+#define dthread_atomic_store_ptr(P, V) __atomic_store_n((P), (V), __ATOMIC_RELEASE)
+
+#define dthread_atomic_store_relaxed_i32(P, V) __atomic_store_n((P), (V), __ATOMIC_RELAXED)
+#define dthread_atomic_store_relaxed_i64(P, V) __atomic_store_n((P), (V), __ATOMIC_RELAXED)
+#define dthread_atomic_store_relaxed_ptr(P, V) __atomic_store_n((P), (V), __ATOMIC_RELAXED)
+
+#define dthread_atomic_cas_i32(P, EXPECTED, DESIRED) \
+    __atomic_compare_exchange_n((P), (EXPECTED), (DESIRED), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define dthread_atomic_cas_i64(P, EXPECTED, DESIRED) \
+    __atomic_compare_exchange_n((P), (EXPECTED), (DESIRED), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define dthread_atomic_cas_ptr(P, EXPECTED, DESIRED) \
+    __atomic_compare_exchange_n((P), (EXPECTED), (DESIRED), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+
+#define dthread_atomic_fetch_add_i32(P, V) __atomic_fetch_add((P), (V), __ATOMIC_SEQ_CST)
+#define dthread_atomic_fetch_add_i64(P, V) __atomic_fetch_add((P), (V), __ATOMIC_SEQ_CST)
+#define dthread_atomic_exchange_i32(P, V) __atomic_exchange_n((P), (V), __ATOMIC_SEQ_CST)
+#define dthread_atomic_exchange_i64(P, V) __atomic_exchange_n((P), (V), __ATOMIC_SEQ_CST)
+#define dthread_atomic_exchange_ptr(P, V) __atomic_exchange_n((P), (V), __ATOMIC_SEQ_CST)
+#define dthread_atomic_fence() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define dthread_atomic_pause() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define dthread_atomic_pause() __asm__ __volatile__("yield")
+#else
+#define dthread_atomic_pause() ((void)0)
+#endif
+
+#endif
+
+#endif // DTHREAD_ATOMIC_H_
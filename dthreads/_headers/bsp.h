@@ -0,0 +1,188 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: bsp.h
+//    Date: 2024-08-26
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Bulk-synchronous-parallel (BSP) superstep runtime header file for
+// *               dthreads library, this is not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_BSP_H_
+#define DTHREAD_BSP_H_
+
+#include "api.h"
+
+#include <stddef.h>
+
+struct DThreadBSP;
+
+/**
+ * @struct DThreadBSPContext
+ * @brief Per worker view of the current superstep.
+ *
+ * One context is owned by each worker of the team, it is passed to the superstep function
+ * and describes which part of the data (`begin` to `end`) belongs to the worker.
+ */
+typedef struct DThreadBSPContext
+{
+    struct DThreadBSP* bsp;
+    void* data;
+
+    int worker;
+    int num_workers;
+
+    size_t superstep;
+    size_t begin;
+    size_t end;
+
+    int _recv_src;
+    size_t _recv_index;
+    size_t _sent;
+} DThreadBSPContext;
+
+/**
+ * @typedef DThreadBSPStep
+ * @brief Defines a function pointer type for superstep functions.
+ *
+ * A superstep function is called once per worker per superstep, it must return non-zero
+ * while the worker still has work to do (votes to continue) and zero to vote for halting.
+ */
+typedef int (*DThreadBSPStep)(DThreadBSPContext* ctx);
+
+/**
+ * @struct DThreadBSPConfig
+ * @brief Configuration of a BSP team.
+ *
+ * - `num_workers`: number of workers, 0 means `dthread_cpu_count()`.
+ * - `num_items`: number of data items to be partitioned evenly among the workers.
+ * - `message_size`: size of each message in bytes, 0 disables messaging.
+ * - `max_supersteps`: upper bound of supersteps per run, 0 means unlimited.
+ * - `pin`: when non-zero worker `i` is pinned to logical CPU `i % dthread_cpu_count()`.
+ */
+typedef struct DThreadBSPConfig
+{
+    int num_workers;
+    size_t num_items;
+    size_t message_size;
+    size_t max_supersteps;
+    int pin;
+} DThreadBSPConfig;
+
+typedef struct _DThreadBSPBuffer
+{
+    char* data;
+    size_t count;
+    size_t capacity;
+} _DThreadBSPBuffer;
+
+/**
+ * @struct DThreadBSP
+ * @brief A fixed team of workers running supersteps over partitioned data.
+ *
+ * Messages sent in superstep `s` are delivered in superstep `s + 1`, the outboxes are
+ * double-buffered so that no locking is needed while sending or receiving.
+ */
+typedef struct DThreadBSP
+{
+    DThread* workers;
+    DThreadBSPContext* contexts;
+    _DThreadBSPBuffer* outboxes;
+    int* votes;
+    size_t* sent;
+
+    DThreadBarrier barrier;
+    DThreadMutex mutex;
+    DThreadCond cond;
+
+    DThreadBSPStep step;
+    void* data;
+
+    int num_workers;
+    size_t num_items;
+    size_t chunk;
+    size_t message_size;
+    size_t max_supersteps;
+    size_t supersteps;
+    int pin;
+
+    unsigned int generation;
+    int finished;
+    int stop;
+} DThreadBSP;
+
+/**
+ * @brief Initializes a BSP team and starts its workers.
+ *
+ * @param bsp A pointer to the BSP team to initialize.
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_bsp_init(DThreadBSP* bsp, DThreadBSPConfig* config);
+
+/**
+ * @brief Runs supersteps until global termination.
+ *
+ * Every worker calls `step` for its partition, then all workers meet at a barrier.
+ * The run terminates when every worker voted to halt and no message was sent in the
+ * superstep, or when `max_supersteps` is reached. This function blocks the calling thread
+ * and the team can be reused for further runs.
+ *
+ * @param bsp A pointer to the BSP team.
+ * @param step The superstep function.
+ * @param data User data available as `ctx->data` in the superstep function.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_bsp_run(DThreadBSP* bsp, DThreadBSPStep step, void* data);
+
+/**
+ * @brief Sends a message to be delivered to a worker in the next superstep.
+ *
+ * `message_size` bytes are copied from `message` into the sender's outbox.
+ *
+ * @param ctx The context of the sending worker.
+ * @param dest The index of the receiving worker.
+ * @param message A pointer to the message to be copied.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_bsp_send(DThreadBSPContext* ctx, int dest, const void* message);
+
+/**
+ * @brief Receives the next message sent to this worker in the previous superstep.
+ *
+ * @param ctx The context of the receiving worker.
+ * @return A pointer to the message or NULL when the inbox is exhausted.
+ */
+DTHREAD_API const void* dthread_bsp_recv(DThreadBSPContext* ctx);
+
+/**
+ * @brief Stops the workers and releases all the resources held by the BSP team.
+ *
+ * @param bsp A pointer to the BSP team to destroy.
+ */
+DTHREAD_API void dthread_bsp_destroy(DThreadBSP* bsp);
+
+/**
+ * @macro dthread_bsp_owner
+ * @brief gets the index of the worker owning the given item
+ *
+ * @param BSP_PTR The reference (pointer) to the BSP team.
+ * @param ITEM The index of the item.
+ */
+#define dthread_bsp_owner(BSP_PTR, ITEM) ((int)((ITEM) / (BSP_PTR)->chunk))
+
+/**
+ * @macro dthread_bsp_get_supersteps
+ * @brief gets the number of supersteps executed by the last run
+ *
+ * @param BSP_PTR The reference (pointer) to the BSP team.
+ */
+#define dthread_bsp_get_supersteps(BSP_PTR) ((BSP_PTR)->supersteps)
+
+#endif // DTHREAD_BSP_H_
@@ -0,0 +1,66 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: clock.h
+//    Date: 2024-09-11
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Monotonic clock and high-resolution sleep header file for dthreads
+// *               library, this is not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_CLOCK_H_
+#define DTHREAD_CLOCK_H_
+
+#include "api.h"
+#include "atomic.h"
+
+/**
+ * @macro DTHREAD_SLEEP_SPIN_NS
+ * @brief Initial spin margin of the sleeps, it adapts to the observed wakeup latency.
+ */
+#ifndef DTHREAD_SLEEP_SPIN_NS
+#define DTHREAD_SLEEP_SPIN_NS 100000
+#endif
+
+// the TSC is only read where the kernel itself trusts it, DTHREAD_CLOCK_NO_TSC opts out
+#if defined(__linux__) && defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__)) && !defined(DTHREAD_CLOCK_NO_TSC)
+#define DTHREAD_CLOCK_TSC_AVAILABLE
+#endif
+
+/**
+ * @brief Gets a monotonic time stamp in nanoseconds.
+ *
+ * Only differences between time stamps are meaningful, the origin is unspecified. On x86-64
+ * Linux with a TSC clocksource the counter is read directly once it has been calibrated
+ * against CLOCK_MONOTONIC.
+ *
+ * @return The current time in nanoseconds.
+ */
+DTHREAD_API uint64_t dthread_now_ns(void);
+
+/**
+ * @brief Sleeps for `ns` nanoseconds, the end of the sleep is spun out for precision.
+ *
+ * @param ns The duration of the sleep in nanoseconds.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_sleep_ns(uint64_t ns);
+
+/**
+ * @brief Sleeps until `dthread_now_ns()` reaches `deadline_ns`.
+ *
+ * The kernel sleeps until shortly before the deadline (an absolute timer, so no drift
+ * accumulates in periodic loops) and the remaining microseconds are spun.
+ *
+ * @param deadline_ns The time stamp to wake up at, as returned by `dthread_now_ns`.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_sleep_until(uint64_t deadline_ns);
+
+#endif // DTHREAD_CLOCK_H_
@@ -0,0 +1,114 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: epoch.h
+//    Date: 2024-09-18
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Epoch based memory reclamation header file for dthreads library, this is not
+// *               to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_EPOCH_H_
+#define DTHREAD_EPOCH_H_
+
+#include "api.h"
+#include "atomic.h"
+
+/**
+ * @macro DTHREAD_EPOCH_MAX_THREADS
+ * @brief Maximum `dthread_index` of a thread using an epoch domain, a multiple of 64.
+ */
+#ifndef DTHREAD_EPOCH_MAX_THREADS
+#define DTHREAD_EPOCH_MAX_THREADS 4096
+#endif
+
+#define _DTHREAD_EPOCH_CHUNK 64
+
+/**
+ * @typedef DThreadReclaimFunc
+ * @brief Releases a retired pointer once no thread can see it anymore.
+ */
+typedef void (*DThreadReclaimFunc)(void* ptr);
+
+typedef struct _DThreadEpochRetired
+{
+    void* ptr;
+    DThreadReclaimFunc reclaim;
+    int64_t epoch;
+} _DThreadEpochRetired;
+
+// one per thread index, only its owner touches everything but `active`, the union makes every
+// record one cache line whatever the size of the fields and the chunks are allocated on a line
+typedef union _DThreadEpochRecord
+{
+    struct
+    {
+        int64_t active;
+        int depth;
+        int num_retired;
+        int cap_retired;
+        _DThreadEpochRetired* retired;
+    };
+
+    char padding[64];
+} _DThreadEpochRecord;
+
+/**
+ * @struct DThreadEpoch
+ * @brief An epoch based reclamation domain.
+ *
+ * Readers run between `dthread_epoch_enter` and `dthread_epoch_exit` without taking any lock,
+ * writers unlink shared objects and hand them to `dthread_epoch_retire`, which releases them
+ * two epochs later, when every reader that could still see them has left.
+ */
+typedef struct DThreadEpoch
+{
+    int64_t epoch;
+    _DThreadEpochRecord* chunks[DTHREAD_EPOCH_MAX_THREADS / _DTHREAD_EPOCH_CHUNK];
+} DThreadEpoch;
+
+/**
+ * @brief Initializes an epoch domain.
+ *
+ * @param domain A pointer to the domain to initialize.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_epoch_init(DThreadEpoch* domain);
+
+/**
+ * @brief Releases every pointer still retired and the domain, no thread may be inside it.
+ *
+ * @param domain A pointer to the domain to destroy.
+ */
+DTHREAD_API void dthread_epoch_destroy(DThreadEpoch* domain);
+
+/**
+ * @brief Enters a read-side section, the calls can be nested.
+ *
+ * @param domain A pointer to the domain.
+ */
+DTHREAD_API void dthread_epoch_enter(DThreadEpoch* domain);
+
+/**
+ * @brief Leaves a read-side section.
+ *
+ * @param domain A pointer to the domain.
+ */
+DTHREAD_API void dthread_epoch_exit(DThreadEpoch* domain);
+
+/**
+ * @brief Releases an object unlinked from a shared structure once no reader can see it.
+ *
+ * @param domain A pointer to the domain.
+ * @param ptr The unlinked object.
+ * @param reclaim The function releasing it, called later by any thread of the domain.
+ */
+DTHREAD_API void dthread_epoch_retire(DThreadEpoch* domain, void* ptr, DThreadReclaimFunc reclaim);
+
+#endif // DTHREAD_EPOCH_H_
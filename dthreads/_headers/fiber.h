@@ -0,0 +1,354 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: fiber.h
+//    Date: 2024-09-07
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Fibers (M:N green threads) header file for dthreads library, this is
+// *               not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_FIBER_H_
+#define DTHREAD_FIBER_H_
+
+#include "api.h"
+#include "atomic.h"
+
+#include <stddef.h>
+
+// hand-written context switch where the ABI is known, `ucontext` elsewhere, Windows fibers on Windows
+#if defined(_WIN32) || defined(_WIN64)
+#define _DTHREAD_FIBER_WINDOWS
+#elif !defined(DTHREAD_FIBER_UCONTEXT) && defined(__GNUC__) && (defined(__x86_64__) || defined(__aarch64__))
+#define _DTHREAD_FIBER_ASM
+#else
+#include <ucontext.h>
+#endif
+
+typedef struct _DThreadFiberContext
+{
+#if defined(_DTHREAD_FIBER_WINDOWS)
+    void* handle;
+#elif defined(_DTHREAD_FIBER_ASM)
+    void* sp;
+#else
+    ucontext_t uc;
+#endif
+} _DThreadFiberContext;
+
+typedef struct _DThreadFiber
+{
+    _DThreadFiberContext ctx;
+
+    DThreadRoutine func;
+    void* data;
+
+    // the mapping holding the stack, the fiber itself lives at its top
+    void* stack;
+    size_t stack_size;
+
+    struct DThreadFiberScheduler* sched;
+    struct _DThreadFiber* next;
+    int state;
+} _DThreadFiber;
+
+typedef struct _DThreadFiberCarrier
+{
+    DThread thread;
+    _DThreadFiberContext ctx;
+
+    struct DThreadFiberScheduler* sched;
+    int index;
+
+    // run queue, guarded by the spin lock
+    int32_t lock;
+    _DThreadFiber* head;
+    _DThreadFiber* tail;
+    int64_t count;
+
+    _DThreadFiber* current;
+
+    // spin lock of the wait queue the current fiber blocked on, released once it is switched out
+    int32_t* release;
+} _DThreadFiberCarrier;
+
+/**
+ * @struct DThreadFiberConfig
+ * @brief Configuration of a fiber scheduler.
+ *
+ * - `num_carriers`: number of carrier threads running the fibers, 0 means `dthread_cpu_count()`.
+ * - `stack_size`: stack size of every fiber, 0 means 64KB. Pages are only committed when touched.
+ * - `max_cached`: stacks of finished fibers kept for reuse, 0 means 1024 and -1 disables the cache.
+ * - `unguarded`: 1 skips the guard page below each stack, every guarded stack costs two kernel
+ *   memory mappings which limits the number of live fibers (`vm.max_map_count` on Linux).
+ */
+typedef struct DThreadFiberConfig
+{
+    int num_carriers;
+    size_t stack_size;
+    int max_cached;
+    int unguarded;
+} DThreadFiberConfig;
+
+/**
+ * @struct DThreadFiberScheduler
+ * @brief Runs many fibers over a small set of carrier threads.
+ *
+ * Every carrier owns a run queue, fibers woken or spawned by a fiber go to the queue of its
+ * carrier and idle carriers steal from the others.
+ */
+typedef struct DThreadFiberScheduler
+{
+    DThreadFiberConfig config;
+
+    // every slot is visible to the carriers from the start, only the first `num_started` run
+    _DThreadFiberCarrier* carriers;
+    int num_carriers;
+    int num_started;
+
+    DThreadMutex mutex;
+    DThreadCond cond;
+    DThreadCond idle;
+
+    int64_t sleepers;
+    int64_t pending;
+    int64_t next_carrier;
+    int32_t stop;
+
+    // stacks of finished fibers
+    int32_t cache_lock;
+    _DThreadFiber* cache;
+    int num_cached;
+
+    size_t page_size;
+} DThreadFiberScheduler;
+
+/**
+ * @struct DThreadFiberMutex
+ * @brief A mutex for fibers, a fiber waiting for it yields its carrier instead of blocking it.
+ */
+typedef struct DThreadFiberMutex
+{
+    int32_t lock;
+    int locked;
+    _DThreadFiber* head;
+    _DThreadFiber* tail;
+} DThreadFiberMutex;
+
+/**
+ * @struct DThreadFiberCond
+ * @brief A condition variable for fibers, used together with a `DThreadFiberMutex`.
+ */
+typedef struct DThreadFiberCond
+{
+    int32_t lock;
+    _DThreadFiber* head;
+    _DThreadFiber* tail;
+} DThreadFiberCond;
+
+/**
+ * @struct DThreadFiberChannel
+ * @brief A bounded FIFO of pointers between fibers, senders wait while it is full and receivers
+ *        while it is empty.
+ */
+typedef struct DThreadFiberChannel
+{
+    int32_t lock;
+
+    void** items;
+    size_t capacity;
+    size_t first;
+    size_t count;
+    int closed;
+
+    _DThreadFiber* senders_head;
+    _DThreadFiber* senders_tail;
+    _DThreadFiber* receivers_head;
+    _DThreadFiber* receivers_tail;
+} DThreadFiberChannel;
+
+/**
+ * @brief Starts the carrier threads of a fiber scheduler.
+ *
+ * @param sched A pointer to the scheduler to initialize.
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_scheduler_init(DThreadFiberScheduler* sched, DThreadFiberConfig* config);
+
+/**
+ * @brief Waits until every fiber of the scheduler has returned.
+ *
+ * It must be called from a thread that is not a carrier of the scheduler.
+ *
+ * @param sched A pointer to the scheduler.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_scheduler_wait(DThreadFiberScheduler* sched);
+
+/**
+ * @brief Waits for the fibers, stops the carriers and releases the scheduler.
+ *
+ * @param sched A pointer to the scheduler to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_scheduler_destroy(DThreadFiberScheduler* sched);
+
+/**
+ * @brief Starts a fiber running the routine, its return value is ignored.
+ *
+ * It can be called from any thread or fiber.
+ *
+ * @param sched A pointer to the scheduler.
+ * @param func The routine to run.
+ * @param data The data passed to the routine.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_spawn(DThreadFiberScheduler* sched, DThreadRoutine func, void* data);
+
+/**
+ * @brief Puts the calling fiber at the end of the run queue and runs the next one.
+ *
+ * Outside of a fiber it yields the thread to the operating system.
+ */
+DTHREAD_API void dthread_fiber_yield(void);
+
+/**
+ * @brief Tells whether the caller runs on a fiber.
+ *
+ * @return Non-zero on a fiber, zero otherwise.
+ */
+DTHREAD_API int dthread_fiber_active(void);
+
+/**
+ * @brief Initializes a fiber mutex.
+ *
+ * @param mutex A pointer to the mutex to initialize.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_mutex_init(DThreadFiberMutex* mutex);
+
+/**
+ * @brief Locks a fiber mutex, the calling fiber is suspended while another one holds it.
+ *
+ * @param mutex A pointer to the mutex to lock.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_mutex_lock(DThreadFiberMutex* mutex);
+
+/**
+ * @brief Unlocks a fiber mutex, the ownership goes straight to the first waiting fiber.
+ *
+ * @param mutex A pointer to the mutex to unlock.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_mutex_unlock(DThreadFiberMutex* mutex);
+
+/**
+ * @brief Destroys a fiber mutex, no fiber may be waiting for it.
+ *
+ * @param mutex A pointer to the mutex to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_mutex_destroy(DThreadFiberMutex* mutex);
+
+/**
+ * @brief Initializes a fiber condition variable.
+ *
+ * @param cond A pointer to the condition variable to initialize.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_cond_init(DThreadFiberCond* cond);
+
+/**
+ * @brief Unlocks the mutex and suspends the calling fiber until the condition is signaled,
+ *        the mutex is locked again before returning.
+ *
+ * @param cond A pointer to the condition variable.
+ * @param mutex A pointer to the locked mutex.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_cond_wait(DThreadFiberCond* cond, DThreadFiberMutex* mutex);
+
+/**
+ * @brief Wakes one fiber waiting on the condition variable.
+ *
+ * @param cond A pointer to the condition variable.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_cond_signal(DThreadFiberCond* cond);
+
+/**
+ * @brief Wakes every fiber waiting on the condition variable.
+ *
+ * @param cond A pointer to the condition variable.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_cond_broadcast(DThreadFiberCond* cond);
+
+/**
+ * @brief Destroys a fiber condition variable, no fiber may be waiting on it.
+ *
+ * @param cond A pointer to the condition variable to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_cond_destroy(DThreadFiberCond* cond);
+
+/**
+ * @brief Initializes a fiber channel.
+ *
+ * @param chan A pointer to the channel to initialize.
+ * @param capacity Number of items the channel buffers, 0 means 1.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_channel_init(DThreadFiberChannel* chan, size_t capacity);
+
+/**
+ * @brief Sends an item, the calling fiber is suspended while the channel is full.
+ *
+ * @param chan A pointer to the channel.
+ * @param item The item to send.
+ * @return 0 on success, non-zero when the channel is closed.
+ */
+DTHREAD_API int dthread_fiber_channel_send(DThreadFiberChannel* chan, void* item);
+
+/**
+ * @brief Receives an item, the calling fiber is suspended while the channel is empty.
+ *
+ * @param chan A pointer to the channel.
+ * @param item A pointer receiving the item.
+ * @return 0 on success, non-zero when the channel is closed and drained.
+ */
+DTHREAD_API int dthread_fiber_channel_recv(DThreadFiberChannel* chan, void** item);
+
+/**
+ * @brief Closes a channel, waiting senders fail and receivers fail once it is drained.
+ *
+ * @param chan A pointer to the channel to close.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_channel_close(DThreadFiberChannel* chan);
+
+/**
+ * @brief Destroys a channel, no fiber may be waiting on it.
+ *
+ * @param chan A pointer to the channel to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fiber_channel_destroy(DThreadFiberChannel* chan);
+
+/**
+ * @macro dthread_fiber_count
+ * @brief gets the number of fibers of the scheduler that have not returned yet
+ *
+ * @param SCHED_PTR The reference (pointer) to the scheduler.
+ */
+#define dthread_fiber_count(SCHED_PTR) dthread_atomic_load_i64(&(SCHED_PTR)->pending)
+
+#endif // DTHREAD_FIBER_H_
@@ -0,0 +1,144 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: graph.h
+//    Date: 2024-09-15
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Task graph header file for dthreads library, this is not to be used in your
+// *               library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_GRAPH_H_
+#define DTHREAD_GRAPH_H_
+
+#include "api.h"
+#include "atomic.h"
+
+/**
+ * @struct DThreadGraphNode
+ * @brief A step of a task graph, a routine with its data and the nodes that depend on it.
+ */
+typedef struct DThreadGraphNode
+{
+    DThreadRoutine func;
+    void* data;
+
+    // the estimated cost and the costliest path from this node to the end of the graph
+    uint64_t cost;
+    uint64_t rank;
+
+    int* successors;
+    int num_successors;
+    int successors_capacity;
+
+    int num_predecessors;
+    int32_t pending;
+} DThreadGraphNode;
+
+/**
+ * @struct DThreadGraph
+ * @brief A directed acyclic graph of routines, it can be executed any number of times.
+ */
+typedef struct DThreadGraph
+{
+    DThreadGraphNode* nodes;
+    int num_nodes;
+    int capacity;
+
+    // the ranks and the ready heap are rebuilt when nodes or edges were added
+    int dirty;
+
+    // nodes whose predecessors have completed, the highest rank on top
+    int* ready;
+    int num_ready;
+
+    DThreadPool* pool;
+    int64_t runners;
+    uint64_t runs;
+
+    DThreadMutex mutex;
+    DThreadCond cond;
+} DThreadGraph;
+
+/**
+ * @brief Initializes an empty graph.
+ *
+ * @param graph A pointer to the graph to initialize.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_graph_init(DThreadGraph* graph);
+
+/**
+ * @brief Adds a node to the graph.
+ *
+ * @param graph A pointer to the graph.
+ * @param func The routine of the node, its result is discarded.
+ * @param data The data passed to the routine.
+ * @return The index of the node or -1 on failure.
+ */
+DTHREAD_API int dthread_graph_add_node(DThreadGraph* graph, DThreadRoutine func, void* data);
+
+/**
+ * @brief Makes `to` wait for `from` to complete.
+ *
+ * @param graph A pointer to the graph.
+ * @param from The index of the node that runs first.
+ * @param to The index of the node that depends on it.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_graph_add_edge(DThreadGraph* graph, int from, int to);
+
+/**
+ * @brief Sets the estimated cost of a node (1 by default), among the ready nodes the one
+ *        heading the costliest remaining path runs first.
+ *
+ * @param graph A pointer to the graph.
+ * @param node The index of the node.
+ * @param cost The estimated cost, in any unit shared by the nodes.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_graph_set_cost(DThreadGraph* graph, int node, uint64_t cost);
+
+/**
+ * @brief Executes the graph on a pool and waits for all the nodes to complete.
+ *
+ * Every node runs once its predecessors have completed, the dependency counters are reset at
+ * the beginning of every run so a graph is executed again without allocating anything. A graph
+ * must not be run by two threads at the same time.
+ *
+ * @param graph A pointer to the graph.
+ * @param pool The pool to run on, NULL runs the nodes on the calling thread.
+ * @return 0 on success, non-zero on failure (the graph has a cycle).
+ */
+DTHREAD_API int dthread_graph_run(DThreadGraph* graph, DThreadPool* pool);
+
+/**
+ * @brief Releases the graph.
+ *
+ * @param graph A pointer to the graph to destroy.
+ */
+DTHREAD_API void dthread_graph_destroy(DThreadGraph* graph);
+
+/**
+ * @macro dthread_graph_get_num_nodes
+ * @brief gets the number of nodes of the graph
+ *
+ * @param GRAPH_PTR The reference (pointer) to the graph.
+ */
+#define dthread_graph_get_num_nodes(GRAPH_PTR) ((GRAPH_PTR)->num_nodes)
+
+/**
+ * @macro dthread_graph_get_runs
+ * @brief gets the number of completed executions of the graph
+ *
+ * @param GRAPH_PTR The reference (pointer) to the graph.
+ */
+#define dthread_graph_get_runs(GRAPH_PTR) ((GRAPH_PTR)->runs)
+
+#endif // DTHREAD_GRAPH_H_
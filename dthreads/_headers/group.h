@@ -0,0 +1,114 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: group.h
+//    Date: 2024-08-31
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Thread group (completion queue) header file for dthreads library, this
+// *               is not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_GROUP_H_
+#define DTHREAD_GROUP_H_
+
+#include "api.h"
+
+#include <stddef.h>
+
+typedef struct _DThreadGroupEntry
+{
+    DThread inner;
+    DThread* thread;
+    struct DThreadGroup* group;
+    struct _DThreadGroupEntry* next;
+    int published;
+} _DThreadGroupEntry;
+
+/**
+ * @struct DThreadGroup
+ * @brief A group of threads whose completions are delivered through a queue.
+ *
+ * Every thread of the group posts itself to the completion queue as soon as its routine
+ * returns, so the results can be consumed in completion order instead of creation order.
+ */
+typedef struct DThreadGroup
+{
+    DThreadMutex mutex;
+    DThreadCond cond;
+
+    _DThreadGroupEntry* head;
+    _DThreadGroupEntry* tail;
+    _DThreadGroupEntry* free_entries;
+
+    size_t pending;
+    size_t failures;
+} DThreadGroup;
+
+/**
+ * @brief Initializes a thread group.
+ *
+ * @param group A pointer to the group to initialize.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_group_init(DThreadGroup* group);
+
+/**
+ * @brief Creates a new thread as a member of the group.
+ *
+ * @param group A pointer to the group.
+ * @param thread A pointer to a DThread initialized with `dthread_init_thread`, it must stay valid
+ *               until it is returned by `dthread_group_join_any`, `dthread_group_poll` or
+ *               the group is joined with `dthread_group_join_all`.
+ * @param attr Optional thread attributes; can be NULL for default attributes, must not be detached.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_group_create(DThreadGroup* group, DThread* thread, DThreadAttr* attr);
+
+/**
+ * @brief Waits for any thread of the group to complete.
+ *
+ * The returned thread is already joined and its result can be read with `dthread_get_result`.
+ *
+ * @param group A pointer to the group.
+ * @return The first thread that completed or NULL if no thread of the group is pending.
+ */
+DTHREAD_API DThread* dthread_group_join_any(DThreadGroup* group);
+
+/**
+ * @brief Returns a completed thread of the group without blocking.
+ *
+ * @param group A pointer to the group.
+ * @return A completed (and joined) thread or NULL if none has completed yet.
+ */
+DTHREAD_API DThread* dthread_group_poll(DThreadGroup* group);
+
+/**
+ * @brief Waits for all the pending threads of the group to complete.
+ *
+ * @param group A pointer to the group.
+ * @return 0 on success, non-zero if joining any of the threads failed.
+ */
+DTHREAD_API int dthread_group_join_all(DThreadGroup* group);
+
+/**
+ * @brief Destroys a group, all of its threads must be joined beforehand.
+ *
+ * @param group A pointer to the group to destroy.
+ */
+DTHREAD_API void dthread_group_destroy(DThreadGroup* group);
+
+/**
+ * @macro dthread_group_pending
+ * @brief gets the number of threads of the group that have not been consumed yet
+ *
+ * @param GROUP_PTR The reference (pointer) to the group.
+ */
+#define dthread_group_pending(GROUP_PTR) ((GROUP_PTR)->pending)
+
+#endif // DTHREAD_GROUP_H_
@@ -0,0 +1,136 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: hashmap.h
+//    Date: 2024-09-18
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Concurrent hash map header file for dthreads library, this is not to be used
+// *               in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_HASHMAP_H_
+#define DTHREAD_HASHMAP_H_
+
+#include "api.h"
+#include "atomic.h"
+#include "epoch.h"
+#include "mapreduce.h"
+
+/**
+ * @macro DTHREAD_HASHMAP_STRIPES
+ * @brief Number of writer locks serializing the writes of the keys hashed to them.
+ */
+#ifndef DTHREAD_HASHMAP_STRIPES
+#define DTHREAD_HASHMAP_STRIPES 64
+#endif
+
+typedef struct _DThreadHashMapStripe
+{
+    int32_t lock;
+    char padding[64 - sizeof(int32_t)];
+} _DThreadHashMapStripe;
+
+struct _DThreadHashMapTable;
+
+/**
+ * @struct DThreadHashMapConfig
+ * @brief Configuration of a hash map over fixed size keys and values.
+ *
+ * - `key_size`, `value_size`: sizes of the keys and values, keys are compared bytewise.
+ * - `hash`: optional key hash, NULL hashes the bytes of the key.
+ * - `capacity`: number of entries held before the first resize, 0 means 64.
+ */
+typedef struct DThreadHashMapConfig
+{
+    size_t key_size;
+    size_t value_size;
+    DThreadHashFunc hash;
+    size_t capacity;
+} DThreadHashMapConfig;
+
+/**
+ * @struct DThreadHashMap
+ * @brief A concurrent hash map, readers never lock or write shared memory.
+ *
+ * The table is open addressed in groups of 16 slots, each with 16 metadata bytes holding 7 bits
+ * of the hash of its entries, so a probe compares a whole group at once (with SSE2 when
+ * available). Writers lock the group they modify and the stripe of their key, and a resize
+ * moves the groups to the new table a few at a time as part of the following writes while
+ * readers look in both. Replaced entries and old tables are released through an epoch domain.
+ */
+typedef struct DThreadHashMap
+{
+    DThreadHashMapConfig config;
+    size_t key_stride;
+
+    struct _DThreadHashMapTable* table;
+    // the table being moved into `table`, NULL when no resize is running
+    struct _DThreadHashMapTable* old;
+
+    int64_t count;
+    int32_t resizing;
+
+    _DThreadHashMapStripe stripes[DTHREAD_HASHMAP_STRIPES];
+    DThreadEpoch epoch;
+} DThreadHashMap;
+
+/**
+ * @brief Initializes an empty hash map.
+ *
+ * @param map A pointer to the map to initialize.
+ * @param config The sizes of the keys and values, `key_size` cannot be 0.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_hashmap_init(DThreadHashMap* map, DThreadHashMapConfig* config);
+
+/**
+ * @brief Releases the map and its entries, no other thread may be using it.
+ *
+ * @param map A pointer to the map to destroy.
+ */
+DTHREAD_API void dthread_hashmap_destroy(DThreadHashMap* map);
+
+/**
+ * @brief Looks a key up without locking.
+ *
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @param value Where the value is copied when found; can be NULL.
+ * @return 0 when found, non-zero otherwise.
+ */
+DTHREAD_API int dthread_hashmap_get(DThreadHashMap* map, const void* key, void* value);
+
+/**
+ * @brief Inserts a key or replaces its value.
+ *
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @param value The value.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_hashmap_put(DThreadHashMap* map, const void* key, const void* value);
+
+/**
+ * @brief Removes a key.
+ *
+ * @param map A pointer to the map.
+ * @param key The key.
+ * @return 0 when the key was removed, non-zero when it was missing.
+ */
+DTHREAD_API int dthread_hashmap_remove(DThreadHashMap* map, const void* key);
+
+/**
+ * @macro dthread_hashmap_get_count
+ * @brief gets the number of entries
+ *
+ * @param MAP_PTR The reference (pointer) to the map.
+ */
+#define dthread_hashmap_get_count(MAP_PTR) dthread_atomic_load_i64(&(MAP_PTR)->count)
+
+#endif // DTHREAD_HASHMAP_H_
@@ -0,0 +1,121 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: mapreduce.h
+//    Date: 2024-09-14
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Map-reduce header file for dthreads library, this is not to be used in your
+// *               library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_MAPREDUCE_H_
+#define DTHREAD_MAPREDUCE_H_
+
+#include "api.h"
+
+#include <stddef.h>
+
+struct DThreadMapContext;
+
+/**
+ * @typedef DThreadMapFunc
+ * @brief Called for every input item, emits key/value pairs with `dthread_map_emit`.
+ */
+typedef void (*DThreadMapFunc)(struct DThreadMapContext* ctx, const void* item, void* data);
+
+/**
+ * @typedef DThreadMergeFunc
+ * @brief Merges `value` into the accumulated value `acc` of the same key, it must be
+ *        associative and commutative.
+ */
+typedef void (*DThreadMergeFunc)(void* acc, const void* value, void* data);
+
+/**
+ * @typedef DThreadReduceFunc
+ * @brief Called once for every distinct key with its final value.
+ */
+typedef void (*DThreadReduceFunc)(const void* key, const void* value, int partition, void* data);
+
+/**
+ * @typedef DThreadHashFunc
+ * @brief Hashes a key of `size` bytes.
+ */
+typedef uint64_t (*DThreadHashFunc)(const void* key, size_t size);
+
+/**
+ * @struct DThreadMapReduceConfig
+ * @brief Describes a map-reduce job over fixed size keys and values.
+ *
+ * - `key_size`, `value_size`: sizes of the keys and values, keys are compared bytewise.
+ * - `map`, `merge`, `reduce`: the job, `reduce` runs concurrently for different partitions
+ *   and serially within a partition.
+ * - `hash`: optional key hash, NULL hashes the bytes of the key.
+ * - `num_partitions`: number of partitions, 0 means four per worker.
+ * - `data`: passed to every callback.
+ */
+typedef struct DThreadMapReduceConfig
+{
+    size_t key_size;
+    size_t value_size;
+
+    DThreadMapFunc map;
+    DThreadMergeFunc merge;
+    DThreadReduceFunc reduce;
+    DThreadHashFunc hash;
+
+    int num_partitions;
+    void* data;
+} DThreadMapReduceConfig;
+
+typedef struct _DThreadMapTable
+{
+    unsigned char* slots;
+    size_t capacity;
+    size_t used;
+} _DThreadMapTable;
+
+/**
+ * @struct DThreadMapContext
+ * @brief The combiner of a map block, one hash table per partition.
+ */
+typedef struct DThreadMapContext
+{
+    struct _DThreadMapReduce* job;
+    _DThreadMapTable* tables;
+    int failed;
+} DThreadMapContext;
+
+/**
+ * @brief Runs a map-reduce job over an array on the workers of a pool.
+ *
+ * The input is split into one block per worker, every block combines what it emits in its
+ * own per-partition hash tables. Once all the blocks are mapped, every partition collects its
+ * tables from all the blocks, merges them and reduces its keys, in parallel and without locks.
+ *
+ * @param pool The pool to run on, NULL runs on the calling thread.
+ * @param items The input items.
+ * @param count The number of items.
+ * @param item_size The size of an item.
+ * @param config The job.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_map_reduce(DThreadPool* pool, const void* items, size_t count, size_t item_size, DThreadMapReduceConfig* config);
+
+/**
+ * @brief Emits a key/value pair from a map routine, it is merged right away with the pairs of
+ *        the same key emitted by the block.
+ *
+ * @param ctx The context passed to the map routine.
+ * @param key The key, `key_size` bytes.
+ * @param value The value, `value_size` bytes.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_map_emit(DThreadMapContext* ctx, const void* key, const void* value);
+
+#endif // DTHREAD_MAPREDUCE_H_
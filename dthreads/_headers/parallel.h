@@ -0,0 +1,142 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: parallel.h
+//    Date: 2024-09-12
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Parallel algorithms header file for dthreads library, this is not to be
+// *               used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_PARALLEL_H_
+#define DTHREAD_PARALLEL_H_
+
+#include "api.h"
+
+#include <stddef.h>
+
+/**
+ * @macro DTHREAD_PARALLEL_CUTOFF
+ * @brief Arrays with fewer elements are processed on the calling thread.
+ */
+#ifndef DTHREAD_PARALLEL_CUTOFF
+#define DTHREAD_PARALLEL_CUTOFF 16384
+#endif
+
+/**
+ * @typedef DThreadCompare
+ * @brief A `qsort` style comparator.
+ */
+typedef int (*DThreadCompare)(const void*, const void*);
+
+/**
+ * @typedef DThreadCombine
+ * @brief An associative operator, `result` may be the same as `left` or `right`.
+ */
+typedef void (*DThreadCombine)(void* result, const void* left, const void* right);
+
+#define DTHREAD_SCAN_EXCLUSIVE 0
+#define DTHREAD_SCAN_INCLUSIVE 1
+
+/**
+ * @brief Sorts an array on the workers of a pool with a sample sort.
+ *
+ * A sample of the array picks one splitter per bucket, the elements are scattered into their
+ * buckets in parallel and every bucket is sorted on its own. The sort is not stable and uses
+ * a temporary copy of the array.
+ *
+ * @param pool The pool to run on, NULL sorts on the calling thread.
+ * @param base The array to sort.
+ * @param count The number of elements.
+ * @param size The size of an element.
+ * @param compare The comparator.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_parallel_sort(DThreadPool* pool, void* base, size_t count, size_t size, DThreadCompare compare);
+
+/**
+ * @brief Sorts unsigned 32 bits keys with a parallel LSD radix sort.
+ *
+ * Every pass builds per-worker histograms of a byte of the keys and scatters the keys through
+ * cache-line sized write-combining buffers, passes on a byte that all the keys share are
+ * skipped. It uses a temporary copy of the array.
+ *
+ * @param pool The pool to run on, NULL sorts on the calling thread.
+ * @param keys The keys to sort.
+ * @param count The number of keys.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_parallel_radix_sort_u32(DThreadPool* pool, uint32_t* keys, size_t count);
+
+/**
+ * @brief Sorts unsigned 64 bits keys with a parallel LSD radix sort.
+ *
+ * @param pool The pool to run on, NULL sorts on the calling thread.
+ * @param keys The keys to sort.
+ * @param count The number of keys.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_parallel_radix_sort_u64(DThreadPool* pool, uint64_t* keys, size_t count);
+
+/**
+ * @brief Sorts unsigned 64 bits keys along with their values, the sort is stable.
+ *
+ * @param pool The pool to run on, NULL sorts on the calling thread.
+ * @param keys The keys to sort.
+ * @param values The values moved along with the keys.
+ * @param count The number of pairs.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_parallel_radix_sort_kv(DThreadPool* pool, uint64_t* keys, uint64_t* values, size_t count);
+
+/**
+ * @brief Replaces every element with the combination of the ones before it, in place.
+ *
+ * Every block is reduced in parallel, the block totals are scanned and then the blocks are
+ * scanned in parallel starting from their total, the array is read twice and written once.
+ *
+ * @param pool The pool to run on, NULL scans on the calling thread.
+ * @param base The array to scan.
+ * @param count The number of elements.
+ * @param size The size of an element.
+ * @param combine The associative operator.
+ * @param identity The identity element of the operator, the first result of an exclusive scan.
+ * @param mode `DTHREAD_SCAN_EXCLUSIVE` or `DTHREAD_SCAN_INCLUSIVE`.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_parallel_scan(DThreadPool* pool, void* base, size_t count, size_t size, DThreadCombine combine,
+                                      const void* identity, int mode);
+
+/**
+ * @brief Prefix sums of 32 bits integers in place, with SSE2 kernels where available.
+ *
+ * @param pool The pool to run on, NULL scans on the calling thread.
+ * @param items The array to scan.
+ * @param count The number of elements.
+ * @param mode `DTHREAD_SCAN_EXCLUSIVE` or `DTHREAD_SCAN_INCLUSIVE`.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_parallel_scan_i32(DThreadPool* pool, int32_t* items, size_t count, int mode);
+
+/**
+ * @brief Prefix sums of 64 bits integers in place, with SSE2 kernels where available.
+ */
+DTHREAD_API int dthread_parallel_scan_i64(DThreadPool* pool, int64_t* items, size_t count, int mode);
+
+/**
+ * @brief Prefix sums of floats in place, the rounding depends on the number of blocks.
+ */
+DTHREAD_API int dthread_parallel_scan_f32(DThreadPool* pool, float* items, size_t count, int mode);
+
+/**
+ * @brief Prefix sums of doubles in place, the rounding depends on the number of blocks.
+ */
+DTHREAD_API int dthread_parallel_scan_f64(DThreadPool* pool, double* items, size_t count, int mode);
+
+#endif // DTHREAD_PARALLEL_H_
@@ -0,0 +1,155 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: pipeline.h
+//    Date: 2024-09-16
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Pipeline header file for dthreads library, this is not to be used in your
+// *               library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_PIPELINE_H_
+#define DTHREAD_PIPELINE_H_
+
+#include "api.h"
+
+struct DThreadPipeline;
+
+#define DTHREAD_STAGE_PARALLEL 0
+#define DTHREAD_STAGE_SERIAL 1
+
+/**
+ * @typedef DThreadPipelineSource
+ * @brief Produces the next item of the pipeline, NULL once the input is exhausted. It is never
+ *        called concurrently.
+ */
+typedef void* (*DThreadPipelineSource)(void* data);
+
+/**
+ * @typedef DThreadStageFunc
+ * @brief Processes an item and returns what is passed to the next stage, NULL drops the item.
+ */
+typedef void* (*DThreadStageFunc)(void* item, void* data);
+
+/**
+ * @struct DThreadPipelineConfig
+ * @brief Configuration of a pipeline.
+ *
+ * - `batch_size`: items read from the source and moved between stages together, 0 means 64.
+ * - `max_batches`: batches in flight, the bound of every queue between stages, 0 means 16.
+ */
+typedef struct DThreadPipelineConfig
+{
+    int batch_size;
+    int max_batches;
+} DThreadPipelineConfig;
+
+typedef struct _DThreadPipelineBatch
+{
+    uint64_t seq;
+    int stage;
+    int count;
+    void** items;
+    struct DThreadPipeline* pipeline;
+    struct _DThreadPipelineBatch* next;
+} _DThreadPipelineBatch;
+
+/**
+ * @struct DThreadStage
+ * @brief A stage of a pipeline, a serial stage also keeps the batches that arrived early.
+ */
+typedef struct DThreadStage
+{
+    DThreadStageFunc func;
+    void* data;
+    int mode;
+
+    // serial stages only, the reorder buffer is indexed by sequence number
+    int busy;
+    uint64_t next_seq;
+    _DThreadPipelineBatch** reorder;
+} DThreadStage;
+
+/**
+ * @struct DThreadPipeline
+ * @brief Stages processing the items of a source, parallel stages run on as many workers as
+ *        there are batches for them and serial stages see the items in input order.
+ */
+typedef struct DThreadPipeline
+{
+    DThreadPipelineConfig config;
+
+    DThreadStage* stages;
+    int num_stages;
+
+    DThreadPool* pool;
+    DThreadPipelineSource source;
+    void* source_data;
+
+    _DThreadPipelineBatch* batches;
+    _DThreadPipelineBatch* free_batches;
+    void** items;
+
+    uint64_t next_seq;
+    int in_flight;
+    int reading;
+    int eof;
+    uint64_t num_items;
+
+    DThreadMutex mutex;
+    DThreadCond cond;
+} DThreadPipeline;
+
+/**
+ * @brief Initializes a pipeline without stages.
+ *
+ * @param pipeline A pointer to the pipeline to initialize.
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pipeline_init(DThreadPipeline* pipeline, DThreadPipelineConfig* config);
+
+/**
+ * @brief Appends a stage to the pipeline.
+ *
+ * @param pipeline A pointer to the pipeline.
+ * @param mode `DTHREAD_STAGE_PARALLEL` or `DTHREAD_STAGE_SERIAL`.
+ * @param func The routine applied to every item.
+ * @param data The data passed to the routine.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pipeline_add_stage(DThreadPipeline* pipeline, int mode, DThreadStageFunc func, void* data);
+
+/**
+ * @brief Runs the items of a source through the stages and waits for the last one.
+ *
+ * @param pipeline A pointer to the pipeline.
+ * @param pool The pool to run on, NULL runs every stage on the calling thread.
+ * @param source The source of the items.
+ * @param data The data passed to the source.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pipeline_run(DThreadPipeline* pipeline, DThreadPool* pool, DThreadPipelineSource source, void* data);
+
+/**
+ * @brief Releases the pipeline.
+ *
+ * @param pipeline A pointer to the pipeline to destroy.
+ */
+DTHREAD_API void dthread_pipeline_destroy(DThreadPipeline* pipeline);
+
+/**
+ * @macro dthread_pipeline_get_num_items
+ * @brief gets the number of items read from the source by the last run
+ *
+ * @param PIPELINE_PTR The reference (pointer) to the pipeline.
+ */
+#define dthread_pipeline_get_num_items(PIPELINE_PTR) ((PIPELINE_PTR)->num_items)
+
+#endif // DTHREAD_PIPELINE_H_
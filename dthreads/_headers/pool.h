@@ -0,0 +1,385 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: pool.h
+//    Date: 2024-09-01
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Work-stealing pool and fork-join header file for dthreads library, this
+// *               is not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_POOL_H_
+#define DTHREAD_POOL_H_
+
+#include "api.h"
+#include "atomic.h"
+#include "topology.h"
+
+#include <stddef.h>
+
+struct DThreadPool;
+struct DThreadFJ;
+
+#define DTHREAD_TASK_PRIORITY_HIGH 0
+#define DTHREAD_TASK_PRIORITY_NORMAL 1
+#define DTHREAD_TASK_PRIORITY_LOW 2
+#define DTHREAD_TASK_PRIORITY_LEVELS 3
+
+#define DTHREAD_TASK_PLACE_ANY 0
+#define DTHREAD_TASK_PLACE_KEY 1
+#define DTHREAD_TASK_PLACE_WORKER 2
+#define DTHREAD_TASK_PLACE_NODE 3
+
+typedef struct _DThreadTask
+{
+    DThreadRoutine func;
+    void* data;
+    struct DThreadFJ* frame;
+    struct _DThreadTask* next;
+    uint64_t enqueued_ns;
+    uint64_t deadline_ns;
+    uint64_t key_ns;
+    uint64_t seq;
+
+    // submission order within its level, the heap orders by deadline
+    struct _DThreadTask* older;
+    struct _DThreadTask* newer;
+} _DThreadTask;
+
+typedef struct _DThreadTaskHeap
+{
+    _DThreadTask** tasks;
+    size_t size;
+    size_t capacity;
+
+    // the queued tasks in submission order, aging and scaling look at the oldest one
+    _DThreadTask* oldest;
+    _DThreadTask* newest;
+} _DThreadTaskHeap;
+
+typedef struct _DThreadDequeArray
+{
+    int64_t size;
+    struct _DThreadDequeArray* retired;
+    void** items;
+} _DThreadDequeArray;
+
+typedef struct _DThreadWorker
+{
+    // Chase-Lev deque, `top` is written by thieves so it lives on its own cache line
+    int64_t top;
+    char _pad[64 - sizeof(int64_t)];
+    int64_t bottom;
+    _DThreadDequeArray* array;
+
+    struct DThreadPool* pool;
+    int index;
+    int blocking;
+    int retired;
+    uint64_t seed;
+
+    // topology CPU index, L3 and NUMA node of a pinned worker, -1 when unknown
+    int cpu;
+    int l3;
+    int node;
+
+    // tasks placed on this worker, others only take them over after `aging_us`
+    _DThreadTask* inbox_head;
+    _DThreadTask* inbox_tail;
+    int64_t inbox_count;
+
+    _DThreadTask* free_tasks;
+    size_t num_free_tasks;
+
+    DThread thread;
+} _DThreadWorker;
+
+/**
+ * @struct DThreadPoolConfig
+ * @brief Configuration of a work-stealing pool.
+ *
+ * - `num_workers`: workers started by `dthread_pool_init`, 0 means the number of CPUs (or `min_workers`
+ *   when autoscaling).
+ * - `min_workers`, `max_workers`: setting `max_workers` enables autoscaling between these bounds,
+ *   `min_workers` defaults to 1.
+ * - `target_wait_us`: microseconds a submitted task may wait in the queue before the team grows, 0 means 1000.
+ * - `idle_timeout`: milliseconds an idle worker waits before it retires (cooldown), 0 means 1000.
+ * - `max_spare`: extra workers started while workers are blocked, 0 means 256 and negative disables it.
+ * - `aging_us`: microseconds a queued task waits before it is treated as one priority level higher, 0 means 10000.
+ * - `pin`: pins every worker to a CPU, the workers fill an L3 and a NUMA node before moving on to the
+ *   next one and idle workers steal from victims sharing their L3, then their node, first.
+ */
+typedef struct DThreadPoolConfig
+{
+    int num_workers;
+    int min_workers;
+    int max_workers;
+    uint32_t target_wait_us;
+    uint32_t idle_timeout;
+    int max_spare;
+    uint32_t aging_us;
+    int pin;
+} DThreadPoolConfig;
+
+/**
+ * @struct DThreadTaskAttr
+ * @brief Scheduling attributes of a submitted task.
+ *
+ * - `priority`: one of `DTHREAD_TASK_PRIORITY_HIGH`, `DTHREAD_TASK_PRIORITY_NORMAL` or `DTHREAD_TASK_PRIORITY_LOW`.
+ * - `deadline_us`: optional deadline relative to the submission, tasks of the same priority are
+ *   started earliest deadline first, a task without deadline is due when it is submitted.
+ * - `placement`, `place`: optional locality hint, `DTHREAD_TASK_PLACE_KEY` sends every task with the
+ *   same `place` key to the same worker, `DTHREAD_TASK_PLACE_WORKER` to the worker with index `place`
+ *   and `DTHREAD_TASK_PLACE_NODE` to a worker pinned on NUMA node `place`.
+ *
+ * NOTE: placed tasks run in submission order on their worker ahead of the shared queues, other
+ *       workers take them over only after they have waited `aging_us`.
+ */
+typedef struct DThreadTaskAttr
+{
+    int priority;
+    uint32_t deadline_us;
+    int placement;
+    uint64_t place;
+} DThreadTaskAttr;
+
+/**
+ * @struct DThreadPoolStats
+ * @brief A snapshot of the pool metrics, see `dthread_pool_stats`.
+ *
+ * - `workers`: live worker threads, `running` of them count towards the `target`, the others are
+ *   `blocked` in a blocking region or parked as `spares`; `idle` running workers have nothing to do.
+ * - `avg_wait_ns`: moving average of the time submitted tasks waited in the queue.
+ * - `deadline_misses`: tasks started after their deadline.
+ * - `placed`, `migrated`: placed tasks run by their own worker and taken over by another one.
+ * - `utilization`: moving average of the fraction of running workers that are busy.
+ * - `grown`, `retired`: number of autoscaling decisions taken so far.
+ */
+typedef struct DThreadPoolStats
+{
+    int workers;
+    int running;
+    int idle;
+    int blocked;
+    int spares;
+    int target;
+
+    size_t queued;
+    uint64_t completed;
+
+    uint64_t avg_wait_ns;
+    double utilization;
+    uint64_t deadline_misses;
+
+    uint64_t placed;
+    uint64_t migrated;
+
+    uint64_t grown;
+    uint64_t retired;
+} DThreadPoolStats;
+
+/**
+ * @struct DThreadPool
+ * @brief A team of workers each owning a work-stealing deque.
+ *
+ * Tasks spawned by a worker go to its own deque and are executed LIFO, idle workers steal the
+ * oldest tasks of a random victim, submitted tasks go through shared priority queues.
+ */
+typedef struct DThreadPool
+{
+    DThreadPoolConfig config;
+
+    _DThreadWorker* workers;
+    int64_t num_workers;
+    int capacity;
+
+    DThreadMutex mutex;
+    DThreadCond cond;
+    DThreadCond idle;
+    DThreadCond spare_cond;
+
+    _DThreadTaskHeap queues[DTHREAD_TASK_PRIORITY_LEVELS];
+    uint64_t next_seq;
+    int next_place;
+
+    DThreadTopology topology;
+    int* cpu_order;
+
+    int64_t queued;
+    int64_t sleepers;
+    int64_t pending;
+    int64_t blocked;
+    int64_t spares;
+    int64_t spare_tokens;
+    int64_t retired;
+    int64_t target;
+    int32_t stop;
+
+    int64_t completed;
+    int64_t avg_wait_ns;
+    int64_t utilization;
+    uint64_t last_scale_ns;
+    uint64_t deadline_misses;
+    uint64_t num_placed;
+    uint64_t num_migrated;
+    uint64_t num_grown;
+    uint64_t num_retired;
+} DThreadPool;
+
+/**
+ * @struct DThreadFJ
+ * @brief A fork-join scope, children spawned into it are waited for by `dthread_fj_sync`.
+ *
+ * NOTE: it is meant to live on the stack of the spawning routine and must be synced before
+ *       it goes out of scope.
+ */
+typedef struct DThreadFJ
+{
+    int64_t pending;
+} DThreadFJ;
+
+/**
+ * @brief Initializes a pool and starts its workers.
+ *
+ * @param pool A pointer to the pool to initialize.
+ * @param config Optional configuration; can be NULL for defaults.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pool_init(DThreadPool* pool, DThreadPoolConfig* config);
+
+/**
+ * @brief Submits a task to the pool, the result of the routine is discarded.
+ *
+ * @param pool A pointer to the pool.
+ * @param func The routine to run on one of the workers.
+ * @param data The data passed to the routine.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pool_submit(DThreadPool* pool, DThreadRoutine func, void* data);
+
+/**
+ * @brief Submits a task with a priority and an optional deadline.
+ *
+ * NOTE: higher priority queues are served first, lower ones are aged so they can not starve.
+ *
+ * @param pool A pointer to the pool.
+ * @param func The routine to run on one of the workers.
+ * @param data The data passed to the routine.
+ * @param attr Optional scheduling attributes; can be NULL for normal priority without deadline.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pool_submit_attr(DThreadPool* pool, DThreadRoutine func, void* data, DThreadTaskAttr* attr);
+
+/**
+ * @brief Waits until every task submitted to the pool has completed.
+ *
+ * NOTE: must not be called from a worker of the same pool.
+ *
+ * @param pool A pointer to the pool.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pool_wait(DThreadPool* pool);
+
+/**
+ * @brief Runs a routine on the pool and waits for its result.
+ *
+ * This is the entry point of fork-join computations, the routine runs on a worker so the
+ * children it spawns with `dthread_fj_spawn` are executed in parallel.
+ *
+ * @param pool A pointer to the pool.
+ * @param func The root routine.
+ * @param data The data passed to the routine.
+ * @return The value returned by the routine.
+ */
+DTHREAD_API void* dthread_pool_run(DThreadPool* pool, DThreadRoutine func, void* data);
+
+/**
+ * @brief Waits for the submitted tasks, stops the workers and releases the pool.
+ *
+ * @param pool A pointer to the pool to destroy.
+ */
+DTHREAD_API void dthread_pool_destroy(DThreadPool* pool);
+
+/**
+ * @brief Takes a snapshot of the pool metrics, including the autoscaling decisions.
+ *
+ * @param pool A pointer to the pool.
+ * @param stats A pointer to the stats to fill.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_pool_stats(DThreadPool* pool, DThreadPoolStats* stats);
+
+/**
+ * @brief Returns the index of the pool worker running the calling thread.
+ *
+ * @return The worker index or -1 if the calling thread is not a pool worker.
+ */
+DTHREAD_API int dthread_pool_worker(void);
+
+/**
+ * @brief Spawns a child task into a fork-join scope.
+ *
+ * The child is pushed to the deque of the calling worker so it can be stolen by idle workers
+ * while the caller continues, outside of a pool the child simply runs inline.
+ *
+ * @param fj A pointer to the fork-join scope.
+ * @param func The child routine, its result is discarded.
+ * @param data The data passed to the routine.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_fj_spawn(DThreadFJ* fj, DThreadRoutine func, void* data);
+
+/**
+ * @brief Waits for all the children spawned into the scope.
+ *
+ * NOTE: the calling worker does not block, it keeps executing its own and stolen tasks until
+ *       the children have completed.
+ *
+ * @param fj A pointer to the fork-join scope.
+ */
+DTHREAD_API void dthread_fj_sync(DThreadFJ* fj);
+
+/**
+ * @brief Marks the beginning of a region where the calling worker may block.
+ *
+ * While a worker is blocked a parked spare worker is resumed (or a new one is started) so the
+ * number of running workers stays at the configured count. dthreads' own blocking primitives
+ * (mutex lock on contention, condition wait, rwlock, semaphore, barrier and join) already do
+ * this, use it around other blocking calls such as file or socket reads.
+ *
+ * NOTE: regions can be nested, it does nothing when called outside of a pool worker.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_blocking_begin(void);
+
+/**
+ * @brief Marks the end of a region started with `dthread_blocking_begin`.
+ *
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_blocking_end(void);
+
+/**
+ * @macro dthread_fj_init
+ * @brief initializes a fork-join scope
+ *
+ * @param FJ_PTR The reference (pointer) to the scope.
+ */
+#define dthread_fj_init(FJ_PTR) ((FJ_PTR)->pending = 0)
+
+/**
+ * @macro dthread_pool_get_num_workers
+ * @brief gets the number of started workers of the pool, including the spare ones
+ *
+ * @param POOL_PTR The reference (pointer) to the pool.
+ */
+#define dthread_pool_get_num_workers(POOL_PTR) ((int)dthread_atomic_load_i64(&(POOL_PTR)->num_workers))
+
+#endif // DTHREAD_POOL_H_
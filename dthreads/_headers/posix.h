@@ -20,9 +20,17 @@
 
 #include "api.h"
 
+#include <errno.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <sched.h>
 #include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
 
 #if defined(_XOPEN_SOURCE) && (_XOPEN_SOURCE >= 700)
 #define DTHREAD_MUTEX_ROBUST_AND_COND_CLOCK_AVAILABLE
@@ -30,6 +38,15 @@
 
 typedef pthread_t _DThreadHandle;
 
+/**
+ * @macro DTHREAD_PREFAULT_MARGIN
+ * @brief Stack bytes left to the thread routine on top of `prefault`, an attribute pre-faulting
+ *        more than the stack size minus this margin is rejected.
+ */
+#ifndef DTHREAD_PREFAULT_MARGIN
+#define DTHREAD_PREFAULT_MARGIN 65536
+#endif
+
 typedef struct DThreadAttr
 {
     size_t stacksize;
@@ -41,8 +58,41 @@ typedef struct DThreadAttr
     int scope;
     size_t stack;
 
+    // low-latency profile
+    int priority;
+    size_t prefault;
+    int lock_memory;
+
 } DThreadAttr;
 
+typedef struct DThreadPreparedAttr
+{
+    pthread_attr_t handle;
+    int initialized;
+
+    size_t prefault;
+    int lock_memory;
+} DThreadPreparedAttr;
+
+/**
+ * @macro dthread_attr_low_latency
+ * @brief Initializes thread attributes for the low-latency profile.
+ *
+ * The thread runs under `SCHED_FIFO` with the given priority, pre-faults `PREFAULT` bytes of
+ * its stack and locks them into memory before the thread routine starts.
+ *
+ * @param PRIORITY The real-time priority (see `sched_get_priority_min/max`).
+ * @param PREFAULT The number of stack bytes to pre-fault and lock.
+ */
+#define dthread_attr_low_latency(PRIORITY, PREFAULT) \
+    (DThreadAttr)                                    \
+    {                                                \
+        .schedpolicy = SCHED_FIFO,                   \
+        .priority = (PRIORITY),                      \
+        .prefault = (PREFAULT),                      \
+        .lock_memory = 1                             \
+    }
+
 typedef struct DThreadMutex
 {
     pthread_mutex_t handle;
@@ -62,6 +112,9 @@ typedef struct DThreadMutexAttr
 typedef struct DThreadCond
 {
     pthread_cond_t handle;
+
+    // the clock the deadlines of `dthread_cond_timedwait` are measured on
+    clockid_t clock;
 } DThreadCond;
 
 typedef struct DThreadCondAttr
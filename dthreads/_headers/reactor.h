@@ -0,0 +1,178 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: reactor.h
+//    Date: 2024-09-09
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: I/O reactor header file for dthreads library, this is not to be used in
+// *               your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_REACTOR_H_
+#define DTHREAD_REACTOR_H_
+
+#include "api.h"
+#include "atomic.h"
+
+#include <stddef.h>
+
+// the reactor is built on epoll and eventfd, elsewhere every function fails
+#if defined(__linux__)
+#define DTHREAD_REACTOR_AVAILABLE
+#endif
+
+#define DTHREAD_REACTOR_READ 0x1
+#define DTHREAD_REACTOR_WRITE 0x2
+#define DTHREAD_REACTOR_ERROR 0x4
+#define DTHREAD_REACTOR_HANGUP 0x8
+
+/**
+ * @typedef DThreadReactorCallback
+ * @brief Called with the file descriptor, the `DTHREAD_REACTOR_*` events it became ready for and
+ *        the registration data.
+ *
+ * Registrations are edge-triggered, the callback must read (or write) until the call would block.
+ */
+typedef void (*DThreadReactorCallback)(int fd, uint32_t events, void* data);
+
+typedef struct DThreadReactorHandle
+{
+    int fd;
+    DThreadReactorCallback callback;
+    void* data;
+    struct _DThreadReactorLoop* loop;
+
+    // events seen but not handed to the callback yet and whether a run is scheduled
+    int32_t pending;
+    int32_t scheduled;
+    int32_t removed;
+    int64_t refs;
+
+    // callbacks past the `removed` check, `dthread_reactor_remove` waits for them
+    int32_t running;
+} DThreadReactorHandle;
+
+typedef struct _DThreadReactorPost
+{
+    DThreadRoutine func;
+    void* data;
+    struct _DThreadReactorPost* next;
+} _DThreadReactorPost;
+
+typedef struct _DThreadReactorLoop
+{
+    struct DThreadReactor* reactor;
+    DThread thread;
+
+    int epoll_fd;
+    int wake_fd;
+
+    // routines to run on the loop thread
+    DThreadMutex mutex;
+    _DThreadReactorPost* head;
+    _DThreadReactorPost* tail;
+} _DThreadReactorLoop;
+
+/**
+ * @struct DThreadReactorConfig
+ * @brief Configuration of a reactor.
+ *
+ * - `num_loops`: number of event loop threads, each with its own epoll instance, 0 means 1.
+ * - `max_events`: events collected by one `epoll_wait`, 0 means 256.
+ * - `batch_size`: ready descriptors dispatched together as one pool task, 0 means 16.
+ * - `pool`: optional pool running the callbacks, NULL runs them on the loop threads.
+ */
+typedef struct DThreadReactorConfig
+{
+    int num_loops;
+    int max_events;
+    int batch_size;
+    DThreadPool* pool;
+} DThreadReactorConfig;
+
+/**
+ * @struct DThreadReactor
+ * @brief Multiplexes many file descriptors over a few event loop threads.
+ */
+typedef struct DThreadReactor
+{
+    DThreadReactorConfig config;
+
+    _DThreadReactorLoop* loops;
+    int num_loops;
+    int64_t next_loop;
+    int32_t stop;
+
+    int64_t events;
+    int64_t batches;
+} DThreadReactor;
+
+/**
+ * @brief Starts the event loop threads of a reactor.
+ *
+ * @param reactor A pointer to the reactor to initialize.
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure (always on platforms without epoll).
+ */
+DTHREAD_API int dthread_reactor_init(DThreadReactor* reactor, DThreadReactorConfig* config);
+
+/**
+ * @brief Stops the event loops and releases the reactor.
+ *
+ * Every descriptor must have been removed, the pool (if any) must outlive this call.
+ *
+ * @param reactor A pointer to the reactor to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_reactor_destroy(DThreadReactor* reactor);
+
+/**
+ * @brief Registers a file descriptor, edge-triggered, on one of the event loops.
+ *
+ * Callbacks of the same descriptor never run concurrently and no readiness edge is lost: events
+ * arriving while the callback runs make it run again.
+ *
+ * @param reactor A pointer to the reactor.
+ * @param handle A pointer receiving the registration.
+ * @param fd The file descriptor, it should be non-blocking.
+ * @param events `DTHREAD_REACTOR_READ` and/or `DTHREAD_REACTOR_WRITE`, errors and hangups are
+ *               always reported.
+ * @param callback The routine called when the descriptor becomes ready.
+ * @param data The data passed to the callback.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_reactor_add(DThreadReactor* reactor, DThreadReactorHandle** handle, int fd, uint32_t events,
+                                    DThreadReactorCallback callback, void* data);
+
+/**
+ * @brief Unregisters a file descriptor.
+ *
+ * It waits for a callback of the descriptor that is running on another thread, once it returns no
+ * callback runs or starts anymore and the descriptor can be closed. Called from the callback of
+ * the descriptor itself it does not wait: no further callback starts and the descriptor can be
+ * closed once the current one returns. The handle is released by the event loop.
+ *
+ * @param handle The registration returned by `dthread_reactor_add`.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_reactor_remove(DThreadReactorHandle* handle);
+
+/**
+ * @brief Runs a routine on an event loop thread, waking it up through its eventfd.
+ *
+ * It can be called from any thread.
+ *
+ * @param reactor A pointer to the reactor.
+ * @param func The routine to run.
+ * @param data The data passed to the routine.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_reactor_post(DThreadReactor* reactor, DThreadRoutine func, void* data);
+
+#endif // DTHREAD_REACTOR_H_
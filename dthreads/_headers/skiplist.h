@@ -0,0 +1,157 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: skiplist.h
+//    Date: 2024-09-19
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Lock-free skip list header file for dthreads library, this is not to be used
+// *               in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_SKIPLIST_H_
+#define DTHREAD_SKIPLIST_H_
+
+#include "api.h"
+#include "atomic.h"
+#include "epoch.h"
+#include "parallel.h"
+
+/**
+ * @macro DTHREAD_SKIPLIST_MAX_LEVEL
+ * @brief Number of levels of a skip list, enough for about 2^MAX_LEVEL entries.
+ */
+#ifndef DTHREAD_SKIPLIST_MAX_LEVEL
+#define DTHREAD_SKIPLIST_MAX_LEVEL 24
+#endif
+
+struct _DThreadSkipNode;
+
+/**
+ * @typedef DThreadVisitFunc
+ * @brief Called for every entry of a scan, a non-zero return stops it. The pointers are only
+ *        valid during the call, `value` is NULL when the values are empty.
+ */
+typedef int (*DThreadVisitFunc)(const void* key, const void* value, void* data);
+
+/**
+ * @struct DThreadSkipListConfig
+ * @brief Configuration of a skip list over fixed size keys and values.
+ *
+ * - `key_size`, `value_size`: sizes of the keys and values, `value_size` can be 0 for a set.
+ * - `compare`: optional key order, NULL compares the bytes of the keys.
+ * - `relax`: `dthread_skiplist_pop_min` takes one of the first `relax + 1` entries at random,
+ *   which spreads concurrent pops over different entries, 0 always takes the first one.
+ */
+typedef struct DThreadSkipListConfig
+{
+    size_t key_size;
+    size_t value_size;
+    DThreadCompare compare;
+    int relax;
+} DThreadSkipListConfig;
+
+/**
+ * @struct DThreadSkipList
+ * @brief A lock-free ordered map.
+ *
+ * An entry is removed once its value is swapped for NULL, it is then marked at every level and
+ * unlinked by whichever thread walks past it. Values, nodes and unlinked entries are released
+ * through an epoch domain, so readers never see freed memory.
+ */
+typedef struct DThreadSkipList
+{
+    DThreadSkipListConfig config;
+    size_t key_stride;
+
+    struct _DThreadSkipNode* head;
+    int64_t count;
+
+    DThreadEpoch epoch;
+} DThreadSkipList;
+
+/**
+ * @brief Initializes an empty skip list.
+ *
+ * @param list A pointer to the list to initialize.
+ * @param config The sizes of the keys and values and their order, `key_size` cannot be 0.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_skiplist_init(DThreadSkipList* list, DThreadSkipListConfig* config);
+
+/**
+ * @brief Releases the list and its entries, no other thread may be using it.
+ *
+ * @param list A pointer to the list to destroy.
+ */
+DTHREAD_API void dthread_skiplist_destroy(DThreadSkipList* list);
+
+/**
+ * @brief Looks a key up.
+ *
+ * @param list A pointer to the list.
+ * @param key The key.
+ * @param value Where the value is copied when found; can be NULL.
+ * @return 0 when found, non-zero otherwise.
+ */
+DTHREAD_API int dthread_skiplist_get(DThreadSkipList* list, const void* key, void* value);
+
+/**
+ * @brief Inserts a key or replaces its value.
+ *
+ * @param list A pointer to the list.
+ * @param key The key.
+ * @param value The value; can be NULL when `value_size` is 0.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_skiplist_put(DThreadSkipList* list, const void* key, const void* value);
+
+/**
+ * @brief Removes a key.
+ *
+ * @param list A pointer to the list.
+ * @param key The key.
+ * @return 0 when the key was removed, non-zero when it was missing.
+ */
+DTHREAD_API int dthread_skiplist_remove(DThreadSkipList* list, const void* key);
+
+/**
+ * @brief Removes one of the smallest entries, see `relax`, so the list works as a concurrent
+ *        priority queue.
+ *
+ * @param list A pointer to the list.
+ * @param key Where the key is copied; can be NULL.
+ * @param value Where the value is copied; can be NULL.
+ * @return 0 when an entry was removed, non-zero when the list was empty.
+ */
+DTHREAD_API int dthread_skiplist_pop_min(DThreadSkipList* list, void* key, void* value);
+
+/**
+ * @brief Visits the entries between two keys in order.
+ *
+ * The scan runs concurrently with the writers, it sees every entry present for its whole
+ * duration and never the same key twice.
+ *
+ * @param list A pointer to the list.
+ * @param low The smallest key visited, NULL starts from the first entry.
+ * @param high The largest key visited, NULL goes up to the last entry.
+ * @param visit Called for every entry.
+ * @param data Passed to `visit`.
+ * @return 0 when the scan went through, non-zero when `visit` stopped it.
+ */
+DTHREAD_API int dthread_skiplist_range(DThreadSkipList* list, const void* low, const void* high, DThreadVisitFunc visit, void* data);
+
+/**
+ * @macro dthread_skiplist_get_count
+ * @brief gets the number of entries
+ *
+ * @param LIST_PTR The reference (pointer) to the list.
+ */
+#define dthread_skiplist_get_count(LIST_PTR) dthread_atomic_load_i64(&(LIST_PTR)->count)
+
+#endif // DTHREAD_SKIPLIST_H_
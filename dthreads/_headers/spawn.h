@@ -0,0 +1,90 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: spawn.h
+//    Date: 2024-08-27
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Cached thread spawning header file for dthreads library, this is not
+// *               to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_SPAWN_H_
+#define DTHREAD_SPAWN_H_
+
+#include "api.h"
+
+/**
+ * @struct DThreadSpawnConfig
+ * @brief Configuration of the cache of parked threads.
+ *
+ * - `idle_timeout`: milliseconds a parked thread waits for a new routine before it exits, 0 means 1000.
+ * - `max_parked`: maximum number of parked threads kept in the cache, 0 means `4 * dthread_cpu_count()`.
+ */
+typedef struct DThreadSpawnConfig
+{
+    uint32_t idle_timeout;
+    int max_parked;
+} DThreadSpawnConfig;
+
+typedef struct _DThreadSpawnSlot
+{
+    DThread thread;
+    DThreadCond cond;
+
+    DThreadRoutine func;
+    void* data;
+    void* result;
+
+    int state;
+    int detached;
+
+    // the worker of the slot has exited and its thread still has to be joined
+    int reap;
+
+    struct _DThreadSpawnSlot* prev;
+    struct _DThreadSpawnSlot* next;
+    struct _DThreadSpawnSlot* all_next;
+} _DThreadSpawnSlot;
+
+/**
+ * @brief Initializes the cache of parked threads used by `dthread_spawn`.
+ *
+ * It must be called before any call to `dthread_spawn`, which fails without it.
+ *
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_spawn_init(DThreadSpawnConfig* config);
+
+/**
+ * @brief Runs the thread routine on a parked thread, creating a new one only if none is parked.
+ *
+ * The thread must be initialized with `dthread_init_thread`, it can be waited for with
+ * `dthread_join` (or released with `dthread_detach`) and its result can be read with
+ * `dthread_get_result` exactly like a thread started with `dthread_create`. Its `handle` is the one
+ * of the cached thread running the routine, that thread is owned and joined by the cache.
+ *
+ * @param thread A pointer to the DThread structure holding the routine and its data.
+ * @return 0 on success, non-zero on failure.
+ *
+ * NOTE: Routines running on cached threads must return normally, do not call `dthread_exit`.
+ */
+DTHREAD_API int dthread_spawn(DThread* thread);
+
+/**
+ * @brief Stops all the parked threads and releases the cache.
+ *
+ * Every spawned thread must be joined or detached before calling this function.
+ */
+DTHREAD_API void dthread_spawn_cleanup(void);
+
+int _dthread_spawn_join(DThread* thread);
+int _dthread_spawn_detach(DThread* thread);
+
+#endif // DTHREAD_SPAWN_H_
@@ -0,0 +1,168 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: timer.h
+//    Date: 2024-09-17
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Timer wheel header file for dthreads library, this is not to be used in your
+// *               library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_TIMER_H_
+#define DTHREAD_TIMER_H_
+
+#include "api.h"
+
+#define DTHREAD_TIMER_LEVELS 4
+#define DTHREAD_TIMER_SLOTS 256
+
+struct DThreadTimer;
+struct DThreadTimerWheel;
+
+/**
+ * @typedef DThreadTimerCallback
+ * @brief Called when a timer expires.
+ */
+typedef void (*DThreadTimerCallback)(struct DThreadTimer* timer);
+
+/**
+ * @struct DThreadTimer
+ * @brief A one-shot or periodic timer, it starts zero initialized with `callback` and `data` set.
+ *
+ * A one-shot timer is no longer used by the wheel once its callback starts, the callback may
+ * release or start it again. A periodic timer stays in the wheel until it is cancelled, it is
+ * re-armed only once its callback has returned so that it never runs concurrently with itself,
+ * expirations missed meanwhile are skipped.
+ */
+typedef struct DThreadTimer
+{
+    DThreadTimerCallback callback;
+    void* data;
+
+    // the `dthread_now_ns` time stamp of the next expiration and the period, 0 when one-shot
+    uint64_t expires_ns;
+    uint64_t period_ns;
+
+    struct DThreadTimerWheel* wheel;
+    struct DThreadTimer* next;
+    struct DThreadTimer* prev;
+    uint64_t tick;
+    int level;
+    int slot;
+    int pending;
+
+    // a periodic callback is in flight, cancelled or started again meanwhile
+    int running;
+    int cancelled;
+    int restarted;
+} DThreadTimer;
+
+/**
+ * @struct DThreadTimerConfig
+ * @brief Configuration of a timer wheel.
+ *
+ * - `tick_us`: resolution of the wheel, timers fire at most one tick late, 0 means 1000. The driver
+ *   wakes up at least every 256 ticks while timers are pending, so tiny ticks cost CPU time.
+ * - `pool`: optional pool running the callbacks, NULL runs them on the driver thread.
+ */
+typedef struct DThreadTimerConfig
+{
+    uint32_t tick_us;
+    DThreadPool* pool;
+} DThreadTimerConfig;
+
+/**
+ * @struct DThreadTimerWheel
+ * @brief A hierarchical timing wheel driven by one thread, every level covers 256 times the
+ *        range of the one below it (49 days with 1ms ticks).
+ */
+typedef struct DThreadTimerWheel
+{
+    DThreadTimerConfig config;
+    uint64_t tick_ns;
+    uint64_t start_ns;
+    uint64_t current_tick;
+
+    DThreadTimer* slots[DTHREAD_TIMER_LEVELS][DTHREAD_TIMER_SLOTS];
+    int64_t level_count[DTHREAD_TIMER_LEVELS];
+    int64_t count;
+    uint64_t fired;
+
+    // expired timers waiting for their callback
+    DThreadTimer* expired;
+    DThreadTimer* expired_tail;
+
+    // when the driver plans to wake up, earlier timers wake it up
+    uint64_t wake_ns;
+    int stop;
+
+    // periodic callbacks in flight, signaled on `done` when one returns
+    int64_t running;
+
+    DThreadMutex mutex;
+    DThreadCond cond;
+    DThreadCond done;
+    DThread driver;
+} DThreadTimerWheel;
+
+/**
+ * @brief Starts a timer wheel and its driver thread.
+ *
+ * @param wheel A pointer to the wheel to initialize.
+ * @param config Optional configuration; can be NULL for default configuration.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_timer_wheel_init(DThreadTimerWheel* wheel, DThreadTimerConfig* config);
+
+/**
+ * @brief Stops the driver thread, the pending timers never fire.
+ *
+ * It waits for the periodic callbacks in flight, the pool (if any) must outlive this call.
+ *
+ * @param wheel A pointer to the wheel to destroy.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_timer_wheel_destroy(DThreadTimerWheel* wheel);
+
+/**
+ * @brief Starts a timer, or moves it when it is already pending, in constant time.
+ *
+ * A periodic timer started again while its callback runs is linked once the callback returns.
+ *
+ * @param wheel A pointer to the wheel.
+ * @param timer A pointer to the timer.
+ * @param delay_ns Nanoseconds before the first expiration.
+ * @param period_ns Nanoseconds between the following expirations, 0 for a one-shot timer.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_timer_start(DThreadTimerWheel* wheel, DThreadTimer* timer, uint64_t delay_ns, uint64_t period_ns);
+
+/**
+ * @brief Cancels a pending timer in constant time.
+ *
+ * A periodic timer whose callback is running is not re-armed and the call waits for the callback
+ * to return, unless it comes from that callback. Once it returns the callback does not run again.
+ *
+ * NOTE: the callback of a one-shot timer belongs to the caller once it started and is not waited for.
+ *
+ * @param wheel A pointer to the wheel.
+ * @param timer A pointer to the timer.
+ * @return 0 when the timer was pending or running periodically, non-zero otherwise.
+ */
+DTHREAD_API int dthread_timer_cancel(DThreadTimerWheel* wheel, DThreadTimer* timer);
+
+/**
+ * @macro dthread_timer_wheel_get_fired
+ * @brief gets the number of expirations so far
+ *
+ * @param WHEEL_PTR The reference (pointer) to the wheel.
+ */
+#define dthread_timer_wheel_get_fired(WHEEL_PTR) ((WHEEL_PTR)->fired)
+
+#endif // DTHREAD_TIMER_H_
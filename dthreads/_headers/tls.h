@@ -0,0 +1,119 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: tls.h
+//    Date: 2024-09-06
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Dense thread indices and thread-local storage header file for dthreads
+// *               library, this is not to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_TLS_H_
+#define DTHREAD_TLS_H_
+
+#include "api.h"
+#include "atomic.h"
+
+/**
+ * @macro DTHREAD_KEYS_MAX
+ * @brief Maximum number of thread-local keys alive at the same time.
+ */
+#ifndef DTHREAD_KEYS_MAX
+#define DTHREAD_KEYS_MAX 128
+#endif
+
+/**
+ * @typedef DThreadKeyDestructor
+ * @brief Called with the non-NULL value of a key when a thread exits.
+ */
+typedef void (*DThreadKeyDestructor)(void*);
+
+/**
+ * @struct DThreadKey
+ * @brief A thread-local storage key, every thread sees its own value (NULL until set).
+ */
+typedef struct DThreadKey
+{
+    int slot;
+    uint64_t seq;
+} DThreadKey;
+
+typedef struct _DThreadTLSBlock
+{
+    void* values[DTHREAD_KEYS_MAX];
+    uint64_t seqs[DTHREAD_KEYS_MAX];
+} _DThreadTLSBlock;
+
+extern DTHREAD_THREAD_LOCAL int _dthread_tls_index;
+extern DTHREAD_THREAD_LOCAL _DThreadTLSBlock* _dthread_tls_block;
+
+int _dthread_index_assign(void);
+
+/**
+ * @macro dthread_index
+ * @brief Returns a small dense index of the calling thread.
+ *
+ * The index is assigned on first use, it is the smallest one not held by a live thread and is
+ * recycled when the thread exits, so it can index per-thread arrays of `dthread_index_limit()`
+ * entries. After the first call it is a single thread-local read.
+ */
+#define dthread_index() (_dthread_tls_index ? _dthread_tls_index - 1 : _dthread_index_assign())
+
+/**
+ * @brief Returns one past the highest index ever handed out by `dthread_index`.
+ *
+ * @return The number of entries a per-thread array needs to cover every thread so far.
+ */
+DTHREAD_API int dthread_index_limit(void);
+
+/**
+ * @brief Creates a thread-local storage key.
+ *
+ * @param key A pointer to the key to initialize.
+ * @param destructor Optional function called with the value of every thread that exits while
+ *                   the key holds a non-NULL value; can be NULL.
+ * @return 0 on success, non-zero when `DTHREAD_KEYS_MAX` keys are already alive.
+ */
+DTHREAD_API int dthread_key_create(DThreadKey* key, DThreadKeyDestructor destructor);
+
+/**
+ * @brief Deletes a thread-local storage key.
+ *
+ * The destructor is not called for the values still held by the threads, those must be
+ * released by the caller.
+ *
+ * @param key A pointer to the key to delete.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_key_delete(DThreadKey* key);
+
+/**
+ * @brief Sets the value of a thread-local storage key for the calling thread.
+ *
+ * @param key A pointer to the key.
+ * @param value The value to store.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_key_set(DThreadKey* key, void* value);
+
+/**
+ * @macro dthread_key_get
+ * @brief Returns the value of a thread-local storage key for the calling thread.
+ *
+ * It is inlined at the call site, a value stored before the key was deleted and created again
+ * is never returned.
+ *
+ * @param KEY_PTR The reference (pointer) to the key.
+ */
+#define dthread_key_get(KEY_PTR)                                                          \
+    ((_dthread_tls_block && _dthread_tls_block->seqs[(KEY_PTR)->slot] == (KEY_PTR)->seq) \
+         ? _dthread_tls_block->values[(KEY_PTR)->slot]                                    \
+         : NULL)
+
+#endif // DTHREAD_TLS_H_
@@ -0,0 +1,129 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: topology.h
+//    Date: 2024-08-29
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: CPU topology discovery header file for dthreads library, this is not
+// *               to be used in your library directly.
+// ***************************************************************************************
+
+#ifndef DTHREAD_TOPOLOGY_H_
+#define DTHREAD_TOPOLOGY_H_
+
+#include "api.h"
+
+#include <stddef.h>
+
+/**
+ * @struct DThreadTopologyCPU
+ * @brief Placement information of a logical CPU.
+ *
+ * - `id`: the operating system's logical CPU number, the one `dthread_affinity_set` expects.
+ * - `package`: the physical package (socket) number.
+ * - `core`, `l2`, `l3`, `node`: indices into the corresponding group arrays of the topology,
+ *   -1 when the information is not available.
+ * - `smt`: position of this CPU among the SMT siblings of its core.
+ */
+typedef struct DThreadTopologyCPU
+{
+    int id;
+    int package;
+    int core;
+    int l2;
+    int l3;
+    int node;
+    int smt;
+} DThreadTopologyCPU;
+
+/**
+ * @struct DThreadTopologyGroup
+ * @brief A set of logical CPUs sharing a core, a cache or a NUMA node.
+ *
+ * `cpus` holds `num_cpus` indices into the `cpus` array of the topology. `cache_size` is the
+ * size of the shared cache in bytes (0 for cores, nodes and unknown sizes).
+ */
+typedef struct DThreadTopologyGroup
+{
+    int* cpus;
+    int num_cpus;
+    size_t cache_size;
+} DThreadTopologyGroup;
+
+/**
+ * @struct DThreadTopology
+ * @brief Snapshot of the CPU topology of the machine.
+ *
+ * On Linux it is read from `/sys/devices/system/cpu` and `/sys/devices/system/node`, on
+ * Windows from `GetLogicalProcessorInformation`. Elsewhere every CPU is reported as its own
+ * core on a single node without cache information.
+ */
+typedef struct DThreadTopology
+{
+    DThreadTopologyCPU* cpus;
+    int num_cpus;
+
+    DThreadTopologyGroup* cores;
+    int num_cores;
+
+    DThreadTopologyGroup* l2;
+    int num_l2;
+
+    DThreadTopologyGroup* l3;
+    int num_l3;
+
+    DThreadTopologyGroup* nodes;
+    int num_nodes;
+} DThreadTopology;
+
+/**
+ * @brief Discovers the CPU topology of the machine.
+ *
+ * @param topo A pointer to the topology to initialize.
+ * @return 0 on success, non-zero on failure.
+ */
+DTHREAD_API int dthread_topology_init(DThreadTopology* topo);
+
+/**
+ * @brief Releases the resources held by a topology.
+ *
+ * @param topo A pointer to the topology to destroy.
+ */
+DTHREAD_API void dthread_topology_destroy(DThreadTopology* topo);
+
+/**
+ * @brief Finds the index of a logical CPU in the topology.
+ *
+ * @param topo A pointer to the topology.
+ * @param id The operating system's logical CPU number.
+ * @return The index into `topo->cpus` or -1 when not found.
+ */
+DTHREAD_API int dthread_topology_find(DThreadTopology* topo, int id);
+
+/**
+ * @brief Measures how far apart two CPUs are.
+ *
+ * @param topo A pointer to the topology.
+ * @param a Index of the first CPU in `topo->cpus`.
+ * @param b Index of the second CPU in `topo->cpus`.
+ * @return 0 for the same CPU, 1 for SMT siblings, 2 for a shared L2, 3 for a shared L3,
+ *         4 for the same NUMA node and 5 otherwise.
+ */
+DTHREAD_API int dthread_topology_distance(DThreadTopology* topo, int a, int b);
+
+/**
+ * @macro dthread_topology_pin
+ * @brief pins the calling thread to the CPU at the given index of the topology
+ *
+ * @param TOPO_PTR The reference (pointer) to the topology.
+ * @param INDEX The index into the `cpus` array of the topology.
+ */
+#define dthread_topology_pin(TOPO_PTR, INDEX) dthread_affinity_set((TOPO_PTR)->cpus[(INDEX)].id)
+
+#endif // DTHREAD_TOPOLOGY_H_
@@ -20,18 +20,61 @@
 
 #include "api.h"
 
+#include <malloc.h>
 #include <stddef.h>
 #include <synchapi.h>
 #include <windows.h>
 
 typedef HANDLE _DThreadHandle;
 
+/**
+ * @macro DTHREAD_PREFAULT_MARGIN
+ * @brief Stack bytes left to the thread routine on top of `prefault`, an attribute pre-faulting
+ *        more than the stack size minus this margin is rejected.
+ */
+#ifndef DTHREAD_PREFAULT_MARGIN
+#define DTHREAD_PREFAULT_MARGIN 65536
+#endif
+
 typedef struct DThreadAttr
 {
     size_t stacksize;
     int dwCreationFlags;
+
+    // low-latency profile
+    int priority;
+    size_t prefault;
+    int lock_memory;
 } DThreadAttr;
 
+typedef struct DThreadPreparedAttr
+{
+    size_t stacksize;
+    DWORD dwCreationFlags;
+
+    int priority;
+    size_t prefault;
+    int lock_memory;
+} DThreadPreparedAttr;
+
+/**
+ * @macro dthread_attr_low_latency
+ * @brief Initializes thread attributes for the low-latency profile.
+ *
+ * The thread runs with the given priority, pre-faults `PREFAULT` bytes of its stack and
+ * locks them into memory before the thread routine starts.
+ *
+ * @param PRIORITY The thread priority, one of `THREAD_PRIORITY_*` values.
+ * @param PREFAULT The number of stack bytes to pre-fault and lock.
+ */
+#define dthread_attr_low_latency(PRIORITY, PREFAULT) \
+    (DThreadAttr)                                    \
+    {                                                \
+        .priority = (PRIORITY),                      \
+        .prefault = (PREFAULT),                      \
+        .lock_memory = 1                             \
+    }
+
 typedef struct DThreadMutex
 {
     CRITICAL_SECTION handle;
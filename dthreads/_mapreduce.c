@@ -0,0 +1,280 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _mapreduce.c
+//    Date: 2024-09-14
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#define _DTHREAD_MAP_TABLE_CAPACITY 64
+#define _DTHREAD_MAP_PARTITIONS_PER_WORKER 4
+
+#define _DTHREAD_MAP_PHASE_MAP 0
+#define _DTHREAD_MAP_PHASE_REDUCE 1
+
+#define _dthread_map_align(SIZE) (((SIZE) + 7) & ~(size_t)7)
+
+typedef struct _DThreadMapReduce
+{
+    int phase;
+    DThreadMapReduceConfig config;
+
+    const unsigned char* items;
+    size_t count;
+    size_t item_size;
+
+    int blocks;
+    int partitions;
+    DThreadMapContext* contexts;
+
+    // a slot is the hash (0 when empty), the key and the value, each 8 bytes aligned
+    size_t value_offset;
+    size_t stride;
+
+    int32_t failed;
+} _DThreadMapReduce;
+
+static uint64_t _dthread_map_hash_bytes(const void* key, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)key;
+    uint64_t hash = 0xcbf29ce484222325ull;
+
+    for (size_t i = 0; i < size; ++i)
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+
+    return hash;
+}
+
+static uint64_t _dthread_map_hash(_DThreadMapReduce* job, const void* key)
+{
+    uint64_t hash = job->config.hash ? job->config.hash(key, job->config.key_size) : _dthread_map_hash_bytes(key, job->config.key_size);
+
+    // spreads the bits, the partition and the table slot are taken from different ends
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    hash ^= hash >> 33;
+
+    return hash ? hash : 1;
+}
+
+static int _dthread_map_table_grow(_DThreadMapReduce* job, _DThreadMapTable* table)
+{
+    size_t capacity = table->capacity ? table->capacity * 2 : _DTHREAD_MAP_TABLE_CAPACITY;
+    unsigned char* slots = (unsigned char*)calloc(capacity, job->stride);
+
+    if (!slots)
+        return 1;
+
+    for (size_t i = 0; i < table->capacity; ++i)
+    {
+        unsigned char* slot = table->slots + i * job->stride;
+        uint64_t hash = *(uint64_t*)slot;
+
+        if (!hash)
+            continue;
+
+        size_t index = hash & (capacity - 1);
+        while (*(uint64_t*)(slots + index * job->stride))
+            index = (index + 1) & (capacity - 1);
+
+        memcpy(slots + index * job->stride, slot, job->stride);
+    }
+
+    free(table->slots);
+    table->slots = slots;
+    table->capacity = capacity;
+
+    return 0;
+}
+
+// inserts the pair or merges the value into the one already there
+static int _dthread_map_table_put(_DThreadMapReduce* job, _DThreadMapTable* table, uint64_t hash, const void* key, const void* value)
+{
+    if ((table->used + 1) * 2 > table->capacity && _dthread_map_table_grow(job, table) != 0)
+        return 1;
+
+    size_t mask = table->capacity - 1;
+
+    for (size_t index = hash & mask;; index = (index + 1) & mask)
+    {
+        unsigned char* slot = table->slots + index * job->stride;
+        uint64_t current = *(uint64_t*)slot;
+
+        if (!current)
+        {
+            *(uint64_t*)slot = hash;
+            memcpy(slot + sizeof(uint64_t), key, job->config.key_size);
+            memcpy(slot + job->value_offset, value, job->config.value_size);
+            table->used++;
+
+            return 0;
+        }
+
+        if (current == hash && memcmp(slot + sizeof(uint64_t), key, job->config.key_size) == 0)
+        {
+            job->config.merge(slot + job->value_offset, value, job->config.data);
+            return 0;
+        }
+    }
+}
+
+static void _dthread_map_body(void* data, int block)
+{
+    _DThreadMapReduce* job = (_DThreadMapReduce*)data;
+
+    if (job->phase == _DTHREAD_MAP_PHASE_MAP)
+    {
+        DThreadMapContext* ctx = &job->contexts[block];
+        size_t begin = _dthread_parallel_block_begin(job->count, job->blocks, block);
+        size_t end = _dthread_parallel_block_begin(job->count, job->blocks, block + 1);
+
+        for (size_t i = begin; i < end && !ctx->failed; ++i)
+            job->config.map(ctx, job->items + i * job->item_size, job->config.data);
+
+        if (ctx->failed)
+            dthread_atomic_store_i32(&job->failed, 1);
+
+        return;
+    }
+
+    // the shuffle, this partition takes its table from every block, nobody else touches them
+    int partition = block;
+    _DThreadMapTable* base = NULL;
+
+    for (int i = 0; i < job->blocks; ++i)
+    {
+        _DThreadMapTable* table = &job->contexts[i].tables[partition];
+
+        if (!base || table->used > base->used)
+            base = table;
+    }
+
+    int failed = 0;
+
+    // the others are merged into the biggest one
+    for (int i = 0; i < job->blocks; ++i)
+    {
+        _DThreadMapTable* table = &job->contexts[i].tables[partition];
+
+        if (table == base)
+            continue;
+
+        for (size_t s = 0; s < table->capacity && !failed; ++s)
+        {
+            unsigned char* slot = table->slots + s * job->stride;
+            uint64_t hash = *(uint64_t*)slot;
+
+            if (hash && _dthread_map_table_put(job, base, hash, slot + sizeof(uint64_t), slot + job->value_offset) != 0)
+                failed = 1;
+        }
+
+        free(table->slots);
+        table->slots = NULL;
+        table->capacity = table->used = 0;
+    }
+
+    if (failed)
+    {
+        dthread_atomic_store_i32(&job->failed, 1);
+        return;
+    }
+
+    for (size_t s = 0; s < base->capacity; ++s)
+    {
+        unsigned char* slot = base->slots + s * job->stride;
+
+        if (*(uint64_t*)slot)
+            job->config.reduce(slot + sizeof(uint64_t), slot + job->value_offset, partition, job->config.data);
+    }
+}
+
+int dthread_map_reduce(DThreadPool* pool, const void* items, size_t count, size_t item_size, DThreadMapReduceConfig* config)
+{
+    dthread_debug("dthread_map_reduce");
+
+    assert((items || count == 0) && config && "`items` and `config` cannot be NULL in dthread_map_reduce");
+    assert(config->map && config->merge && config->reduce && "`map`, `merge` and `reduce` cannot be NULL in dthread_map_reduce");
+
+    _DThreadMapReduce job = {0};
+    job.config = *config;
+    job.items = (const unsigned char*)items;
+    job.count = count;
+    job.item_size = item_size;
+
+    int workers = pool ? dthread_pool_get_num_workers(pool) : 1;
+    if (workers < 1)
+        workers = 1;
+
+    job.blocks = count < (size_t)workers ? (count ? (int)count : 1) : workers;
+    job.partitions = job.config.num_partitions > 0 ? job.config.num_partitions : workers * _DTHREAD_MAP_PARTITIONS_PER_WORKER;
+
+    job.value_offset = sizeof(uint64_t) + _dthread_map_align(job.config.key_size);
+    job.stride = job.value_offset + _dthread_map_align(job.config.value_size);
+
+    job.contexts = (DThreadMapContext*)calloc((size_t)job.blocks, sizeof(DThreadMapContext));
+    if (!job.contexts)
+        return 1;
+
+    for (int i = 0; i < job.blocks; ++i)
+    {
+        job.contexts[i].job = &job;
+        job.contexts[i].tables = (_DThreadMapTable*)calloc((size_t)job.partitions, sizeof(_DThreadMapTable));
+
+        if (!job.contexts[i].tables)
+            job.failed = 1;
+    }
+
+    if (!job.failed)
+    {
+        job.phase = _DTHREAD_MAP_PHASE_MAP;
+        _dthread_parallel_blocks(pool, job.blocks, _dthread_map_body, &job);
+    }
+
+    if (!job.failed)
+    {
+        job.phase = _DTHREAD_MAP_PHASE_REDUCE;
+        _dthread_parallel_blocks(pool, job.partitions, _dthread_map_body, &job);
+    }
+
+    for (int i = 0; i < job.blocks; ++i)
+    {
+        for (int p = 0; job.contexts[i].tables && p < job.partitions; ++p)
+            free(job.contexts[i].tables[p].slots);
+
+        free(job.contexts[i].tables);
+    }
+
+    free(job.contexts);
+
+    return job.failed;
+}
+
+int dthread_map_emit(DThreadMapContext* ctx, const void* key, const void* value)
+{
+    assert(ctx && key && value && "`ctx`, `key` and `value` cannot be NULL in dthread_map_emit");
+
+    _DThreadMapReduce* job = ctx->job;
+    uint64_t hash = _dthread_map_hash(job, key);
+    _DThreadMapTable* table = &ctx->tables[(hash >> 32) % (uint64_t)job->partitions];
+
+    if (_dthread_map_table_put(job, table, hash, key, value) != 0)
+    {
+        ctx->failed = 1;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,911 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _parallel.c
+//    Date: 2024-09-12
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#if (defined(__x86_64__) && defined(__SSE2__)) || defined(_M_X64)
+#include <emmintrin.h>
+#define _DTHREAD_PARALLEL_SSE2
+#endif
+
+// samples taken per bucket to pick the splitters
+#define _DTHREAD_SORT_OVERSAMPLING 32
+
+// buckets per block, the buckets are sorted by the workers as they steal them
+#define _DTHREAD_SORT_BUCKETS_PER_BLOCK 4
+
+#define _DTHREAD_RADIX_BITS 8
+#define _DTHREAD_RADIX_BUCKETS (1 << _DTHREAD_RADIX_BITS)
+
+// write-combining buffer of a bucket, a cache line
+#define _DTHREAD_RADIX_LINE 64
+
+typedef void (*_DThreadParallelBody)(void* data, int block);
+
+typedef struct
+{
+    _DThreadParallelBody body;
+    void* data;
+    int begin;
+    int end;
+} _DThreadParallelRange;
+
+static dthread_define_routine(_dthread_parallel_split)
+{
+    _DThreadParallelRange* range = (_DThreadParallelRange*)data;
+
+    if (range->end - range->begin == 1)
+    {
+        range->body(range->data, range->begin);
+        return NULL;
+    }
+
+    // halves are spawned so idle workers steal the biggest pieces first
+    int mid = range->begin + (range->end - range->begin) / 2;
+    _DThreadParallelRange left = {range->body, range->data, range->begin, mid};
+    _DThreadParallelRange right = {range->body, range->data, mid, range->end};
+    DThreadFJ fj;
+    dthread_fj_init(&fj);
+
+    dthread_fj_spawn(&fj, _dthread_parallel_split, &left);
+    _dthread_parallel_split(&right);
+    dthread_fj_sync(&fj);
+
+    return NULL;
+}
+
+// runs `body` for every block in [0, blocks) and returns once they have all completed
+static void _dthread_parallel_blocks(DThreadPool* pool, int blocks, _DThreadParallelBody body, void* data)
+{
+    if (blocks <= 0)
+        return;
+
+    _DThreadParallelRange range = {body, data, 0, blocks};
+
+    if (pool && blocks > 1)
+        dthread_pool_run(pool, _dthread_parallel_split, &range);
+    else
+        _dthread_parallel_split(&range);
+}
+
+// the number of blocks an array of `count` elements is split into
+static int _dthread_parallel_width(DThreadPool* pool, size_t count)
+{
+    if (!pool || count < DTHREAD_PARALLEL_CUTOFF)
+        return 1;
+
+    int width = dthread_pool_get_num_workers(pool);
+
+    return width < 1 ? 1 : width;
+}
+
+#define _dthread_parallel_block_begin(COUNT, BLOCKS, BLOCK) ((size_t)((COUNT) * (uint64_t)(BLOCK) / (uint64_t)(BLOCKS)))
+
+/*
+ * Sample sort
+ */
+
+#define _DTHREAD_SORT_CLASSIFY 0
+#define _DTHREAD_SORT_SCATTER 1
+#define _DTHREAD_SORT_BUCKETS 2
+
+typedef struct
+{
+    int phase;
+
+    char* base;
+    char* tmp;
+    size_t count;
+    size_t size;
+    DThreadCompare compare;
+
+    int blocks;
+    int buckets;
+    char* splitters;
+    uint16_t* ids;
+
+    // blocks * buckets counters, then the offsets the blocks scatter to
+    size_t* counts;
+    size_t* starts;
+} _DThreadSampleSort;
+
+static void _dthread_sort_body(void* data, int block)
+{
+    _DThreadSampleSort* sort = (_DThreadSampleSort*)data;
+    size_t size = sort->size;
+
+    if (sort->phase == _DTHREAD_SORT_BUCKETS)
+    {
+        size_t begin = sort->starts[block];
+        size_t n = sort->starts[block + 1] - begin;
+
+        qsort(sort->tmp + begin * size, n, size, sort->compare);
+        memcpy(sort->base + begin * size, sort->tmp + begin * size, n * size);
+
+        return;
+    }
+
+    size_t begin = _dthread_parallel_block_begin(sort->count, sort->blocks, block);
+    size_t end = _dthread_parallel_block_begin(sort->count, sort->blocks, block + 1);
+    size_t* counts = sort->counts + (size_t)block * (size_t)sort->buckets;
+
+    if (sort->phase == _DTHREAD_SORT_CLASSIFY)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const char* item = sort->base + i * size;
+            int lo = 0, hi = sort->buckets - 1;
+
+            // the first splitter greater than the item
+            while (lo < hi)
+            {
+                int mid = (lo + hi) / 2;
+
+                if (sort->compare(item, sort->splitters + (size_t)mid * size) < 0)
+                    hi = mid;
+                else
+                    lo = mid + 1;
+            }
+
+            sort->ids[i] = (uint16_t)lo;
+            counts[lo]++;
+        }
+    }
+    else
+    {
+        for (size_t i = begin; i < end; ++i)
+            memcpy(sort->tmp + counts[sort->ids[i]]++ * size, sort->base + i * size, size);
+    }
+}
+
+int dthread_parallel_sort(DThreadPool* pool, void* base, size_t count, size_t size, DThreadCompare compare)
+{
+    dthread_debug("dthread_parallel_sort");
+
+    assert((base || count == 0) && compare && "`base` and `compare` cannot be NULL in dthread_parallel_sort");
+
+    int blocks = _dthread_parallel_width(pool, count);
+
+    if (blocks == 1)
+    {
+        qsort(base, count, size, compare);
+        return 0;
+    }
+
+    _DThreadSampleSort sort = {0};
+    sort.base = (char*)base;
+    sort.count = count;
+    sort.size = size;
+    sort.compare = compare;
+    sort.blocks = blocks;
+    sort.buckets = blocks * _DTHREAD_SORT_BUCKETS_PER_BLOCK;
+
+    if (sort.buckets > UINT16_MAX)
+        sort.buckets = UINT16_MAX;
+
+    size_t num_samples = (size_t)sort.buckets * _DTHREAD_SORT_OVERSAMPLING;
+
+    sort.tmp = (char*)malloc(count * size);
+    sort.ids = (uint16_t*)malloc(count * sizeof(uint16_t));
+    sort.counts = (size_t*)calloc((size_t)blocks * (size_t)sort.buckets, sizeof(size_t));
+    sort.starts = (size_t*)malloc(((size_t)sort.buckets + 1) * sizeof(size_t));
+    sort.splitters = (char*)malloc(num_samples * size);
+
+    if (!sort.tmp || !sort.ids || !sort.counts || !sort.starts || !sort.splitters)
+    {
+        free(sort.splitters);
+        free(sort.starts);
+        free(sort.counts);
+        free(sort.ids);
+        free(sort.tmp);
+        return 1;
+    }
+
+    // a fixed seed keeps the runs reproducible
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    for (size_t i = 0; i < num_samples; ++i)
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+
+        memcpy(sort.splitters + i * size, sort.base + (size_t)(state % count) * size, size);
+    }
+
+    qsort(sort.splitters, num_samples, size, compare);
+
+    // every OVERSAMPLING-th sample splits two buckets, kept at the front of the buffer
+    for (int i = 0; i < sort.buckets - 1; ++i)
+        memmove(sort.splitters + (size_t)i * size, sort.splitters + ((size_t)(i + 1) * _DTHREAD_SORT_OVERSAMPLING) * size, size);
+
+    sort.phase = _DTHREAD_SORT_CLASSIFY;
+    _dthread_parallel_blocks(pool, blocks, _dthread_sort_body, &sort);
+
+    // bucket major offsets, the blocks keep their order within a bucket
+    size_t offset = 0;
+    for (int b = 0; b < sort.buckets; ++b)
+    {
+        sort.starts[b] = offset;
+
+        for (int block = 0; block < blocks; ++block)
+        {
+            size_t* counter = &sort.counts[(size_t)block * (size_t)sort.buckets + (size_t)b];
+            size_t n = *counter;
+
+            *counter = offset;
+            offset += n;
+        }
+    }
+    sort.starts[sort.buckets] = offset;
+
+    sort.phase = _DTHREAD_SORT_SCATTER;
+    _dthread_parallel_blocks(pool, blocks, _dthread_sort_body, &sort);
+
+    sort.phase = _DTHREAD_SORT_BUCKETS;
+    _dthread_parallel_blocks(pool, sort.buckets, _dthread_sort_body, &sort);
+
+    free(sort.splitters);
+    free(sort.starts);
+    free(sort.counts);
+    free(sort.ids);
+    free(sort.tmp);
+
+    return 0;
+}
+
+/*
+ * LSD radix sort
+ */
+
+#define _DTHREAD_RADIX_HISTOGRAM 0
+#define _DTHREAD_RADIX_SCATTER 1
+#define _DTHREAD_RADIX_COPY 2
+
+typedef struct
+{
+    int phase;
+    int key_size;
+    int shift;
+
+    void* src;
+    void* dst;
+    uint64_t* src_values;
+    uint64_t* dst_values;
+
+    size_t count;
+    int blocks;
+
+    // blocks * buckets counters, then the offsets the blocks scatter to
+    size_t* counts;
+
+    // per block write-combining buffers of every bucket, keys then values
+    unsigned char* lines;
+} _DThreadRadix;
+
+static void _dthread_radix_scatter_u32(_DThreadRadix* radix, size_t begin, size_t end, size_t* offsets, unsigned char* lines)
+{
+    enum
+    {
+        PER_LINE = _DTHREAD_RADIX_LINE / sizeof(uint32_t)
+    };
+
+    const uint32_t* src = (const uint32_t*)radix->src;
+    uint32_t* dst = (uint32_t*)radix->dst;
+    uint32_t* buffers = (uint32_t*)lines;
+    unsigned char fill[_DTHREAD_RADIX_BUCKETS] = {0};
+    int shift = radix->shift;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint32_t key = src[i];
+        unsigned int b = (key >> shift) & (_DTHREAD_RADIX_BUCKETS - 1);
+        uint32_t* line = buffers + b * PER_LINE;
+
+        line[fill[b]++] = key;
+
+        // a whole line reaches memory at once instead of a store per key
+        if (fill[b] == PER_LINE)
+        {
+            memcpy(dst + offsets[b], line, _DTHREAD_RADIX_LINE);
+            offsets[b] += PER_LINE;
+            fill[b] = 0;
+        }
+    }
+
+    for (unsigned int b = 0; b < _DTHREAD_RADIX_BUCKETS; ++b)
+    {
+        memcpy(dst + offsets[b], buffers + b * PER_LINE, fill[b] * sizeof(uint32_t));
+        offsets[b] += fill[b];
+    }
+}
+
+static void _dthread_radix_scatter_u64(_DThreadRadix* radix, size_t begin, size_t end, size_t* offsets, unsigned char* lines)
+{
+    enum
+    {
+        PER_LINE = _DTHREAD_RADIX_LINE / sizeof(uint64_t)
+    };
+
+    const uint64_t* src = (const uint64_t*)radix->src;
+    const uint64_t* src_values = radix->src_values;
+    uint64_t* dst = (uint64_t*)radix->dst;
+    uint64_t* dst_values = radix->dst_values;
+    uint64_t* buffers = (uint64_t*)lines;
+    uint64_t* value_buffers = buffers + _DTHREAD_RADIX_BUCKETS * PER_LINE;
+    unsigned char fill[_DTHREAD_RADIX_BUCKETS] = {0};
+    int shift = radix->shift;
+
+    for (size_t i = begin; i < end; ++i)
+    {
+        uint64_t key = src[i];
+        unsigned int b = (unsigned int)(key >> shift) & (_DTHREAD_RADIX_BUCKETS - 1);
+        unsigned int slot = b * PER_LINE + fill[b]++;
+
+        buffers[slot] = key;
+        if (src_values)
+            value_buffers[slot] = src_values[i];
+
+        if (fill[b] == PER_LINE)
+        {
+            memcpy(dst + offsets[b], buffers + b * PER_LINE, _DTHREAD_RADIX_LINE);
+            if (src_values)
+                memcpy(dst_values + offsets[b], value_buffers + b * PER_LINE, _DTHREAD_RADIX_LINE);
+
+            offsets[b] += PER_LINE;
+            fill[b] = 0;
+        }
+    }
+
+    for (unsigned int b = 0; b < _DTHREAD_RADIX_BUCKETS; ++b)
+    {
+        memcpy(dst + offsets[b], buffers + b * PER_LINE, fill[b] * sizeof(uint64_t));
+        if (src_values)
+            memcpy(dst_values + offsets[b], value_buffers + b * PER_LINE, fill[b] * sizeof(uint64_t));
+
+        offsets[b] += fill[b];
+    }
+}
+
+static void _dthread_radix_body(void* data, int block)
+{
+    _DThreadRadix* radix = (_DThreadRadix*)data;
+    size_t begin = _dthread_parallel_block_begin(radix->count, radix->blocks, block);
+    size_t end = _dthread_parallel_block_begin(radix->count, radix->blocks, block + 1);
+    size_t* counts = radix->counts + (size_t)block * _DTHREAD_RADIX_BUCKETS;
+
+    if (radix->phase == _DTHREAD_RADIX_HISTOGRAM)
+    {
+        memset(counts, 0, _DTHREAD_RADIX_BUCKETS * sizeof(size_t));
+
+        if (radix->key_size == 4)
+        {
+            const uint32_t* src = (const uint32_t*)radix->src;
+            for (size_t i = begin; i < end; ++i)
+                counts[(src[i] >> radix->shift) & (_DTHREAD_RADIX_BUCKETS - 1)]++;
+        }
+        else
+        {
+            const uint64_t* src = (const uint64_t*)radix->src;
+            for (size_t i = begin; i < end; ++i)
+                counts[(src[i] >> radix->shift) & (_DTHREAD_RADIX_BUCKETS - 1)]++;
+        }
+    }
+    else if (radix->phase == _DTHREAD_RADIX_SCATTER)
+    {
+        unsigned char* lines = radix->lines + (size_t)block * _DTHREAD_RADIX_BUCKETS * _DTHREAD_RADIX_LINE * 2;
+
+        if (radix->key_size == 4)
+            _dthread_radix_scatter_u32(radix, begin, end, counts, lines);
+        else
+            _dthread_radix_scatter_u64(radix, begin, end, counts, lines);
+    }
+    else
+    {
+        // the sorted keys ended up in the temporary buffer
+        size_t key_size = (size_t)radix->key_size;
+        memcpy((char*)radix->dst + begin * key_size, (char*)radix->src + begin * key_size, (end - begin) * key_size);
+
+        if (radix->src_values)
+            memcpy(radix->dst_values + begin, radix->src_values + begin, (end - begin) * sizeof(uint64_t));
+    }
+}
+
+static int _dthread_radix_sort(DThreadPool* pool, void* keys, uint64_t* values, size_t count, int key_size)
+{
+    if (count < 2)
+        return 0;
+
+    _DThreadRadix radix = {0};
+    radix.key_size = key_size;
+    radix.count = count;
+    radix.blocks = _dthread_parallel_width(pool, count);
+
+    void* tmp = malloc(count * (size_t)key_size);
+    uint64_t* tmp_values = values ? (uint64_t*)malloc(count * sizeof(uint64_t)) : NULL;
+
+    radix.counts = (size_t*)malloc((size_t)radix.blocks * _DTHREAD_RADIX_BUCKETS * sizeof(size_t));
+    radix.lines = (unsigned char*)malloc((size_t)radix.blocks * _DTHREAD_RADIX_BUCKETS * _DTHREAD_RADIX_LINE * 2);
+
+    if (!tmp || (values && !tmp_values) || !radix.counts || !radix.lines)
+    {
+        free(radix.lines);
+        free(radix.counts);
+        free(tmp_values);
+        free(tmp);
+        return 1;
+    }
+
+    radix.src = keys;
+    radix.dst = tmp;
+    radix.src_values = values;
+    radix.dst_values = tmp_values;
+
+    for (radix.shift = 0; radix.shift < key_size * 8; radix.shift += _DTHREAD_RADIX_BITS)
+    {
+        radix.phase = _DTHREAD_RADIX_HISTOGRAM;
+        _dthread_parallel_blocks(pool, radix.blocks, _dthread_radix_body, &radix);
+
+        // exclusive offsets, bucket major so that the sort stays stable
+        size_t offset = 0;
+        int skip = 0;
+
+        for (int b = 0; b < _DTHREAD_RADIX_BUCKETS; ++b)
+        {
+            size_t start = offset;
+
+            for (int block = 0; block < radix.blocks; ++block)
+            {
+                size_t* counter = &radix.counts[(size_t)block * _DTHREAD_RADIX_BUCKETS + (size_t)b];
+                size_t n = *counter;
+
+                *counter = offset;
+                offset += n;
+            }
+
+            // every key shares this byte, the pass would not move anything
+            if (offset - start == count)
+                skip = 1;
+        }
+
+        if (skip)
+            continue;
+
+        radix.phase = _DTHREAD_RADIX_SCATTER;
+        _dthread_parallel_blocks(pool, radix.blocks, _dthread_radix_body, &radix);
+
+        void* swap = radix.src;
+        radix.src = radix.dst;
+        radix.dst = swap;
+
+        uint64_t* swap_values = radix.src_values;
+        radix.src_values = radix.dst_values;
+        radix.dst_values = swap_values;
+    }
+
+    if (radix.src != keys)
+    {
+        radix.phase = _DTHREAD_RADIX_COPY;
+        _dthread_parallel_blocks(pool, radix.blocks, _dthread_radix_body, &radix);
+    }
+
+    free(radix.lines);
+    free(radix.counts);
+    free(tmp_values);
+    free(tmp);
+
+    return 0;
+}
+
+int dthread_parallel_radix_sort_u32(DThreadPool* pool, uint32_t* keys, size_t count)
+{
+    dthread_debug("dthread_parallel_radix_sort_u32");
+
+    assert((keys || count == 0) && "`keys` cannot be NULL in dthread_parallel_radix_sort_u32");
+
+    return _dthread_radix_sort(pool, keys, NULL, count, 4);
+}
+
+int dthread_parallel_radix_sort_u64(DThreadPool* pool, uint64_t* keys, size_t count)
+{
+    dthread_debug("dthread_parallel_radix_sort_u64");
+
+    assert((keys || count == 0) && "`keys` cannot be NULL in dthread_parallel_radix_sort_u64");
+
+    return _dthread_radix_sort(pool, keys, NULL, count, 8);
+}
+
+int dthread_parallel_radix_sort_kv(DThreadPool* pool, uint64_t* keys, uint64_t* values, size_t count)
+{
+    dthread_debug("dthread_parallel_radix_sort_kv");
+
+    assert(((keys && values) || count == 0) && "`keys` and `values` cannot be NULL in dthread_parallel_radix_sort_kv");
+
+    return _dthread_radix_sort(pool, keys, values, count, 8);
+}
+
+/*
+ * Prefix sums
+ */
+
+#define _DTHREAD_SCAN_REDUCE 0
+#define _DTHREAD_SCAN_APPLY 1
+
+#define _DTHREAD_SCAN_GENERIC 0
+#define _DTHREAD_SCAN_I32 1
+#define _DTHREAD_SCAN_I64 2
+#define _DTHREAD_SCAN_F32 3
+#define _DTHREAD_SCAN_F64 4
+
+typedef struct
+{
+    int phase;
+    int kind;
+    int inclusive;
+
+    char* base;
+    size_t count;
+    size_t size;
+    DThreadCombine combine;
+    const void* identity;
+
+    int blocks;
+
+    // the total of every block, then what comes before every block
+    unsigned char* sums;
+} _DThreadScan;
+
+#define _DTHREAD_SCAN_SERIAL(NAME, TYPE)                                                      \
+    static TYPE _dthread_scan_reduce_##NAME(const TYPE* items, size_t n)                      \
+    {                                                                                         \
+        TYPE total = 0;                                                                       \
+        for (size_t i = 0; i < n; ++i)                                                        \
+            total += items[i];                                                                \
+        return total;                                                                         \
+    }                                                                                         \
+                                                                                              \
+    static TYPE _dthread_scan_serial_##NAME(TYPE* items, size_t n, TYPE carry, int inclusive) \
+    {                                                                                         \
+        for (size_t i = 0; i < n; ++i)                                                        \
+        {                                                                                     \
+            TYPE item = items[i];                                                             \
+            items[i] = inclusive ? carry + item : carry;                                      \
+            carry += item;                                                                    \
+        }                                                                                     \
+        return carry;                                                                         \
+    }
+
+_DTHREAD_SCAN_SERIAL(i32, int32_t)
+_DTHREAD_SCAN_SERIAL(i64, int64_t)
+_DTHREAD_SCAN_SERIAL(f32, float)
+_DTHREAD_SCAN_SERIAL(f64, double)
+
+#ifdef _DTHREAD_PARALLEL_SSE2
+
+// the vector kernels add shifted copies of a register to itself (log2(lanes) steps) and
+// broadcast the last lane as the carry of the next register
+
+static int32_t _dthread_scan_simd_i32(int32_t* items, size_t n, int32_t carry_in, int inclusive)
+{
+    __m128i carry = _mm_set1_epi32(carry_in);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(items + i));
+        __m128i local = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        local = _mm_add_epi32(local, _mm_slli_si128(local, 8));
+
+        __m128i sum = _mm_add_epi32(local, carry);
+        __m128i out = inclusive ? sum : _mm_add_epi32(_mm_slli_si128(local, 4), carry);
+
+        _mm_storeu_si128((__m128i*)(items + i), out);
+        carry = _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    return _dthread_scan_serial_i32(items + i, n - i, _mm_cvtsi128_si32(carry), inclusive);
+}
+
+static int64_t _dthread_scan_simd_i64(int64_t* items, size_t n, int64_t carry_in, int inclusive)
+{
+    __m128i carry = _mm_set1_epi64x(carry_in);
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128i x = _mm_loadu_si128((const __m128i*)(items + i));
+        __m128i local = _mm_add_epi64(x, _mm_slli_si128(x, 8));
+
+        __m128i sum = _mm_add_epi64(local, carry);
+        __m128i out = inclusive ? sum : _mm_add_epi64(_mm_slli_si128(local, 8), carry);
+
+        _mm_storeu_si128((__m128i*)(items + i), out);
+        carry = _mm_shuffle_epi32(sum, _MM_SHUFFLE(3, 2, 3, 2));
+    }
+
+    return _dthread_scan_serial_i64(items + i, n - i, _mm_cvtsi128_si64(carry), inclusive);
+}
+
+static float _dthread_scan_simd_f32(float* items, size_t n, float carry_in, int inclusive)
+{
+    __m128 carry = _mm_set1_ps(carry_in);
+    size_t i = 0;
+
+    for (; i + 4 <= n; i += 4)
+    {
+        __m128 x = _mm_loadu_ps(items + i);
+        __m128 local = _mm_add_ps(x, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(x), 4)));
+        local = _mm_add_ps(local, _mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(local), 8)));
+
+        __m128 sum = _mm_add_ps(local, carry);
+        __m128 out = inclusive ? sum : _mm_add_ps(_mm_castsi128_ps(_mm_slli_si128(_mm_castps_si128(local), 4)), carry);
+
+        _mm_storeu_ps(items + i, out);
+        carry = _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(3, 3, 3, 3));
+    }
+
+    return _dthread_scan_serial_f32(items + i, n - i, _mm_cvtss_f32(carry), inclusive);
+}
+
+static double _dthread_scan_simd_f64(double* items, size_t n, double carry_in, int inclusive)
+{
+    __m128d carry = _mm_set1_pd(carry_in);
+    size_t i = 0;
+
+    for (; i + 2 <= n; i += 2)
+    {
+        __m128d x = _mm_loadu_pd(items + i);
+        __m128d local = _mm_add_pd(x, _mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(x), 8)));
+
+        __m128d sum = _mm_add_pd(local, carry);
+        __m128d out = inclusive ? sum : _mm_add_pd(_mm_castsi128_pd(_mm_slli_si128(_mm_castpd_si128(local), 8)), carry);
+
+        _mm_storeu_pd(items + i, out);
+        carry = _mm_unpackhi_pd(sum, sum);
+    }
+
+    return _dthread_scan_serial_f64(items + i, n - i, _mm_cvtsd_f64(carry), inclusive);
+}
+
+#else
+
+#define _dthread_scan_simd_i32 _dthread_scan_serial_i32
+#define _dthread_scan_simd_i64 _dthread_scan_serial_i64
+#define _dthread_scan_simd_f32 _dthread_scan_serial_f32
+#define _dthread_scan_simd_f64 _dthread_scan_serial_f64
+
+#endif
+
+static void _dthread_scan_generic(_DThreadScan* scan, size_t begin, size_t end, unsigned char* sum)
+{
+    size_t size = scan->size;
+    unsigned char* item = (unsigned char*)scan->base + begin * size;
+
+    if (scan->phase == _DTHREAD_SCAN_REDUCE)
+    {
+        memcpy(sum, scan->identity, size);
+
+        for (size_t i = begin; i < end; ++i, item += size)
+            scan->combine(sum, sum, item);
+
+        return;
+    }
+
+    // `sum` is the running carry, followed by room for one element
+    unsigned char* saved = sum + size;
+
+    for (size_t i = begin; i < end; ++i, item += size)
+    {
+        if (scan->inclusive)
+        {
+            scan->combine(item, sum, item);
+            memcpy(sum, item, size);
+        }
+        else
+        {
+            memcpy(saved, item, size);
+            memcpy(item, sum, size);
+            scan->combine(sum, sum, saved);
+        }
+    }
+}
+
+static void _dthread_scan_body(void* data, int block)
+{
+    _DThreadScan* scan = (_DThreadScan*)data;
+    size_t begin = _dthread_parallel_block_begin(scan->count, scan->blocks, block);
+    size_t end = _dthread_parallel_block_begin(scan->count, scan->blocks, block + 1);
+    size_t n = end - begin;
+    int reduce = scan->phase == _DTHREAD_SCAN_REDUCE;
+
+    switch (scan->kind)
+    {
+        case _DTHREAD_SCAN_I32:
+        {
+            int32_t* sum = (int32_t*)scan->sums + block;
+            int32_t* items = (int32_t*)scan->base + begin;
+            *sum = reduce ? _dthread_scan_reduce_i32(items, n) : _dthread_scan_simd_i32(items, n, *sum, scan->inclusive);
+            break;
+        }
+
+        case _DTHREAD_SCAN_I64:
+        {
+            int64_t* sum = (int64_t*)scan->sums + block;
+            int64_t* items = (int64_t*)scan->base + begin;
+            *sum = reduce ? _dthread_scan_reduce_i64(items, n) : _dthread_scan_simd_i64(items, n, *sum, scan->inclusive);
+            break;
+        }
+
+        case _DTHREAD_SCAN_F32:
+        {
+            float* sum = (float*)scan->sums + block;
+            float* items = (float*)scan->base + begin;
+            *sum = reduce ? _dthread_scan_reduce_f32(items, n) : _dthread_scan_simd_f32(items, n, *sum, scan->inclusive);
+            break;
+        }
+
+        case _DTHREAD_SCAN_F64:
+        {
+            double* sum = (double*)scan->sums + block;
+            double* items = (double*)scan->base + begin;
+            *sum = reduce ? _dthread_scan_reduce_f64(items, n) : _dthread_scan_simd_f64(items, n, *sum, scan->inclusive);
+            break;
+        }
+
+        default:
+            _dthread_scan_generic(scan, begin, end, scan->sums + (size_t)block * scan->size * 2);
+            break;
+    }
+}
+
+// exclusive scan of the block totals on the calling thread
+static void _dthread_scan_totals(_DThreadScan* scan, unsigned char* carry)
+{
+    size_t size = scan->size;
+
+    memset(carry, 0, size * 2);
+    if (scan->kind == _DTHREAD_SCAN_GENERIC)
+        memcpy(carry, scan->identity, size);
+
+    for (int block = 0; block < scan->blocks; ++block)
+    {
+        // generic sums have room for a second element
+        unsigned char* sum = scan->sums + (size_t)block * size * (scan->kind == _DTHREAD_SCAN_GENERIC ? 2 : 1);
+        unsigned char* total = carry + size;
+
+        memcpy(total, sum, size);
+        memcpy(sum, carry, size);
+
+        switch (scan->kind)
+        {
+            case _DTHREAD_SCAN_I32:
+                *(int32_t*)carry += *(int32_t*)total;
+                break;
+            case _DTHREAD_SCAN_I64:
+                *(int64_t*)carry += *(int64_t*)total;
+                break;
+            case _DTHREAD_SCAN_F32:
+                *(float*)carry += *(float*)total;
+                break;
+            case _DTHREAD_SCAN_F64:
+                *(double*)carry += *(double*)total;
+                break;
+            default:
+                scan->combine(carry, carry, total);
+                break;
+        }
+    }
+}
+
+static int _dthread_scan(DThreadPool* pool, _DThreadScan* scan)
+{
+    if (scan->count == 0)
+        return 0;
+
+    scan->blocks = _dthread_parallel_width(pool, scan->count);
+
+    size_t stride = scan->kind == _DTHREAD_SCAN_GENERIC ? scan->size * 2 : scan->size;
+    // two more slots for the carry and the total while the block totals are scanned
+    scan->sums = (unsigned char*)calloc((size_t)scan->blocks + 2, stride);
+
+    if (!scan->sums)
+        return 1;
+
+    if (scan->blocks > 1)
+    {
+        scan->phase = _DTHREAD_SCAN_REDUCE;
+        _dthread_parallel_blocks(pool, scan->blocks, _dthread_scan_body, scan);
+
+        _dthread_scan_totals(scan, scan->sums + (size_t)scan->blocks * stride);
+    }
+    else if (scan->kind == _DTHREAD_SCAN_GENERIC)
+    {
+        memcpy(scan->sums, scan->identity, scan->size);
+    }
+
+    scan->phase = _DTHREAD_SCAN_APPLY;
+    _dthread_parallel_blocks(pool, scan->blocks, _dthread_scan_body, scan);
+
+    free(scan->sums);
+
+    return 0;
+}
+
+int dthread_parallel_scan(DThreadPool* pool, void* base, size_t count, size_t size, DThreadCombine combine, const void* identity, int mode)
+{
+    dthread_debug("dthread_parallel_scan");
+
+    assert((base || count == 0) && combine && identity && "`base`, `combine` and `identity` cannot be NULL in dthread_parallel_scan");
+
+    _DThreadScan scan = {0};
+    scan.kind = _DTHREAD_SCAN_GENERIC;
+    scan.inclusive = mode == DTHREAD_SCAN_INCLUSIVE;
+    scan.base = (char*)base;
+    scan.count = count;
+    scan.size = size;
+    scan.combine = combine;
+    scan.identity = identity;
+
+    return _dthread_scan(pool, &scan);
+}
+
+static int _dthread_scan_typed(DThreadPool* pool, void* items, size_t count, size_t size, int kind, int mode)
+{
+    _DThreadScan scan = {0};
+    scan.kind = kind;
+    scan.inclusive = mode == DTHREAD_SCAN_INCLUSIVE;
+    scan.base = (char*)items;
+    scan.count = count;
+    scan.size = size;
+
+    return _dthread_scan(pool, &scan);
+}
+
+int dthread_parallel_scan_i32(DThreadPool* pool, int32_t* items, size_t count, int mode)
+{
+    dthread_debug("dthread_parallel_scan_i32");
+
+    assert((items || count == 0) && "`items` cannot be NULL in dthread_parallel_scan_i32");
+
+    return _dthread_scan_typed(pool, items, count, sizeof(int32_t), _DTHREAD_SCAN_I32, mode);
+}
+
+int dthread_parallel_scan_i64(DThreadPool* pool, int64_t* items, size_t count, int mode)
+{
+    dthread_debug("dthread_parallel_scan_i64");
+
+    assert((items || count == 0) && "`items` cannot be NULL in dthread_parallel_scan_i64");
+
+    return _dthread_scan_typed(pool, items, count, sizeof(int64_t), _DTHREAD_SCAN_I64, mode);
+}
+
+int dthread_parallel_scan_f32(DThreadPool* pool, float* items, size_t count, int mode)
+{
+    dthread_debug("dthread_parallel_scan_f32");
+
+    assert((items || count == 0) && "`items` cannot be NULL in dthread_parallel_scan_f32");
+
+    return _dthread_scan_typed(pool, items, count, sizeof(float), _DTHREAD_SCAN_F32, mode);
+}
+
+int dthread_parallel_scan_f64(DThreadPool* pool, double* items, size_t count, int mode)
+{
+    dthread_debug("dthread_parallel_scan_f64");
+
+    assert((items || count == 0) && "`items` cannot be NULL in dthread_parallel_scan_f64");
+
+    return _dthread_scan_typed(pool, items, count, sizeof(double), _DTHREAD_SCAN_F64, mode);
+}
@@ -0,0 +1,346 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _pipeline.c
+//    Date: 2024-09-16
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#define _DTHREAD_PIPELINE_BATCH_SIZE 64
+#define _DTHREAD_PIPELINE_MAX_BATCHES 16
+
+static dthread_define_routine(_dthread_pipeline_read);
+static dthread_define_routine(_dthread_pipeline_process);
+
+static void _dthread_pipeline_spawn(DThreadPipeline* pipeline, DThreadRoutine func, void* data)
+{
+    // without room in the pool the work is done right here
+    if (dthread_pool_submit(pipeline->pool, func, data) != 0)
+        func(data);
+}
+
+// fills a batch from the source, must be called by the only reader, non-zero at the end
+static int _dthread_pipeline_fill(DThreadPipeline* pipeline, _DThreadPipelineBatch* batch)
+{
+    batch->stage = 0;
+    batch->count = 0;
+
+    while (batch->count < pipeline->config.batch_size)
+    {
+        void* item = pipeline->source(pipeline->source_data);
+
+        if (!item)
+            return 1;
+
+        batch->items[batch->count++] = item;
+    }
+
+    return 0;
+}
+
+// must be called with the mutex held, a serial stage takes the batches one at a time in input
+// order, non-zero when the batch has to wait for the ones before it
+static int _dthread_pipeline_enter(DThreadPipeline* pipeline, DThreadStage* stage, _DThreadPipelineBatch* batch)
+{
+    if (stage->busy || stage->next_seq != batch->seq)
+    {
+        stage->reorder[batch->seq % (uint64_t)pipeline->config.max_batches] = batch;
+        return 1;
+    }
+
+    stage->busy = 1;
+
+    return 0;
+}
+
+static void _dthread_pipeline_apply(DThreadStage* stage, _DThreadPipelineBatch* batch)
+{
+    for (int i = 0; i < batch->count; ++i)
+    {
+        if (batch->items[i])
+            batch->items[i] = stage->func(batch->items[i], stage->data);
+    }
+}
+
+// must be called with the mutex held, the pipeline is done once the source is exhausted and
+// every batch has left
+static void _dthread_pipeline_release(DThreadPipeline* pipeline, _DThreadPipelineBatch* batch)
+{
+    batch->next = pipeline->free_batches;
+    pipeline->free_batches = batch;
+    pipeline->in_flight--;
+
+    if (!pipeline->eof && !pipeline->reading)
+    {
+        pipeline->reading = 1;
+
+        dthread_mutex_unlock(&pipeline->mutex);
+        _dthread_pipeline_spawn(pipeline, _dthread_pipeline_read, pipeline);
+        dthread_mutex_lock(&pipeline->mutex);
+    }
+
+    if (pipeline->eof && pipeline->in_flight == 0 && !pipeline->reading)
+        dthread_cond_broadcast(&pipeline->cond);
+}
+
+static dthread_define_routine(_dthread_pipeline_process)
+{
+    _DThreadPipelineBatch* batch = (_DThreadPipelineBatch*)data;
+    DThreadPipeline* pipeline = batch->pipeline;
+
+    for (;;)
+    {
+        DThreadStage* stage = &pipeline->stages[batch->stage];
+
+        _dthread_pipeline_apply(stage, batch);
+
+        if (stage->mode == DTHREAD_STAGE_SERIAL)
+        {
+            // hands the stage over to the batch that follows, if it is already waiting
+            dthread_mutex_lock(&pipeline->mutex);
+
+            stage->next_seq++;
+
+            size_t slot = (size_t)(stage->next_seq % (uint64_t)pipeline->config.max_batches);
+            _DThreadPipelineBatch* waiting = stage->reorder[slot];
+
+            if (waiting && waiting->seq == stage->next_seq)
+                stage->reorder[slot] = NULL;
+            else
+            {
+                waiting = NULL;
+                stage->busy = 0;
+            }
+
+            dthread_mutex_unlock(&pipeline->mutex);
+
+            if (waiting)
+                _dthread_pipeline_spawn(pipeline, _dthread_pipeline_process, waiting);
+        }
+
+        if (++batch->stage == pipeline->num_stages)
+            break;
+
+        DThreadStage* next = &pipeline->stages[batch->stage];
+
+        if (next->mode == DTHREAD_STAGE_PARALLEL)
+            continue;
+
+        dthread_mutex_lock(&pipeline->mutex);
+        int wait = _dthread_pipeline_enter(pipeline, next, batch);
+        dthread_mutex_unlock(&pipeline->mutex);
+
+        if (wait)
+            return NULL;
+    }
+
+    dthread_mutex_lock(&pipeline->mutex);
+    _dthread_pipeline_release(pipeline, batch);
+    dthread_mutex_unlock(&pipeline->mutex);
+
+    return NULL;
+}
+
+static dthread_define_routine(_dthread_pipeline_read)
+{
+    DThreadPipeline* pipeline = (DThreadPipeline*)data;
+
+    dthread_mutex_lock(&pipeline->mutex);
+
+    _DThreadPipelineBatch* batch = pipeline->free_batches;
+
+    // every batch is in flight, the next one to leave starts the reader again
+    if (!batch || pipeline->eof)
+    {
+        pipeline->reading = 0;
+
+        if (pipeline->eof && pipeline->in_flight == 0)
+            dthread_cond_broadcast(&pipeline->cond);
+
+        dthread_mutex_unlock(&pipeline->mutex);
+        return NULL;
+    }
+
+    pipeline->free_batches = batch->next;
+    pipeline->in_flight++;
+    batch->seq = pipeline->next_seq++;
+
+    dthread_mutex_unlock(&pipeline->mutex);
+
+    int eof = _dthread_pipeline_fill(pipeline, batch);
+
+    dthread_mutex_lock(&pipeline->mutex);
+
+    pipeline->num_items += (uint64_t)batch->count;
+    if (eof)
+    {
+        pipeline->eof = 1;
+        pipeline->reading = 0;
+    }
+
+    int wait = pipeline->stages[0].mode == DTHREAD_STAGE_SERIAL && _dthread_pipeline_enter(pipeline, &pipeline->stages[0], batch);
+
+    dthread_mutex_unlock(&pipeline->mutex);
+
+    // the reader moves on to the next batch while this one goes through the stages
+    if (!eof)
+        _dthread_pipeline_spawn(pipeline, _dthread_pipeline_read, pipeline);
+
+    return wait ? NULL : _dthread_pipeline_process(batch);
+}
+
+int dthread_pipeline_init(DThreadPipeline* pipeline, DThreadPipelineConfig* config)
+{
+    dthread_debug("dthread_pipeline_init");
+
+    assert(pipeline && "`pipeline` cannot be NULL in dthread_pipeline_init");
+
+    memset(pipeline, 0, sizeof(*pipeline));
+
+    DThreadPipelineConfig cfg = config ? *config : (DThreadPipelineConfig){0};
+
+    if (cfg.batch_size <= 0)
+        cfg.batch_size = _DTHREAD_PIPELINE_BATCH_SIZE;
+    if (cfg.max_batches <= 0)
+        cfg.max_batches = _DTHREAD_PIPELINE_MAX_BATCHES;
+
+    pipeline->config = cfg;
+
+    pipeline->batches = (_DThreadPipelineBatch*)calloc((size_t)cfg.max_batches, sizeof(_DThreadPipelineBatch));
+    pipeline->items = (void**)malloc((size_t)cfg.max_batches * (size_t)cfg.batch_size * sizeof(void*));
+
+    if (!pipeline->batches || !pipeline->items)
+    {
+        free(pipeline->items);
+        free(pipeline->batches);
+        return 1;
+    }
+
+    dthread_mutex_init(&pipeline->mutex, NULL);
+    dthread_cond_init(&pipeline->cond, NULL);
+
+    return 0;
+}
+
+int dthread_pipeline_add_stage(DThreadPipeline* pipeline, int mode, DThreadStageFunc func, void* data)
+{
+    dthread_debug("dthread_pipeline_add_stage");
+
+    assert(pipeline && func && "`pipeline` and `func` cannot be NULL in dthread_pipeline_add_stage");
+
+    DThreadStage* stages = (DThreadStage*)realloc(pipeline->stages, (size_t)(pipeline->num_stages + 1) * sizeof(DThreadStage));
+    if (!stages)
+        return 1;
+
+    pipeline->stages = stages;
+
+    DThreadStage* stage = &stages[pipeline->num_stages];
+    memset(stage, 0, sizeof(*stage));
+    stage->func = func;
+    stage->data = data;
+    stage->mode = mode == DTHREAD_STAGE_SERIAL ? DTHREAD_STAGE_SERIAL : DTHREAD_STAGE_PARALLEL;
+
+    if (stage->mode == DTHREAD_STAGE_SERIAL)
+    {
+        stage->reorder = (_DThreadPipelineBatch**)calloc((size_t)pipeline->config.max_batches, sizeof(_DThreadPipelineBatch*));
+        if (!stage->reorder)
+            return 1;
+    }
+
+    pipeline->num_stages++;
+
+    return 0;
+}
+
+int dthread_pipeline_run(DThreadPipeline* pipeline, DThreadPool* pool, DThreadPipelineSource source, void* data)
+{
+    dthread_debug("dthread_pipeline_run");
+
+    assert(pipeline && source && "`pipeline` and `source` cannot be NULL in dthread_pipeline_run");
+
+    if (pipeline->num_stages == 0)
+        return 1;
+
+    pipeline->pool = pool;
+    pipeline->source = source;
+    pipeline->source_data = data;
+    pipeline->next_seq = 0;
+    pipeline->in_flight = 0;
+    pipeline->eof = 0;
+    pipeline->num_items = 0;
+    pipeline->free_batches = NULL;
+
+    for (int i = pipeline->config.max_batches - 1; i >= 0; --i)
+    {
+        _DThreadPipelineBatch* batch = &pipeline->batches[i];
+
+        batch->items = pipeline->items + (size_t)i * (size_t)pipeline->config.batch_size;
+        batch->pipeline = pipeline;
+        batch->next = pipeline->free_batches;
+        pipeline->free_batches = batch;
+    }
+
+    for (int i = 0; i < pipeline->num_stages; ++i)
+    {
+        pipeline->stages[i].busy = 0;
+        pipeline->stages[i].next_seq = 0;
+    }
+
+    if (!pool)
+    {
+        // one batch at a time through every stage keeps the input order on its own
+        _DThreadPipelineBatch* batch = pipeline->free_batches;
+        int eof = 0;
+
+        while (!eof)
+        {
+            eof = _dthread_pipeline_fill(pipeline, batch);
+            pipeline->num_items += (uint64_t)batch->count;
+
+            for (int i = 0; i < pipeline->num_stages; ++i)
+                _dthread_pipeline_apply(&pipeline->stages[i], batch);
+        }
+
+        return 0;
+    }
+
+    pipeline->reading = 1;
+    _dthread_pipeline_spawn(pipeline, _dthread_pipeline_read, pipeline);
+
+    dthread_mutex_lock(&pipeline->mutex);
+    while (!pipeline->eof || pipeline->in_flight > 0 || pipeline->reading)
+        dthread_cond_wait(&pipeline->cond, &pipeline->mutex);
+    dthread_mutex_unlock(&pipeline->mutex);
+
+    return 0;
+}
+
+void dthread_pipeline_destroy(DThreadPipeline* pipeline)
+{
+    dthread_debug("dthread_pipeline_destroy");
+
+    assert(pipeline && "`pipeline` cannot be NULL in dthread_pipeline_destroy");
+
+    for (int i = 0; i < pipeline->num_stages; ++i)
+        free(pipeline->stages[i].reorder);
+
+    free(pipeline->stages);
+    free(pipeline->items);
+    free(pipeline->batches);
+
+    dthread_cond_destroy(&pipeline->cond);
+    dthread_mutex_destroy(&pipeline->mutex);
+
+    memset(pipeline, 0, sizeof(*pipeline));
+}
@@ -0,0 +1,1347 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _pool.c
+//    Date: 2024-09-01
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#define _DTHREAD_POOL_DEQUE_SIZE 256
+#define _DTHREAD_POOL_MAX_FREE_TASKS 1024
+#define _DTHREAD_POOL_SPINS 32
+#define _DTHREAD_POOL_MAX_SPARE 256
+#define _DTHREAD_POOL_TARGET_WAIT_US 1000
+#define _DTHREAD_POOL_IDLE_TIMEOUT 1000
+#define _DTHREAD_POOL_AGING_US 10000
+
+#define _DTHREAD_POOL_RETIRED 1
+#define _DTHREAD_POOL_REAPED 2
+
+#define _DTHREAD_POOL_EMPTY ((_DThreadTask*)0)
+#define _DTHREAD_POOL_ABORT ((_DThreadTask*)1)
+
+static DTHREAD_THREAD_LOCAL _DThreadWorker* _dthread_pool_self = NULL;
+
+static void _dthread_pool_relax(void)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    SwitchToThread();
+#else
+    sched_yield();
+#endif
+}
+
+// the pool's own waits are idleness, not blocking, keep them out of `dthread_blocking_begin`
+static void _dthread_pool_lock(DThreadPool* pool)
+{
+    if (_dthread_pool_self)
+        _dthread_pool_self->blocking++;
+
+    dthread_mutex_lock(&pool->mutex);
+}
+
+static void _dthread_pool_unlock(DThreadPool* pool)
+{
+    dthread_mutex_unlock(&pool->mutex);
+
+    if (_dthread_pool_self)
+        _dthread_pool_self->blocking--;
+}
+
+static int64_t _dthread_pool_running(DThreadPool* pool)
+{
+    return dthread_atomic_load_i64(&pool->num_workers) - dthread_atomic_load_i64(&pool->retired) -
+           dthread_atomic_load_i64(&pool->spares) - dthread_atomic_load_i64(&pool->blocked);
+}
+
+static int _dthread_pool_autoscaling(DThreadPool* pool)
+{
+    return pool->config.max_workers > pool->config.min_workers;
+}
+
+// must be called with the pool mutex held
+static void _dthread_pool_sample(DThreadPool* pool, uint64_t wait_ns)
+{
+    int64_t running = _dthread_pool_running(pool);
+    int64_t busy = running - dthread_atomic_load_i64(&pool->sleepers);
+    int64_t utilization = running > 0 ? busy * 1000 / running : 0;
+
+    // exponentially weighted, 1/8 of every new sample
+    pool->avg_wait_ns += ((int64_t)wait_ns - pool->avg_wait_ns) / 8;
+    pool->utilization += (utilization - pool->utilization) / 8;
+}
+
+static uint64_t _dthread_pool_rand(_DThreadWorker* worker)
+{
+    // xorshift64, only used to pick victims
+    uint64_t x = worker->seed;
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    worker->seed = x;
+
+    return x;
+}
+
+static _DThreadDequeArray* _dthread_pool_array_new(int64_t size)
+{
+    _DThreadDequeArray* array = (_DThreadDequeArray*)malloc(sizeof(_DThreadDequeArray) + (size_t)size * sizeof(void*));
+    if (!array)
+        return NULL;
+
+    array->size = size;
+    array->retired = NULL;
+    array->items = (void**)(array + 1);
+
+    return array;
+}
+
+// owner only, the old array is kept alive until the pool is destroyed since thieves may still read it
+static _DThreadDequeArray* _dthread_pool_grow(_DThreadWorker* worker, _DThreadDequeArray* array, int64_t top, int64_t bottom)
+{
+    _DThreadDequeArray* grown = _dthread_pool_array_new(array->size * 2);
+    if (!grown)
+        return NULL;
+
+    for (int64_t i = top; i < bottom; ++i)
+        grown->items[i & (grown->size - 1)] = dthread_atomic_load_relaxed_ptr(&array->items[i & (array->size - 1)]);
+
+    grown->retired = array;
+    dthread_atomic_store_ptr((void**)&worker->array, grown);
+
+    return grown;
+}
+
+static int _dthread_pool_push(_DThreadWorker* worker, _DThreadTask* task)
+{
+    int64_t bottom = dthread_atomic_load_relaxed_i64(&worker->bottom);
+    int64_t top = dthread_atomic_load_i64(&worker->top);
+    _DThreadDequeArray* array = (_DThreadDequeArray*)dthread_atomic_load_relaxed_ptr((void**)&worker->array);
+
+    if (bottom - top > array->size - 1)
+    {
+        array = _dthread_pool_grow(worker, array, top, bottom);
+        if (!array)
+            return 1;
+    }
+
+    dthread_atomic_store_relaxed_ptr(&array->items[bottom & (array->size - 1)], (void*)task);
+    dthread_atomic_store_i64(&worker->bottom, bottom + 1);
+
+    return 0;
+}
+
+static _DThreadTask* _dthread_pool_take(_DThreadWorker* worker)
+{
+    int64_t bottom = dthread_atomic_load_relaxed_i64(&worker->bottom) - 1;
+    _DThreadDequeArray* array = (_DThreadDequeArray*)dthread_atomic_load_relaxed_ptr((void**)&worker->array);
+
+    dthread_atomic_store_relaxed_i64(&worker->bottom, bottom);
+    dthread_atomic_fence();
+
+    int64_t top = dthread_atomic_load_relaxed_i64(&worker->top);
+
+    if (top > bottom)
+    {
+        dthread_atomic_store_relaxed_i64(&worker->bottom, bottom + 1);
+        return _DTHREAD_POOL_EMPTY;
+    }
+
+    _DThreadTask* task = (_DThreadTask*)dthread_atomic_load_relaxed_ptr(&array->items[bottom & (array->size - 1)]);
+
+    if (top == bottom)
+    {
+        // last item, race against the thieves for it
+        if (!dthread_atomic_cas_i64(&worker->top, &top, top + 1))
+            task = _DTHREAD_POOL_EMPTY;
+
+        dthread_atomic_store_relaxed_i64(&worker->bottom, bottom + 1);
+    }
+
+    return task;
+}
+
+static _DThreadTask* _dthread_pool_steal(_DThreadWorker* victim)
+{
+    int64_t top = dthread_atomic_load_i64(&victim->top);
+    dthread_atomic_fence();
+    int64_t bottom = dthread_atomic_load_i64(&victim->bottom);
+
+    if (top >= bottom)
+        return _DTHREAD_POOL_EMPTY;
+
+    _DThreadDequeArray* array = (_DThreadDequeArray*)dthread_atomic_load_ptr((void**)&victim->array);
+    _DThreadTask* task = (_DThreadTask*)dthread_atomic_load_relaxed_ptr(&array->items[top & (array->size - 1)]);
+
+    if (!dthread_atomic_cas_i64(&victim->top, &top, top + 1))
+        return _DTHREAD_POOL_ABORT;
+
+    return task;
+}
+
+// takes the first placed task of a worker's inbox, a thief only gets tasks that have waited
+// `aging_us` for their (busy) worker or whose worker has retired
+static _DThreadTask* _dthread_pool_pop_inbox(_DThreadWorker* owner, _DThreadWorker* worker)
+{
+    DThreadPool* pool = owner->pool;
+
+    if (dthread_atomic_load_i64(&owner->inbox_count) == 0)
+        return NULL;
+
+    _dthread_pool_lock(pool);
+
+    _DThreadTask* task = owner->inbox_head;
+
+    if (task && owner != worker && !owner->retired &&
+        dthread_now_ns() - task->enqueued_ns < (uint64_t)pool->config.aging_us * 1000ull)
+        task = NULL;
+
+    if (task)
+    {
+        owner->inbox_head = task->next;
+        if (!owner->inbox_head)
+            owner->inbox_tail = NULL;
+        dthread_atomic_fetch_add_i64(&owner->inbox_count, -1);
+
+        if (owner == worker)
+            pool->num_placed++;
+        else
+            pool->num_migrated++;
+    }
+
+    _dthread_pool_unlock(pool);
+
+    return task;
+}
+
+// 0 for workers sharing an L3, 1 for the same NUMA node and 2 otherwise (or unknown)
+static int _dthread_pool_steal_class(_DThreadWorker* a, _DThreadWorker* b)
+{
+    if (a->l3 >= 0 && a->l3 == b->l3)
+        return 0;
+
+    if (a->node >= 0 && a->node == b->node)
+        return 1;
+
+    return 2;
+}
+
+static _DThreadTask* _dthread_pool_steal_any(_DThreadWorker* worker)
+{
+    DThreadPool* pool = worker->pool;
+
+    // another pass as long as a lost race shows that some victim still had work
+    for (int aborted = 1; aborted;)
+    {
+        int n = (int)dthread_atomic_load_i64(&pool->num_workers);
+
+        if (n < 2)
+            return NULL;
+
+        int start = (int)(_dthread_pool_rand(worker) % (uint64_t)n);
+        aborted = 0;
+
+        // without topology every victim is as far as any other, a single pass is enough
+        for (int steal_class = pool->cpu_order ? 0 : 2; steal_class <= 2; ++steal_class)
+        {
+            for (int i = 0; i < n; ++i)
+            {
+                _DThreadWorker* victim = &pool->workers[(start + i) % n];
+                if (victim == worker || _dthread_pool_steal_class(worker, victim) != steal_class)
+                    continue;
+
+                _DThreadTask* task = _dthread_pool_steal(victim);
+                if (task == _DTHREAD_POOL_ABORT)
+                {
+                    // lost the race to another thief, the victim still had work
+                    aborted = 1;
+                    continue;
+                }
+
+                if (!task)
+                    task = _dthread_pool_pop_inbox(victim, worker);
+
+                if (task)
+                    return task;
+            }
+        }
+    }
+
+    return NULL;
+}
+
+static int _dthread_pool_task_before(_DThreadTask* a, _DThreadTask* b)
+{
+    // earliest deadline first, plain tasks are due when submitted, ties keep submission order
+    return a->key_ns < b->key_ns || (a->key_ns == b->key_ns && a->seq < b->seq);
+}
+
+// must be called with the pool mutex held
+static int _dthread_pool_heap_push(_DThreadTaskHeap* heap, _DThreadTask* task)
+{
+    if (heap->size == heap->capacity)
+    {
+        size_t capacity = heap->capacity ? heap->capacity * 2 : 64;
+        _DThreadTask** tasks = (_DThreadTask**)realloc(heap->tasks, capacity * sizeof(_DThreadTask*));
+        if (!tasks)
+            return 1;
+
+        heap->tasks = tasks;
+        heap->capacity = capacity;
+    }
+
+    size_t i = heap->size++;
+
+    while (i > 0)
+    {
+        size_t parent = (i - 1) / 2;
+        if (!_dthread_pool_task_before(task, heap->tasks[parent]))
+            break;
+
+        heap->tasks[i] = heap->tasks[parent];
+        i = parent;
+    }
+
+    heap->tasks[i] = task;
+
+    task->older = heap->newest;
+    task->newer = NULL;
+
+    if (heap->newest)
+        heap->newest->newer = task;
+    else
+        heap->oldest = task;
+    heap->newest = task;
+
+    return 0;
+}
+
+// must be called with the pool mutex held and a non-empty heap
+static _DThreadTask* _dthread_pool_heap_pop(_DThreadTaskHeap* heap)
+{
+    _DThreadTask* top = heap->tasks[0];
+    _DThreadTask* last = heap->tasks[--heap->size];
+    size_t i = 0;
+
+    for (;;)
+    {
+        size_t child = 2 * i + 1;
+        if (child >= heap->size)
+            break;
+
+        if (child + 1 < heap->size && _dthread_pool_task_before(heap->tasks[child + 1], heap->tasks[child]))
+            child++;
+
+        if (!_dthread_pool_task_before(heap->tasks[child], last))
+            break;
+
+        heap->tasks[i] = heap->tasks[child];
+        i = child;
+    }
+
+    if (heap->size > 0)
+        heap->tasks[i] = last;
+
+    if (top->older)
+        top->older->newer = top->newer;
+    else
+        heap->oldest = top->newer;
+
+    if (top->newer)
+        top->newer->older = top->older;
+    else
+        heap->newest = top->older;
+
+    return top;
+}
+
+// must be called with the pool mutex held, -1 when nothing is queued
+static int _dthread_pool_select_level(DThreadPool* pool, uint64_t now)
+{
+    uint64_t aging_ns = (uint64_t)pool->config.aging_us * 1000ull;
+    int64_t best_effective = INT64_MAX;
+    int best = -1;
+
+    for (int level = 0; level < DTHREAD_TASK_PRIORITY_LEVELS; ++level)
+    {
+        _DThreadTaskHeap* heap = &pool->queues[level];
+        if (heap->size == 0)
+            continue;
+
+        // aging, a level is promoted by one for every `aging_us` its oldest task has waited
+        int64_t effective = (int64_t)level - (int64_t)((now - heap->oldest->enqueued_ns) / aging_ns);
+        if (effective < best_effective)
+        {
+            best_effective = effective;
+            best = level;
+        }
+    }
+
+    return best;
+}
+
+// must be called with the pool mutex held
+static uint64_t _dthread_pool_oldest_ns(DThreadPool* pool, uint64_t now)
+{
+    uint64_t oldest = now;
+
+    for (int level = 0; level < DTHREAD_TASK_PRIORITY_LEVELS; ++level)
+    {
+        _DThreadTaskHeap* heap = &pool->queues[level];
+        if (heap->size > 0 && heap->oldest->enqueued_ns < oldest)
+            oldest = heap->oldest->enqueued_ns;
+    }
+
+    return oldest;
+}
+
+static void _dthread_pool_scale_up(DThreadPool* pool, uint64_t now, uint64_t wait_ns);
+
+static _DThreadTask* _dthread_pool_pop_queued(DThreadPool* pool)
+{
+    if (dthread_atomic_load_i64(&pool->queued) == 0)
+        return NULL;
+
+    _dthread_pool_lock(pool);
+
+    _DThreadTask* task = NULL;
+    uint64_t now = dthread_now_ns();
+    int level = _dthread_pool_select_level(pool, now);
+
+    if (level >= 0)
+    {
+        task = _dthread_pool_heap_pop(&pool->queues[level]);
+        dthread_atomic_fetch_add_i64(&pool->queued, -1);
+
+        if (task->deadline_ns && now > task->deadline_ns)
+            pool->deadline_misses++;
+
+        _dthread_pool_sample(pool, now - task->enqueued_ns);
+
+        if (pool->queued > 0)
+            _dthread_pool_scale_up(pool, now, (uint64_t)pool->avg_wait_ns);
+    }
+
+    _dthread_pool_unlock(pool);
+
+    return task;
+}
+
+static _DThreadTask* _dthread_pool_alloc_task(_DThreadWorker* worker)
+{
+    if (worker && worker->free_tasks)
+    {
+        _DThreadTask* task = worker->free_tasks;
+        worker->free_tasks = task->next;
+        worker->num_free_tasks--;
+
+        return task;
+    }
+
+    return (_DThreadTask*)malloc(sizeof(_DThreadTask));
+}
+
+static void _dthread_pool_free_task(_DThreadWorker* worker, _DThreadTask* task)
+{
+    if (worker->num_free_tasks >= _DTHREAD_POOL_MAX_FREE_TASKS)
+    {
+        free(task);
+        return;
+    }
+
+    task->next = worker->free_tasks;
+    worker->free_tasks = task;
+    worker->num_free_tasks++;
+}
+
+static void _dthread_pool_wake(DThreadPool* pool)
+{
+    // pairs with the fence in `_dthread_pool_sleep`, either we see the sleeper or it sees the task
+    dthread_atomic_fence();
+
+    if (dthread_atomic_load_i64(&pool->sleepers) == 0)
+        return;
+
+    _dthread_pool_lock(pool);
+    dthread_cond_signal(&pool->cond);
+    _dthread_pool_unlock(pool);
+}
+
+static void _dthread_pool_execute(_DThreadWorker* worker, _DThreadTask* task)
+{
+    DThreadPool* pool = worker->pool;
+    DThreadRoutine func = task->func;
+    void* data = task->data;
+    DThreadFJ* frame = task->frame;
+
+    // recycle first so the children of this task can reuse it
+    _dthread_pool_free_task(worker, task);
+
+    func(data);
+
+    if (frame)
+    {
+        dthread_atomic_fetch_add_i64(&frame->pending, -1);
+        return;
+    }
+
+    dthread_atomic_fetch_add_i64(&pool->completed, 1);
+
+    if (dthread_atomic_fetch_add_i64(&pool->pending, -1) == 1)
+    {
+        _dthread_pool_lock(pool);
+        dthread_cond_broadcast(&pool->idle);
+        _dthread_pool_unlock(pool);
+    }
+}
+
+// must be called with the pool mutex held, `later` is set when placed tasks of other workers
+// will become stealable once they have waited long enough
+static int _dthread_pool_has_work(DThreadPool* pool, _DThreadWorker* self, int* later)
+{
+    if (dthread_atomic_load_i64(&pool->queued) > 0)
+        return 1;
+
+    int64_t n = dthread_atomic_load_i64(&pool->num_workers);
+    uint64_t aging_ns = (uint64_t)pool->config.aging_us * 1000ull;
+    uint64_t now = 0;
+
+    for (int64_t i = 0; i < n; ++i)
+    {
+        _DThreadWorker* worker = &pool->workers[i];
+        if (dthread_atomic_load_i64(&worker->top) < dthread_atomic_load_i64(&worker->bottom))
+            return 1;
+
+        if (!worker->inbox_head)
+            continue;
+
+        if (worker == self || worker->retired)
+            return 1;
+
+        if (!now)
+            now = dthread_now_ns();
+
+        if (now - worker->inbox_head->enqueued_ns >= aging_ns)
+            return 1;
+
+        *later = 1;
+    }
+
+    return 0;
+}
+
+// must be called with the pool mutex held, the worker exits right after
+static void _dthread_pool_retire(DThreadPool* pool, _DThreadWorker* worker)
+{
+    worker->retired = _DTHREAD_POOL_RETIRED;
+    dthread_atomic_fetch_add_i64(&pool->retired, 1);
+    pool->num_retired++;
+}
+
+// returns non-zero when the worker has to exit, the pool is stopping or the worker retired
+static int _dthread_pool_sleep(_DThreadWorker* worker)
+{
+    DThreadPool* pool = worker->pool;
+    int exit;
+
+    _dthread_pool_lock(pool);
+
+    dthread_atomic_fetch_add_i64(&pool->sleepers, 1);
+    dthread_atomic_fence();
+
+    int later = 0;
+
+    exit = pool->stop;
+    if (!exit && !_dthread_pool_has_work(pool, worker, &later))
+    {
+        if (later)
+        {
+            // come back when the placed tasks of busy workers may be taken over
+            dthread_cond_timedwait(&pool->cond, &pool->mutex, pool->config.aging_us / 1000 + 1);
+        }
+        else if (_dthread_pool_autoscaling(pool) && pool->target > pool->config.min_workers)
+        {
+            // idle for a whole cooldown, the team is larger than it needs to be
+            if (dthread_cond_timedwait(&pool->cond, &pool->mutex, pool->config.idle_timeout) != 0 && !pool->stop &&
+                pool->target > pool->config.min_workers && !_dthread_pool_has_work(pool, worker, &later) && !later)
+            {
+                dthread_atomic_fetch_add_i64(&pool->target, -1);
+                _dthread_pool_retire(pool, worker);
+                exit = 1;
+            }
+        }
+        else
+            dthread_cond_wait(&pool->cond, &pool->mutex);
+
+        exit |= pool->stop;
+    }
+
+    dthread_atomic_fetch_add_i64(&pool->sleepers, -1);
+
+    _dthread_pool_sample(pool, 0);
+
+    _dthread_pool_unlock(pool);
+
+    return exit;
+}
+
+// parks the calling worker as a spare while more workers than the target are running, returns
+// non-zero when the worker has to exit, the pool is stopping or the spare retired after a cooldown
+static int _dthread_pool_park(_DThreadWorker* worker)
+{
+    DThreadPool* pool = worker->pool;
+    int exit;
+
+    _dthread_pool_lock(pool);
+
+    exit = pool->stop;
+    if (!exit && _dthread_pool_running(pool) > pool->target)
+    {
+        dthread_atomic_fetch_add_i64(&pool->spares, 1);
+
+        int timed_out = 0;
+        while (!pool->spare_tokens && !pool->stop && !timed_out)
+            timed_out = dthread_cond_timedwait(&pool->spare_cond, &pool->mutex, pool->config.idle_timeout) != 0;
+
+        // the waker has already taken us out of `spares` when it handed a token
+        if (pool->spare_tokens)
+            pool->spare_tokens--;
+        else
+        {
+            dthread_atomic_fetch_add_i64(&pool->spares, -1);
+
+            if (!pool->stop)
+            {
+                _dthread_pool_retire(pool, worker);
+                exit = 1;
+            }
+        }
+
+        exit |= pool->stop;
+    }
+
+    _dthread_pool_unlock(pool);
+
+    return exit;
+}
+
+static dthread_define_routine(_dthread_pool_worker_main)
+{
+    _DThreadWorker* worker = (_DThreadWorker*)data;
+    DThreadPool* pool = worker->pool;
+
+    _dthread_pool_self = worker;
+
+    if (worker->cpu >= 0)
+        dthread_topology_pin(&pool->topology, worker->cpu);
+    else if (pool->config.pin)
+        dthread_affinity_set(worker->index % dthread_cpu_count());
+
+    for (;;)
+    {
+        _DThreadTask* task = NULL;
+
+        // a compensating worker goes back to the spares once the blocked one has returned
+        if (_dthread_pool_running(pool) > dthread_atomic_load_i64(&pool->target) && _dthread_pool_park(worker))
+            break;
+
+        for (int spin = 0; !task && spin < _DTHREAD_POOL_SPINS; ++spin)
+        {
+            task = _dthread_pool_take(worker);
+            if (!task)
+                task = _dthread_pool_pop_inbox(worker, worker);
+            if (!task)
+                task = _dthread_pool_pop_queued(pool);
+            if (!task)
+                task = _dthread_pool_steal_any(worker);
+            if (!task)
+                _dthread_pool_relax();
+        }
+
+        if (task)
+        {
+            _dthread_pool_execute(worker, task);
+            continue;
+        }
+
+        if (_dthread_pool_sleep(worker))
+            break;
+    }
+
+    _dthread_pool_self = NULL;
+
+    return NULL;
+}
+
+// must be called with the pool mutex held, publishes the worker on success
+static int _dthread_pool_start_worker(DThreadPool* pool, int index)
+{
+    _DThreadWorker* worker = &pool->workers[index];
+
+    // a retired slot keeps its (empty) deque since thieves may still be looking at it
+    if (!worker->array)
+    {
+        worker->pool = pool;
+        worker->index = index;
+        worker->seed = 0x9E3779B97F4A7C15ull * (uint64_t)(index + 1);
+        worker->cpu = worker->l3 = worker->node = -1;
+
+        // consecutive slots fill an L3 (then a node) before moving on to the next one
+        if (pool->cpu_order)
+        {
+            worker->cpu = pool->cpu_order[index % pool->topology.num_cpus];
+            worker->l3 = pool->topology.cpus[worker->cpu].l3;
+            worker->node = pool->topology.cpus[worker->cpu].node;
+        }
+
+        worker->array = _dthread_pool_array_new(_DTHREAD_POOL_DEQUE_SIZE);
+        if (!worker->array)
+            return 1;
+    }
+
+    worker->thread = dthread_init_thread(_dthread_pool_worker_main, worker);
+    if (dthread_create(&worker->thread, NULL) != 0)
+        return 1;
+
+    if (index == pool->num_workers)
+        dthread_atomic_store_i64(&pool->num_workers, index + 1);
+
+    return 0;
+}
+
+// must be called with the pool mutex held, makes one more worker run: a parked spare, a
+// retired slot restarted or a brand new slot
+static int _dthread_pool_add_worker(DThreadPool* pool)
+{
+    if (dthread_atomic_load_i64(&pool->spares) > 0)
+    {
+        dthread_atomic_fetch_add_i64(&pool->spares, -1);
+        pool->spare_tokens++;
+        dthread_cond_signal(&pool->spare_cond);
+
+        return 0;
+    }
+
+    if (dthread_atomic_load_i64(&pool->retired) > 0)
+    {
+        for (int i = 0; i < pool->num_workers; ++i)
+        {
+            _DThreadWorker* worker = &pool->workers[i];
+            if (!worker->retired)
+                continue;
+
+            // the thread has left (or is leaving) its loop already, this only reaps it
+            if (worker->retired == _DTHREAD_POOL_RETIRED)
+            {
+                dthread_join(&worker->thread);
+                worker->retired = _DTHREAD_POOL_REAPED;
+            }
+
+            if (_dthread_pool_start_worker(pool, i) != 0)
+                return 1;
+
+            worker->retired = 0;
+            dthread_atomic_fetch_add_i64(&pool->retired, -1);
+
+            return 0;
+        }
+    }
+
+    if (pool->num_workers < pool->capacity)
+        return _dthread_pool_start_worker(pool, (int)pool->num_workers);
+
+    return 1;
+}
+
+// must be called with the pool mutex held, grows the team when tasks wait longer than the target
+static void _dthread_pool_scale_up(DThreadPool* pool, uint64_t now, uint64_t wait_ns)
+{
+    if (!_dthread_pool_autoscaling(pool) || pool->stop || pool->target >= pool->config.max_workers)
+        return;
+
+    uint64_t target_wait_ns = (uint64_t)pool->config.target_wait_us * 1000ull;
+
+    // idle workers will pick the backlog up, and give the last decision time to show its effect
+    if (wait_ns <= target_wait_ns || dthread_atomic_load_i64(&pool->sleepers) > 0 || now - pool->last_scale_ns < target_wait_ns)
+        return;
+
+    pool->last_scale_ns = now;
+
+    if (_dthread_pool_add_worker(pool) == 0)
+    {
+        dthread_atomic_fetch_add_i64(&pool->target, 1);
+        pool->num_grown++;
+    }
+}
+
+// stops and joins the started workers and releases everything the pool owns
+static void _dthread_pool_shutdown(DThreadPool* pool)
+{
+    _dthread_pool_lock(pool);
+    pool->stop = 1;
+    dthread_cond_broadcast(&pool->cond);
+    dthread_cond_broadcast(&pool->spare_cond);
+    _dthread_pool_unlock(pool);
+
+    // no worker can be started once `stop` is set, retired workers still need to be reaped
+    int64_t n = dthread_atomic_load_i64(&pool->num_workers);
+
+    for (int64_t i = 0; i < n; ++i)
+    {
+        if (pool->workers[i].retired != _DTHREAD_POOL_REAPED)
+            dthread_join(&pool->workers[i].thread);
+    }
+
+    // a slot may own a deque without a running worker if starting its thread failed
+    for (int i = 0; i < pool->capacity; ++i)
+    {
+        _DThreadWorker* worker = &pool->workers[i];
+        _DThreadDequeArray* array = worker->array;
+
+        while (array)
+        {
+            _DThreadDequeArray* retired = array->retired;
+            free(array);
+            array = retired;
+        }
+
+        _DThreadTask* task = worker->free_tasks;
+        while (task)
+        {
+            _DThreadTask* next = task->next;
+            free(task);
+            task = next;
+        }
+    }
+
+    free(pool->workers);
+
+    for (int level = 0; level < DTHREAD_TASK_PRIORITY_LEVELS; ++level)
+        free(pool->queues[level].tasks);
+
+    if (pool->cpu_order)
+    {
+        free(pool->cpu_order);
+        dthread_topology_destroy(&pool->topology);
+    }
+
+    dthread_cond_destroy(&pool->spare_cond);
+    dthread_cond_destroy(&pool->idle);
+    dthread_cond_destroy(&pool->cond);
+    dthread_mutex_destroy(&pool->mutex);
+
+    memset(pool, 0, sizeof(*pool));
+}
+
+static int _dthread_pool_cpu_before(DThreadTopologyCPU* a, DThreadTopologyCPU* b)
+{
+    if (a->node != b->node)
+        return a->node < b->node;
+    if (a->l3 != b->l3)
+        return a->l3 < b->l3;
+    if (a->core != b->core)
+        return a->core < b->core;
+
+    return a->smt < b->smt;
+}
+
+// indices of the topology CPUs sorted by node, L3 and core
+static int* _dthread_pool_cpu_order(DThreadTopology* topo)
+{
+    int* order = (int*)malloc((size_t)topo->num_cpus * sizeof(int));
+    if (!order)
+        return NULL;
+
+    for (int i = 0; i < topo->num_cpus; ++i)
+    {
+        int j = i;
+
+        for (; j > 0 && _dthread_pool_cpu_before(&topo->cpus[i], &topo->cpus[order[j - 1]]); --j)
+            order[j] = order[j - 1];
+
+        order[j] = i;
+    }
+
+    return order;
+}
+
+// rendezvous hashing, the key goes to the live worker with the highest weight so that only the
+// keys of a worker that starts or retires move
+static int _dthread_pool_place_key(DThreadPool* pool, uint64_t key)
+{
+    uint64_t best_weight = 0;
+    int best = -1;
+
+    for (int i = 0; i < (int)pool->num_workers; ++i)
+    {
+        if (pool->workers[i].retired)
+            continue;
+
+        uint64_t weight = (key ^ ((uint64_t)(i + 1) * 0x9E3779B97F4A7C15ull)) * 0xBF58476D1CE4E5B9ull;
+        weight ^= weight >> 31;
+        weight *= 0x94D049BB133111EBull;
+        weight ^= weight >> 29;
+
+        if (best < 0 || weight > best_weight)
+        {
+            best_weight = weight;
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+// must be called with the pool mutex held, the worker slot a placed task goes to or -1
+static int _dthread_pool_place(DThreadPool* pool, DThreadTaskAttr* attr)
+{
+    int n = (int)pool->num_workers;
+    int slot = -1;
+
+    if (!attr || n == 0)
+        return -1;
+
+    switch (attr->placement)
+    {
+        case DTHREAD_TASK_PLACE_KEY:
+            slot = _dthread_pool_place_key(pool, attr->place);
+            break;
+
+        case DTHREAD_TASK_PLACE_WORKER:
+            slot = (int)(attr->place % (uint64_t)n);
+            break;
+
+        case DTHREAD_TASK_PLACE_NODE:
+            for (int i = 0; i < n; ++i)
+            {
+                int candidate = (pool->next_place + i) % n;
+                _DThreadWorker* worker = &pool->workers[candidate];
+
+                if (worker->node == (int)attr->place && !worker->retired)
+                {
+                    pool->next_place = candidate + 1;
+                    slot = candidate;
+                    break;
+                }
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    if (slot < 0 || slot >= n || pool->workers[slot].retired)
+        return -1;
+
+    return slot;
+}
+
+// starts a spare worker (or hands a token to a parked one) for a worker that is about to block
+static void _dthread_pool_compensate(DThreadPool* pool)
+{
+    _dthread_pool_lock(pool);
+
+    // best effort, the blocked worker just continues if no thread can be started
+    if (!pool->stop && _dthread_pool_running(pool) < pool->target)
+        _dthread_pool_add_worker(pool);
+
+    _dthread_pool_unlock(pool);
+}
+
+int dthread_pool_init(DThreadPool* pool, DThreadPoolConfig* config)
+{
+    dthread_debug("dthread_pool_init");
+
+    assert(pool && "`pool` cannot be NULL in dthread_pool_init");
+
+    memset(pool, 0, sizeof(*pool));
+
+    DThreadPoolConfig cfg = config ? *config : (DThreadPoolConfig){0};
+
+    if (cfg.max_workers > 0)
+    {
+        if (cfg.min_workers <= 0)
+            cfg.min_workers = 1;
+        if (cfg.min_workers > cfg.max_workers)
+            cfg.min_workers = cfg.max_workers;
+        if (cfg.num_workers < cfg.min_workers)
+            cfg.num_workers = cfg.min_workers;
+        if (cfg.num_workers > cfg.max_workers)
+            cfg.num_workers = cfg.max_workers;
+    }
+    else
+    {
+        if (cfg.num_workers <= 0)
+            cfg.num_workers = dthread_cpu_count();
+
+        cfg.min_workers = cfg.max_workers = cfg.num_workers;
+    }
+
+    if (cfg.max_spare == 0)
+        cfg.max_spare = _DTHREAD_POOL_MAX_SPARE;
+    else if (cfg.max_spare < 0)
+        cfg.max_spare = 0;
+    if (cfg.target_wait_us == 0)
+        cfg.target_wait_us = _DTHREAD_POOL_TARGET_WAIT_US;
+    if (cfg.idle_timeout == 0)
+        cfg.idle_timeout = _DTHREAD_POOL_IDLE_TIMEOUT;
+    if (cfg.aging_us == 0)
+        cfg.aging_us = _DTHREAD_POOL_AGING_US;
+
+    pool->config = cfg;
+    pool->capacity = cfg.max_workers + cfg.max_spare;
+    pool->target = cfg.num_workers;
+
+    if (dthread_mutex_init(&pool->mutex, NULL) != 0)
+        return 1;
+
+    if (dthread_cond_init(&pool->cond, NULL) != 0 || dthread_cond_init(&pool->idle, NULL) != 0 ||
+        dthread_cond_init(&pool->spare_cond, NULL) != 0)
+        return 1;
+
+    pool->workers = (_DThreadWorker*)calloc((size_t)pool->capacity, sizeof(_DThreadWorker));
+    if (!pool->workers)
+        return 1;
+
+    // pinned workers know where they run, that is what locality aware stealing needs
+    if (cfg.pin && dthread_topology_init(&pool->topology) == 0)
+    {
+        pool->cpu_order = _dthread_pool_cpu_order(&pool->topology);
+        if (!pool->cpu_order)
+            dthread_topology_destroy(&pool->topology);
+    }
+
+    // a worker blocking right away must not start a spare in the middle of the team
+    _dthread_pool_lock(pool);
+
+    for (int i = 0; i < cfg.num_workers; ++i)
+    {
+        if (_dthread_pool_start_worker(pool, i) != 0)
+        {
+            _dthread_pool_unlock(pool);
+            _dthread_pool_shutdown(pool);
+            return 1;
+        }
+    }
+
+    _dthread_pool_unlock(pool);
+
+    return 0;
+}
+
+int dthread_pool_submit(DThreadPool* pool, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_pool_submit");
+
+    return dthread_pool_submit_attr(pool, func, data, NULL);
+}
+
+int dthread_pool_submit_attr(DThreadPool* pool, DThreadRoutine func, void* data, DThreadTaskAttr* attr)
+{
+    dthread_debug("dthread_pool_submit_attr");
+
+    assert(pool && func && "`pool` and `func` cannot be NULL in dthread_pool_submit_attr");
+
+    int priority = attr ? attr->priority : DTHREAD_TASK_PRIORITY_NORMAL;
+    if (priority < 0)
+        priority = 0;
+    if (priority >= DTHREAD_TASK_PRIORITY_LEVELS)
+        priority = DTHREAD_TASK_PRIORITY_LEVELS - 1;
+
+    _DThreadWorker* self = _dthread_pool_self;
+    _DThreadTask* task = _dthread_pool_alloc_task(self && self->pool == pool ? self : NULL);
+    if (!task)
+        return 1;
+
+    task->func = func;
+    task->data = data;
+    task->frame = NULL;
+    task->next = NULL;
+    task->enqueued_ns = dthread_now_ns();
+    task->deadline_ns = (attr && attr->deadline_us) ? task->enqueued_ns + (uint64_t)attr->deadline_us * 1000ull : 0;
+    task->key_ns = task->deadline_ns ? task->deadline_ns : task->enqueued_ns;
+
+    dthread_atomic_fetch_add_i64(&pool->pending, 1);
+
+    _dthread_pool_lock(pool);
+
+    task->seq = pool->next_seq++;
+
+    int slot = _dthread_pool_place(pool, attr);
+    if (slot >= 0)
+    {
+        _DThreadWorker* owner = &pool->workers[slot];
+
+        if (owner->inbox_tail)
+            owner->inbox_tail->next = task;
+        else
+            owner->inbox_head = task;
+        owner->inbox_tail = task;
+
+        dthread_atomic_fetch_add_i64(&owner->inbox_count, 1);
+
+        // the condition is shared, only a broadcast is sure to reach the owner
+        if (dthread_atomic_load_i64(&pool->sleepers) > 0)
+            dthread_cond_broadcast(&pool->cond);
+
+        _dthread_pool_unlock(pool);
+
+        return 0;
+    }
+
+    if (_dthread_pool_heap_push(&pool->queues[priority], task) != 0)
+    {
+        _dthread_pool_unlock(pool);
+
+        dthread_atomic_fetch_add_i64(&pool->pending, -1);
+        free(task);
+
+        return 1;
+    }
+
+    dthread_atomic_fetch_add_i64(&pool->queued, 1);
+
+    // every worker may be stuck in long tasks, then nothing is dequeued to notice the backlog
+    _dthread_pool_scale_up(pool, task->enqueued_ns, task->enqueued_ns - _dthread_pool_oldest_ns(pool, task->enqueued_ns));
+
+    if (dthread_atomic_load_i64(&pool->sleepers) > 0)
+        dthread_cond_signal(&pool->cond);
+
+    _dthread_pool_unlock(pool);
+
+    return 0;
+}
+
+int dthread_pool_wait(DThreadPool* pool)
+{
+    dthread_debug("dthread_pool_wait");
+
+    assert(pool && "`pool` cannot be NULL in dthread_pool_wait");
+
+    _dthread_pool_lock(pool);
+
+    while (dthread_atomic_load_i64(&pool->pending) > 0)
+        dthread_cond_wait(&pool->idle, &pool->mutex);
+
+    _dthread_pool_unlock(pool);
+
+    return 0;
+}
+
+typedef struct
+{
+    DThreadRoutine func;
+    void* data;
+    void* result;
+    int done;
+    DThreadMutex mutex;
+    DThreadCond cond;
+} _DThreadPoolRun;
+
+static dthread_define_routine(_dthread_pool_run_trampoline)
+{
+    _DThreadPoolRun* run = (_DThreadPoolRun*)data;
+
+    void* result = run->func(run->data);
+
+    dthread_mutex_lock(&run->mutex);
+    run->result = result;
+    run->done = 1;
+    dthread_cond_signal(&run->cond);
+    dthread_mutex_unlock(&run->mutex);
+
+    return NULL;
+}
+
+void* dthread_pool_run(DThreadPool* pool, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_pool_run");
+
+    assert(pool && func && "`pool` and `func` cannot be NULL in dthread_pool_run");
+
+    // already on a worker of this pool, waiting here would only take a worker away
+    if (_dthread_pool_self && _dthread_pool_self->pool == pool)
+        return func(data);
+
+    _DThreadPoolRun run = {.func = func, .data = data};
+
+    if (dthread_mutex_init(&run.mutex, NULL) != 0)
+        return NULL;
+
+    if (dthread_cond_init(&run.cond, NULL) != 0)
+    {
+        dthread_mutex_destroy(&run.mutex);
+        return NULL;
+    }
+
+    if (dthread_pool_submit(pool, _dthread_pool_run_trampoline, &run) != 0)
+        run.result = func(data);
+    else
+    {
+        dthread_mutex_lock(&run.mutex);
+        while (!run.done)
+            dthread_cond_wait(&run.cond, &run.mutex);
+        dthread_mutex_unlock(&run.mutex);
+    }
+
+    dthread_cond_destroy(&run.cond);
+    dthread_mutex_destroy(&run.mutex);
+
+    return run.result;
+}
+
+void dthread_pool_destroy(DThreadPool* pool)
+{
+    dthread_debug("dthread_pool_destroy");
+
+    if (!pool->workers)
+        return;
+
+    dthread_pool_wait(pool);
+
+    _dthread_pool_shutdown(pool);
+}
+
+int dthread_pool_stats(DThreadPool* pool, DThreadPoolStats* stats)
+{
+    dthread_debug("dthread_pool_stats");
+
+    assert(pool && stats && "`pool` and `stats` cannot be NULL in dthread_pool_stats");
+
+    _dthread_pool_lock(pool);
+
+    stats->workers = (int)(pool->num_workers - pool->retired);
+    stats->running = (int)_dthread_pool_running(pool);
+    stats->idle = (int)dthread_atomic_load_i64(&pool->sleepers);
+    stats->blocked = (int)dthread_atomic_load_i64(&pool->blocked);
+    stats->spares = (int)pool->spares;
+    stats->target = (int)pool->target;
+    stats->queued = (size_t)pool->queued;
+    for (int64_t i = 0; i < pool->num_workers; ++i)
+        stats->queued += (size_t)pool->workers[i].inbox_count;
+
+    stats->completed = (uint64_t)dthread_atomic_load_i64(&pool->completed);
+    stats->avg_wait_ns = (uint64_t)pool->avg_wait_ns;
+    stats->utilization = (double)pool->utilization / 1000.0;
+    stats->deadline_misses = pool->deadline_misses;
+    stats->placed = pool->num_placed;
+    stats->migrated = pool->num_migrated;
+    stats->grown = pool->num_grown;
+    stats->retired = pool->num_retired;
+
+    _dthread_pool_unlock(pool);
+
+    return 0;
+}
+
+int dthread_pool_worker(void)
+{
+    dthread_debug("dthread_pool_worker");
+
+    return _dthread_pool_self ? _dthread_pool_self->index : -1;
+}
+
+int dthread_fj_spawn(DThreadFJ* fj, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_fj_spawn");
+
+    assert(fj && func && "`fj` and `func` cannot be NULL in dthread_fj_spawn");
+
+    _DThreadWorker* worker = _dthread_pool_self;
+
+    if (worker)
+    {
+        _DThreadTask* task = _dthread_pool_alloc_task(worker);
+
+        if (task)
+        {
+            task->func = func;
+            task->data = data;
+            task->frame = fj;
+            task->next = NULL;
+
+            dthread_atomic_fetch_add_i64(&fj->pending, 1);
+
+            if (_dthread_pool_push(worker, task) == 0)
+            {
+                _dthread_pool_wake(worker->pool);
+                return 0;
+            }
+
+            dthread_atomic_fetch_add_i64(&fj->pending, -1);
+            _dthread_pool_free_task(worker, task);
+        }
+    }
+
+    // serial elision, outside of a pool (or out of memory) the child runs right away
+    func(data);
+
+    return 0;
+}
+
+void dthread_fj_sync(DThreadFJ* fj)
+{
+    dthread_debug("dthread_fj_sync");
+
+    assert(fj && "`fj` cannot be NULL in dthread_fj_sync");
+
+    _DThreadWorker* worker = _dthread_pool_self;
+
+    while (dthread_atomic_load_i64(&fj->pending) > 0)
+    {
+        // our own children are at the bottom of our deque unless they have been stolen
+        _DThreadTask* task = _dthread_pool_take(worker);
+        if (!task)
+            task = _dthread_pool_steal_any(worker);
+
+        if (task)
+            _dthread_pool_execute(worker, task);
+        else
+            _dthread_pool_relax();
+    }
+}
+
+int dthread_blocking_begin(void)
+{
+    dthread_debug("dthread_blocking_begin");
+
+    _DThreadWorker* worker = _dthread_pool_self;
+
+    // only the outermost region of a worker counts
+    if (!worker || worker->blocking++ > 0)
+        return 0;
+
+    DThreadPool* pool = worker->pool;
+
+    dthread_atomic_fetch_add_i64(&pool->blocked, 1);
+
+    if (_dthread_pool_running(pool) < dthread_atomic_load_i64(&pool->target))
+        _dthread_pool_compensate(pool);
+
+    return 0;
+}
+
+int dthread_blocking_end(void)
+{
+    dthread_debug("dthread_blocking_end");
+
+    _DThreadWorker* worker = _dthread_pool_self;
+
+    if (!worker || --worker->blocking > 0)
+        return 0;
+
+    // the extra worker parks itself on its own once it notices the surplus
+    dthread_atomic_fetch_add_i64(&worker->pool->blocked, -1);
+
+    return 0;
+}
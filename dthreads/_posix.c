@@ -16,48 +16,185 @@
 #include "_headers/common.h"
 #include "dthread.h"
 
-int dthread_create(DThread* thread, DThreadAttr* attr)
+typedef struct
 {
-    dthread_debug("dthread_create");
+    DThreadRoutine func;
+    void* data;
+    size_t prefault;
+    int lock_memory;
+} _DThreadProfile;
+
+// touches every page of a stack region right below the caller's frame so that the
+// thread routine never takes a page fault on first touch of that much stack
+static __attribute__((noinline)) void _dthread_prefault_stack(size_t size, int lock_memory, uintptr_t* region_out)
+{
+    volatile char region[size];
 
-    assert(thread && "`thread` cannot be NULL in dthread_create");
+    for (size_t i = 0; i < size; i += 4096)
+        region[i] = 0;
+    region[size - 1] = 0;
 
-    pthread_attr_t p_attr;
+    if (lock_memory)
+        mlock((const void*)region, size);
 
-    if (attr)
+    *region_out = (uintptr_t)region;
+}
+
+static dthread_define_routine(_dthread_profile_trampoline)
+{
+    _DThreadProfile profile = *(_DThreadProfile*)data;
+    free(data);
+
+    uintptr_t region = 0;
+    if (profile.prefault)
+        _dthread_prefault_stack(profile.prefault, profile.lock_memory, &region);
+
+    void* result = profile.func(profile.data);
+
+    if (region && profile.lock_memory)
+        munlock((const void*)region, profile.prefault);
+
+    return result;
+}
+
+int dthread_attr_prepare(DThreadPreparedAttr* prepared, DThreadAttr* attr)
+{
+    dthread_debug("dthread_attr_prepare");
+
+    assert(prepared && "`prepared` cannot be NULL in dthread_attr_prepare");
+
+    prepared->initialized = 0;
+    prepared->prefault = 0;
+    prepared->lock_memory = 0;
+
+    if (!attr)
+        return 0;
+
+    if (pthread_attr_init(&prepared->handle))
+        return 1;
+
+    if (attr->detachstate)
+        pthread_attr_setdetachstate(&prepared->handle, attr->detachstate);
+
+    if (attr->guardsize)
+        pthread_attr_setguardsize(&prepared->handle, attr->guardsize);
+
+    if (attr->inheritsched)
+        pthread_attr_setinheritsched(&prepared->handle, attr->inheritsched);
+
+    if (attr->schedpolicy)
+        pthread_attr_setschedpolicy(&prepared->handle, attr->schedpolicy);
+
+    if (attr->scope)
+        pthread_attr_setscope(&prepared->handle, attr->scope);
+
+    if (attr->stack)
+        pthread_attr_setstack(&prepared->handle, attr->stackaddr, attr->stack);
+
+    if (attr->stacksize)
+        pthread_attr_setstacksize(&prepared->handle, attr->stacksize);
+
+    if (attr->priority)
+    {
+        struct sched_param param;
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = attr->priority;
+
+        pthread_attr_setschedparam(&prepared->handle, &param);
+
+        // a priority is meaningless when inherited from the creating thread
+        if (!attr->inheritsched)
+            pthread_attr_setinheritsched(&prepared->handle, PTHREAD_EXPLICIT_SCHED);
+    }
+
+    // the pre-faulted region lives on the new stack (the default one without `stacksize`), the
+    // routine needs room on top of it
+    if (attr->prefault)
     {
-        if (pthread_attr_init(&p_attr))
+        size_t stacksize = 0;
+        pthread_attr_getstacksize(&prepared->handle, &stacksize);
+
+        if (stacksize && (stacksize <= DTHREAD_PREFAULT_MARGIN || attr->prefault > stacksize - DTHREAD_PREFAULT_MARGIN))
+        {
+            pthread_attr_destroy(&prepared->handle);
             return 1;
+        }
+    }
 
-        if (attr->detachstate)
-            pthread_attr_setdetachstate(&p_attr, attr->detachstate);
+    prepared->prefault = attr->prefault;
+    prepared->lock_memory = attr->lock_memory;
+    prepared->initialized = 1;
+
+    return 0;
+}
 
-        if (attr->guardsize)
-            pthread_attr_setguardsize(&p_attr, attr->guardsize);
+int dthread_attr_release(DThreadPreparedAttr* prepared)
+{
+    dthread_debug("dthread_attr_release");
 
-        if (attr->inheritsched)
-            pthread_attr_setinheritsched(&p_attr, attr->inheritsched);
+    if (!prepared->initialized)
+        return 0;
 
-        if (attr->schedpolicy)
-            pthread_attr_setschedpolicy(&p_attr, attr->schedpolicy);
+    prepared->initialized = 0;
 
-        if (attr->scope)
-            pthread_attr_setscope(&p_attr, attr->scope);
+    return pthread_attr_destroy(&prepared->handle);
+}
 
-        if (attr->stack)
-            pthread_attr_setstack(&p_attr, attr->stackaddr, attr->stack);
+int dthread_create_prepared(DThread* thread, DThreadPreparedAttr* prepared)
+{
+    dthread_debug("dthread_create_prepared");
 
-        if (attr->stacksize)
-            pthread_attr_setstacksize(&p_attr, attr->stacksize);
-    }
+    assert(thread && "`thread` cannot be NULL in dthread_create_prepared");
 
-    return pthread_create(&thread->handle, attr ? &p_attr : NULL, thread->_func, thread->_data);
+    // a plain thread, `dthread_set_func` style setups never touch the spawn slot
+    thread->_slot = NULL;
+
+    pthread_attr_t* p_attr = (prepared && prepared->initialized) ? &prepared->handle : NULL;
+
+    if (!prepared || !prepared->prefault)
+        return pthread_create(&thread->handle, p_attr, thread->_func, thread->_data);
+
+    _DThreadProfile* profile = (_DThreadProfile*)malloc(sizeof(_DThreadProfile));
+    if (!profile)
+        return 1;
+
+    profile->func = thread->_func;
+    profile->data = thread->_data;
+    profile->prefault = prepared->prefault;
+    profile->lock_memory = prepared->lock_memory;
+
+    int result = pthread_create(&thread->handle, p_attr, _dthread_profile_trampoline, profile);
+    if (result != 0)
+        free(profile);
+
+    return result;
+}
+
+int dthread_create(DThread* thread, DThreadAttr* attr)
+{
+    dthread_debug("dthread_create");
+
+    assert(thread && "`thread` cannot be NULL in dthread_create");
+
+    DThreadPreparedAttr prepared;
+
+    if (dthread_attr_prepare(&prepared, attr))
+        return 1;
+
+    int result = dthread_create_prepared(thread, &prepared);
+
+    dthread_attr_release(&prepared);
+
+    return result;
 }
 
 int dthread_detach(DThread* thread)
 {
     dthread_debug("dthread_detach");
 
+    if (thread->_slot)
+        return _dthread_spawn_detach(thread);
+
     return pthread_detach(thread->handle);
 }
 
@@ -65,9 +202,161 @@ int dthread_join(DThread* thread)
 {
     dthread_debug("dthread_join");
 
-    void* code = (void**)&thread->_result;
+    int result;
+
+    dthread_blocking_begin();
+
+    if (thread->_slot)
+        result = _dthread_spawn_join(thread);
+    else
+        result = pthread_join(thread->handle, (void**)&thread->_result);
+
+    dthread_blocking_end();
+
+    return result;
+}
+
+// threads of `dthread_create_many` wait here until the whole group exists, a failed group
+// is released without running any routine
+typedef struct
+{
+    DThreadMutex mutex;
+    DThreadCond cond;
+    size_t arrived;
+    size_t left;
+    int state;
+} _DThreadStartGate;
+
+typedef struct
+{
+    _DThreadStartGate* gate;
+    DThreadRoutine func;
+    void* data;
+} _DThreadGated;
+
+static dthread_define_routine(_dthread_gated_trampoline)
+{
+    _DThreadGated gated = *(_DThreadGated*)data;
+    _DThreadStartGate* gate = gated.gate;
+
+    dthread_mutex_lock(&gate->mutex);
+
+    gate->arrived++;
+    dthread_cond_broadcast(&gate->cond);
+
+    while (gate->state == 0)
+        dthread_cond_wait(&gate->cond, &gate->mutex);
+
+    int run = gate->state > 0;
+
+    gate->left++;
+    dthread_cond_broadcast(&gate->cond);
+
+    dthread_mutex_unlock(&gate->mutex);
+
+    return run ? gated.func(gated.data) : NULL;
+}
+
+int dthread_create_many(DThread* threads, size_t n, DThreadAttr* attr)
+{
+    dthread_debug("dthread_create_many");
+
+    assert((threads || n == 0) && "`threads` cannot be NULL in dthread_create_many");
 
-    return pthread_join(thread->handle, code);
+    if (n == 0)
+        return 0;
+
+    DThreadPreparedAttr prepared;
+
+    if (dthread_attr_prepare(&prepared, attr))
+        return 1;
+
+    _DThreadStartGate gate;
+    _DThreadGated* gated = (_DThreadGated*)malloc(n * sizeof(_DThreadGated));
+
+    if (!gated || dthread_mutex_init(&gate.mutex, NULL) != 0)
+    {
+        free(gated);
+        dthread_attr_release(&prepared);
+        return 1;
+    }
+
+    if (dthread_cond_init(&gate.cond, NULL) != 0)
+    {
+        dthread_mutex_destroy(&gate.mutex);
+        free(gated);
+        dthread_attr_release(&prepared);
+        return 1;
+    }
+
+    gate.arrived = gate.left = 0;
+    gate.state = 0;
+
+    size_t i = 0;
+    for (; i < n; ++i)
+    {
+        gated[i].gate = &gate;
+        gated[i].func = threads[i]._func;
+        gated[i].data = threads[i]._data;
+
+        threads[i]._func = _dthread_gated_trampoline;
+        threads[i]._data = &gated[i];
+
+        if (dthread_create_prepared(&threads[i], &prepared) != 0)
+        {
+            threads[i]._func = gated[i].func;
+            threads[i]._data = gated[i].data;
+            break;
+        }
+    }
+
+    dthread_attr_release(&prepared);
+
+    dthread_mutex_lock(&gate.mutex);
+
+    // once arrived a thread no longer reads its `DThread`, the routine can be put back
+    while (gate.arrived < i)
+        dthread_cond_wait(&gate.cond, &gate.mutex);
+
+    for (size_t j = 0; j < i; ++j)
+    {
+        threads[j]._func = gated[j].func;
+        threads[j]._data = gated[j].data;
+    }
+
+    gate.state = i == n ? 1 : -1;
+    dthread_cond_broadcast(&gate.cond);
+
+    while (gate.left < i)
+        dthread_cond_wait(&gate.cond, &gate.mutex);
+
+    dthread_mutex_unlock(&gate.mutex);
+
+    dthread_cond_destroy(&gate.cond);
+    dthread_mutex_destroy(&gate.mutex);
+    free(gated);
+
+    if (i == n)
+        return 0;
+
+    dthread_join_all(threads, i);
+
+    return 1;
+}
+
+int dthread_join_all(DThread* threads, size_t n)
+{
+    dthread_debug("dthread_join_all");
+
+    int result = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (dthread_join(&threads[i]) != 0)
+            result = 1;
+    }
+
+    return result;
 }
 
 int dthread_equal(DThread* thread1, DThread* thread2)
@@ -102,9 +391,44 @@ int dthread_cancel(DThread* thread)
 {
     dthread_debug("dthread_cancel");
 
+    // cached threads outlive their routines, they cannot be cancelled
+    if (thread->_slot)
+        return 1;
+
     return pthread_cancel(thread->handle);
 }
 
+int dthread_cpu_count(void)
+{
+    dthread_debug("dthread_cpu_count");
+
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (int)count : 1;
+}
+
+int dthread_affinity_set(int cpu)
+{
+    dthread_debug("dthread_affinity_set");
+
+#ifdef __linux__
+    // 👉 NOTE: raw syscall keeps us away from `_GNU_SOURCE` only `cpu_set_t` macros
+    unsigned long mask[1024 / (8 * sizeof(unsigned long))] = {0};
+    size_t bits = 8 * sizeof(unsigned long);
+
+    if (cpu < 0 || (size_t)cpu >= bits * (sizeof(mask) / sizeof(mask[0])))
+        return 1;
+
+    mask[cpu / bits] |= 1UL << (cpu % bits);
+
+    return syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) != 0;
+#else
+    (void)cpu;
+
+    return 1;
+#endif
+}
+
 int dthread_mutex_init(DThreadMutex* mutex, DThreadMutexAttr* attr)
 {
     dthread_debug("dthread_mutex_init");
@@ -121,7 +445,7 @@ int dthread_mutex_init(DThreadMutex* mutex, DThreadMutexAttr* attr)
         if (attr->type)
             pthread_mutexattr_settype(&p_attr, attr->type);
 
-#if DTHREAD_MUTEX_ROBUST_AND_COND_CLOCK_AVAILABLE
+#ifdef DTHREAD_MUTEX_ROBUST_AND_COND_CLOCK_AVAILABLE
         if (attr->robust)
             pthread_mutexattr_setrobust(&p_attr, attr->robust);
 #endif
@@ -140,7 +464,16 @@ int dthread_mutex_lock(DThreadMutex* mutex)
 {
     dthread_debug("dthread_mutex_lock");
 
-    return pthread_mutex_lock(&mutex->handle);
+    // only a contended lock is worth compensating for
+    int result = pthread_mutex_trylock(&mutex->handle);
+    if (result != EBUSY)
+        return result;
+
+    dthread_blocking_begin();
+    result = pthread_mutex_lock(&mutex->handle);
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_mutex_trylock(DThreadMutex* mutex)
@@ -170,21 +503,36 @@ int dthread_cond_init(DThreadCond* cond, DThreadCondAttr* attr)
 
     pthread_condattr_t p_attr;
 
+    if (pthread_condattr_init(&p_attr) != 0)
+        return 1;
+
+    // timed waits are relative, a monotonic deadline does not move with the wall clock
+#ifdef __APPLE__
+    cond->clock = CLOCK_REALTIME;
+#else
+    cond->clock = CLOCK_MONOTONIC;
+#endif
+
     if (attr)
     {
-        if (pthread_condattr_init(&p_attr) != 0)
-            return 1;
-
         if (attr->pshared)
             pthread_condattr_setpshared(&p_attr, attr->pshared);
 
-#if DTHREAD_MUTEX_ROBUST_AND_COND_CLOCK_AVAILABLE
+#ifdef DTHREAD_MUTEX_ROBUST_AND_COND_CLOCK_AVAILABLE
         if (attr->clock)
-            pthread_condattr_setclock(&p_attr, attr->clock);
+            cond->clock = attr->clock;
 #endif
     }
 
-    return pthread_cond_init(&cond->handle, attr ? &p_attr : NULL);
+#ifndef __APPLE__
+    pthread_condattr_setclock(&p_attr, cond->clock);
+#endif
+
+    int result = pthread_cond_init(&cond->handle, &p_attr);
+
+    pthread_condattr_destroy(&p_attr);
+
+    return result;
 }
 
 int dthread_cond_signal(DThreadCond* cond)
@@ -212,7 +560,33 @@ int dthread_cond_wait(DThreadCond* cond, DThreadMutex* mutex)
 {
     dthread_debug("dthread_cond_wait");
 
-    return pthread_cond_wait(&cond->handle, &mutex->handle);
+    dthread_blocking_begin();
+    int result = pthread_cond_wait(&cond->handle, &mutex->handle);
+    dthread_blocking_end();
+
+    return result;
+}
+
+int dthread_cond_timedwait(DThreadCond* cond, DThreadMutex* mutex, uint32_t milliseconds)
+{
+    dthread_debug("dthread_cond_timedwait");
+
+    struct timespec ts;
+    clock_gettime(cond->clock, &ts);
+
+    ts.tv_sec += milliseconds / 1000;
+    ts.tv_nsec += (long)(milliseconds % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L)
+    {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+
+    dthread_blocking_begin();
+    int result = pthread_cond_timedwait(&cond->handle, &mutex->handle, &ts);
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_rwlock_init(DThreadRWLock* rwlock)
@@ -226,7 +600,15 @@ int dthread_rwlock_rdlock(DThreadRWLock* rwlock)
 {
     dthread_debug("dthread_rwlock_rdlock");
 
-    return pthread_rwlock_rdlock(&rwlock->handle);
+    int result = pthread_rwlock_tryrdlock(&rwlock->handle);
+    if (result != EBUSY)
+        return result;
+
+    dthread_blocking_begin();
+    result = pthread_rwlock_rdlock(&rwlock->handle);
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_rwlock_unlock(DThreadRWLock* rwlock)
@@ -240,7 +622,15 @@ int dthread_rwlock_wrlock(DThreadRWLock* rwlock)
 {
     dthread_debug("dthread_rwlock_wrlock");
 
-    return pthread_rwlock_wrlock(&rwlock->handle);
+    int result = pthread_rwlock_trywrlock(&rwlock->handle);
+    if (result != EBUSY)
+        return result;
+
+    dthread_blocking_begin();
+    result = pthread_rwlock_wrlock(&rwlock->handle);
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_rwlock_destroy(DThreadRWLock* rwlock)
@@ -283,6 +673,8 @@ void dthread_barrier_wait(DThreadBarrier* barrier)
 {
     dthread_debug("dthread_barrier_wait");
 
+    dthread_blocking_begin();
+
 #ifdef __APPLE__
     pthread_mutex_lock(&barrier->mutex);
     barrier->num_threads++;
@@ -301,6 +693,8 @@ void dthread_barrier_wait(DThreadBarrier* barrier)
 #else
     pthread_barrier_wait(&barrier->handle);
 #endif
+
+    dthread_blocking_end();
 }
 
 void dthread_barrier_destroy(DThreadBarrier* barrier)
@@ -333,11 +727,17 @@ int dthread_semaphore_wait(DThreadSemaphore* semaphore)
 {
     dthread_debug("dthread_semaphore_wait");
 
+    dthread_blocking_begin();
+
 #ifdef __APPLE__
-    return sem_wait(semaphore->handle);
+    int result = sem_wait(semaphore->handle);
 #else
-    return sem_wait(&semaphore->handle);
+    int result = sem_wait(&semaphore->handle);
 #endif
+
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_semaphore_post(DThreadSemaphore* semaphore)
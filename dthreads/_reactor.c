@@ -0,0 +1,517 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _reactor.c
+//    Date: 2024-09-09
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#ifdef DTHREAD_REACTOR_AVAILABLE
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#define _DTHREAD_REACTOR_MAX_EVENTS 256
+#define _DTHREAD_REACTOR_BATCH_SIZE 16
+
+// the handle whose callback runs on this thread
+static DTHREAD_THREAD_LOCAL DThreadReactorHandle* _dthread_reactor_current = NULL;
+
+typedef struct _DThreadReactorBatch
+{
+    int count;
+    DThreadReactorHandle** handles;
+} _DThreadReactorBatch;
+
+static void _dthread_reactor_release(DThreadReactorHandle* handle)
+{
+    if (dthread_atomic_fetch_add_i64(&handle->refs, -1) == 1)
+        free(handle);
+}
+
+static uint32_t _dthread_reactor_events(uint32_t epoll_events)
+{
+    uint32_t events = 0;
+
+    if (epoll_events & (EPOLLIN | EPOLLPRI))
+        events |= DTHREAD_REACTOR_READ;
+    if (epoll_events & EPOLLOUT)
+        events |= DTHREAD_REACTOR_WRITE;
+    if (epoll_events & EPOLLERR)
+        events |= DTHREAD_REACTOR_ERROR;
+    if (epoll_events & (EPOLLHUP | EPOLLRDHUP))
+        events |= DTHREAD_REACTOR_HANGUP;
+
+    return events;
+}
+
+// records the events, returns non-zero when the handle has to be dispatched
+static int _dthread_reactor_schedule(DThreadReactorHandle* handle, uint32_t events)
+{
+    int32_t pending = dthread_atomic_load_i32(&handle->pending);
+
+    while (!dthread_atomic_cas_i32(&handle->pending, &pending, pending | (int32_t)events))
+        ;
+
+    // already scheduled or running, that run picks the new events up
+    if (dthread_atomic_exchange_i32(&handle->scheduled, 1) != 0)
+        return 0;
+
+    dthread_atomic_fetch_add_i64(&handle->refs, 1);
+
+    return 1;
+}
+
+static void _dthread_reactor_run(DThreadReactorHandle* handle)
+{
+    for (;;)
+    {
+        uint32_t events = (uint32_t)dthread_atomic_exchange_i32(&handle->pending, 0);
+
+        if (events)
+        {
+            // pairs with the fence in `dthread_reactor_remove`, either it waits for this run or the
+            // run sees the removal
+            dthread_atomic_fetch_add_i32(&handle->running, 1);
+            dthread_atomic_fence();
+
+            if (!dthread_atomic_load_i32(&handle->removed))
+            {
+                _dthread_reactor_current = handle;
+                handle->callback(handle->fd, events, handle->data);
+                _dthread_reactor_current = NULL;
+            }
+
+            dthread_atomic_fetch_add_i32(&handle->running, -1);
+        }
+
+        dthread_atomic_exchange_i32(&handle->scheduled, 0);
+
+        // events recorded while the callback ran found it scheduled, run again unless the loop
+        // already dispatched them after the flag was cleared
+        if (dthread_atomic_load_i32(&handle->pending) == 0 || dthread_atomic_exchange_i32(&handle->scheduled, 1) != 0)
+            break;
+    }
+
+    _dthread_reactor_release(handle);
+}
+
+static dthread_define_routine(_dthread_reactor_run_batch)
+{
+    _DThreadReactorBatch* batch = (_DThreadReactorBatch*)data;
+
+    for (int i = 0; i < batch->count; ++i)
+        _dthread_reactor_run(batch->handles[i]);
+
+    free(batch);
+
+    return NULL;
+}
+
+static void _dthread_reactor_dispatch(DThreadReactor* reactor, DThreadReactorHandle** ready, int count)
+{
+    DThreadPool* pool = reactor->config.pool;
+
+    if (!pool)
+    {
+        for (int i = 0; i < count; ++i)
+            _dthread_reactor_run(ready[i]);
+
+        return;
+    }
+
+    for (int first = 0; first < count; first += reactor->config.batch_size)
+    {
+        int n = count - first < reactor->config.batch_size ? count - first : reactor->config.batch_size;
+
+        // one allocation for the batch and its handles
+        _DThreadReactorBatch* batch =
+            (_DThreadReactorBatch*)malloc(sizeof(_DThreadReactorBatch) + (size_t)n * sizeof(DThreadReactorHandle*));
+
+        if (batch)
+        {
+            batch->count = n;
+            batch->handles = (DThreadReactorHandle**)(batch + 1);
+            memcpy(batch->handles, ready + first, (size_t)n * sizeof(DThreadReactorHandle*));
+
+            if (dthread_pool_submit(pool, _dthread_reactor_run_batch, batch) == 0)
+            {
+                dthread_atomic_fetch_add_i64(&reactor->batches, 1);
+                continue;
+            }
+
+            free(batch);
+        }
+
+        // the pool is out of memory, do not drop the events
+        for (int i = first; i < first + n; ++i)
+            _dthread_reactor_run(ready[i]);
+    }
+}
+
+static int _dthread_reactor_post_to(_DThreadReactorLoop* loop, DThreadRoutine func, void* data)
+{
+    _DThreadReactorPost* post = (_DThreadReactorPost*)malloc(sizeof(_DThreadReactorPost));
+    if (!post)
+        return 1;
+
+    post->func = func;
+    post->data = data;
+    post->next = NULL;
+
+    dthread_mutex_lock(&loop->mutex);
+
+    if (loop->tail)
+        loop->tail->next = post;
+    else
+        loop->head = post;
+    loop->tail = post;
+
+    dthread_mutex_unlock(&loop->mutex);
+
+    uint64_t one = 1;
+    return write(loop->wake_fd, &one, sizeof(one)) == sizeof(one) ? 0 : 1;
+}
+
+static void _dthread_reactor_run_posts(_DThreadReactorLoop* loop)
+{
+    dthread_mutex_lock(&loop->mutex);
+
+    _DThreadReactorPost* post = loop->head;
+    loop->head = loop->tail = NULL;
+
+    dthread_mutex_unlock(&loop->mutex);
+
+    while (post)
+    {
+        _DThreadReactorPost* next = post->next;
+
+        post->func(post->data);
+        free(post);
+
+        post = next;
+    }
+}
+
+static dthread_define_routine(_dthread_reactor_release_routine)
+{
+    _dthread_reactor_release((DThreadReactorHandle*)data);
+
+    return NULL;
+}
+
+static dthread_define_routine(_dthread_reactor_loop_main)
+{
+    _DThreadReactorLoop* loop = (_DThreadReactorLoop*)data;
+    DThreadReactor* reactor = loop->reactor;
+    int max_events = reactor->config.max_events;
+
+    struct epoll_event* events = (struct epoll_event*)malloc((size_t)max_events * sizeof(struct epoll_event));
+    DThreadReactorHandle** ready = (DThreadReactorHandle**)malloc((size_t)max_events * sizeof(DThreadReactorHandle*));
+
+    if (!events || !ready)
+    {
+        free(events);
+        free(ready);
+        return (void*)1;
+    }
+
+    for (;;)
+    {
+        int n = epoll_wait(loop->epoll_fd, events, max_events, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        int num_ready = 0;
+        int woken = 0;
+
+        for (int i = 0; i < n; ++i)
+        {
+            DThreadReactorHandle* handle = (DThreadReactorHandle*)events[i].data.ptr;
+
+            // the eventfd is registered without a handle
+            if (!handle)
+            {
+                woken = 1;
+                continue;
+            }
+
+            if (_dthread_reactor_schedule(handle, _dthread_reactor_events(events[i].events)))
+                ready[num_ready++] = handle;
+        }
+
+        dthread_atomic_fetch_add_i64(&reactor->events, n - woken);
+        _dthread_reactor_dispatch(reactor, ready, num_ready);
+
+        // handles removed meanwhile are released only now, after this round's events took their references
+        if (woken)
+        {
+            uint64_t count;
+            if (read(loop->wake_fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+                break;
+
+            _dthread_reactor_run_posts(loop);
+        }
+
+        if (dthread_atomic_load_i32(&reactor->stop))
+            break;
+    }
+
+    free(events);
+    free(ready);
+
+    return NULL;
+}
+
+int dthread_reactor_init(DThreadReactor* reactor, DThreadReactorConfig* config)
+{
+    dthread_debug("dthread_reactor_init");
+
+    assert(reactor && "`reactor` cannot be NULL in dthread_reactor_init");
+
+    memset(reactor, 0, sizeof(*reactor));
+
+    DThreadReactorConfig cfg = config ? *config : (DThreadReactorConfig){0};
+
+    if (cfg.num_loops <= 0)
+        cfg.num_loops = 1;
+    if (cfg.max_events <= 0)
+        cfg.max_events = _DTHREAD_REACTOR_MAX_EVENTS;
+    if (cfg.batch_size <= 0)
+        cfg.batch_size = _DTHREAD_REACTOR_BATCH_SIZE;
+
+    reactor->config = cfg;
+
+    reactor->loops = (_DThreadReactorLoop*)calloc((size_t)cfg.num_loops, sizeof(_DThreadReactorLoop));
+    if (!reactor->loops)
+        return 1;
+
+    for (int i = 0; i < cfg.num_loops; ++i)
+    {
+        _DThreadReactorLoop* loop = &reactor->loops[i];
+
+        loop->reactor = reactor;
+        loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        struct epoll_event event;
+        memset(&event, 0, sizeof(event));
+        event.events = EPOLLIN;
+        event.data.ptr = NULL;
+
+        if (loop->epoll_fd < 0 || loop->wake_fd < 0 || epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &event) != 0)
+        {
+            if (loop->epoll_fd >= 0)
+                close(loop->epoll_fd);
+            if (loop->wake_fd >= 0)
+                close(loop->wake_fd);
+
+            dthread_reactor_destroy(reactor);
+            return 1;
+        }
+
+        dthread_mutex_init(&loop->mutex, NULL);
+
+        loop->thread = dthread_init_thread(_dthread_reactor_loop_main, loop);
+        if (dthread_create(&loop->thread, NULL) != 0)
+        {
+            close(loop->epoll_fd);
+            close(loop->wake_fd);
+            dthread_mutex_destroy(&loop->mutex);
+
+            dthread_reactor_destroy(reactor);
+            return 1;
+        }
+
+        reactor->num_loops = i + 1;
+    }
+
+    return 0;
+}
+
+int dthread_reactor_destroy(DThreadReactor* reactor)
+{
+    dthread_debug("dthread_reactor_destroy");
+
+    assert(reactor && "`reactor` cannot be NULL in dthread_reactor_destroy");
+
+    dthread_atomic_store_i32(&reactor->stop, 1);
+
+    int result = 0;
+    uint64_t one = 1;
+
+    for (int i = 0; i < reactor->num_loops; ++i)
+    {
+        if (write(reactor->loops[i].wake_fd, &one, sizeof(one)) != sizeof(one))
+            result = 1;
+    }
+
+    for (int i = 0; i < reactor->num_loops; ++i)
+    {
+        _DThreadReactorLoop* loop = &reactor->loops[i];
+
+        if (dthread_join(&loop->thread) != 0)
+            result = 1;
+
+        // posted after the loop stopped
+        _dthread_reactor_run_posts(loop);
+
+        close(loop->epoll_fd);
+        close(loop->wake_fd);
+        dthread_mutex_destroy(&loop->mutex);
+    }
+
+    free(reactor->loops);
+    reactor->loops = NULL;
+    reactor->num_loops = 0;
+
+    return result;
+}
+
+int dthread_reactor_add(DThreadReactor* reactor, DThreadReactorHandle** handle, int fd, uint32_t events,
+                        DThreadReactorCallback callback, void* data)
+{
+    dthread_debug("dthread_reactor_add");
+
+    assert(reactor && handle && callback && "`reactor`, `handle` and `callback` cannot be NULL in dthread_reactor_add");
+
+    DThreadReactorHandle* h = (DThreadReactorHandle*)calloc(1, sizeof(DThreadReactorHandle));
+    if (!h)
+        return 1;
+
+    int64_t next = dthread_atomic_fetch_add_i64(&reactor->next_loop, 1);
+
+    h->fd = fd;
+    h->callback = callback;
+    h->data = data;
+    h->loop = &reactor->loops[next % reactor->num_loops];
+    h->refs = 1;
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLET;
+    event.data.ptr = h;
+
+    if (events & DTHREAD_REACTOR_READ)
+        event.events |= EPOLLIN | EPOLLRDHUP;
+    if (events & DTHREAD_REACTOR_WRITE)
+        event.events |= EPOLLOUT;
+
+    if (epoll_ctl(h->loop->epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0)
+    {
+        free(h);
+        return 1;
+    }
+
+    *handle = h;
+
+    return 0;
+}
+
+int dthread_reactor_remove(DThreadReactorHandle* handle)
+{
+    dthread_debug("dthread_reactor_remove");
+
+    assert(handle && "`handle` cannot be NULL in dthread_reactor_remove");
+
+    dthread_atomic_store_i32(&handle->removed, 1);
+    dthread_atomic_fence();
+
+    int result = epoll_ctl(handle->loop->epoll_fd, EPOLL_CTL_DEL, handle->fd, NULL) == 0 ? 0 : 1;
+
+    // a callback may have passed the check before the store, the one of the caller never returns here
+    if (_dthread_reactor_current != handle)
+    {
+        while (dthread_atomic_load_i32(&handle->running) != 0)
+            _dthread_pool_relax();
+    }
+
+    // the loop may still hold events of this handle from its current round
+    if (_dthread_reactor_post_to(handle->loop, _dthread_reactor_release_routine, handle) != 0)
+        result = 1;
+
+    return result;
+}
+
+int dthread_reactor_post(DThreadReactor* reactor, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_reactor_post");
+
+    assert(reactor && func && "`reactor` and `func` cannot be NULL in dthread_reactor_post");
+
+    int64_t next = dthread_atomic_fetch_add_i64(&reactor->next_loop, 1);
+
+    return _dthread_reactor_post_to(&reactor->loops[next % reactor->num_loops], func, data);
+}
+
+#else
+
+int dthread_reactor_init(DThreadReactor* reactor, DThreadReactorConfig* config)
+{
+    dthread_debug("dthread_reactor_init");
+
+    (void)config;
+    memset(reactor, 0, sizeof(*reactor));
+
+    return 1;
+}
+
+int dthread_reactor_destroy(DThreadReactor* reactor)
+{
+    dthread_debug("dthread_reactor_destroy");
+
+    (void)reactor;
+
+    return 1;
+}
+
+int dthread_reactor_add(DThreadReactor* reactor, DThreadReactorHandle** handle, int fd, uint32_t events,
+                        DThreadReactorCallback callback, void* data)
+{
+    dthread_debug("dthread_reactor_add");
+
+    (void)reactor;
+    (void)handle;
+    (void)fd;
+    (void)events;
+    (void)callback;
+    (void)data;
+
+    return 1;
+}
+
+int dthread_reactor_remove(DThreadReactorHandle* handle)
+{
+    dthread_debug("dthread_reactor_remove");
+
+    (void)handle;
+
+    return 1;
+}
+
+int dthread_reactor_post(DThreadReactor* reactor, DThreadRoutine func, void* data)
+{
+    dthread_debug("dthread_reactor_post");
+
+    (void)reactor;
+    (void)func;
+    (void)data;
+
+    return 1;
+}
+
+#endif
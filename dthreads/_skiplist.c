@@ -0,0 +1,497 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _skiplist.c
+//    Date: 2024-09-19
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+// the low bit of a next pointer marks its node as removed at that level
+#define _DTHREAD_SKIP_MARK ((uintptr_t)1)
+
+typedef struct _DThreadSkipNode
+{
+    // an immutable copy of the value, NULL once the entry is removed
+    void* value;
+    int32_t level;
+    // the inserter and the remover both release the node when they are done with it
+    int32_t released;
+} _DThreadSkipNode;
+
+// the next pointers follow the node, then the key
+#define _dthread_skip_next(NODE) ((uintptr_t*)((NODE) + 1))
+#define _dthread_skip_key(NODE) ((unsigned char*)(_dthread_skip_next(NODE) + (NODE)->level))
+
+#define _dthread_skip_load(NODE, LEVEL) ((uintptr_t)dthread_atomic_load_ptr((void**)&_dthread_skip_next(NODE)[LEVEL]))
+#define _dthread_skip_unmark(PTR) ((_DThreadSkipNode*)((PTR) & ~_DTHREAD_SKIP_MARK))
+
+// the value of the entries of a set
+static char _dthread_skip_present;
+
+static DTHREAD_THREAD_LOCAL uint64_t _dthread_skip_seed = 0;
+
+static uint64_t _dthread_skip_rand(void)
+{
+    // xorshift64, only used for the levels and the relaxed pops
+    uint64_t x = _dthread_skip_seed;
+
+    if (!x)
+        x = ((uint64_t)dthread_index() + 1) * 0x9e3779b97f4a7c15ull;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    _dthread_skip_seed = x;
+
+    return x;
+}
+
+static int _dthread_skip_compare(DThreadSkipList* list, const void* a, const void* b)
+{
+    return list->config.compare ? list->config.compare(a, b) : memcmp(a, b, list->config.key_size);
+}
+
+static _DThreadSkipNode* _dthread_skip_node_new(DThreadSkipList* list, int level)
+{
+    _DThreadSkipNode* node = (_DThreadSkipNode*)calloc(1, sizeof(_DThreadSkipNode) + (size_t)level * sizeof(uintptr_t) + list->key_stride);
+    if (node)
+        node->level = level;
+
+    return node;
+}
+
+static void* _dthread_skip_value_new(DThreadSkipList* list, const void* value)
+{
+    if (list->config.value_size == 0)
+        return &_dthread_skip_present;
+
+    void* copy = malloc(list->config.value_size);
+    if (copy)
+        memcpy(copy, value, list->config.value_size);
+
+    return copy;
+}
+
+static void _dthread_skip_value_retire(DThreadSkipList* list, void* value)
+{
+    if (value != &_dthread_skip_present)
+        dthread_epoch_retire(&list->epoch, value, free);
+}
+
+/*
+ * Lookup, every walk unlinks the marked nodes it meets so that removals never wait
+ */
+
+static int _dthread_skip_find(DThreadSkipList* list, const void* key, _DThreadSkipNode** preds, _DThreadSkipNode** succs)
+{
+retry:;
+    _DThreadSkipNode* pred = list->head;
+
+    for (int level = DTHREAD_SKIPLIST_MAX_LEVEL - 1; level >= 0; --level)
+    {
+        _DThreadSkipNode* curr = _dthread_skip_unmark(_dthread_skip_load(pred, level));
+
+        while (curr)
+        {
+            uintptr_t succ = _dthread_skip_load(curr, level);
+
+            if (succ & _DTHREAD_SKIP_MARK)
+            {
+                // fails when pred is being removed too, the walk starts over
+                void* expected = curr;
+                if (!dthread_atomic_cas_ptr((void**)&_dthread_skip_next(pred)[level], &expected, _dthread_skip_unmark(succ)))
+                    goto retry;
+
+                curr = _dthread_skip_unmark(succ);
+                continue;
+            }
+
+            if (_dthread_skip_compare(list, _dthread_skip_key(curr), key) >= 0)
+                break;
+
+            pred = curr;
+            curr = _dthread_skip_unmark(succ);
+        }
+
+        preds[level] = pred;
+        succs[level] = curr;
+    }
+
+    return succs[0] && _dthread_skip_compare(list, _dthread_skip_key(succs[0]), key) == 0;
+}
+
+// marks every level from the top, the level 0 mark is what the walks rely on
+static void _dthread_skip_mark(_DThreadSkipNode* node)
+{
+    for (int level = node->level - 1; level >= 0; --level)
+    {
+        uintptr_t next = _dthread_skip_load(node, level);
+
+        while (!(next & _DTHREAD_SKIP_MARK))
+        {
+            void* expected = (void*)next;
+
+            if (dthread_atomic_cas_ptr((void**)&_dthread_skip_next(node)[level], &expected, (void*)(next | _DTHREAD_SKIP_MARK)))
+                break;
+
+            next = (uintptr_t)expected;
+        }
+    }
+}
+
+static void _dthread_skip_release(DThreadSkipList* list, _DThreadSkipNode* node)
+{
+    if (dthread_atomic_fetch_add_i32(&node->released, 1) == 1)
+        dthread_epoch_retire(&list->epoch, node, free);
+}
+
+// removes an entry whose value this thread swapped for NULL
+static void _dthread_skip_unlink(DThreadSkipList* list, _DThreadSkipNode* node, void* value)
+{
+    _DThreadSkipNode* preds[DTHREAD_SKIPLIST_MAX_LEVEL];
+    _DThreadSkipNode* succs[DTHREAD_SKIPLIST_MAX_LEVEL];
+
+    dthread_atomic_fetch_add_i64(&list->count, -1);
+    _dthread_skip_value_retire(list, value);
+
+    _dthread_skip_mark(node);
+    _dthread_skip_find(list, _dthread_skip_key(node), preds, succs);
+    _dthread_skip_release(list, node);
+}
+
+int dthread_skiplist_init(DThreadSkipList* list, DThreadSkipListConfig* config)
+{
+    dthread_debug("dthread_skiplist_init");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_init");
+    assert(config && config->key_size > 0 && "`config->key_size` cannot be 0 in dthread_skiplist_init");
+
+    memset(list, 0, sizeof(*list));
+
+    list->config = *config;
+    list->key_stride = (list->config.key_size + 7) & ~(size_t)7;
+
+    if (list->config.relax < 0)
+        list->config.relax = 0;
+
+    list->head = _dthread_skip_node_new(list, DTHREAD_SKIPLIST_MAX_LEVEL);
+
+    if (!list->head)
+        return 1;
+
+    return dthread_epoch_init(&list->epoch);
+}
+
+void dthread_skiplist_destroy(DThreadSkipList* list)
+{
+    dthread_debug("dthread_skiplist_destroy");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_destroy");
+
+    // the removed nodes still linked are retired already, only their neighbours are freed here
+    _DThreadSkipNode* node = list->head;
+
+    while (node)
+    {
+        uintptr_t next = _dthread_skip_next(node)[0];
+
+        if (node == list->head || !(next & _DTHREAD_SKIP_MARK))
+        {
+            if (node != list->head && node->value != &_dthread_skip_present)
+                free(node->value);
+
+            free(node);
+        }
+
+        node = _dthread_skip_unmark(next);
+    }
+
+    dthread_epoch_destroy(&list->epoch);
+
+    list->head = NULL;
+    list->count = 0;
+}
+
+int dthread_skiplist_get(DThreadSkipList* list, const void* key, void* value)
+{
+    dthread_debug("dthread_skiplist_get");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_get");
+    assert(key && "`key` cannot be NULL in dthread_skiplist_get");
+
+    _DThreadSkipNode* preds[DTHREAD_SKIPLIST_MAX_LEVEL];
+    _DThreadSkipNode* succs[DTHREAD_SKIPLIST_MAX_LEVEL];
+    int result = 1;
+
+    dthread_epoch_enter(&list->epoch);
+
+    if (_dthread_skip_find(list, key, preds, succs))
+    {
+        void* current = dthread_atomic_load_ptr(&succs[0]->value);
+
+        if (current)
+        {
+            if (value && list->config.value_size)
+                memcpy(value, current, list->config.value_size);
+
+            result = 0;
+        }
+    }
+
+    dthread_epoch_exit(&list->epoch);
+
+    return result;
+}
+
+int dthread_skiplist_put(DThreadSkipList* list, const void* key, const void* value)
+{
+    dthread_debug("dthread_skiplist_put");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_put");
+    assert(key && "`key` cannot be NULL in dthread_skiplist_put");
+
+    _DThreadSkipNode* preds[DTHREAD_SKIPLIST_MAX_LEVEL];
+    _DThreadSkipNode* succs[DTHREAD_SKIPLIST_MAX_LEVEL];
+    _DThreadSkipNode* node = NULL;
+    void* copy = _dthread_skip_value_new(list, value);
+
+    if (!copy)
+        return 1;
+
+    dthread_epoch_enter(&list->epoch);
+
+    for (;;)
+    {
+        if (_dthread_skip_find(list, key, preds, succs))
+        {
+            _DThreadSkipNode* found = succs[0];
+            void* current = dthread_atomic_load_ptr(&found->value);
+
+            while (current)
+            {
+                if (dthread_atomic_cas_ptr(&found->value, &current, copy))
+                {
+                    _dthread_skip_value_retire(list, current);
+                    dthread_epoch_exit(&list->epoch);
+
+                    free(node);
+                    return 0;
+                }
+            }
+
+            // being removed, it is unlinked by the next walk once marked
+            _dthread_skip_mark(found);
+            continue;
+        }
+
+        if (!node)
+        {
+            int level = 1;
+            for (uint64_t bits = _dthread_skip_rand(); level < DTHREAD_SKIPLIST_MAX_LEVEL && (bits & 1); bits >>= 1)
+                ++level;
+
+            node = _dthread_skip_node_new(list, level);
+
+            if (!node)
+            {
+                dthread_epoch_exit(&list->epoch);
+
+                if (copy != &_dthread_skip_present)
+                    free(copy);
+                return 1;
+            }
+
+            memcpy(_dthread_skip_key(node), key, list->config.key_size);
+            node->value = copy;
+        }
+
+        for (int level = 0; level < node->level; ++level)
+            _dthread_skip_next(node)[level] = (uintptr_t)succs[level];
+
+        // the entry exists once it is linked at level 0
+        void* expected = succs[0];
+        if (dthread_atomic_cas_ptr((void**)&_dthread_skip_next(preds[0])[0], &expected, node))
+            break;
+    }
+
+    dthread_atomic_fetch_add_i64(&list->count, 1);
+
+    for (int level = 1; level < node->level; ++level)
+    {
+        for (;;)
+        {
+            uintptr_t next = _dthread_skip_load(node, level);
+
+            // removed meanwhile, its remover takes care of the levels linked so far
+            if (next & _DTHREAD_SKIP_MARK)
+                goto linked;
+
+            void* expected = (void*)next;
+            if (next != (uintptr_t)succs[level] &&
+                !dthread_atomic_cas_ptr((void**)&_dthread_skip_next(node)[level], &expected, succs[level]))
+                goto linked;
+
+            expected = succs[level];
+            if (dthread_atomic_cas_ptr((void**)&_dthread_skip_next(preds[level])[level], &expected, node))
+                break;
+
+            if (!_dthread_skip_find(list, key, preds, succs) || succs[0] != node)
+                goto linked;
+        }
+    }
+
+linked:
+    // a removal that ran while the upper levels were linked may have missed some of them
+    if (!dthread_atomic_load_ptr(&node->value))
+        _dthread_skip_find(list, key, preds, succs);
+
+    _dthread_skip_release(list, node);
+    dthread_epoch_exit(&list->epoch);
+
+    return 0;
+}
+
+int dthread_skiplist_remove(DThreadSkipList* list, const void* key)
+{
+    dthread_debug("dthread_skiplist_remove");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_remove");
+    assert(key && "`key` cannot be NULL in dthread_skiplist_remove");
+
+    _DThreadSkipNode* preds[DTHREAD_SKIPLIST_MAX_LEVEL];
+    _DThreadSkipNode* succs[DTHREAD_SKIPLIST_MAX_LEVEL];
+    int result = 1;
+
+    dthread_epoch_enter(&list->epoch);
+
+    if (_dthread_skip_find(list, key, preds, succs))
+    {
+        _DThreadSkipNode* node = succs[0];
+        void* current = dthread_atomic_load_ptr(&node->value);
+
+        // swapping the value for NULL is the removal, losing the race means another one won
+        while (current)
+        {
+            if (dthread_atomic_cas_ptr(&node->value, &current, NULL))
+            {
+                _dthread_skip_unlink(list, node, current);
+                result = 0;
+                break;
+            }
+        }
+    }
+
+    dthread_epoch_exit(&list->epoch);
+
+    return result;
+}
+
+int dthread_skiplist_pop_min(DThreadSkipList* list, void* key, void* value)
+{
+    dthread_debug("dthread_skiplist_pop_min");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_pop_min");
+
+    int skip = list->config.relax ? (int)(_dthread_skip_rand() % (uint64_t)(list->config.relax + 1)) : 0;
+    int result = 1;
+
+    dthread_epoch_enter(&list->epoch);
+
+    for (;;)
+    {
+        _DThreadSkipNode* candidate = NULL;
+        void* current = NULL;
+        int seen = 0;
+
+        // the live entry number `skip`, or the last one when there are fewer
+        for (_DThreadSkipNode* node = _dthread_skip_unmark(_dthread_skip_load(list->head, 0)); node;
+             node = _dthread_skip_unmark(_dthread_skip_load(node, 0)))
+        {
+            void* node_value = dthread_atomic_load_ptr(&node->value);
+
+            if (!node_value)
+                continue;
+
+            candidate = node;
+            current = node_value;
+
+            if (seen++ == skip)
+                break;
+        }
+
+        if (!candidate)
+            break;
+
+        if (dthread_atomic_cas_ptr(&candidate->value, &current, NULL))
+        {
+            if (key)
+                memcpy(key, _dthread_skip_key(candidate), list->config.key_size);
+            if (value && list->config.value_size)
+                memcpy(value, current, list->config.value_size);
+
+            _dthread_skip_unlink(list, candidate, current);
+            result = 0;
+            break;
+        }
+
+        // another pop took it, the next attempt goes for the first entry
+        skip = 0;
+    }
+
+    dthread_epoch_exit(&list->epoch);
+
+    return result;
+}
+
+int dthread_skiplist_range(DThreadSkipList* list, const void* low, const void* high, DThreadVisitFunc visit, void* data)
+{
+    dthread_debug("dthread_skiplist_range");
+
+    assert(list && "`list` cannot be NULL in dthread_skiplist_range");
+    assert(visit && "`visit` cannot be NULL in dthread_skiplist_range");
+
+    _DThreadSkipNode* preds[DTHREAD_SKIPLIST_MAX_LEVEL];
+    _DThreadSkipNode* succs[DTHREAD_SKIPLIST_MAX_LEVEL];
+    int result = 0;
+
+    dthread_epoch_enter(&list->epoch);
+
+    _DThreadSkipNode* node;
+
+    if (low)
+    {
+        _dthread_skip_find(list, low, preds, succs);
+        node = succs[0];
+    }
+    else
+        node = _dthread_skip_unmark(_dthread_skip_load(list->head, 0));
+
+    // the keys only grow along level 0, even through removed nodes
+    for (; node; node = _dthread_skip_unmark(_dthread_skip_load(node, 0)))
+    {
+        if (high && _dthread_skip_compare(list, _dthread_skip_key(node), high) > 0)
+            break;
+
+        void* current = dthread_atomic_load_ptr(&node->value);
+
+        if (current && visit(_dthread_skip_key(node), list->config.value_size ? current : NULL, data))
+        {
+            result = 1;
+            break;
+        }
+    }
+
+    dthread_epoch_exit(&list->epoch);
+
+    return result;
+}
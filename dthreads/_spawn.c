@@ -0,0 +1,338 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _spawn.c
+//    Date: 2024-08-27
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+enum
+{
+    _DTHREAD_SPAWN_PARKED,
+    _DTHREAD_SPAWN_RUNNING,
+    _DTHREAD_SPAWN_DONE,
+    _DTHREAD_SPAWN_RETIRING
+};
+
+// one mutex guards every state transition, each slot has its own condition variable
+// so that wake ups go to exactly the worker or joiner that is interested in them
+static struct
+{
+    DThreadMutex mutex;
+    DThreadCond cond;
+
+    _DThreadSpawnSlot* parked;
+    _DThreadSpawnSlot* free_slots;
+    _DThreadSpawnSlot* all;
+
+    int num_parked;
+    int live;
+    int max_parked;
+    uint32_t idle_timeout;
+    int shutdown;
+    int initialized;
+} _dthread_spawn_cache;
+
+static void _dthread_spawn_unlink(_DThreadSpawnSlot* slot)
+{
+    if (slot->prev)
+        slot->prev->next = slot->next;
+    else
+        _dthread_spawn_cache.parked = slot->next;
+
+    if (slot->next)
+        slot->next->prev = slot->prev;
+
+    slot->prev = slot->next = NULL;
+    _dthread_spawn_cache.num_parked--;
+}
+
+// must be called with the cache mutex held
+static void _dthread_spawn_park_or_retire(_DThreadSpawnSlot* slot)
+{
+    if (_dthread_spawn_cache.shutdown || _dthread_spawn_cache.num_parked >= _dthread_spawn_cache.max_parked)
+    {
+        slot->state = _DTHREAD_SPAWN_RETIRING;
+    }
+    else
+    {
+        // LIFO so that the most recently used (cache-hot) thread is reused first
+        slot->state = _DTHREAD_SPAWN_PARKED;
+        slot->prev = NULL;
+        slot->next = _dthread_spawn_cache.parked;
+        if (slot->next)
+            slot->next->prev = slot;
+        _dthread_spawn_cache.parked = slot;
+        _dthread_spawn_cache.num_parked++;
+    }
+
+    dthread_cond_broadcast(&slot->cond);
+}
+
+static dthread_define_routine(_dthread_spawn_worker)
+{
+    _DThreadSpawnSlot* slot = (_DThreadSpawnSlot*)data;
+
+    dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+
+    for (;;)
+    {
+        if (slot->state == _DTHREAD_SPAWN_RUNNING)
+        {
+            dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+            void* result = slot->func(slot->data);
+            dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+
+            slot->result = result;
+
+            if (slot->detached)
+            {
+                _dthread_spawn_park_or_retire(slot);
+            }
+            else
+            {
+                slot->state = _DTHREAD_SPAWN_DONE;
+                dthread_cond_broadcast(&slot->cond);
+            }
+        }
+        else if (slot->state == _DTHREAD_SPAWN_RETIRING)
+        {
+            break;
+        }
+        else if (slot->state == _DTHREAD_SPAWN_PARKED)
+        {
+            if (_dthread_spawn_cache.shutdown)
+            {
+                _dthread_spawn_unlink(slot);
+                break;
+            }
+
+            if (dthread_cond_timedwait(&slot->cond, &_dthread_spawn_cache.mutex, _dthread_spawn_cache.idle_timeout) != 0 &&
+                slot->state == _DTHREAD_SPAWN_PARKED)
+            {
+                // idle for too long, give the kernel thread back
+                _dthread_spawn_unlink(slot);
+                break;
+            }
+        }
+        else
+        {
+            // done, waiting for the joiner to collect the result
+            dthread_cond_wait(&slot->cond, &_dthread_spawn_cache.mutex);
+        }
+    }
+
+    slot->state = _DTHREAD_SPAWN_RETIRING;
+    slot->reap = 1;
+    slot->next = _dthread_spawn_cache.free_slots;
+    _dthread_spawn_cache.free_slots = slot;
+
+    if (--_dthread_spawn_cache.live == 0)
+        dthread_cond_broadcast(&_dthread_spawn_cache.cond);
+
+    dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+    return NULL;
+}
+
+int dthread_spawn_init(DThreadSpawnConfig* config)
+{
+    dthread_debug("dthread_spawn_init");
+
+    memset(&_dthread_spawn_cache, 0, sizeof(_dthread_spawn_cache));
+
+    _dthread_spawn_cache.idle_timeout = (config && config->idle_timeout) ? config->idle_timeout : 1000;
+    _dthread_spawn_cache.max_parked = (config && config->max_parked > 0) ? config->max_parked : 4 * dthread_cpu_count();
+
+    if (dthread_mutex_init(&_dthread_spawn_cache.mutex, NULL) != 0)
+        return 1;
+
+    if (dthread_cond_init(&_dthread_spawn_cache.cond, NULL) != 0)
+    {
+        dthread_mutex_destroy(&_dthread_spawn_cache.mutex);
+        return 1;
+    }
+
+    _dthread_spawn_cache.initialized = 1;
+
+    return 0;
+}
+
+int dthread_spawn(DThread* thread)
+{
+    dthread_debug("dthread_spawn");
+
+    assert(thread && "`thread` cannot be NULL in dthread_spawn");
+    assert(_dthread_spawn_cache.initialized && "dthread_spawn_init must be called before dthread_spawn");
+
+    if (!_dthread_spawn_cache.initialized)
+        return 1;
+
+    _DThreadSpawnSlot* slot;
+    int fresh = 0;
+    int reap = 0;
+
+    dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+
+    if (_dthread_spawn_cache.parked)
+    {
+        slot = _dthread_spawn_cache.parked;
+        _dthread_spawn_unlink(slot);
+    }
+    else
+    {
+        fresh = 1;
+
+        if (_dthread_spawn_cache.free_slots)
+        {
+            slot = _dthread_spawn_cache.free_slots;
+            _dthread_spawn_cache.free_slots = slot->next;
+
+            reap = slot->reap;
+            slot->reap = 0;
+        }
+        else
+        {
+            slot = (_DThreadSpawnSlot*)calloc(1, sizeof(_DThreadSpawnSlot));
+            if (!slot)
+            {
+                dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+                return 1;
+            }
+
+            dthread_cond_init(&slot->cond, NULL);
+            slot->all_next = _dthread_spawn_cache.all;
+            _dthread_spawn_cache.all = slot;
+        }
+
+        slot->next = slot->prev = NULL;
+        _dthread_spawn_cache.live++;
+    }
+
+    slot->func = thread->_func;
+    slot->data = thread->_data;
+    slot->result = NULL;
+    slot->detached = 0;
+    slot->state = _DTHREAD_SPAWN_RUNNING;
+
+    thread->_result = NULL;
+    thread->_slot = slot;
+
+    if (!fresh)
+    {
+        thread->handle = slot->thread.handle;
+        dthread_cond_broadcast(&slot->cond);
+        dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+        return 0;
+    }
+
+    dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+    // the previous worker of the slot has given it back already, it only has to return
+    if (reap)
+        dthread_join(&slot->thread);
+
+    slot->thread = dthread_init_thread(_dthread_spawn_worker, slot);
+    if (dthread_create(&slot->thread, NULL) != 0)
+    {
+        dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+        slot->state = _DTHREAD_SPAWN_RETIRING;
+        slot->next = _dthread_spawn_cache.free_slots;
+        _dthread_spawn_cache.free_slots = slot;
+        _dthread_spawn_cache.live--;
+        dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+        thread->_slot = NULL;
+        return 1;
+    }
+
+    // the worker stays joinable, the cache joins it once it retires
+    thread->handle = slot->thread.handle;
+
+    return 0;
+}
+
+int _dthread_spawn_join(DThread* thread)
+{
+    _DThreadSpawnSlot* slot = thread->_slot;
+
+    dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+
+    while (slot->state != _DTHREAD_SPAWN_DONE)
+        dthread_cond_wait(&slot->cond, &_dthread_spawn_cache.mutex);
+
+    thread->_result = slot->result;
+    thread->_slot = NULL;
+    _dthread_spawn_park_or_retire(slot);
+
+    dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+    return 0;
+}
+
+int _dthread_spawn_detach(DThread* thread)
+{
+    _DThreadSpawnSlot* slot = thread->_slot;
+
+    dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+
+    if (slot->state == _DTHREAD_SPAWN_DONE)
+        _dthread_spawn_park_or_retire(slot);
+    else
+        slot->detached = 1;
+
+    thread->_slot = NULL;
+
+    dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+    return 0;
+}
+
+void dthread_spawn_cleanup(void)
+{
+    dthread_debug("dthread_spawn_cleanup");
+
+    if (!_dthread_spawn_cache.initialized)
+        return;
+
+    dthread_mutex_lock(&_dthread_spawn_cache.mutex);
+
+    _dthread_spawn_cache.shutdown = 1;
+    for (_DThreadSpawnSlot* slot = _dthread_spawn_cache.all; slot; slot = slot->all_next)
+        dthread_cond_broadcast(&slot->cond);
+
+    while (_dthread_spawn_cache.live > 0)
+        dthread_cond_wait(&_dthread_spawn_cache.cond, &_dthread_spawn_cache.mutex);
+
+    dthread_mutex_unlock(&_dthread_spawn_cache.mutex);
+
+    // the workers still unlock the mutex after giving their slot back
+    _DThreadSpawnSlot* slot = _dthread_spawn_cache.all;
+    while (slot)
+    {
+        _DThreadSpawnSlot* next = slot->all_next;
+
+        if (slot->reap)
+            dthread_join(&slot->thread);
+
+        dthread_cond_destroy(&slot->cond);
+        free(slot);
+        slot = next;
+    }
+
+    dthread_cond_destroy(&_dthread_spawn_cache.cond);
+    dthread_mutex_destroy(&_dthread_spawn_cache.mutex);
+
+    memset(&_dthread_spawn_cache, 0, sizeof(_dthread_spawn_cache));
+}
@@ -0,0 +1,516 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _timer.c
+//    Date: 2024-09-17
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+#define _DTHREAD_TIMER_TICK_US 1000
+
+// below this distance the driver stops using the coarse timed wait and sleeps precisely
+#define _DTHREAD_TIMER_COARSE_NS 2000000ull
+
+#define _DTHREAD_TIMER_SLOT_BITS 8
+#define _DTHREAD_TIMER_MAX_DELTA ((1ull << (_DTHREAD_TIMER_SLOT_BITS * DTHREAD_TIMER_LEVELS)) - 1)
+
+// the expired timers waiting for their callback, they can still be cancelled there
+#define _DTHREAD_TIMER_EXPIRED -1
+
+// the periodic timer whose callback runs on this thread
+static DTHREAD_THREAD_LOCAL DThreadTimer* _dthread_timer_current = NULL;
+
+static uint64_t _dthread_timer_tick_of(DThreadTimerWheel* wheel, uint64_t ns)
+{
+    if (ns <= wheel->start_ns)
+        return 0;
+
+    return (ns - wheel->start_ns + wheel->tick_ns - 1) / wheel->tick_ns;
+}
+
+static DThreadTimer** _dthread_timer_head(DThreadTimerWheel* wheel, DThreadTimer* timer)
+{
+    if (timer->level == _DTHREAD_TIMER_EXPIRED)
+        return &wheel->expired;
+
+    return &wheel->slots[timer->level][timer->slot];
+}
+
+static void _dthread_timer_link(DThreadTimerWheel* wheel, DThreadTimer* timer)
+{
+    if (timer->tick <= wheel->current_tick)
+        timer->tick = wheel->current_tick + 1;
+
+    // timers too far away wait in the last level and are placed again when it cascades
+    uint64_t delta = timer->tick - wheel->current_tick;
+    uint64_t at = delta > _DTHREAD_TIMER_MAX_DELTA ? wheel->current_tick + _DTHREAD_TIMER_MAX_DELTA : timer->tick;
+
+    if (delta > _DTHREAD_TIMER_MAX_DELTA)
+        delta = _DTHREAD_TIMER_MAX_DELTA;
+
+    int level = 0;
+    while (level < DTHREAD_TIMER_LEVELS - 1 && delta >= (1ull << (_DTHREAD_TIMER_SLOT_BITS * (level + 1))))
+        ++level;
+
+    timer->level = level;
+    timer->slot = (int)((at >> (_DTHREAD_TIMER_SLOT_BITS * level)) & (DTHREAD_TIMER_SLOTS - 1));
+    timer->prev = NULL;
+    timer->next = wheel->slots[level][timer->slot];
+    timer->pending = 1;
+
+    if (timer->next)
+        timer->next->prev = timer;
+
+    wheel->slots[level][timer->slot] = timer;
+    wheel->level_count[level]++;
+    wheel->count++;
+}
+
+static void _dthread_timer_unlink(DThreadTimerWheel* wheel, DThreadTimer* timer)
+{
+    if (timer->prev)
+        timer->prev->next = timer->next;
+    else
+        *_dthread_timer_head(wheel, timer) = timer->next;
+
+    if (timer->next)
+        timer->next->prev = timer->prev;
+    else if (timer->level == _DTHREAD_TIMER_EXPIRED)
+        wheel->expired_tail = timer->prev;
+
+    if (timer->level != _DTHREAD_TIMER_EXPIRED)
+    {
+        wheel->level_count[timer->level]--;
+        wheel->count--;
+    }
+
+    timer->next = timer->prev = NULL;
+    timer->pending = 0;
+}
+
+static void _dthread_timer_expire(DThreadTimerWheel* wheel, DThreadTimer* timer)
+{
+    _dthread_timer_unlink(wheel, timer);
+
+    timer->level = _DTHREAD_TIMER_EXPIRED;
+    timer->prev = wheel->expired_tail;
+    timer->next = NULL;
+    timer->pending = 1;
+
+    if (wheel->expired_tail)
+        wheel->expired_tail->next = timer;
+    else
+        wheel->expired = timer;
+
+    wheel->expired_tail = timer;
+}
+
+static void _dthread_timer_cascade(DThreadTimerWheel* wheel, int level)
+{
+    int slot = (int)((wheel->current_tick >> (_DTHREAD_TIMER_SLOT_BITS * level)) & (DTHREAD_TIMER_SLOTS - 1));
+    DThreadTimer* timer = wheel->slots[level][slot];
+
+    while (timer)
+    {
+        DThreadTimer* next = timer->next;
+
+        // the timers due in this very tick skip the first level, it is collected right after
+        if (timer->tick <= wheel->current_tick)
+            _dthread_timer_expire(wheel, timer);
+        else
+        {
+            _dthread_timer_unlink(wheel, timer);
+            _dthread_timer_link(wheel, timer);
+        }
+
+        timer = next;
+    }
+}
+
+static void _dthread_timer_advance(DThreadTimerWheel* wheel, uint64_t now_tick)
+{
+    while (wheel->current_tick < now_tick)
+    {
+        // nothing to cascade, an idle wheel jumps straight to the present
+        if (wheel->count == 0)
+        {
+            wheel->current_tick = now_tick;
+            break;
+        }
+
+        ++wheel->current_tick;
+
+        // the upper levels cascade when the levels below them wrap around, the highest one first
+        // so that its timers can still move further down in this tick
+        int levels = 0;
+        while (levels < DTHREAD_TIMER_LEVELS - 1 &&
+               ((wheel->current_tick >> (_DTHREAD_TIMER_SLOT_BITS * levels)) & (DTHREAD_TIMER_SLOTS - 1)) == 0)
+            ++levels;
+
+        for (int level = levels; level > 0; --level)
+            _dthread_timer_cascade(wheel, level);
+
+        DThreadTimer** slot = &wheel->slots[0][wheel->current_tick & (DTHREAD_TIMER_SLOTS - 1)];
+
+        while (*slot)
+            _dthread_timer_expire(wheel, *slot);
+    }
+}
+
+static uint64_t _dthread_timer_next_tick(DThreadTimerWheel* wheel)
+{
+    uint64_t next = UINT64_MAX;
+
+    if (wheel->level_count[0] > 0)
+    {
+        for (uint64_t tick = wheel->current_tick + 1; tick <= wheel->current_tick + DTHREAD_TIMER_SLOTS; ++tick)
+        {
+            if (wheel->slots[0][tick & (DTHREAD_TIMER_SLOTS - 1)])
+            {
+                next = tick;
+                break;
+            }
+        }
+    }
+
+    // the upper levels only need the driver when the first level wraps around
+    if (wheel->count > wheel->level_count[0])
+    {
+        uint64_t cascade = (wheel->current_tick | (DTHREAD_TIMER_SLOTS - 1)) + 1;
+
+        if (cascade < next)
+            next = cascade;
+    }
+
+    return next;
+}
+
+// must be called with the mutex held once the callback of a periodic timer has returned
+static void _dthread_timer_rearm(DThreadTimerWheel* wheel, DThreadTimer* timer)
+{
+    timer->running = 0;
+    wheel->running--;
+
+    if (!timer->cancelled && (timer->restarted || timer->period_ns > 0))
+    {
+        uint64_t now = dthread_now_ns();
+
+        // the driver only keeps the wheel in sync while it holds timers
+        if (wheel->count == 0)
+            _dthread_timer_advance(wheel, (now - wheel->start_ns) / wheel->tick_ns);
+
+        // periodic timers keep their phase unless they fell a whole period behind
+        if (!timer->restarted)
+        {
+            timer->expires_ns += timer->period_ns;
+            if (timer->expires_ns <= now)
+                timer->expires_ns = now + timer->period_ns;
+        }
+
+        timer->tick = _dthread_timer_tick_of(wheel, timer->expires_ns);
+        _dthread_timer_link(wheel, timer);
+
+        if (wheel->start_ns + timer->tick * wheel->tick_ns < wheel->wake_ns)
+            dthread_cond_signal(&wheel->cond);
+    }
+
+    timer->cancelled = 0;
+    timer->restarted = 0;
+
+    dthread_cond_broadcast(&wheel->done);
+}
+
+static void _dthread_timer_run_periodic(DThreadTimer* timer)
+{
+    DThreadTimerWheel* wheel = timer->wheel;
+
+    _dthread_timer_current = timer;
+    timer->callback(timer);
+    _dthread_timer_current = NULL;
+
+    dthread_mutex_lock(&wheel->mutex);
+    _dthread_timer_rearm(wheel, timer);
+    dthread_mutex_unlock(&wheel->mutex);
+}
+
+static dthread_define_routine(_dthread_timer_fire)
+{
+    DThreadTimer* timer = (DThreadTimer*)data;
+
+    timer->callback(timer);
+
+    return NULL;
+}
+
+static dthread_define_routine(_dthread_timer_fire_periodic)
+{
+    _dthread_timer_run_periodic((DThreadTimer*)data);
+
+    return NULL;
+}
+
+static dthread_define_routine(_dthread_timer_driver_main)
+{
+    DThreadTimerWheel* wheel = (DThreadTimerWheel*)data;
+    uint64_t coarse_ns = 2 * wheel->tick_ns > _DTHREAD_TIMER_COARSE_NS ? 2 * wheel->tick_ns : _DTHREAD_TIMER_COARSE_NS;
+
+    dthread_mutex_lock(&wheel->mutex);
+
+    while (!wheel->stop)
+    {
+        uint64_t now = dthread_now_ns();
+
+        _dthread_timer_advance(wheel, (now - wheel->start_ns) / wheel->tick_ns);
+
+        if (wheel->expired)
+        {
+            DThreadTimer* timer = wheel->expired;
+            DThreadTimerCallback callback = timer->callback;
+
+            _dthread_timer_unlink(wheel, timer);
+
+            wheel->fired++;
+
+            // periodic timers are linked again by `_dthread_timer_rearm` once the callback returns
+            if (timer->period_ns > 0)
+            {
+                timer->running = 1;
+                wheel->running++;
+
+                if (wheel->config.pool && dthread_pool_submit(wheel->config.pool, _dthread_timer_fire_periodic, timer) == 0)
+                    continue;
+
+                dthread_mutex_unlock(&wheel->mutex);
+                _dthread_timer_run_periodic(timer);
+                dthread_mutex_lock(&wheel->mutex);
+
+                continue;
+            }
+
+            if (wheel->config.pool && dthread_pool_submit(wheel->config.pool, _dthread_timer_fire, timer) == 0)
+                continue;
+
+            dthread_mutex_unlock(&wheel->mutex);
+            callback(timer);
+            dthread_mutex_lock(&wheel->mutex);
+
+            continue;
+        }
+
+        uint64_t next_tick = _dthread_timer_next_tick(wheel);
+
+        if (next_tick == UINT64_MAX)
+        {
+            wheel->wake_ns = UINT64_MAX;
+            dthread_cond_wait(&wheel->cond, &wheel->mutex);
+            continue;
+        }
+
+        uint64_t wake_ns = wheel->start_ns + next_tick * wheel->tick_ns;
+        now = dthread_now_ns();
+
+        if (wake_ns <= now)
+            continue;
+
+        // far deadlines use the timed wait so that earlier timers can wake the driver up
+        if (wake_ns - now > coarse_ns)
+        {
+            wheel->wake_ns = wake_ns;
+            dthread_cond_timedwait(&wheel->cond, &wheel->mutex, (uint32_t)((wake_ns - now - coarse_ns / 2) / 1000000));
+            continue;
+        }
+
+        // near deadlines are slept precisely one tick at a time, a timer started meanwhile is
+        // never due before the next tick
+        uint64_t boundary = wheel->start_ns + (wheel->current_tick + 1) * wheel->tick_ns;
+        wheel->wake_ns = boundary;
+
+        dthread_mutex_unlock(&wheel->mutex);
+        dthread_sleep_until(boundary);
+        dthread_mutex_lock(&wheel->mutex);
+    }
+
+    dthread_mutex_unlock(&wheel->mutex);
+
+    return NULL;
+}
+
+int dthread_timer_wheel_init(DThreadTimerWheel* wheel, DThreadTimerConfig* config)
+{
+    dthread_debug("dthread_timer_wheel_init");
+
+    assert(wheel && "`wheel` cannot be NULL in dthread_timer_wheel_init");
+
+    memset(wheel, 0, sizeof(*wheel));
+
+    wheel->config = config ? *config : (DThreadTimerConfig){0};
+
+    if (wheel->config.tick_us == 0)
+        wheel->config.tick_us = _DTHREAD_TIMER_TICK_US;
+
+    wheel->tick_ns = (uint64_t)wheel->config.tick_us * 1000;
+    wheel->start_ns = dthread_now_ns();
+    wheel->wake_ns = UINT64_MAX;
+
+    if (dthread_mutex_init(&wheel->mutex, NULL) != 0)
+        return 1;
+
+    if (dthread_cond_init(&wheel->cond, NULL) != 0)
+    {
+        dthread_mutex_destroy(&wheel->mutex);
+        return 1;
+    }
+
+    if (dthread_cond_init(&wheel->done, NULL) != 0)
+    {
+        dthread_cond_destroy(&wheel->cond);
+        dthread_mutex_destroy(&wheel->mutex);
+        return 1;
+    }
+
+    wheel->driver = dthread_init_thread(_dthread_timer_driver_main, wheel);
+
+    if (dthread_create(&wheel->driver, NULL) != 0)
+    {
+        dthread_cond_destroy(&wheel->done);
+        dthread_cond_destroy(&wheel->cond);
+        dthread_mutex_destroy(&wheel->mutex);
+        return 1;
+    }
+
+    return 0;
+}
+
+int dthread_timer_wheel_destroy(DThreadTimerWheel* wheel)
+{
+    dthread_debug("dthread_timer_wheel_destroy");
+
+    assert(wheel && "`wheel` cannot be NULL in dthread_timer_wheel_destroy");
+
+    dthread_mutex_lock(&wheel->mutex);
+    wheel->stop = 1;
+    dthread_cond_signal(&wheel->cond);
+    dthread_mutex_unlock(&wheel->mutex);
+
+    int result = dthread_join(&wheel->driver) != 0;
+
+    // the periodic callbacks on the pool still re-arm their timers on this wheel
+    dthread_mutex_lock(&wheel->mutex);
+    while (wheel->running > 0)
+        dthread_cond_wait(&wheel->done, &wheel->mutex);
+    dthread_mutex_unlock(&wheel->mutex);
+
+    // the dropped timers can be started again on another wheel
+    for (int level = 0; level < DTHREAD_TIMER_LEVELS; ++level)
+    {
+        for (int slot = 0; slot < DTHREAD_TIMER_SLOTS; ++slot)
+        {
+            while (wheel->slots[level][slot])
+                _dthread_timer_unlink(wheel, wheel->slots[level][slot]);
+        }
+    }
+
+    while (wheel->expired)
+        _dthread_timer_unlink(wheel, wheel->expired);
+
+    dthread_cond_destroy(&wheel->done);
+    dthread_cond_destroy(&wheel->cond);
+    dthread_mutex_destroy(&wheel->mutex);
+
+    return result;
+}
+
+int dthread_timer_start(DThreadTimerWheel* wheel, DThreadTimer* timer, uint64_t delay_ns, uint64_t period_ns)
+{
+    dthread_debug("dthread_timer_start");
+
+    assert(wheel && "`wheel` cannot be NULL in dthread_timer_start");
+    assert(timer && "`timer` cannot be NULL in dthread_timer_start");
+    assert(timer->callback && "`timer->callback` cannot be NULL in dthread_timer_start");
+
+    uint64_t now = dthread_now_ns();
+
+    dthread_mutex_lock(&wheel->mutex);
+
+    if (timer->pending || timer->running)
+    {
+        if (timer->wheel != wheel)
+        {
+            dthread_mutex_unlock(&wheel->mutex);
+            return 1;
+        }
+
+        if (timer->pending)
+            _dthread_timer_unlink(wheel, timer);
+    }
+
+    // the driver only keeps the wheel in sync while it holds timers
+    if (wheel->count == 0)
+        _dthread_timer_advance(wheel, (now - wheel->start_ns) / wheel->tick_ns);
+
+    timer->wheel = wheel;
+    timer->expires_ns = now + delay_ns;
+    timer->period_ns = period_ns;
+    timer->tick = _dthread_timer_tick_of(wheel, timer->expires_ns);
+
+    // the running callback links it when it returns
+    if (timer->running)
+    {
+        timer->cancelled = 0;
+        timer->restarted = 1;
+
+        dthread_mutex_unlock(&wheel->mutex);
+        return 0;
+    }
+
+    _dthread_timer_link(wheel, timer);
+
+    if (wheel->start_ns + timer->tick * wheel->tick_ns < wheel->wake_ns)
+        dthread_cond_signal(&wheel->cond);
+
+    dthread_mutex_unlock(&wheel->mutex);
+
+    return 0;
+}
+
+int dthread_timer_cancel(DThreadTimerWheel* wheel, DThreadTimer* timer)
+{
+    dthread_debug("dthread_timer_cancel");
+
+    assert(wheel && "`wheel` cannot be NULL in dthread_timer_cancel");
+    assert(timer && "`timer` cannot be NULL in dthread_timer_cancel");
+
+    dthread_mutex_lock(&wheel->mutex);
+
+    int result = 1;
+
+    if (timer->pending && timer->wheel == wheel)
+    {
+        _dthread_timer_unlink(wheel, timer);
+        result = 0;
+    }
+    else if (timer->running && timer->wheel == wheel)
+    {
+        timer->cancelled = 1;
+        timer->restarted = 0;
+        result = 0;
+
+        // the callback itself cannot wait for its own return
+        while (timer->running && _dthread_timer_current != timer)
+            dthread_cond_wait(&wheel->done, &wheel->mutex);
+    }
+
+    dthread_mutex_unlock(&wheel->mutex);
+
+    return result;
+}
@@ -0,0 +1,298 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _tls.c
+//    Date: 2024-09-06
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+// passes over the keys of an exiting thread, destructors may set values again
+#define _DTHREAD_TLS_DESTRUCTOR_PASSES 4
+
+DTHREAD_THREAD_LOCAL int _dthread_tls_index = 0;
+DTHREAD_THREAD_LOCAL _DThreadTLSBlock* _dthread_tls_block = NULL;
+static DTHREAD_THREAD_LOCAL int _dthread_tls_watched = 0;
+
+static struct
+{
+    DThreadKeyDestructor destructor;
+    uint64_t seq;
+    int used;
+} _dthread_tls_keys[DTHREAD_KEYS_MAX];
+
+static uint64_t _dthread_tls_next_seq = 0;
+
+// one bit per index, set while a live thread holds it
+static uint64_t* _dthread_tls_used = NULL;
+static int _dthread_tls_words = 0;
+static int _dthread_tls_limit = 0;
+
+static void _dthread_tls_thread_exit(void* unused);
+
+#if defined(_WIN32) || defined(_WIN64)
+
+static SRWLOCK _dthread_tls_mutex = SRWLOCK_INIT;
+static INIT_ONCE _dthread_tls_once = INIT_ONCE_STATIC_INIT;
+static DWORD _dthread_tls_exit_key = FLS_OUT_OF_INDEXES;
+
+#define _dthread_tls_lock() AcquireSRWLockExclusive(&_dthread_tls_mutex)
+#define _dthread_tls_unlock() ReleaseSRWLockExclusive(&_dthread_tls_mutex)
+
+static VOID WINAPI _dthread_tls_fls_callback(PVOID value)
+{
+    if (value)
+        _dthread_tls_thread_exit(value);
+}
+
+static BOOL CALLBACK _dthread_tls_init_once(PINIT_ONCE once, PVOID param, PVOID* context)
+{
+    (void)once;
+    (void)param;
+    (void)context;
+
+    _dthread_tls_exit_key = FlsAlloc(_dthread_tls_fls_callback);
+
+    return _dthread_tls_exit_key != FLS_OUT_OF_INDEXES;
+}
+
+// the fiber local value only exists to get a callback when the thread exits
+static void _dthread_tls_watch(void)
+{
+    if (_dthread_tls_watched)
+        return;
+
+    if (InitOnceExecuteOnce(&_dthread_tls_once, _dthread_tls_init_once, NULL, NULL))
+        _dthread_tls_watched = FlsSetValue(_dthread_tls_exit_key, (PVOID)1) ? 1 : 0;
+}
+
+#else
+
+static pthread_mutex_t _dthread_tls_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t _dthread_tls_once = PTHREAD_ONCE_INIT;
+static pthread_key_t _dthread_tls_exit_key;
+static int _dthread_tls_exit_key_ok = 0;
+
+#define _dthread_tls_lock() pthread_mutex_lock(&_dthread_tls_mutex)
+#define _dthread_tls_unlock() pthread_mutex_unlock(&_dthread_tls_mutex)
+
+static void _dthread_tls_init_once(void)
+{
+    _dthread_tls_exit_key_ok = pthread_key_create(&_dthread_tls_exit_key, _dthread_tls_thread_exit) == 0;
+}
+
+// the pthread key value only exists to get a callback when the thread exits
+static void _dthread_tls_watch(void)
+{
+    if (_dthread_tls_watched)
+        return;
+
+    pthread_once(&_dthread_tls_once, _dthread_tls_init_once);
+
+    if (_dthread_tls_exit_key_ok)
+        _dthread_tls_watched = pthread_setspecific(_dthread_tls_exit_key, (void*)1) == 0;
+}
+
+#endif
+
+static void _dthread_tls_thread_exit(void* unused)
+{
+    (void)unused;
+
+    _DThreadTLSBlock* block = _dthread_tls_block;
+
+    for (int pass = 0; block && pass < _DTHREAD_TLS_DESTRUCTOR_PASSES; ++pass)
+    {
+        int called = 0;
+
+        for (int slot = 0; slot < DTHREAD_KEYS_MAX; ++slot)
+        {
+            void* value = block->values[slot];
+            if (!value)
+                continue;
+
+            block->values[slot] = NULL;
+
+            _dthread_tls_lock();
+            DThreadKeyDestructor destructor = (_dthread_tls_keys[slot].used && _dthread_tls_keys[slot].seq == block->seqs[slot])
+                                                  ? _dthread_tls_keys[slot].destructor
+                                                  : NULL;
+            _dthread_tls_unlock();
+
+            if (destructor)
+            {
+                destructor(value);
+                called = 1;
+            }
+        }
+
+        if (!called)
+            break;
+    }
+
+    free(block);
+    _dthread_tls_block = NULL;
+
+    // last, a destructor may still have asked for the index
+    if (_dthread_tls_index)
+    {
+        int index = _dthread_tls_index - 1;
+
+        _dthread_tls_lock();
+        _dthread_tls_used[index / 64] &= ~(1ull << (index % 64));
+        _dthread_tls_unlock();
+
+        _dthread_tls_index = 0;
+    }
+}
+
+int _dthread_index_assign(void)
+{
+    dthread_debug("_dthread_index_assign");
+
+    _dthread_tls_watch();
+
+    int index = -1;
+
+    _dthread_tls_lock();
+
+    for (int word = 0; word < _dthread_tls_words && index < 0; ++word)
+    {
+        uint64_t free_bits = ~_dthread_tls_used[word];
+        if (!free_bits)
+            continue;
+
+        int bit = 0;
+        while (!(free_bits & (1ull << bit)))
+            bit++;
+
+        index = word * 64 + bit;
+    }
+
+    if (index < 0)
+    {
+        int words = _dthread_tls_words ? _dthread_tls_words * 2 : 1;
+        uint64_t* used = (uint64_t*)realloc(_dthread_tls_used, (size_t)words * sizeof(uint64_t));
+
+        if (used)
+        {
+            memset(used + _dthread_tls_words, 0, (size_t)(words - _dthread_tls_words) * sizeof(uint64_t));
+            index = _dthread_tls_words * 64;
+
+            _dthread_tls_used = used;
+            _dthread_tls_words = words;
+        }
+    }
+
+    if (index >= 0)
+    {
+        _dthread_tls_used[index / 64] |= 1ull << (index % 64);
+
+        if (index >= _dthread_tls_limit)
+            _dthread_tls_limit = index + 1;
+
+        _dthread_tls_index = index + 1;
+    }
+
+    _dthread_tls_unlock();
+
+    return index;
+}
+
+int dthread_index_limit(void)
+{
+    dthread_debug("dthread_index_limit");
+
+    _dthread_tls_lock();
+    int limit = _dthread_tls_limit;
+    _dthread_tls_unlock();
+
+    return limit;
+}
+
+int dthread_key_create(DThreadKey* key, DThreadKeyDestructor destructor)
+{
+    dthread_debug("dthread_key_create");
+
+    assert(key && "`key` cannot be NULL in dthread_key_create");
+
+    int result = 1;
+
+    _dthread_tls_lock();
+
+    for (int slot = 0; slot < DTHREAD_KEYS_MAX; ++slot)
+    {
+        if (_dthread_tls_keys[slot].used)
+            continue;
+
+        // a fresh sequence number hides the values left behind by a deleted key
+        _dthread_tls_keys[slot].used = 1;
+        _dthread_tls_keys[slot].seq = ++_dthread_tls_next_seq;
+        _dthread_tls_keys[slot].destructor = destructor;
+
+        key->slot = slot;
+        key->seq = _dthread_tls_keys[slot].seq;
+        result = 0;
+        break;
+    }
+
+    _dthread_tls_unlock();
+
+    return result;
+}
+
+int dthread_key_delete(DThreadKey* key)
+{
+    dthread_debug("dthread_key_delete");
+
+    assert(key && "`key` cannot be NULL in dthread_key_delete");
+
+    int result = 1;
+
+    _dthread_tls_lock();
+
+    if (key->slot >= 0 && key->slot < DTHREAD_KEYS_MAX && _dthread_tls_keys[key->slot].used &&
+        _dthread_tls_keys[key->slot].seq == key->seq)
+    {
+        _dthread_tls_keys[key->slot].used = 0;
+        _dthread_tls_keys[key->slot].destructor = NULL;
+        result = 0;
+    }
+
+    _dthread_tls_unlock();
+
+    return result;
+}
+
+int dthread_key_set(DThreadKey* key, void* value)
+{
+    dthread_debug("dthread_key_set");
+
+    assert(key && "`key` cannot be NULL in dthread_key_set");
+
+    if (key->slot < 0 || key->slot >= DTHREAD_KEYS_MAX)
+        return 1;
+
+    if (!_dthread_tls_block)
+    {
+        _dthread_tls_block = (_DThreadTLSBlock*)calloc(1, sizeof(_DThreadTLSBlock));
+        if (!_dthread_tls_block)
+            return 1;
+
+        _dthread_tls_watch();
+    }
+
+    _dthread_tls_block->values[key->slot] = value;
+    _dthread_tls_block->seqs[key->slot] = key->seq;
+
+    return 0;
+}
@@ -0,0 +1,524 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: _topology.c
+//    Date: 2024-08-29
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: DO NOT LINK TO THIS FILE DIRECTLY REFER TO README
+// ***************************************************************************************
+
+#include "_headers/common.h"
+#include "dthread.h"
+
+// while discovering, every CPU gets a key per kind of group (-1 for unknown), CPUs with
+// equal keys end up in the same group
+typedef struct
+{
+    int* core;
+    int* l2;
+    int* l3;
+    int* node;
+    size_t* l2_size;
+    size_t* l3_size;
+} _DThreadTopologyKeys;
+
+// groups the CPUs by key and replaces every key with the index of the CPU's group
+static int _dthread_topology_group(DThreadTopology* topo, int* keys, const size_t* sizes,
+                                   DThreadTopologyGroup** out_groups, int* out_count)
+{
+    int n = topo->num_cpus;
+    int count = 0;
+    int* dense = (int*)malloc((size_t)n * sizeof(int));
+    if (!dense)
+        return 1;
+
+    for (int i = 0; i < n; ++i)
+    {
+        dense[i] = -1;
+        if (keys[i] < 0)
+            continue;
+
+        for (int j = 0; j < i && dense[i] < 0; ++j)
+        {
+            if (keys[j] == keys[i])
+                dense[i] = dense[j];
+        }
+
+        if (dense[i] < 0)
+            dense[i] = count++;
+    }
+
+    DThreadTopologyGroup* groups = count ? (DThreadTopologyGroup*)calloc((size_t)count, sizeof(DThreadTopologyGroup)) : NULL;
+    if (count && !groups)
+    {
+        free(dense);
+        return 1;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        keys[i] = dense[i];
+        if (dense[i] >= 0)
+            groups[dense[i]].num_cpus++;
+    }
+
+    for (int g = 0; g < count; ++g)
+    {
+        groups[g].cpus = (int*)malloc((size_t)groups[g].num_cpus * sizeof(int));
+        if (!groups[g].cpus)
+        {
+            for (int k = 0; k < g; ++k)
+                free(groups[k].cpus);
+            free(groups);
+            free(dense);
+            return 1;
+        }
+
+        groups[g].num_cpus = 0;
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        if (dense[i] < 0)
+            continue;
+
+        DThreadTopologyGroup* group = &groups[dense[i]];
+        if (group->num_cpus == 0 && sizes)
+            group->cache_size = sizes[i];
+
+        group->cpus[group->num_cpus++] = i;
+    }
+
+    free(dense);
+
+    *out_groups = groups;
+    *out_count = count;
+
+    return 0;
+}
+
+static void _dthread_topology_free_groups(DThreadTopologyGroup* groups, int count)
+{
+    for (int g = 0; g < count; ++g)
+        free(groups[g].cpus);
+
+    free(groups);
+}
+
+#if defined(__linux__)
+
+static int _dthread_topology_read(const char* path, char* buffer, size_t size)
+{
+    FILE* file = fopen(path, "r");
+    if (!file)
+        return 1;
+
+    size_t len = fread(buffer, 1, size - 1, file);
+    fclose(file);
+
+    while (len > 0 && (buffer[len - 1] == '\n' || buffer[len - 1] == ' '))
+        len--;
+    buffer[len] = '\0';
+
+    return len == 0;
+}
+
+// parses kernel cpu lists like "0-3,8,10-11", returns the number of ids written to `out`
+static int _dthread_topology_parse_list(const char* text, int* out, int max)
+{
+    int count = 0;
+
+    while (*text)
+    {
+        char* end;
+        long first = strtol(text, &end, 10);
+        if (end == text)
+            break;
+
+        long last = first;
+        if (*end == '-')
+        {
+            text = end + 1;
+            last = strtol(text, &end, 10);
+        }
+
+        for (long id = first; id <= last; ++id)
+        {
+            if (out && count < max)
+                out[count] = (int)id;
+            count++;
+        }
+
+        text = (*end == ',') ? end + 1 : end;
+    }
+
+    return count;
+}
+
+static size_t _dthread_topology_parse_size(const char* text)
+{
+    char* end;
+    size_t size = (size_t)strtoull(text, &end, 10);
+
+    if (*end == 'K')
+        size *= 1024;
+    else if (*end == 'M')
+        size *= 1024 * 1024;
+
+    return size;
+}
+
+static int _dthread_topology_discover(DThreadTopology* topo, _DThreadTopologyKeys* keys)
+{
+    char path[256];
+    char text[4096];
+
+    for (int i = 0; i < topo->num_cpus; ++i)
+    {
+        int id = topo->cpus[i].id;
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/physical_package_id", id);
+        if (_dthread_topology_read(path, text, sizeof(text)) == 0)
+            topo->cpus[i].package = atoi(text);
+
+        snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/topology/core_id", id);
+        if (_dthread_topology_read(path, text, sizeof(text)) == 0)
+            keys->core[i] = (topo->cpus[i].package << 16) | (atoi(text) & 0xffff);
+        else
+            keys->core[i] = id;
+
+        for (int index = 0;; ++index)
+        {
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/level", id, index);
+            if (_dthread_topology_read(path, text, sizeof(text)) != 0)
+                break;
+
+            int level = atoi(text);
+            if (level != 2 && level != 3)
+                continue;
+
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/type", id, index);
+            if (_dthread_topology_read(path, text, sizeof(text)) == 0 && strcmp(text, "Instruction") == 0)
+                continue;
+
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/shared_cpu_list", id, index);
+            if (_dthread_topology_read(path, text, sizeof(text)) != 0)
+                continue;
+
+            // the lowest CPU sharing the cache identifies the cache
+            int first = id;
+            _dthread_topology_parse_list(text, &first, 1);
+
+            size_t size = 0;
+            snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/cache/index%d/size", id, index);
+            if (_dthread_topology_read(path, text, sizeof(text)) == 0)
+                size = _dthread_topology_parse_size(text);
+
+            if (level == 2)
+            {
+                keys->l2[i] = first;
+                keys->l2_size[i] = size;
+            }
+            else
+            {
+                keys->l3[i] = first;
+                keys->l3_size[i] = size;
+            }
+        }
+    }
+
+    if (_dthread_topology_read("/sys/devices/system/node/online", text, sizeof(text)) == 0)
+    {
+        int num_nodes = _dthread_topology_parse_list(text, NULL, 0);
+        int* nodes = (int*)malloc((size_t)num_nodes * sizeof(int));
+        int* cpus = (int*)malloc(4096 * sizeof(int));
+
+        if (nodes && cpus)
+        {
+            _dthread_topology_parse_list(text, nodes, num_nodes);
+
+            for (int k = 0; k < num_nodes; ++k)
+            {
+                snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", nodes[k]);
+                if (_dthread_topology_read(path, text, sizeof(text)) != 0)
+                    continue;
+
+                int count = _dthread_topology_parse_list(text, cpus, 4096);
+                for (int c = 0; c < count && c < 4096; ++c)
+                {
+                    int i = dthread_topology_find(topo, cpus[c]);
+                    if (i >= 0)
+                        keys->node[i] = nodes[k];
+                }
+            }
+        }
+
+        free(nodes);
+        free(cpus);
+    }
+
+    return 0;
+}
+
+static int _dthread_topology_online(int** ids)
+{
+    char text[4096];
+
+    if (_dthread_topology_read("/sys/devices/system/cpu/online", text, sizeof(text)) != 0)
+        return 0;
+
+    int count = _dthread_topology_parse_list(text, NULL, 0);
+    *ids = (int*)malloc((size_t)count * sizeof(int));
+    if (!*ids)
+        return 0;
+
+    return _dthread_topology_parse_list(text, *ids, count);
+}
+
+#elif defined(_WIN32) || defined(_WIN64)
+
+static int _dthread_topology_lowest_bit(ULONG_PTR mask)
+{
+    for (int bit = 0; bit < (int)(8 * sizeof(ULONG_PTR)); ++bit)
+    {
+        if (mask & ((ULONG_PTR)1 << bit))
+            return bit;
+    }
+
+    return -1;
+}
+
+static int _dthread_topology_discover(DThreadTopology* topo, _DThreadTopologyKeys* keys)
+{
+    DWORD length = 0;
+    GetLogicalProcessorInformation(NULL, &length);
+
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION* info = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)malloc(length);
+    if (!info)
+        return 1;
+
+    if (!GetLogicalProcessorInformation(info, &length))
+    {
+        free(info);
+        return 1;
+    }
+
+    DWORD count = length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION);
+
+    for (DWORD k = 0; k < count; ++k)
+    {
+        ULONG_PTR mask = info[k].ProcessorMask;
+        int first = _dthread_topology_lowest_bit(mask);
+
+        for (int i = 0; i < topo->num_cpus; ++i)
+        {
+            int id = topo->cpus[i].id;
+            if (id >= (int)(8 * sizeof(ULONG_PTR)) || !(mask & ((ULONG_PTR)1 << id)))
+                continue;
+
+            switch (info[k].Relationship)
+            {
+            case RelationProcessorCore:
+                keys->core[i] = first;
+                break;
+
+            case RelationProcessorPackage:
+                topo->cpus[i].package = first;
+                break;
+
+            case RelationNumaNode:
+                keys->node[i] = (int)info[k].NumaNode.NodeNumber;
+                break;
+
+            case RelationCache:
+                if (info[k].Cache.Type == CacheInstruction)
+                    break;
+
+                if (info[k].Cache.Level == 2)
+                {
+                    keys->l2[i] = first;
+                    keys->l2_size[i] = info[k].Cache.Size;
+                }
+                else if (info[k].Cache.Level == 3)
+                {
+                    keys->l3[i] = first;
+                    keys->l3_size[i] = info[k].Cache.Size;
+                }
+                break;
+
+            default:
+                break;
+            }
+        }
+    }
+
+    free(info);
+
+    return 0;
+}
+
+static int _dthread_topology_online(int** ids)
+{
+    (void)ids;
+
+    return 0;
+}
+
+#else
+
+static int _dthread_topology_discover(DThreadTopology* topo, _DThreadTopologyKeys* keys)
+{
+    (void)topo;
+    (void)keys;
+
+    return 0;
+}
+
+static int _dthread_topology_online(int** ids)
+{
+    (void)ids;
+
+    return 0;
+}
+
+#endif
+
+int dthread_topology_init(DThreadTopology* topo)
+{
+    dthread_debug("dthread_topology_init");
+
+    assert(topo && "`topo` cannot be NULL in dthread_topology_init");
+
+    memset(topo, 0, sizeof(*topo));
+
+    int* ids = NULL;
+    int n = _dthread_topology_online(&ids);
+
+    if (n <= 0)
+    {
+        // no list of online CPUs, assume they are numbered contiguously
+        n = dthread_cpu_count();
+        ids = (int*)malloc((size_t)n * sizeof(int));
+        if (!ids)
+            return 1;
+
+        for (int i = 0; i < n; ++i)
+            ids[i] = i;
+    }
+
+    topo->num_cpus = n;
+    topo->cpus = (DThreadTopologyCPU*)calloc((size_t)n, sizeof(DThreadTopologyCPU));
+
+    _DThreadTopologyKeys keys;
+    keys.core = (int*)malloc((size_t)n * sizeof(int));
+    keys.l2 = (int*)malloc((size_t)n * sizeof(int));
+    keys.l3 = (int*)malloc((size_t)n * sizeof(int));
+    keys.node = (int*)malloc((size_t)n * sizeof(int));
+    keys.l2_size = (size_t*)calloc((size_t)n, sizeof(size_t));
+    keys.l3_size = (size_t*)calloc((size_t)n, sizeof(size_t));
+
+    int result = !topo->cpus || !keys.core || !keys.l2 || !keys.l3 || !keys.node || !keys.l2_size || !keys.l3_size;
+
+    if (result == 0)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            topo->cpus[i].id = ids[i];
+            keys.core[i] = ids[i];
+            keys.l2[i] = keys.l3[i] = -1;
+            keys.node[i] = 0;
+        }
+
+        result = _dthread_topology_discover(topo, &keys);
+    }
+
+    if (result == 0)
+        result = _dthread_topology_group(topo, keys.core, NULL, &topo->cores, &topo->num_cores) ||
+                 _dthread_topology_group(topo, keys.l2, keys.l2_size, &topo->l2, &topo->num_l2) ||
+                 _dthread_topology_group(topo, keys.l3, keys.l3_size, &topo->l3, &topo->num_l3) ||
+                 _dthread_topology_group(topo, keys.node, NULL, &topo->nodes, &topo->num_nodes);
+
+    if (result == 0)
+    {
+        for (int i = 0; i < n; ++i)
+        {
+            topo->cpus[i].core = keys.core[i];
+            topo->cpus[i].l2 = keys.l2[i];
+            topo->cpus[i].l3 = keys.l3[i];
+            topo->cpus[i].node = keys.node[i];
+        }
+
+        for (int c = 0; c < topo->num_cores; ++c)
+        {
+            for (int k = 0; k < topo->cores[c].num_cpus; ++k)
+                topo->cpus[topo->cores[c].cpus[k]].smt = k;
+        }
+    }
+
+    free(ids);
+    free(keys.core);
+    free(keys.l2);
+    free(keys.l3);
+    free(keys.node);
+    free(keys.l2_size);
+    free(keys.l3_size);
+
+    if (result != 0)
+        dthread_topology_destroy(topo);
+
+    return result;
+}
+
+void dthread_topology_destroy(DThreadTopology* topo)
+{
+    dthread_debug("dthread_topology_destroy");
+
+    _dthread_topology_free_groups(topo->cores, topo->num_cores);
+    _dthread_topology_free_groups(topo->l2, topo->num_l2);
+    _dthread_topology_free_groups(topo->l3, topo->num_l3);
+    _dthread_topology_free_groups(topo->nodes, topo->num_nodes);
+
+    free(topo->cpus);
+
+    memset(topo, 0, sizeof(*topo));
+}
+
+int dthread_topology_find(DThreadTopology* topo, int id)
+{
+    for (int i = 0; i < topo->num_cpus; ++i)
+    {
+        if (topo->cpus[i].id == id)
+            return i;
+    }
+
+    return -1;
+}
+
+int dthread_topology_distance(DThreadTopology* topo, int a, int b)
+{
+    DThreadTopologyCPU* x = &topo->cpus[a];
+    DThreadTopologyCPU* y = &topo->cpus[b];
+
+    if (a == b)
+        return 0;
+
+    if (x->core >= 0 && x->core == y->core)
+        return 1;
+
+    if (x->l2 >= 0 && x->l2 == y->l2)
+        return 2;
+
+    if (x->l3 >= 0 && x->l3 == y->l3)
+        return 3;
+
+    if (x->node >= 0 && x->node == y->node)
+        return 4;
+
+    return 5;
+}
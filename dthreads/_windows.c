@@ -29,24 +29,155 @@ DWORD WINAPI _dthread_winapi_function_wrapper(void* data)
     return 0;
 }
 
+typedef struct
+{
+    DThread* thread;
+    int priority;
+    size_t prefault;
+    int lock_memory;
+} _DThreadProfile;
+
+// touches every page of a stack region right below the caller's frame so that the
+// thread routine never takes a page fault on first touch of that much stack
+static __declspec(noinline) void _dthread_prefault_stack(size_t size, int lock_memory, uintptr_t* region_out)
+{
+    volatile char* region = (volatile char*)_alloca(size);
+
+    for (size_t i = 0; i < size; i += 4096)
+        region[i] = 0;
+    region[size - 1] = 0;
+
+    if (lock_memory)
+        VirtualLock((LPVOID)region, size);
+
+    *region_out = (uintptr_t)region;
+}
+
+DWORD WINAPI _dthread_winapi_profile_wrapper(void* data)
+{
+    _DThreadProfile profile = *(_DThreadProfile*)data;
+    free(data);
+
+    if (profile.priority)
+        SetThreadPriority(GetCurrentThread(), profile.priority);
+
+    uintptr_t region = 0;
+    if (profile.prefault)
+        _dthread_prefault_stack(profile.prefault, profile.lock_memory, &region);
+
+    profile.thread->_result = profile.thread->_func(profile.thread->_data);
+
+    if (region && profile.lock_memory)
+        VirtualUnlock((LPVOID)region, profile.prefault);
+
+    return 0;
+}
+
+// the stack reserved for new threads by the executable, used when no size is given
+static size_t _dthread_default_stack_reserve(void)
+{
+    PIMAGE_DOS_HEADER dos = (PIMAGE_DOS_HEADER)GetModuleHandle(NULL);
+    PIMAGE_NT_HEADERS nt = (PIMAGE_NT_HEADERS)((BYTE*)dos + dos->e_lfanew);
+
+    return (size_t)nt->OptionalHeader.SizeOfStackReserve;
+}
+
+int dthread_attr_prepare(DThreadPreparedAttr* prepared, DThreadAttr* attr)
+{
+    dthread_debug("dthread_attr_prepare");
+
+    assert(prepared && "`prepared` cannot be NULL in dthread_attr_prepare");
+
+    prepared->stacksize = attr ? attr->stacksize : 0;
+    prepared->dwCreationFlags = attr ? (DWORD)attr->dwCreationFlags : 0;
+    prepared->priority = attr ? attr->priority : 0;
+    prepared->prefault = attr ? attr->prefault : 0;
+    prepared->lock_memory = attr ? attr->lock_memory : 0;
+
+    // the pre-faulted region lives on the new stack, the routine needs room on top of it
+    if (prepared->prefault)
+    {
+        size_t stacksize = _dthread_default_stack_reserve();
+
+        if (prepared->dwCreationFlags & STACK_SIZE_PARAM_IS_A_RESERVATION)
+            stacksize = prepared->stacksize ? prepared->stacksize : stacksize;
+        else if (prepared->stacksize > stacksize)
+            stacksize = prepared->stacksize;
+
+        if (stacksize <= DTHREAD_PREFAULT_MARGIN || prepared->prefault > stacksize - DTHREAD_PREFAULT_MARGIN)
+            return 1;
+    }
+
+    return 0;
+}
+
+int dthread_attr_release(DThreadPreparedAttr* prepared)
+{
+    dthread_debug("dthread_attr_release");
+
+    (void)prepared;
+
+    return 0;
+}
+
+int dthread_create_prepared(DThread* thread, DThreadPreparedAttr* prepared)
+{
+    dthread_debug("dthread_create_prepared");
+
+    assert(thread && "`thread` cannot be NULL in dthread_create_prepared");
+
+    // a plain thread, `dthread_set_func` style setups never touch the spawn slot
+    thread->_slot = NULL;
+
+    if (!prepared)
+    {
+        thread->handle = CreateThread(NULL, 0, _dthread_winapi_function_wrapper, thread, 0, NULL);
+        return thread->handle == NULL;
+    }
+
+    if (!prepared->priority && !prepared->prefault)
+    {
+        thread->handle = CreateThread(NULL, prepared->stacksize, _dthread_winapi_function_wrapper, thread, prepared->dwCreationFlags, NULL);
+        return thread->handle == NULL;
+    }
+
+    _DThreadProfile* profile = (_DThreadProfile*)malloc(sizeof(_DThreadProfile));
+    if (!profile)
+        return 1;
+
+    profile->thread = thread;
+    profile->priority = prepared->priority;
+    profile->prefault = prepared->prefault;
+    profile->lock_memory = prepared->lock_memory;
+
+    thread->handle = CreateThread(NULL, prepared->stacksize, _dthread_winapi_profile_wrapper, profile, prepared->dwCreationFlags, NULL);
+    if (thread->handle == NULL)
+        free(profile);
+
+    return thread->handle == NULL;
+}
+
 int dthread_create(DThread* thread, DThreadAttr* attr)
 {
     dthread_debug("dthread_create");
 
     assert(thread && "`thread` cannot be NULL in dthread_create");
 
-    if (attr)
-        thread->handle = CreateThread(NULL, attr->stacksize ? attr->stacksize : 0, _dthread_winapi_function_wrapper, thread, attr->dwCreationFlags ? (DWORD)attr->dwCreationFlags : 0, NULL);
-    else
-        thread->handle = CreateThread(NULL, 0, _dthread_winapi_function_wrapper, thread, 0, NULL);
+    DThreadPreparedAttr prepared;
 
-    return thread->handle == NULL;
+    if (dthread_attr_prepare(&prepared, attr))
+        return 1;
+
+    return dthread_create_prepared(thread, &prepared);
 }
 
 int dthread_detach(DThread* thread)
 {
     dthread_debug("dthread_detach");
 
+    if (thread->_slot)
+        return _dthread_spawn_detach(thread);
+
     return !CloseHandle(thread->handle);
 }
 
@@ -54,7 +185,19 @@ int dthread_join(DThread* thread)
 {
     dthread_debug("dthread_join");
 
+    if (thread->_slot)
+    {
+        dthread_blocking_begin();
+        int result = _dthread_spawn_join(thread);
+        dthread_blocking_end();
+
+        return result;
+    }
+
+    dthread_blocking_begin();
     DWORD wait_result = WaitForSingleObject(thread->handle, INFINITE);
+    dthread_blocking_end();
+
     if (wait_result != WAIT_OBJECT_0)
     {
         dthread_debug_args("dthread_join: WaitForSingleObject failed, result: %lu", wait_result);
@@ -68,6 +211,149 @@ int dthread_join(DThread* thread)
     return !CloseHandle(thread->handle);
 }
 
+// threads of `dthread_create_many` wait here until the whole group exists, a failed group
+// is released without running any routine
+typedef struct
+{
+    DThreadMutex mutex;
+    DThreadCond cond;
+    size_t arrived;
+    size_t left;
+    int state;
+} _DThreadStartGate;
+
+typedef struct
+{
+    _DThreadStartGate* gate;
+    DThreadRoutine func;
+    void* data;
+} _DThreadGated;
+
+static dthread_define_routine(_dthread_gated_trampoline)
+{
+    _DThreadGated gated = *(_DThreadGated*)data;
+    _DThreadStartGate* gate = gated.gate;
+
+    dthread_mutex_lock(&gate->mutex);
+
+    gate->arrived++;
+    dthread_cond_broadcast(&gate->cond);
+
+    while (gate->state == 0)
+        dthread_cond_wait(&gate->cond, &gate->mutex);
+
+    int run = gate->state > 0;
+
+    gate->left++;
+    dthread_cond_broadcast(&gate->cond);
+
+    dthread_mutex_unlock(&gate->mutex);
+
+    return run ? gated.func(gated.data) : NULL;
+}
+
+int dthread_create_many(DThread* threads, size_t n, DThreadAttr* attr)
+{
+    dthread_debug("dthread_create_many");
+
+    assert((threads || n == 0) && "`threads` cannot be NULL in dthread_create_many");
+
+    if (n == 0)
+        return 0;
+
+    DThreadPreparedAttr prepared;
+
+    if (dthread_attr_prepare(&prepared, attr))
+        return 1;
+
+    _DThreadStartGate gate;
+    _DThreadGated* gated = (_DThreadGated*)malloc(n * sizeof(_DThreadGated));
+
+    if (!gated || dthread_mutex_init(&gate.mutex, NULL) != 0)
+    {
+        free(gated);
+        dthread_attr_release(&prepared);
+        return 1;
+    }
+
+    if (dthread_cond_init(&gate.cond, NULL) != 0)
+    {
+        dthread_mutex_destroy(&gate.mutex);
+        free(gated);
+        dthread_attr_release(&prepared);
+        return 1;
+    }
+
+    gate.arrived = gate.left = 0;
+    gate.state = 0;
+
+    size_t i = 0;
+    for (; i < n; ++i)
+    {
+        gated[i].gate = &gate;
+        gated[i].func = threads[i]._func;
+        gated[i].data = threads[i]._data;
+
+        threads[i]._func = _dthread_gated_trampoline;
+        threads[i]._data = &gated[i];
+
+        if (dthread_create_prepared(&threads[i], &prepared) != 0)
+        {
+            threads[i]._func = gated[i].func;
+            threads[i]._data = gated[i].data;
+            break;
+        }
+    }
+
+    dthread_attr_release(&prepared);
+
+    dthread_mutex_lock(&gate.mutex);
+
+    // once arrived a thread no longer reads its `DThread`, the routine can be put back
+    while (gate.arrived < i)
+        dthread_cond_wait(&gate.cond, &gate.mutex);
+
+    for (size_t j = 0; j < i; ++j)
+    {
+        threads[j]._func = gated[j].func;
+        threads[j]._data = gated[j].data;
+    }
+
+    gate.state = i == n ? 1 : -1;
+    dthread_cond_broadcast(&gate.cond);
+
+    while (gate.left < i)
+        dthread_cond_wait(&gate.cond, &gate.mutex);
+
+    dthread_mutex_unlock(&gate.mutex);
+
+    dthread_cond_destroy(&gate.cond);
+    dthread_mutex_destroy(&gate.mutex);
+    free(gated);
+
+    if (i == n)
+        return 0;
+
+    dthread_join_all(threads, i);
+
+    return 1;
+}
+
+int dthread_join_all(DThread* threads, size_t n)
+{
+    dthread_debug("dthread_join_all");
+
+    int result = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        if (dthread_join(&threads[i]) != 0)
+            result = 1;
+    }
+
+    return result;
+}
+
 int dthread_equal(DThread* thread1, DThread* thread2)
 {
     dthread_debug("dthread_equal");
@@ -104,9 +390,33 @@ int dthread_cancel(DThread* thread)
 {
     dthread_debug("dthread_cancel");
 
+    // cached threads outlive their routines, they cannot be cancelled
+    if (thread->_slot)
+        return 1;
+
     return !TerminateThread(thread->handle, 0);
 }
 
+int dthread_cpu_count(void)
+{
+    dthread_debug("dthread_cpu_count");
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+int dthread_affinity_set(int cpu)
+{
+    dthread_debug("dthread_affinity_set");
+
+    if (cpu < 0 || cpu >= (int)(8 * sizeof(DWORD_PTR)))
+        return 1;
+
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) == 0;
+}
+
 int dthread_mutex_init(DThreadMutex* mutex, DThreadMutexAttr* attr)
 {
     dthread_debug("dthread_mutex_init");
@@ -122,7 +432,13 @@ int dthread_mutex_lock(DThreadMutex* mutex)
 {
     dthread_debug("dthread_mutex_lock");
 
+    // only a contended lock is worth compensating for
+    if (TryEnterCriticalSection(&mutex->handle))
+        return 0;
+
+    dthread_blocking_begin();
     EnterCriticalSection(&mutex->handle);
+    dthread_blocking_end();
 
     return 0;
 }
@@ -194,7 +510,22 @@ int dthread_cond_wait(DThreadCond* cond, DThreadMutex* mutex)
 {
     dthread_debug("dthread_cond_wait");
 
-    return !SleepConditionVariableCS(&cond->handle, &mutex->handle, INFINITE);
+    dthread_blocking_begin();
+    int result = !SleepConditionVariableCS(&cond->handle, &mutex->handle, INFINITE);
+    dthread_blocking_end();
+
+    return result;
+}
+
+int dthread_cond_timedwait(DThreadCond* cond, DThreadMutex* mutex, uint32_t milliseconds)
+{
+    dthread_debug("dthread_cond_timedwait");
+
+    dthread_blocking_begin();
+    int result = !SleepConditionVariableCS(&cond->handle, &mutex->handle, milliseconds);
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_rwlock_init(DThreadRWLock* rwlock)
@@ -216,7 +547,12 @@ int dthread_rwlock_rdlock(DThreadRWLock* rwlock)
 {
     dthread_debug("dthread_rwlock_rdlock");
 
-    AcquireSRWLockShared(rwlock->handle);
+    if (!TryAcquireSRWLockShared(rwlock->handle))
+    {
+        dthread_blocking_begin();
+        AcquireSRWLockShared(rwlock->handle);
+        dthread_blocking_end();
+    }
 
     rwlock->type = 1;
 
@@ -244,7 +580,12 @@ int dthread_rwlock_wrlock(DThreadRWLock* rwlock)
 {
     dthread_debug("dthread_rwlock_wrlock");
 
-    AcquireSRWLockExclusive(rwlock->handle);
+    if (!TryAcquireSRWLockExclusive(rwlock->handle))
+    {
+        dthread_blocking_begin();
+        AcquireSRWLockExclusive(rwlock->handle);
+        dthread_blocking_end();
+    }
 
     rwlock->type = 2;
 
@@ -277,6 +618,8 @@ void dthread_barrier_wait(DThreadBarrier* barrier)
 {
     dthread_debug("dthread_barrier_wait");
 
+    dthread_blocking_begin();
+
     EnterCriticalSection(&barrier->cs);
     barrier->waiting++;
 
@@ -291,6 +634,8 @@ void dthread_barrier_wait(DThreadBarrier* barrier)
     }
 
     LeaveCriticalSection(&barrier->cs);
+
+    dthread_blocking_end();
 }
 
 void dthread_barrier_destroy(DThreadBarrier* barrier)
@@ -312,7 +657,11 @@ int dthread_semaphore_wait(DThreadSemaphore* semaphore)
 {
     dthread_debug("dthread_semaphore_wait");
 
-    return WaitForSingleObject(semaphore->handle, INFINITE) == WAIT_OBJECT_0 ? 0 : -1;
+    dthread_blocking_begin();
+    int result = WaitForSingleObject(semaphore->handle, INFINITE) == WAIT_OBJECT_0 ? 0 : -1;
+    dthread_blocking_end();
+
+    return result;
 }
 
 int dthread_semaphore_post(DThreadSemaphore* semaphore)
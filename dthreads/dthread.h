@@ -22,6 +22,7 @@
 #define DTHREAD_H_
 
 #include "_headers/api.h"
+#include "_headers/atomic.h"
 
 #include <time.h>
 
@@ -97,6 +98,8 @@ extern "C"
      * This structure holds the function pointer to the thread routine and its data.
      * It also holds the void pointer to the result
      */
+    struct _DThreadSpawnSlot;
+
     typedef struct
     {
         DThreadRoutine _func;
@@ -105,6 +108,8 @@ extern "C"
 
         _DThreadHandle handle;
 
+        struct _DThreadSpawnSlot* _slot;
+
     } DThread;
 
 /**
@@ -174,6 +179,62 @@ extern "C"
      */
     DTHREAD_API int dthread_create(DThread* thread, DThreadAttr* attr);
 
+    /**
+     * @brief Compiles thread attributes into a reusable prepared attribute object.
+     *
+     * Preparing the attributes once and creating many threads with `dthread_create_prepared`
+     * avoids rebuilding the native attributes for every thread.
+     *
+     * @param prepared A pointer to the prepared attribute object to be initialized.
+     * @param attr Optional thread attributes; can be NULL for default attributes.
+     * @return 0 on success, non-zero on failure.
+     */
+    DTHREAD_API int dthread_attr_prepare(DThreadPreparedAttr* prepared, DThreadAttr* attr);
+
+    /**
+     * @brief Releases the native resources held by a prepared attribute object.
+     *
+     * @param prepared A pointer to the prepared attribute object to release.
+     * @return 0 on success, non-zero on failure.
+     */
+    DTHREAD_API int dthread_attr_release(DThreadPreparedAttr* prepared);
+
+    /**
+     * @brief Creates a new thread using prepared attributes.
+     *
+     * @param thread A pointer to the DThread structure to be initialized.
+     * @param prepared Optional prepared attributes; can be NULL for default attributes.
+     * @return 0 on success, non-zero on failure.
+     */
+    DTHREAD_API int dthread_create_prepared(DThread* thread, DThreadPreparedAttr* prepared);
+
+    /**
+     * @brief Creates a group of threads sharing the same attributes.
+     *
+     * The attributes are prepared only once for the whole group.
+     *
+     * @param threads An array of `n` DThread structures initialized with `dthread_init_thread`.
+     * @param n The number of threads to create.
+     * @param attr Optional thread attributes; can be NULL for default attributes.
+     * @return 0 on success, non-zero on failure.
+     *
+     * NOTE: The threads wait at a start gate until the whole group is created. On failure the gate
+     * releases them without running any routine and they are joined before returning, so either
+     * every routine of the group runs or none does.
+     */
+    DTHREAD_API int dthread_create_many(DThread* threads, size_t n, DThreadAttr* attr);
+
+    /**
+     * @brief Waits for a group of threads to complete.
+     *
+     * Every thread is joined even if joining one of them fails.
+     *
+     * @param threads An array of `n` threads to wait for.
+     * @param n The number of threads.
+     * @return 0 on success, non-zero if joining any of the threads failed.
+     */
+    DTHREAD_API int dthread_join_all(DThread* threads, size_t n);
+
     /**
      * @brief Detaches a thread, allowing it to run independently.
      *
@@ -246,6 +307,27 @@ extern "C"
      */
     DTHREAD_API int dthread_cancel(DThread* thread);
 
+    /**
+     * @brief Returns the number of logical CPUs currently online.
+     *
+     * This function is useful for sizing worker teams, it never returns less than 1.
+     *
+     * @return The number of online logical CPUs.
+     */
+    DTHREAD_API int dthread_cpu_count(void);
+
+    /**
+     * @brief Pins the calling thread to a logical CPU.
+     *
+     * This function restricts the calling thread so that it only runs on the given logical CPU.
+     *
+     * @param cpu The zero based index of the logical CPU.
+     * @return 0 on success, non-zero on failure or when pinning is not supported by the platform.
+     *
+     * NOTE: Thread pinning is only supported on Linux and Windows, elsewhere this function always fails.
+     */
+    DTHREAD_API int dthread_affinity_set(int cpu);
+
     /**
      * @brief Initializes a mutex.
      *
@@ -349,6 +431,20 @@ extern "C"
      */
     DTHREAD_API int dthread_cond_wait(DThreadCond* cond, DThreadMutex* mutex);
 
+    /**
+     * @brief Waits on a condition variable for a limited amount of time.
+     *
+     * This function behaves like `dthread_cond_wait` but gives up after the given timeout. On POSIX
+     * the deadline is taken on the clock of the condition variable, `CLOCK_MONOTONIC` unless its
+     * attributes select another one (`CLOCK_REALTIME` on macOS, which cannot select a clock).
+     *
+     * @param cond A pointer to the condition variable to wait on.
+     * @param mutex A pointer to the mutex associated with the condition variable.
+     * @param milliseconds The maximum time to wait in milliseconds.
+     * @return 0 when signaled, non-zero on timeout or failure.
+     */
+    DTHREAD_API int dthread_cond_timedwait(DThreadCond* cond, DThreadMutex* mutex, uint32_t milliseconds);
+
     /**
      * @brief Initializes a read-write lock.
      *
@@ -469,6 +565,26 @@ extern "C"
     DTHREAD_API int dthread_semaphore_destroy(DThreadSemaphore* semaphore);
 
 #include "_headers/random.h"
+
+#include "_headers/bsp.h"
+#include "_headers/spawn.h"
+#include "_headers/topology.h"
+#include "_headers/group.h"
+#include "_headers/pool.h"
+#include "_headers/tls.h"
+#include "_headers/fiber.h"
+#include "_headers/reactor.h"
+#include "_headers/aio.h"
+#include "_headers/clock.h"
+#include "_headers/parallel.h"
+#include "_headers/mapreduce.h"
+#include "_headers/graph.h"
+#include "_headers/pipeline.h"
+#include "_headers/timer.h"
+#include "_headers/epoch.h"
+#include "_headers/hashmap.h"
+#include "_headers/skiplist.h"
+
 #ifdef __cplusplus
 }
 #endif
@@ -486,6 +602,25 @@ extern "C"
 
 #include "_random.c"
 
+#include "_bsp.c"
+#include "_spawn.c"
+#include "_topology.c"
+#include "_group.c"
+#include "_pool.c"
+#include "_tls.c"
+#include "_fiber.c"
+#include "_reactor.c"
+#include "_aio.c"
+#include "_clock.c"
+#include "_parallel.c"
+#include "_mapreduce.c"
+#include "_graph.c"
+#include "_pipeline.c"
+#include "_timer.c"
+#include "_epoch.c"
+#include "_hashmap.c"
+#include "_skiplist.c"
+
 #endif
 
 #endif // DTHREAD_H_
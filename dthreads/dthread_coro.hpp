@@ -0,0 +1,687 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: dthread_coro.hpp
+//    Date: 2024-09-08
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: C++20 coroutine support for dthreads, `task<T>` coroutines resumed on the
+// *  workers of a `DThreadPool` with awaitable mutex, semaphore and timers. Include
+// *  `dthread.h` (with `DTHREAD_IMPL` in exactly one translation unit) before this header.
+// ***************************************************************************************
+
+#ifndef DTHREAD_CORO_HPP_
+#define DTHREAD_CORO_HPP_
+
+#include "dthread.h"
+
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dthread
+{
+    class executor;
+
+    namespace detail
+    {
+        // the pool task of a resumption, the coroutine handle travels as the task data
+        inline void* resume_routine(void* data)
+        {
+            std::coroutine_handle<>::from_address(data).resume();
+            return nullptr;
+        }
+
+        // a node of an intrusive wait list, it lives in the frame of the suspended coroutine
+        struct waiter
+        {
+            std::coroutine_handle<> handle;
+            waiter* next = nullptr;
+        };
+
+        struct wait_list
+        {
+            waiter* head = nullptr;
+            waiter* tail = nullptr;
+
+            void push(waiter* w)
+            {
+                w->next = nullptr;
+                if (tail)
+                    tail->next = w;
+                else
+                    head = w;
+                tail = w;
+            }
+
+            waiter* pop()
+            {
+                waiter* w = head;
+                if (w)
+                {
+                    head = w->next;
+                    if (!head)
+                        tail = nullptr;
+                }
+                return w;
+            }
+        };
+
+        // RAII wrapper of the C mutex
+        class lock_guard
+        {
+        public:
+            explicit lock_guard(DThreadMutex& mutex) : _mutex(mutex) { dthread_mutex_lock(&_mutex); }
+            ~lock_guard() { dthread_mutex_unlock(&_mutex); }
+
+            lock_guard(const lock_guard&) = delete;
+            lock_guard& operator=(const lock_guard&) = delete;
+
+        private:
+            DThreadMutex& _mutex;
+        };
+
+        template <typename T>
+        class promise_value
+        {
+        public:
+            template <typename U>
+            void return_value(U&& value)
+            {
+                _value.emplace(std::forward<U>(value));
+            }
+
+            T take()
+            {
+                rethrow();
+                return std::move(*_value);
+            }
+
+            void unhandled_exception() { _error = std::current_exception(); }
+
+        protected:
+            void rethrow()
+            {
+                if (_error)
+                    std::rethrow_exception(_error);
+            }
+
+            std::optional<T> _value;
+            std::exception_ptr _error;
+        };
+
+        template <>
+        class promise_value<void>
+        {
+        public:
+            void return_void() {}
+
+            void take() { rethrow(); }
+
+            void unhandled_exception() { _error = std::current_exception(); }
+
+        protected:
+            void rethrow()
+            {
+                if (_error)
+                    std::rethrow_exception(_error);
+            }
+
+            std::exception_ptr _error;
+        };
+    } // namespace detail
+
+    /**
+     * @class task
+     * @brief A lazily started coroutine producing a `T`.
+     *
+     * The coroutine starts when it is awaited (or passed to `sync_wait`/`executor::spawn`) and
+     * resumes its awaiter on the thread that completes it, without going through the pool.
+     */
+    template <typename T = void>
+    class task
+    {
+    public:
+        struct promise_type : detail::promise_value<T>
+        {
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+
+            task get_return_object() { return task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+
+            std::suspend_always initial_suspend() noexcept { return {}; }
+
+            struct final_awaiter
+            {
+                bool await_ready() noexcept { return false; }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> handle) noexcept
+                {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            final_awaiter final_suspend() noexcept { return {}; }
+        };
+
+        task() = default;
+
+        task(task&& other) noexcept : _handle(std::exchange(other._handle, nullptr)) {}
+
+        task& operator=(task&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (_handle)
+                    _handle.destroy();
+                _handle = std::exchange(other._handle, nullptr);
+            }
+            return *this;
+        }
+
+        task(const task&) = delete;
+        task& operator=(const task&) = delete;
+
+        ~task()
+        {
+            if (_handle)
+                _handle.destroy();
+        }
+
+        auto operator co_await() && noexcept
+        {
+            struct awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() noexcept { return !handle || handle.done(); }
+
+                // symmetric transfer, awaiting a chain of tasks does not grow the stack
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume() { return handle.promise().take(); }
+            };
+
+            return awaiter{_handle};
+        }
+
+    private:
+        explicit task(std::coroutine_handle<promise_type> handle) : _handle(handle) {}
+
+        std::coroutine_handle<promise_type> _handle;
+    };
+
+    namespace detail
+    {
+        // starts itself and destroys its frame when done, used for fire-and-forget tasks
+        struct detached
+        {
+            struct promise_type
+            {
+                detached get_return_object() { return {}; }
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                std::suspend_never final_suspend() noexcept { return {}; }
+                void return_void() {}
+                void unhandled_exception() { std::terminate(); }
+            };
+        };
+    } // namespace detail
+
+    /**
+     * @class executor
+     * @brief Resumes coroutines on the workers of a `DThreadPool` and fires timers.
+     *
+     * It owns the pool when constructed from a configuration, or uses an existing one. A single
+     * timer thread is started on the first timer, coroutines still sleeping when the executor is
+     * destroyed are never resumed.
+     */
+    class executor
+    {
+    public:
+        explicit executor(DThreadPoolConfig* config = nullptr) : _pool(&_own_pool), _owns_pool(true)
+        {
+            if (dthread_pool_init(&_own_pool, config) != 0)
+                throw std::runtime_error("dthread_pool_init failed");
+
+            init_timers();
+        }
+
+        explicit executor(DThreadPool& pool) : _pool(&pool), _owns_pool(false) { init_timers(); }
+
+        executor(const executor&) = delete;
+        executor& operator=(const executor&) = delete;
+
+        ~executor()
+        {
+            {
+                detail::lock_guard guard(_timer_mutex);
+                _timer_stop = true;
+                dthread_cond_signal(&_timer_cond);
+            }
+
+            if (_timer_started)
+                dthread_join(&_timer_thread);
+
+            dthread_cond_destroy(&_timer_cond);
+            dthread_mutex_destroy(&_timer_mutex);
+
+            if (_owns_pool)
+                dthread_pool_destroy(&_own_pool);
+        }
+
+        DThreadPool& pool() noexcept { return *_pool; }
+
+        /**
+         * @brief Resumes a suspended coroutine on a worker of the pool.
+         */
+        void post(std::coroutine_handle<> handle)
+        {
+            if (dthread_pool_submit(_pool, detail::resume_routine, handle.address()) != 0)
+                throw std::runtime_error("dthread_pool_submit failed");
+        }
+
+        /**
+         * @brief `co_await ex.schedule()` moves the coroutine onto a worker of the pool.
+         */
+        auto schedule() noexcept
+        {
+            struct awaiter
+            {
+                executor* ex;
+
+                bool await_ready() noexcept { return false; }
+                void await_suspend(std::coroutine_handle<> handle) { ex->post(handle); }
+                void await_resume() noexcept {}
+            };
+
+            return awaiter{this};
+        }
+
+        /**
+         * @brief `co_await ex.sleep_for(duration)` resumes the coroutine on the pool after the
+         *        duration, no thread is blocked meanwhile.
+         */
+        template <typename Rep, typename Period>
+        auto sleep_for(std::chrono::duration<Rep, Period> duration) noexcept
+        {
+            return sleep_until(clock::now() + std::chrono::duration_cast<clock::duration>(duration));
+        }
+
+        /**
+         * @brief `co_await ex.sleep_until(time_point)` resumes the coroutine on the pool at the time point.
+         */
+        auto sleep_until(std::chrono::steady_clock::time_point deadline) noexcept
+        {
+            struct awaiter
+            {
+                executor* ex;
+                std::chrono::steady_clock::time_point deadline;
+
+                bool await_ready() noexcept { return deadline <= clock::now(); }
+                void await_suspend(std::coroutine_handle<> handle) { ex->add_timer(deadline, handle); }
+                void await_resume() noexcept {}
+            };
+
+            return awaiter{this, deadline};
+        }
+
+        /**
+         * @brief Starts a task on the pool without waiting for it, its exceptions terminate the program.
+         */
+        void spawn(task<void>&& work) { run_detached(this, std::move(work)); }
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        struct timer
+        {
+            clock::time_point deadline;
+            std::coroutine_handle<> handle;
+
+            bool operator>(const timer& other) const noexcept { return deadline > other.deadline; }
+        };
+
+        static detail::detached run_detached(executor* ex, task<void> work)
+        {
+            co_await ex->schedule();
+            co_await std::move(work);
+        }
+
+        void init_timers()
+        {
+            dthread_mutex_init(&_timer_mutex, NULL);
+            dthread_cond_init(&_timer_cond, NULL);
+        }
+
+        void add_timer(clock::time_point deadline, std::coroutine_handle<> handle)
+        {
+            detail::lock_guard guard(_timer_mutex);
+
+            if (!_timer_started)
+            {
+                _timer_thread = dthread_init_thread(timer_main, this);
+                if (dthread_create(&_timer_thread, NULL) != 0)
+                    throw std::runtime_error("dthread_create failed");
+                _timer_started = true;
+            }
+
+            _timers.push(timer{deadline, handle});
+
+            // only an earlier first deadline changes how long the timer thread sleeps
+            if (_timers.top().handle == handle)
+                dthread_cond_signal(&_timer_cond);
+        }
+
+        static void* timer_main(void* data)
+        {
+            executor* ex = static_cast<executor*>(data);
+
+            detail::lock_guard guard(ex->_timer_mutex);
+
+            while (!ex->_timer_stop)
+            {
+                if (ex->_timers.empty())
+                {
+                    dthread_cond_wait(&ex->_timer_cond, &ex->_timer_mutex);
+                    continue;
+                }
+
+                clock::time_point now = clock::now();
+                timer first = ex->_timers.top();
+
+                if (first.deadline <= now)
+                {
+                    ex->_timers.pop();
+                    ex->post(first.handle);
+                    continue;
+                }
+
+                auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(first.deadline - now).count();
+                dthread_cond_timedwait(&ex->_timer_cond, &ex->_timer_mutex, (uint32_t)(wait > 0 ? wait : 1));
+            }
+
+            return nullptr;
+        }
+
+        DThreadPool _own_pool;
+        DThreadPool* _pool;
+        bool _owns_pool;
+
+        DThreadMutex _timer_mutex;
+        DThreadCond _timer_cond;
+        DThread _timer_thread;
+        bool _timer_started = false;
+        bool _timer_stop = false;
+        std::priority_queue<timer, std::vector<timer>, std::greater<timer>> _timers;
+    };
+
+    /**
+     * @class async_mutex
+     * @brief A mutex whose waiters suspend instead of blocking their thread.
+     *
+     * `co_await m.lock()` then `m.unlock()`, the ownership goes straight to the first waiter,
+     * which is resumed on the pool.
+     */
+    class async_mutex
+    {
+    public:
+        explicit async_mutex(executor& ex) : _ex(ex) { dthread_mutex_init(&_mutex, NULL); }
+
+        async_mutex(const async_mutex&) = delete;
+        async_mutex& operator=(const async_mutex&) = delete;
+
+        ~async_mutex() { dthread_mutex_destroy(&_mutex); }
+
+        auto lock() noexcept
+        {
+            struct awaiter : detail::waiter
+            {
+                async_mutex* m;
+
+                explicit awaiter(async_mutex* m) : m(m) {}
+
+                bool await_ready() noexcept { return false; }
+
+                bool await_suspend(std::coroutine_handle<> awaiting)
+                {
+                    detail::lock_guard guard(m->_mutex);
+
+                    if (!m->_locked)
+                    {
+                        m->_locked = true;
+                        return false;
+                    }
+
+                    handle = awaiting;
+                    m->_waiters.push(this);
+                    return true;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            return awaiter{this};
+        }
+
+        bool try_lock() noexcept
+        {
+            detail::lock_guard guard(_mutex);
+
+            if (_locked)
+                return false;
+
+            _locked = true;
+            return true;
+        }
+
+        void unlock()
+        {
+            detail::waiter* next;
+
+            {
+                detail::lock_guard guard(_mutex);
+
+                next = _waiters.pop();
+                if (!next)
+                    _locked = false;
+            }
+
+            if (next)
+                _ex.post(next->handle);
+        }
+
+    private:
+        executor& _ex;
+        DThreadMutex _mutex;
+        bool _locked = false;
+        detail::wait_list _waiters;
+    };
+
+    /**
+     * @class async_semaphore
+     * @brief A counting semaphore whose waiters suspend instead of blocking their thread.
+     *
+     * `co_await s.acquire()` then `s.release()`, a released unit goes straight to the first
+     * waiter, which is resumed on the pool.
+     */
+    class async_semaphore
+    {
+    public:
+        async_semaphore(executor& ex, std::ptrdiff_t count) : _ex(ex), _count(count) { dthread_mutex_init(&_mutex, NULL); }
+
+        async_semaphore(const async_semaphore&) = delete;
+        async_semaphore& operator=(const async_semaphore&) = delete;
+
+        ~async_semaphore() { dthread_mutex_destroy(&_mutex); }
+
+        auto acquire() noexcept
+        {
+            struct awaiter : detail::waiter
+            {
+                async_semaphore* s;
+
+                explicit awaiter(async_semaphore* s) : s(s) {}
+
+                bool await_ready() noexcept { return false; }
+
+                bool await_suspend(std::coroutine_handle<> awaiting)
+                {
+                    detail::lock_guard guard(s->_mutex);
+
+                    if (s->_count > 0)
+                    {
+                        s->_count--;
+                        return false;
+                    }
+
+                    handle = awaiting;
+                    s->_waiters.push(this);
+                    return true;
+                }
+
+                void await_resume() noexcept {}
+            };
+
+            return awaiter{this};
+        }
+
+        void release()
+        {
+            detail::waiter* next;
+
+            {
+                detail::lock_guard guard(_mutex);
+
+                next = _waiters.pop();
+                if (!next)
+                    _count++;
+            }
+
+            if (next)
+                _ex.post(next->handle);
+        }
+
+    private:
+        executor& _ex;
+        DThreadMutex _mutex;
+        std::ptrdiff_t _count;
+        detail::wait_list _waiters;
+    };
+
+    namespace detail
+    {
+        struct latch
+        {
+            DThreadMutex mutex;
+            DThreadCond cond;
+            bool done = false;
+
+            latch()
+            {
+                dthread_mutex_init(&mutex, NULL);
+                dthread_cond_init(&cond, NULL);
+            }
+
+            ~latch()
+            {
+                dthread_cond_destroy(&cond);
+                dthread_mutex_destroy(&mutex);
+            }
+
+            void set()
+            {
+                lock_guard guard(mutex);
+                done = true;
+                dthread_cond_signal(&cond);
+            }
+
+            void wait()
+            {
+                lock_guard guard(mutex);
+                while (!done)
+                    dthread_cond_wait(&cond, &mutex);
+            }
+        };
+
+        template <typename T>
+        detached sync_run(task<T>& work, std::optional<T>& result, std::exception_ptr& error, latch& done)
+        {
+            try
+            {
+                result.emplace(co_await std::move(work));
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            done.set();
+        }
+
+        inline detached sync_run(task<void>& work, std::exception_ptr& error, latch& done)
+        {
+            try
+            {
+                co_await std::move(work);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+
+            done.set();
+        }
+    } // namespace detail
+
+    /**
+     * @brief Runs a task to completion and returns its result, the calling thread blocks.
+     *
+     * The task starts on the calling thread, it must not be a worker of the pool it awaits on.
+     */
+    template <typename T>
+    T sync_wait(task<T> work)
+    {
+        detail::latch done;
+        std::exception_ptr error;
+
+        if constexpr (std::is_void_v<T>)
+        {
+            detail::sync_run(work, error, done);
+            done.wait();
+
+            if (error)
+                std::rethrow_exception(error);
+        }
+        else
+        {
+            std::optional<T> result;
+
+            detail::sync_run(work, result, error, done);
+            done.wait();
+
+            if (error)
+                std::rethrow_exception(error);
+
+            return std::move(*result);
+        }
+    }
+} // namespace dthread
+
+#endif // DTHREAD_CORO_HPP_
@@ -0,0 +1,139 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: aio.c
+//    Date: 2024-09-10
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_CHUNKS 64
+#define CHUNK_SIZE (64 * 1024)
+
+DThreadMutex mutex;
+int64_t transferred = 0;
+int failures = 0;
+
+static void on_done(DThreadAIOOp* op)
+{
+    dthread_mutex_lock(&mutex);
+    if (op->result == (int64_t)op->length || op->opcode == DTHREAD_AIO_FSYNC)
+        transferred += op->opcode == DTHREAD_AIO_FSYNC ? 0 : op->result;
+    else
+        failures++;
+    dthread_mutex_unlock(&mutex);
+}
+
+static int run(DThreadAIOConfig* config)
+{
+    DThreadAIO aio;
+    FILE* file = tmpfile();
+
+    if (!file || dthread_aio_init(&aio, config) != 0)
+    {
+        fprintf(stderr, "AIO init failed\n");
+        return 0;
+    }
+
+    int fd = fileno(file);
+    unsigned char* data = (unsigned char*)malloc(NUM_CHUNKS * CHUNK_SIZE);
+    unsigned char* back = (unsigned char*)calloc(NUM_CHUNKS, CHUNK_SIZE);
+
+    for (size_t i = 0; i < NUM_CHUNKS * CHUNK_SIZE; ++i)
+        data[i] = (unsigned char)(i * 31 + i / CHUNK_SIZE);
+
+    // the write side comes from a registered buffer
+    void* buffers[] = {data};
+    size_t lengths[] = {NUM_CHUNKS * CHUNK_SIZE};
+    dthread_aio_register_buffers(&aio, buffers, lengths, 1);
+
+    DThreadAIOOp ops[NUM_CHUNKS];
+    DThreadAIOOp* batch[NUM_CHUNKS];
+
+    transferred = 0;
+    failures = 0;
+
+    for (int i = 0; i < NUM_CHUNKS; ++i)
+    {
+        ops[i] = (DThreadAIOOp){.opcode = DTHREAD_AIO_WRITE,
+                                .fd = fd,
+                                .buffer = data + i * CHUNK_SIZE,
+                                .length = CHUNK_SIZE,
+                                .offset = (uint64_t)i * CHUNK_SIZE,
+                                .fixed = 1,
+                                .buffer_index = 0,
+                                .callback = on_done};
+        batch[i] = &ops[i];
+    }
+
+    dthread_aio_submit(&aio, batch, NUM_CHUNKS);
+    dthread_aio_wait(&aio);
+
+    ops[0] = (DThreadAIOOp){.opcode = DTHREAD_AIO_FSYNC, .fd = fd, .callback = on_done};
+    dthread_aio_submit(&aio, batch, 1);
+    dthread_aio_wait(&aio);
+
+    // reads in reverse order, any block may complete first
+    for (int i = 0; i < NUM_CHUNKS; ++i)
+    {
+        int block = NUM_CHUNKS - 1 - i;
+        ops[i] = (DThreadAIOOp){.opcode = DTHREAD_AIO_READ,
+                                .fd = fd,
+                                .buffer = back + block * CHUNK_SIZE,
+                                .length = CHUNK_SIZE,
+                                .offset = (uint64_t)block * CHUNK_SIZE,
+                                .callback = on_done};
+    }
+
+    dthread_aio_submit(&aio, batch, NUM_CHUNKS);
+    dthread_aio_wait(&aio);
+
+    int ok = failures == 0 && transferred == 2 * NUM_CHUNKS * CHUNK_SIZE && memcmp(data, back, NUM_CHUNKS * CHUNK_SIZE) == 0;
+
+    printf("%s backend: %lld bytes transferred, %s\n", dthread_aio_backend(&aio) == DTHREAD_AIO_BACKEND_URING ? "io_uring" : "threads",
+           (long long)transferred, ok ? "verified" : "mismatch");
+
+    dthread_aio_destroy(&aio);
+    free(back);
+    free(data);
+    fclose(file);
+
+    return ok;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+
+    dthread_mutex_init(&mutex, NULL);
+
+    if (dthread_pool_init(&pool, NULL) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    // io_uring where the kernel allows it, callbacks on the pool
+    int ok = run(&(DThreadAIOConfig){.pool = &pool});
+
+    // the portable fallback, callbacks on the I/O threads
+    ok &= run(&(DThreadAIOConfig){.force_threads = 1});
+
+    dthread_pool_destroy(&pool);
+    dthread_mutex_destroy(&mutex);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,84 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: autoscale.c
+//    Date: 2024-09-03
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
+
+#define NUM_TASKS 40
+
+dthread_define_routine(request)
+{
+    (void)data;
+
+    // looks like busy work to the pool
+    xsleep(5);
+
+    return NULL;
+}
+
+static void print_stats(const char* when, DThreadPool* pool)
+{
+    DThreadPoolStats stats;
+    dthread_pool_stats(pool, &stats);
+
+    printf("%-8s workers: %d (target %d), queued: %zu, completed: %llu, avg wait: %.2fms, utilization: %.0f%%, grown: %llu, retired: %llu\n",
+           when, stats.workers, stats.target, stats.queued, (unsigned long long)stats.completed, (double)stats.avg_wait_ns / 1e6,
+           stats.utilization * 100.0, (unsigned long long)stats.grown, (unsigned long long)stats.retired);
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig config = {
+        .min_workers = 1,
+        .max_workers = 4,
+        .target_wait_us = 2000,
+        .idle_timeout = 50,
+    };
+
+    if (dthread_pool_init(&pool, &config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    print_stats("start", &pool);
+
+    // a burst, the queue grows faster than a single worker can drain it
+    for (int i = 0; i < NUM_TASKS; ++i)
+        dthread_pool_submit(&pool, request, NULL);
+
+    xsleep(30);
+    print_stats("burst", &pool);
+
+    dthread_pool_wait(&pool);
+    print_stats("drained", &pool);
+
+    // idle longer than the cooldown, the extra workers retire
+    xsleep(300);
+    print_stats("idle", &pool);
+
+    DThreadPoolStats stats;
+    dthread_pool_stats(&pool, &stats);
+
+    dthread_pool_destroy(&pool);
+
+    return (stats.grown > 0 && stats.workers == 1 && stats.completed == NUM_TASKS) ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: blocking.c
+//    Date: 2024-09-02
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
+
+#define NUM_WORKERS 2
+#define NUM_TASKS 6
+
+DThreadBarrier barrier;
+DThreadMutex mutex;
+int done = 0;
+
+dthread_define_routine(rendezvous)
+{
+    (void)data;
+
+    // every task waits for all the others, with only NUM_WORKERS workers and no
+    // compensation this would never return
+    dthread_barrier_wait(&barrier);
+
+    dthread_mutex_lock(&mutex);
+    done++;
+    dthread_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+dthread_define_routine(slow_read)
+{
+    (void)data;
+
+    // a blocking call dthreads knows nothing about, like a file read
+    dthread_blocking_begin();
+    xsleep(20);
+    dthread_blocking_end();
+
+    dthread_mutex_lock(&mutex);
+    done++;
+    dthread_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig config = {.num_workers = NUM_WORKERS};
+
+    dthread_barrier_init(&barrier, NUM_TASKS);
+    dthread_mutex_init(&mutex, NULL);
+
+    if (dthread_pool_init(&pool, &config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_TASKS; ++i)
+        dthread_pool_submit(&pool, rendezvous, NULL);
+
+    dthread_pool_wait(&pool);
+
+    printf("%d tasks met at the barrier, %d workers started\n", done, dthread_pool_get_num_workers(&pool));
+
+    // the spare workers are reused instead of starting new ones
+    for (int i = 0; i < NUM_TASKS; ++i)
+        dthread_pool_submit(&pool, slow_read, NULL);
+
+    dthread_pool_wait(&pool);
+
+    printf("%d tasks completed, %d workers started\n", done, dthread_pool_get_num_workers(&pool));
+
+    dthread_pool_destroy(&pool);
+    dthread_mutex_destroy(&mutex);
+    dthread_barrier_destroy(&barrier);
+
+    return done == 2 * NUM_TASKS ? 0 : 1;
+}
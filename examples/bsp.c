@@ -0,0 +1,114 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: bsp.c
+//    Date: 2024-08-26
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_VERTICES 1000
+#define NUM_WORKERS 4
+
+typedef struct
+{
+    size_t vertex;
+    int value;
+} Message;
+
+int values[NUM_VERTICES];
+
+void send_to_neighbors(DThreadBSPContext* ctx, size_t v)
+{
+    Message msg = {0, values[v]};
+
+    if (v > 0)
+    {
+        msg.vertex = v - 1;
+        dthread_bsp_send(ctx, dthread_bsp_owner(ctx->bsp, v - 1), &msg);
+    }
+
+    if (v + 1 < NUM_VERTICES)
+    {
+        msg.vertex = v + 1;
+        dthread_bsp_send(ctx, dthread_bsp_owner(ctx->bsp, v + 1), &msg);
+    }
+}
+
+// every vertex adopts the maximum value it hears about and tells its neighbors
+int max_propagation(DThreadBSPContext* ctx)
+{
+    if (ctx->superstep == 0)
+    {
+        for (size_t v = ctx->begin; v < ctx->end; ++v)
+            send_to_neighbors(ctx, v);
+
+        return 0;
+    }
+
+    const Message* msg;
+    while ((msg = dthread_bsp_recv(ctx)) != NULL)
+    {
+        if (msg->value > values[msg->vertex])
+        {
+            values[msg->vertex] = msg->value;
+            send_to_neighbors(ctx, msg->vertex);
+        }
+    }
+
+    // halting is driven by messages only
+    return 0;
+}
+
+int main(void)
+{
+    DThreadBSP bsp;
+    DThreadBSPConfig config = {
+        .num_workers = NUM_WORKERS,
+        .num_items = NUM_VERTICES,
+        .message_size = sizeof(Message),
+        .pin = 1,
+    };
+
+    if (dthread_bsp_init(&bsp, &config) != 0)
+    {
+        fprintf(stderr, "BSP init failed\n");
+        return 1;
+    }
+
+    // the same team is reused for several runs
+    for (int round = 0; round < 3; ++round)
+    {
+        for (int v = 0; v < NUM_VERTICES; ++v)
+            values[v] = (v * 7919 + round) % NUM_VERTICES;
+
+        dthread_bsp_run(&bsp, max_propagation, NULL);
+
+        for (int v = 0; v < NUM_VERTICES; ++v)
+        {
+            if (values[v] != NUM_VERTICES - 1)
+            {
+                fprintf(stderr, "vertex %d ended with %d\n", v, values[v]);
+                return 1;
+            }
+        }
+
+        printf("Round %d converged after %zu supersteps\n", round, dthread_bsp_get_supersteps(&bsp));
+    }
+
+    dthread_bsp_destroy(&bsp);
+
+    return 0;
+}
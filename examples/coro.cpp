@@ -0,0 +1,99 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: coro.cpp
+//    Date: 2024-09-08
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread_coro.hpp
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+#include "../dthreads/dthread_coro.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+
+#define NUM_REQUESTS 100
+#define MAX_IN_FLIGHT 3
+
+using namespace std::chrono_literals;
+
+struct Service
+{
+    dthread::executor& ex;
+
+    dthread::async_mutex mutex;
+    dthread::async_semaphore slots;
+    dthread::async_semaphore finished;
+
+    long total = 0;
+    std::atomic<int> in_flight{0};
+    std::atomic<int> max_in_flight{0};
+
+    explicit Service(dthread::executor& ex) : ex(ex), mutex(ex), slots(ex, MAX_IN_FLIGHT), finished(ex, 0) {}
+};
+
+dthread::task<int> lookup(Service& service, int id)
+{
+    // a timer resumes the coroutine, no worker sleeps in the meantime
+    co_await service.ex.sleep_for(2ms);
+
+    co_return id * 2;
+}
+
+dthread::task<void> handle(Service& service, int id)
+{
+    co_await service.slots.acquire();
+
+    int now = ++service.in_flight;
+    for (int seen = service.max_in_flight; now > seen && !service.max_in_flight.compare_exchange_weak(seen, now);)
+        ;
+
+    int value = co_await lookup(service, id);
+
+    --service.in_flight;
+    service.slots.release();
+
+    co_await service.mutex.lock();
+    service.total += value;
+    service.mutex.unlock();
+
+    service.finished.release();
+}
+
+dthread::task<long> serve(Service& service)
+{
+    co_await service.ex.schedule();
+
+    for (int i = 0; i < NUM_REQUESTS; ++i)
+        service.ex.spawn(handle(service, i));
+
+    for (int i = 0; i < NUM_REQUESTS; ++i)
+        co_await service.finished.acquire();
+
+    co_return service.total;
+}
+
+int main(void)
+{
+    DThreadPoolConfig config = {.num_workers = 2};
+    dthread::executor ex(&config);
+    Service service(ex);
+
+    auto start = std::chrono::steady_clock::now();
+    long total = dthread::sync_wait(serve(service));
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+
+    printf("%d requests on 2 workers in %lldms, total: %ld, at most %d in flight\n", NUM_REQUESTS,
+           (long long)elapsed.count(), total, service.max_in_flight.load());
+
+    return (total == (long)NUM_REQUESTS * (NUM_REQUESTS - 1) && service.max_in_flight <= MAX_IN_FLIGHT) ? 0 : 1;
+}
@@ -0,0 +1,135 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: fiber.c
+//    Date: 2024-09-07
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#define NUM_PRODUCERS 10000
+#define NUM_CONSUMERS 100
+#define NUM_ITEMS 10
+#define NUM_YIELDS 1000000
+
+DThreadFiberChannel channel;
+
+DThreadFiberMutex mutex;
+DThreadFiberCond cond;
+int producers_left = NUM_PRODUCERS;
+long total = 0;
+
+dthread_define_routine(producer)
+{
+    uintptr_t id = (uintptr_t)data;
+
+    for (uintptr_t i = 0; i < NUM_ITEMS; ++i)
+        dthread_fiber_channel_send(&channel, (void*)(id * NUM_ITEMS + i + 1));
+
+    dthread_fiber_mutex_lock(&mutex);
+    if (--producers_left == 0)
+        dthread_fiber_cond_signal(&cond);
+    dthread_fiber_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+dthread_define_routine(consumer)
+{
+    (void)data;
+
+    long sum = 0;
+    void* item;
+
+    // a full or empty channel suspends the fiber, the carrier keeps running the others
+    while (dthread_fiber_channel_recv(&channel, &item) == 0)
+        sum += (long)(uintptr_t)item;
+
+    dthread_fiber_mutex_lock(&mutex);
+    total += sum;
+    dthread_fiber_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+dthread_define_routine(closer)
+{
+    (void)data;
+
+    dthread_fiber_mutex_lock(&mutex);
+    while (producers_left > 0)
+        dthread_fiber_cond_wait(&cond, &mutex);
+    dthread_fiber_mutex_unlock(&mutex);
+
+    dthread_fiber_channel_close(&channel);
+
+    return NULL;
+}
+
+dthread_define_routine(spinner)
+{
+    (void)data;
+
+    for (int i = 0; i < NUM_YIELDS; ++i)
+        dthread_fiber_yield();
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThreadFiberScheduler sched;
+    DThreadFiberConfig config = {.num_carriers = 2, .stack_size = 16 * 1024};
+
+    if (dthread_fiber_scheduler_init(&sched, &config) != 0)
+    {
+        fprintf(stderr, "Scheduler init failed\n");
+        return 1;
+    }
+
+    dthread_fiber_channel_init(&channel, 64);
+    dthread_fiber_mutex_init(&mutex);
+    dthread_fiber_cond_init(&cond);
+
+    dthread_fiber_spawn(&sched, closer, NULL);
+
+    for (int i = 0; i < NUM_CONSUMERS; ++i)
+        dthread_fiber_spawn(&sched, consumer, NULL);
+
+    for (uintptr_t i = 0; i < NUM_PRODUCERS; ++i)
+        dthread_fiber_spawn(&sched, producer, (void*)i);
+
+    dthread_fiber_scheduler_wait(&sched);
+
+    long n = (long)NUM_PRODUCERS * NUM_ITEMS;
+    printf("%d fibers moved %ld items, sum: %ld (expected %ld)\n", NUM_PRODUCERS + NUM_CONSUMERS + 1, n, total,
+           n * (n + 1) / 2);
+
+    // a yield is two switches, into the carrier and into the next fiber
+    clock_t start = clock();
+    dthread_fiber_spawn(&sched, spinner, NULL);
+    dthread_fiber_scheduler_wait(&sched);
+    double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+    printf("%d yields in %.3fs, %.0fns per yield\n", NUM_YIELDS, seconds, seconds * 1e9 / NUM_YIELDS);
+
+    dthread_fiber_channel_destroy(&channel);
+    dthread_fiber_cond_destroy(&cond);
+    dthread_fiber_mutex_destroy(&mutex);
+    dthread_fiber_scheduler_destroy(&sched);
+
+    return total == n * (n + 1) / 2 ? 0 : 1;
+}
@@ -0,0 +1,148 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: forkjoin.c
+//    Date: 2024-09-01
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_ITEMS 200000
+#define CUTOFF 2048
+
+typedef struct
+{
+    int n;
+    long result;
+} Fib;
+
+dthread_define_routine(fib)
+{
+    Fib* f = (Fib*)data;
+
+    if (f->n < 2)
+    {
+        f->result = f->n;
+        return NULL;
+    }
+
+    Fib a = {.n = f->n - 1};
+    Fib b = {.n = f->n - 2};
+    DThreadFJ fj;
+    dthread_fj_init(&fj);
+
+    // the first half can be stolen while this worker computes the second one
+    dthread_fj_spawn(&fj, fib, &a);
+    fib(&b);
+    dthread_fj_sync(&fj);
+
+    f->result = a.result + b.result;
+
+    return NULL;
+}
+
+typedef struct
+{
+    int* items;
+    size_t n;
+} Slice;
+
+static void insertion_sort(int* items, size_t n)
+{
+    for (size_t i = 1; i < n; ++i)
+    {
+        int key = items[i];
+        size_t j = i;
+
+        for (; j > 0 && items[j - 1] > key; --j)
+            items[j] = items[j - 1];
+
+        items[j] = key;
+    }
+}
+
+dthread_define_routine(quicksort)
+{
+    Slice* s = (Slice*)data;
+
+    if (s->n <= CUTOFF)
+    {
+        insertion_sort(s->items, s->n);
+        return NULL;
+    }
+
+    int pivot = s->items[s->n / 2];
+    size_t i = 0, j = s->n - 1;
+
+    for (;;)
+    {
+        while (s->items[i] < pivot)
+            ++i;
+        while (s->items[j] > pivot)
+            --j;
+
+        if (i >= j)
+            break;
+
+        int tmp = s->items[i];
+        s->items[i++] = s->items[j];
+        s->items[j--] = tmp;
+    }
+
+    Slice left = {s->items, j + 1};
+    Slice right = {s->items + j + 1, s->n - j - 1};
+    DThreadFJ fj;
+    dthread_fj_init(&fj);
+
+    dthread_fj_spawn(&fj, quicksort, &left);
+    quicksort(&right);
+    dthread_fj_sync(&fj);
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+
+    if (dthread_pool_init(&pool, NULL) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    Fib f = {.n = 25};
+    dthread_pool_run(&pool, fib, &f);
+    printf("fib(%d) = %ld on %d workers\n", f.n, f.result, dthread_pool_get_num_workers(&pool));
+
+    int* items = (int*)malloc(NUM_ITEMS * sizeof(int));
+    srand(42);
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        items[i] = rand();
+
+    Slice all = {items, NUM_ITEMS};
+    dthread_pool_run(&pool, quicksort, &all);
+
+    int sorted = 1;
+    for (size_t i = 1; i < NUM_ITEMS; ++i)
+        sorted &= items[i - 1] <= items[i];
+
+    printf("Sorted %d items: %s\n", NUM_ITEMS, sorted ? "yes" : "no");
+
+    free(items);
+    dthread_pool_destroy(&pool);
+
+    return (sorted && f.result == 75025) ? 0 : 1;
+}
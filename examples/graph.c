@@ -0,0 +1,137 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: graph.c
+//    Date: 2024-09-15
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_FRAMES 1000
+
+typedef struct
+{
+    const char* name;
+    int32_t done;
+    int deps[2];
+} Step;
+
+Step steps[] = {
+    {"load", 0, {-1, -1}},     // 0
+    {"physics", 0, {0, -1}},   // 1
+    {"animation", 0, {0, -1}}, // 2
+    {"audio", 0, {0, -1}},     // 3
+    {"culling", 0, {1, 2}},    // 4
+    {"render", 0, {4, -1}},    // 5
+    {"present", 0, {5, 3}},    // 6
+};
+
+#define NUM_STEPS ((int)(sizeof(steps) / sizeof(steps[0])))
+
+int32_t violations = 0;
+
+dthread_define_routine(run_step)
+{
+    Step* step = (Step*)data;
+
+    // everything this step depends on has already run in this frame
+    for (int i = 0; i < 2; ++i)
+    {
+        if (step->deps[i] >= 0 && dthread_atomic_load_i32(&steps[step->deps[i]].done) <= dthread_atomic_load_i32(&step->done))
+            dthread_atomic_fetch_add_i32(&violations, 1);
+    }
+
+    dthread_atomic_fetch_add_i32(&step->done, 1);
+
+    return NULL;
+}
+
+char order[8];
+int num_ran = 0;
+
+dthread_define_routine(record)
+{
+    order[num_ran++] = *(const char*)data;
+    return NULL;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+
+    if (dthread_pool_init(&pool, NULL) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    DThreadGraph frame;
+    dthread_graph_init(&frame);
+
+    for (int i = 0; i < NUM_STEPS; ++i)
+        dthread_graph_add_node(&frame, run_step, &steps[i]);
+
+    for (int i = 0; i < NUM_STEPS; ++i)
+    {
+        for (int d = 0; d < 2; ++d)
+        {
+            if (steps[i].deps[d] >= 0)
+                dthread_graph_add_edge(&frame, steps[i].deps[d], i);
+        }
+    }
+
+    // the same graph every frame, nothing is allocated after the first run
+    uint64_t start = dthread_now_ns();
+    for (int f = 0; f < NUM_FRAMES; ++f)
+        dthread_graph_run(&frame, &pool);
+
+    printf("%llu frames of %d steps, %.2fus per frame, %d dependency violations\n", (unsigned long long)dthread_graph_get_runs(&frame),
+           dthread_graph_get_num_nodes(&frame), (double)(dthread_now_ns() - start) / 1e3 / NUM_FRAMES, violations);
+
+    int ok = violations == 0 && steps[6].done == NUM_FRAMES;
+
+    // the head of the longest chain goes first, ties by the order the nodes were added
+    DThreadGraph chains;
+    dthread_graph_init(&chains);
+
+    int a = dthread_graph_add_node(&chains, record, "a");
+    int b = dthread_graph_add_node(&chains, record, "b");
+    int c = dthread_graph_add_node(&chains, record, "c");
+    int x = dthread_graph_add_node(&chains, record, "X");
+    int y = dthread_graph_add_node(&chains, record, "Y");
+    int z = dthread_graph_add_node(&chains, record, "Z");
+
+    dthread_graph_add_edge(&chains, x, y);
+    dthread_graph_add_edge(&chains, y, z);
+    dthread_graph_set_cost(&chains, a, 2);
+    (void)b;
+    (void)c;
+
+    dthread_graph_run(&chains, NULL);
+    printf("Critical path first: %.*s\n", num_ran, order);
+
+    ok &= memcmp(order, "XaYbcZ", 6) == 0;
+
+    // a cycle is refused
+    dthread_graph_add_edge(&chains, z, x);
+    ok &= dthread_graph_run(&chains, NULL) != 0;
+
+    dthread_graph_destroy(&chains);
+    dthread_graph_destroy(&frame);
+    dthread_pool_destroy(&pool);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: group.c
+//    Date: 2024-08-31
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
+
+#define NUM_THREADS 5
+
+dthread_define_routine(slow_square)
+{
+    uintptr_t n = (uintptr_t)data;
+
+    // the first threads created are the slowest ones
+    xsleep((uint32_t)(NUM_THREADS - n) * 50);
+
+    return (void*)(n * n);
+}
+
+int main(void)
+{
+    DThreadGroup group;
+    DThread threads[NUM_THREADS];
+    uintptr_t total = 0;
+
+    dthread_group_init(&group);
+
+    for (uintptr_t i = 0; i < NUM_THREADS; ++i)
+    {
+        threads[i] = dthread_init_thread(slow_square, i);
+        if (dthread_group_create(&group, &threads[i], NULL) != 0)
+        {
+            fprintf(stderr, "Thread create failed\n");
+            return 1;
+        }
+    }
+
+    // nothing is ready yet
+    if (dthread_group_poll(&group) == NULL)
+        printf("Nothing completed yet, %zu pending\n", dthread_group_pending(&group));
+
+    // consume the results as soon as they are ready, not in creation order
+    DThread* done;
+    while ((done = dthread_group_join_any(&group)) != NULL)
+    {
+        printf("Thread %d completed with %zu\n", (int)(done - threads), (size_t)dthread_get_result(done));
+        total += (uintptr_t)dthread_get_result(done);
+    }
+
+    // groups are reusable, join_all just waits for everything
+    for (uintptr_t i = 0; i < NUM_THREADS; ++i)
+    {
+        threads[i] = dthread_init_thread(slow_square, i);
+        dthread_group_create(&group, &threads[i], NULL);
+    }
+
+    dthread_group_join_all(&group);
+
+    for (int i = 0; i < NUM_THREADS; ++i)
+        total += (uintptr_t)dthread_get_result(&threads[i]);
+
+    dthread_group_destroy(&group);
+
+    printf("Total: %zu\n", (size_t)total);
+
+    return total == 2 * (0 + 1 + 4 + 9 + 16) ? 0 : 1;
+}
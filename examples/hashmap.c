@@ -0,0 +1,159 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: hashmap.c
+//    Date: 2024-09-18
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_READERS 4
+#define NUM_WRITERS 2
+#define NUM_KEYS 100000
+#define NUM_VERSIONS 3
+
+typedef struct
+{
+    uint64_t key;
+    uint64_t version;
+} Value;
+
+DThreadHashMap map;
+
+// keys below these were inserted by each writer, the readers must find them
+int64_t published[NUM_WRITERS];
+int32_t removing = 0;
+int32_t writers_done = 0;
+
+int64_t lookups = 0;
+int64_t errors = 0;
+
+dthread_define_routine(writer)
+{
+    int w = (int)(intptr_t)data;
+
+    // a small map grows many times while the readers go on
+    for (uint64_t key = (uint64_t)w, i = 0; key < NUM_KEYS; key += NUM_WRITERS, ++i)
+    {
+        Value value = {key, 0};
+        dthread_hashmap_put(&map, &key, &value);
+        dthread_atomic_store_i64(&published[w], (int64_t)i + 1);
+    }
+
+    for (uint64_t version = 1; version <= NUM_VERSIONS; ++version)
+    {
+        for (uint64_t key = (uint64_t)w; key < NUM_KEYS; key += NUM_WRITERS)
+        {
+            Value value = {key, version};
+            dthread_hashmap_put(&map, &key, &value);
+        }
+    }
+
+    dthread_atomic_store_i32(&removing, 1);
+
+    for (uint64_t key = (uint64_t)w; key < NUM_KEYS; key += NUM_WRITERS)
+    {
+        if (key % 3 == 0 && dthread_hashmap_remove(&map, &key) != 0)
+            dthread_atomic_fetch_add_i64(&errors, 1);
+    }
+
+    dthread_atomic_fetch_add_i32(&writers_done, 1);
+
+    return NULL;
+}
+
+dthread_define_routine(reader)
+{
+    uint64_t seed = (uint64_t)(intptr_t)data + 1;
+    int64_t count = 0;
+
+    while (dthread_atomic_load_i32(&writers_done) < NUM_WRITERS)
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        uint64_t key = (seed >> 33) % NUM_KEYS;
+        int must_exist = !dthread_atomic_load_i32(&removing) &&
+                         (int64_t)(key / NUM_WRITERS) < dthread_atomic_load_i64(&published[key % NUM_WRITERS]);
+
+        Value value;
+        int found = dthread_hashmap_get(&map, &key, &value) == 0;
+
+        // a value is never torn or mixed with another key
+        if ((must_exist && !found) || (found && (value.key != key || value.version > NUM_VERSIONS)))
+            dthread_atomic_fetch_add_i64(&errors, 1);
+
+        ++count;
+    }
+
+    dthread_atomic_fetch_add_i64(&lookups, count);
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThread readers[NUM_READERS];
+    DThread writers[NUM_WRITERS];
+
+    if (dthread_hashmap_init(&map, &(DThreadHashMapConfig){.key_size = sizeof(uint64_t), .value_size = sizeof(Value), .capacity = 16}) != 0)
+    {
+        fprintf(stderr, "Hash map init failed\n");
+        return 1;
+    }
+
+    uint64_t start = dthread_now_ns();
+
+    for (int i = 0; i < NUM_READERS; ++i)
+    {
+        readers[i] = dthread_init_thread(reader, (void*)(intptr_t)i);
+        dthread_create(&readers[i], NULL);
+    }
+
+    for (int i = 0; i < NUM_WRITERS; ++i)
+    {
+        writers[i] = dthread_init_thread(writer, (void*)(intptr_t)i);
+        dthread_create(&writers[i], NULL);
+    }
+
+    for (int i = 0; i < NUM_WRITERS; ++i)
+        dthread_join(&writers[i]);
+
+    for (int i = 0; i < NUM_READERS; ++i)
+        dthread_join(&readers[i]);
+
+    double elapsed = (double)(dthread_now_ns() - start) / 1e9;
+
+    // every key left holds its last version
+    int64_t expected = 0;
+    for (uint64_t key = 0; key < NUM_KEYS; ++key)
+    {
+        Value value;
+        int found = dthread_hashmap_get(&map, &key, &value) == 0;
+
+        expected += key % 3 != 0;
+
+        if (found != (key % 3 != 0) || (found && value.version != NUM_VERSIONS))
+            errors++;
+    }
+
+    printf("%lld entries, %lld concurrent lookups (%.1fM/s), %lld errors\n", (long long)dthread_hashmap_get_count(&map),
+           (long long)lookups, (double)lookups / elapsed / 1e6, (long long)errors);
+
+    int ok = errors == 0 && dthread_hashmap_get_count(&map) == expected;
+
+    dthread_hashmap_destroy(&map);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,72 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: latency.c
+//    Date: 2024-08-30
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(_WIN32) || defined(_WIN64)
+#define RT_PRIORITY THREAD_PRIORITY_TIME_CRITICAL
+#else
+#define RT_PRIORITY sched_get_priority_min(SCHED_FIFO)
+#endif
+
+#define PREFAULT (256 * 1024)
+
+dthread_define_routine(market_data)
+{
+    // this much stack has already been faulted in (and locked) before we got here
+    volatile char scratch[128 * 1024];
+    uintptr_t sum = 0;
+
+    for (size_t i = 0; i < sizeof(scratch); ++i)
+        scratch[i] = (char)(i + (uintptr_t)data);
+
+    for (size_t i = 0; i < sizeof(scratch); i += 4096)
+        sum += (unsigned char)scratch[i];
+
+    return (void*)sum;
+}
+
+int main(void)
+{
+    DThread thread = dthread_init_thread(market_data, 1);
+    DThreadAttr attr = dthread_attr_low_latency(RT_PRIORITY, PREFAULT);
+
+    if (dthread_create(&thread, &attr) != 0)
+    {
+        // real-time scheduling usually needs privileges, keep the rest of the profile
+        printf("Real-time priority not permitted, running with pre-faulted stack only\n");
+
+        attr = (DThreadAttr){.prefault = PREFAULT, .lock_memory = 1};
+        if (dthread_create(&thread, &attr) != 0)
+        {
+            fprintf(stderr, "Thread create failed\n");
+            return 1;
+        }
+    }
+
+    dthread_join(&thread);
+
+    DThread plain = dthread_init_thread(market_data, 1);
+    dthread_create(&plain, NULL);
+    dthread_join(&plain);
+
+    printf("Low-latency result: %zu, plain result: %zu\n", (size_t)dthread_get_result(&thread), (size_t)dthread_get_result(&plain));
+
+    return dthread_get_result(&thread) == dthread_get_result(&plain) ? 0 : 1;
+}
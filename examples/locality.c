@@ -0,0 +1,97 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: locality.c
+//    Date: 2024-09-05
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_WORKERS 4
+#define NUM_SHARDS 8
+#define NUM_ROUNDS 50
+#define SHARD_SIZE 8192
+
+typedef struct
+{
+    int items[SHARD_SIZE];
+    long sum;
+
+    // which workers touched the shard, bit per worker index
+    unsigned int workers;
+} Shard;
+
+Shard shards[NUM_SHARDS];
+
+dthread_define_routine(update)
+{
+    Shard* shard = (Shard*)data;
+
+    // the same shard always lands on the same worker, its items stay in that worker's cache
+    for (int i = 0; i < SHARD_SIZE; ++i)
+        shard->sum += ++shard->items[i];
+
+    shard->workers |= 1u << dthread_pool_worker();
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig config = {.num_workers = NUM_WORKERS, .pin = 1};
+
+    if (dthread_pool_init(&pool, &config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    // one round at a time, a shard is never updated by two workers at once
+    for (int round = 0; round < NUM_ROUNDS; ++round)
+    {
+        for (int i = 0; i < NUM_SHARDS; ++i)
+        {
+            DThreadTaskAttr attr = {.placement = DTHREAD_TASK_PLACE_KEY, .place = (uint64_t)i};
+            dthread_pool_submit_attr(&pool, update, &shards[i], &attr);
+        }
+
+        dthread_pool_wait(&pool);
+    }
+
+    int ok = 1;
+    long expected = (long)SHARD_SIZE * NUM_ROUNDS * (NUM_ROUNDS + 1) / 2;
+
+    for (int i = 0; i < NUM_SHARDS; ++i)
+    {
+        int count = 0;
+        for (unsigned int w = shards[i].workers; w; w &= w - 1)
+            count++;
+
+        printf("Shard %d: sum %ld, updated by %d worker(s)\n", i, shards[i].sum, count);
+        ok &= shards[i].sum == expected;
+    }
+
+    DThreadPoolStats stats;
+    dthread_pool_stats(&pool, &stats);
+    printf("Placed: %llu, migrated: %llu\n", (unsigned long long)stats.placed, (unsigned long long)stats.migrated);
+
+    ok &= stats.placed + stats.migrated == NUM_SHARDS * NUM_ROUNDS;
+
+    dthread_pool_destroy(&pool);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,79 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: many.c
+//    Date: 2024-08-28
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_THREADS 256
+
+dthread_define_routine(triple)
+{
+    return (void*)((uintptr_t)data * 3);
+}
+
+int main(void)
+{
+    DThread threads[NUM_THREADS];
+    DThreadAttr attr = {0};
+    uintptr_t expected = 0, total = 0;
+
+    // small stacks are enough for tiny routines, keeps hundreds of threads cheap
+    attr.stacksize = 64 * 1024;
+
+    for (uintptr_t i = 0; i < NUM_THREADS; ++i)
+    {
+        threads[i] = dthread_init_thread(triple, i);
+        expected += i * 3;
+    }
+
+    if (dthread_create_many(threads, NUM_THREADS, &attr) != 0)
+    {
+        fprintf(stderr, "Failed to create the team\n");
+        return 1;
+    }
+
+    if (dthread_join_all(threads, NUM_THREADS) != 0)
+    {
+        fprintf(stderr, "Failed to join the team\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_THREADS; ++i)
+        total += (uintptr_t)dthread_get_result(&threads[i]);
+
+    // the same prepared attributes can be used over and over
+    DThreadPreparedAttr prepared;
+    dthread_attr_prepare(&prepared, &attr);
+
+    for (int wave = 0; wave < 2; ++wave)
+    {
+        for (int i = 0; i < NUM_THREADS; ++i)
+            dthread_create_prepared(&threads[i], &prepared);
+
+        dthread_join_all(threads, NUM_THREADS);
+
+        for (int i = 0; i < NUM_THREADS; ++i)
+            total += (uintptr_t)dthread_get_result(&threads[i]);
+    }
+
+    dthread_attr_release(&prepared);
+
+    printf("Total: %zu\n", (size_t)total);
+
+    return total == expected * 3 ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: mapreduce.c
+//    Date: 2024-09-14
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_ORDERS 1000000
+#define NUM_CUSTOMERS 5000
+// enough workers for the map and reduce tasks to overlap even on a single CPU host
+#define NUM_WORKERS 4
+
+typedef struct
+{
+    uint32_t customer;
+    uint32_t cents;
+} Order;
+
+typedef struct
+{
+    int64_t orders;
+    int64_t cents;
+} Total;
+
+Total totals[NUM_CUSTOMERS];
+int32_t num_keys = 0;
+
+static void map_order(DThreadMapContext* ctx, const void* item, void* data)
+{
+    (void)data;
+
+    const Order* order = (const Order*)item;
+    Total one = {1, order->cents};
+
+    dthread_map_emit(ctx, &order->customer, &one);
+}
+
+static void merge_total(void* acc, const void* value, void* data)
+{
+    (void)data;
+
+    Total* total = (Total*)acc;
+    const Total* other = (const Total*)value;
+
+    total->orders += other->orders;
+    total->cents += other->cents;
+}
+
+static void reduce_total(const void* key, const void* value, int partition, void* data)
+{
+    (void)partition;
+    (void)data;
+
+    // every key is reduced once, the slots of the result never collide
+    uint32_t customer = *(const uint32_t*)key;
+    totals[customer] = *(const Total*)value;
+
+    dthread_atomic_fetch_add_i32(&num_keys, 1);
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig pool_config = {.num_workers = NUM_WORKERS};
+
+    if (dthread_pool_init(&pool, &pool_config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    Order* orders = (Order*)malloc(NUM_ORDERS * sizeof(Order));
+    Total* expected = (Total*)calloc(NUM_CUSTOMERS, sizeof(Total));
+
+    srand(42);
+    for (size_t i = 0; i < NUM_ORDERS; ++i)
+    {
+        orders[i].customer = (uint32_t)(rand() % NUM_CUSTOMERS);
+        orders[i].cents = (uint32_t)(rand() % 10000);
+
+        expected[orders[i].customer].orders++;
+        expected[orders[i].customer].cents += orders[i].cents;
+    }
+
+    DThreadMapReduceConfig config = {
+        .key_size = sizeof(uint32_t),
+        .value_size = sizeof(Total),
+        .map = map_order,
+        .merge = merge_total,
+        .reduce = reduce_total,
+    };
+
+    uint64_t start = dthread_now_ns();
+    int result = dthread_map_reduce(&pool, orders, NUM_ORDERS, sizeof(Order), &config);
+
+    printf("Grouped %d orders by %d customers in %.2fms\n", NUM_ORDERS, num_keys, (double)(dthread_now_ns() - start) / 1e6);
+
+    int ok = result == 0 && num_keys == NUM_CUSTOMERS;
+    for (int i = 0; i < NUM_CUSTOMERS; ++i)
+        ok &= totals[i].orders == expected[i].orders && totals[i].cents == expected[i].cents;
+
+    printf("Customer 7: %lld orders, %lld.%02lld total\n", (long long)totals[7].orders, (long long)(totals[7].cents / 100),
+           (long long)(totals[7].cents % 100));
+
+    free(expected);
+    free(orders);
+    dthread_pool_destroy(&pool);
+
+    return ok ? 0 : 1;
+}
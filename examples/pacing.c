@@ -0,0 +1,63 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: pacing.c
+//    Date: 2024-09-11
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_TICKS 200
+#define PERIOD_NS 500000ull
+
+int main(void)
+{
+    uint64_t start = dthread_now_ns();
+    uint64_t previous = start;
+    int monotonic = 1;
+
+    // a producer paced at 2000 items per second, absolute deadlines do not drift
+    uint64_t worst = 0, total = 0;
+    for (int i = 1; i <= NUM_TICKS; ++i)
+    {
+        uint64_t deadline = start + i * PERIOD_NS;
+        dthread_sleep_until(deadline);
+
+        uint64_t now = dthread_now_ns();
+        uint64_t late = now - deadline;
+
+        monotonic &= now >= previous;
+        previous = now;
+
+        total += late;
+        if (late > worst)
+            worst = late;
+    }
+
+    uint64_t elapsed = dthread_now_ns() - start;
+
+    printf("%d ticks of %lluus in %.3fms, average lateness %lluns, worst %lluns\n", NUM_TICKS, PERIOD_NS / 1000,
+           (double)elapsed / 1e6, (unsigned long long)(total / NUM_TICKS), (unsigned long long)worst);
+
+    uint64_t before = dthread_now_ns();
+    dthread_sleep_ns(2000000);
+    uint64_t slept = dthread_now_ns() - before;
+
+    printf("Slept %lluns for 2ms\n", (unsigned long long)slept);
+
+    // a sleep never returns early
+    return (monotonic && elapsed >= NUM_TICKS * PERIOD_NS && slept >= 2000000) ? 0 : 1;
+}
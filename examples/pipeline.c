@@ -0,0 +1,112 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: pipeline.c
+//    Date: 2024-09-16
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_RECORDS 200000
+
+typedef struct
+{
+    uint64_t id;
+    uint64_t value;
+} Record;
+
+Record records[NUM_RECORDS];
+uint64_t next_id = 0;
+
+uint64_t last_written = 0;
+uint64_t num_written = 0;
+int in_order = 1;
+
+// parse: the source hands out records one by one
+static void* read_record(void* data)
+{
+    (void)data;
+
+    if (next_id == NUM_RECORDS)
+        return NULL;
+
+    Record* record = &records[next_id];
+    record->id = ++next_id;
+
+    return record;
+}
+
+// transform: the expensive part, parallel
+static void* transform(void* item, void* data)
+{
+    (void)data;
+
+    Record* record = (Record*)item;
+    uint64_t x = record->id;
+
+    for (int i = 0; i < 200; ++i)
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+
+    record->value = x;
+
+    // every tenth record is filtered out
+    return record->id % 10 == 0 ? NULL : record;
+}
+
+// write: serial, it sees the records in input order
+static void* write_record(void* item, void* data)
+{
+    (void)data;
+
+    Record* record = (Record*)item;
+
+    in_order &= record->id > last_written;
+    last_written = record->id;
+    num_written++;
+
+    return record;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+
+    if (dthread_pool_init(&pool, NULL) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    DThreadPipeline pipeline;
+    DThreadPipelineConfig config = {.batch_size = 256, .max_batches = 8};
+
+    dthread_pipeline_init(&pipeline, &config);
+    dthread_pipeline_add_stage(&pipeline, DTHREAD_STAGE_PARALLEL, transform, NULL);
+    dthread_pipeline_add_stage(&pipeline, DTHREAD_STAGE_SERIAL, write_record, NULL);
+
+    uint64_t start = dthread_now_ns();
+    dthread_pipeline_run(&pipeline, &pool, read_record, NULL);
+
+    printf("%llu records read, %llu written in %s in %.2fms\n", (unsigned long long)dthread_pipeline_get_num_items(&pipeline),
+           (unsigned long long)num_written, in_order ? "input order" : "WRONG ORDER", (double)(dthread_now_ns() - start) / 1e6);
+
+    int ok = in_order && num_written == NUM_RECORDS - NUM_RECORDS / 10;
+
+    dthread_pipeline_destroy(&pipeline);
+    dthread_pool_destroy(&pool);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: priority.c
+//    Date: 2024-09-04
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
+
+DThreadMutex mutex;
+DThreadCond cond;
+int gate_open = 0;
+
+char order[64];
+int num_done = 0;
+
+dthread_define_routine(gate)
+{
+    (void)data;
+
+    // keeps the only worker busy until everything is queued
+    dthread_mutex_lock(&mutex);
+    while (!gate_open)
+        dthread_cond_wait(&cond, &mutex);
+    gate_open = 0;
+    dthread_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+dthread_define_routine(job)
+{
+    dthread_mutex_lock(&mutex);
+    order[num_done++] = (char)(uintptr_t)data;
+    dthread_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+static void open_gate(DThreadPool* pool)
+{
+    dthread_mutex_lock(&mutex);
+    gate_open = 1;
+    dthread_cond_signal(&cond);
+    dthread_mutex_unlock(&mutex);
+
+    dthread_pool_wait(pool);
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig config = {.num_workers = 1, .max_spare = -1, .aging_us = 10000};
+
+    dthread_mutex_init(&mutex, NULL);
+    dthread_cond_init(&cond, NULL);
+
+    if (dthread_pool_init(&pool, &config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    dthread_pool_submit(&pool, gate, NULL);
+
+    DThreadTaskAttr low = {.priority = DTHREAD_TASK_PRIORITY_LOW};
+    DThreadTaskAttr high = {.priority = DTHREAD_TASK_PRIORITY_HIGH};
+
+    dthread_pool_submit_attr(&pool, job, (void*)'l', &low);
+    dthread_pool_submit(&pool, job, (void*)'n');
+    dthread_pool_submit_attr(&pool, job, (void*)'h', &high);
+
+    // same priority, earliest deadline first
+    dthread_pool_submit_attr(&pool, job, (void*)'3', &(DThreadTaskAttr){.priority = DTHREAD_TASK_PRIORITY_HIGH, .deadline_us = 30000});
+    dthread_pool_submit_attr(&pool, job, (void*)'1', &(DThreadTaskAttr){.priority = DTHREAD_TASK_PRIORITY_HIGH, .deadline_us = 10000});
+    dthread_pool_submit_attr(&pool, job, (void*)'2', &(DThreadTaskAttr){.priority = DTHREAD_TASK_PRIORITY_HIGH, .deadline_us = 20000});
+
+    open_gate(&pool);
+    printf("Execution order: %.*s\n", num_done, order);
+
+    int ok = memcmp(order, "h123nl", 6) == 0;
+
+    // a low priority task that waited long enough overtakes a fresh high priority one
+    num_done = 0;
+    dthread_pool_submit(&pool, gate, NULL);
+    dthread_pool_submit_attr(&pool, job, (void*)'l', &low);
+    xsleep(50);
+    dthread_pool_submit_attr(&pool, job, (void*)'h', &high);
+
+    open_gate(&pool);
+    printf("Execution order after aging: %.*s\n", num_done, order);
+
+    ok &= memcmp(order, "lh", 2) == 0;
+
+    DThreadPoolStats stats;
+    dthread_pool_stats(&pool, &stats);
+    printf("Deadline misses: %llu\n", (unsigned long long)stats.deadline_misses);
+
+    dthread_pool_destroy(&pool);
+    dthread_cond_destroy(&cond);
+    dthread_mutex_destroy(&mutex);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,159 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: reactor.c
+//    Date: 2024-09-09
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef DTHREAD_REACTOR_AVAILABLE
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#define NUM_PIPES 32
+#define NUM_MESSAGES 20000
+#define MESSAGE_SIZE 64
+
+typedef struct
+{
+    int fds[2];
+    long received;
+    DThreadReactorHandle* handle;
+} Pipe;
+
+Pipe pipes[NUM_PIPES];
+
+DThreadMutex mutex;
+DThreadCond cond;
+long total = 0;
+int posted = 0;
+
+void on_readable(int fd, uint32_t events, void* data)
+{
+    Pipe* pipe = (Pipe*)data;
+    char buffer[4096];
+    long n, got = 0;
+
+    (void)events;
+
+    // edge-triggered, drain until the read would block
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0)
+        got += n;
+
+    // never concurrent for the same pipe, no lock needed here
+    pipe->received += got;
+
+    dthread_mutex_lock(&mutex);
+    total += got;
+    dthread_cond_signal(&cond);
+    dthread_mutex_unlock(&mutex);
+}
+
+dthread_define_routine(on_post)
+{
+    (void)data;
+
+    dthread_mutex_lock(&mutex);
+    posted = 1;
+    dthread_cond_signal(&cond);
+    dthread_mutex_unlock(&mutex);
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig pool_config = {.num_workers = 2};
+    DThreadReactor reactor;
+
+    dthread_mutex_init(&mutex, NULL);
+    dthread_cond_init(&cond, NULL);
+
+    if (dthread_pool_init(&pool, &pool_config) != 0)
+        return 1;
+
+    DThreadReactorConfig config = {.num_loops = 2, .pool = &pool};
+    if (dthread_reactor_init(&reactor, &config) != 0)
+    {
+        fprintf(stderr, "Reactor init failed\n");
+        return 1;
+    }
+
+    for (int i = 0; i < NUM_PIPES; ++i)
+    {
+        if (pipe(pipes[i].fds) != 0)
+            return 1;
+
+        fcntl(pipes[i].fds[0], F_SETFL, O_NONBLOCK);
+        dthread_reactor_add(&reactor, &pipes[i].handle, pipes[i].fds[0], DTHREAD_REACTOR_READ, on_readable, &pipes[i]);
+    }
+
+    char message[MESSAGE_SIZE];
+    memset(message, 'x', sizeof(message));
+
+    for (int i = 0; i < NUM_MESSAGES; ++i)
+    {
+        if (write(pipes[i % NUM_PIPES].fds[1], message, sizeof(message)) != sizeof(message))
+            return 1;
+    }
+
+    // wakes a loop thread through its eventfd
+    dthread_reactor_post(&reactor, on_post, NULL);
+
+    long expected = (long)NUM_MESSAGES * MESSAGE_SIZE;
+
+    dthread_mutex_lock(&mutex);
+    while (total < expected || !posted)
+        dthread_cond_wait(&cond, &mutex);
+    dthread_mutex_unlock(&mutex);
+
+    int ok = 1;
+    for (int i = 0; i < NUM_PIPES; ++i)
+    {
+        ok &= pipes[i].received == expected / NUM_PIPES;
+
+        // no callback of the pipe runs anymore, it can be closed right away
+        dthread_reactor_remove(pipes[i].handle);
+        close(pipes[i].fds[0]);
+        close(pipes[i].fds[1]);
+    }
+
+    printf("Received %ld bytes over %d pipes, %lld events in %lld batches\n", total, NUM_PIPES,
+           (long long)dthread_atomic_load_i64(&reactor.events), (long long)dthread_atomic_load_i64(&reactor.batches));
+
+    // batches dispatched before the removals may still be queued, they only drop their references
+    dthread_pool_wait(&pool);
+    dthread_reactor_destroy(&reactor);
+    dthread_pool_destroy(&pool);
+
+    dthread_cond_destroy(&cond);
+    dthread_mutex_destroy(&mutex);
+
+    return ok ? 0 : 1;
+}
+
+#else
+
+int main(void)
+{
+    printf("The reactor needs epoll, skipped\n");
+
+    return 0;
+}
+
+#endif
@@ -18,18 +18,7 @@
 #include "../dthreads/dthread.h"
 #include <stdio.h>
 
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-#define xsleep(x) Sleep((x))
-#else
-void xsleep(uint32_t milliseconds)
-{
-    struct timespec ts;
-    ts.tv_sec = milliseconds / 1000;
-    ts.tv_nsec = (milliseconds % 1000) * 1000000;
-    nanosleep(&ts, NULL);
-}
-#endif
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
 
 #define NUM_READERS 5
 #define NUM_WRITERS 2
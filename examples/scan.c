@@ -0,0 +1,126 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: scan.c
+//    Date: 2024-09-13
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define NUM_ITEMS 2000000
+// the blocked scan only splits the array over more than one worker
+#define NUM_WORKERS 4
+
+typedef struct
+{
+    int64_t count;
+    double sum;
+} Stats;
+
+// a running count and sum in one pass, any associative operator works
+static void combine_stats(void* result, const void* left, const void* right)
+{
+    const Stats* a = (const Stats*)left;
+    const Stats* b = (const Stats*)right;
+    Stats c = {a->count + b->count, a->sum + b->sum};
+
+    *(Stats*)result = c;
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig config = {.num_workers = NUM_WORKERS};
+
+    if (dthread_pool_init(&pool, &config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    int32_t* values = (int32_t*)malloc(NUM_ITEMS * sizeof(int32_t));
+    int32_t* offsets = (int32_t*)malloc(NUM_ITEMS * sizeof(int32_t));
+    int32_t* kept = (int32_t*)malloc(NUM_ITEMS * sizeof(int32_t));
+    Stats* stats = (Stats*)malloc(NUM_ITEMS * sizeof(Stats));
+
+    srand(42);
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        values[i] = rand() % 1000;
+
+    // stream compaction: the exclusive scan of the flags is where every kept item goes
+    uint64_t start = dthread_now_ns();
+
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        offsets[i] = values[i] % 3 == 0;
+
+    dthread_parallel_scan_i32(&pool, offsets, NUM_ITEMS, DTHREAD_SCAN_EXCLUSIVE);
+
+    int32_t num_kept = offsets[NUM_ITEMS - 1] + (values[NUM_ITEMS - 1] % 3 == 0);
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+    {
+        if (values[i] % 3 == 0)
+            kept[offsets[i]] = values[i];
+    }
+
+    printf("Kept %d of %d items in %.2fms\n", num_kept, NUM_ITEMS, (double)(dthread_now_ns() - start) / 1e6);
+
+    int ok = 1;
+    for (int32_t i = 0, j = 0; i < NUM_ITEMS; ++i)
+    {
+        if (values[i] % 3 == 0)
+            ok &= kept[j++] == values[i];
+    }
+
+    // both integer scans against a serial one, element by element
+    for (int mode = DTHREAD_SCAN_EXCLUSIVE; mode <= DTHREAD_SCAN_INCLUSIVE; ++mode)
+    {
+        memcpy(offsets, values, NUM_ITEMS * sizeof(int32_t));
+        dthread_parallel_scan_i32(&pool, offsets, NUM_ITEMS, mode);
+
+        int32_t running = 0;
+        for (size_t i = 0; i < NUM_ITEMS; ++i)
+        {
+            int32_t expected = mode == DTHREAD_SCAN_EXCLUSIVE ? running : running + values[i];
+
+            ok &= offsets[i] == expected;
+            running += values[i];
+        }
+    }
+
+    printf("Integer scans %s\n", ok ? "match the serial ones" : "DO NOT MATCH the serial ones");
+
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        stats[i] = (Stats){1, (double)values[i]};
+
+    start = dthread_now_ns();
+    Stats identity = {0, 0.0};
+    dthread_parallel_scan(&pool, stats, NUM_ITEMS, sizeof(Stats), combine_stats, &identity, DTHREAD_SCAN_INCLUSIVE);
+
+    Stats last = stats[NUM_ITEMS - 1];
+    printf("Running mean after %lld items: %.3f in %.2fms\n", (long long)last.count, last.sum / (double)last.count,
+           (double)(dthread_now_ns() - start) / 1e6);
+
+    ok &= last.count == NUM_ITEMS && stats[9].count == 10;
+
+    free(stats);
+    free(kept);
+    free(offsets);
+    free(values);
+    dthread_pool_destroy(&pool);
+
+    return ok ? 0 : 1;
+}
@@ -21,19 +21,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-#if defined(_WIN32) || defined(_WIN64)
-#include <windows.h>
-
-#define xsleep(x) Sleep((x))
-#else
-void xsleep(uint32_t milliseconds)
-{
-    struct timespec ts;
-    ts.tv_sec = milliseconds / 1000;
-    ts.tv_nsec = (milliseconds % 1000) * 1000000;
-    nanosleep(&ts, NULL);
-}
-#endif
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
 
 #define THREAD_NUM 16
 
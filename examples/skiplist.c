@@ -0,0 +1,196 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: skiplist.c
+//    Date: 2024-09-19
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_THREADS 4
+#define NUM_KEYS 40000
+#define NUM_JOBS 20000
+
+DThreadSkipList index_list;
+DThreadSkipList queue;
+
+int64_t errors = 0;
+int64_t popped = 0;
+int32_t producers_done = 0;
+unsigned char seen[NUM_JOBS];
+
+int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+dthread_define_routine(indexer)
+{
+    int t = (int)(intptr_t)data;
+
+    // interleaved keys, every thread inserts all over the list
+    for (uint64_t key = (uint64_t)t; key < NUM_KEYS; key += NUM_THREADS)
+    {
+        uint64_t value = key * 10;
+        dthread_skiplist_put(&index_list, &key, &value);
+    }
+
+    for (uint64_t key = (uint64_t)t; key < NUM_KEYS; key += NUM_THREADS)
+    {
+        if (key % 5 == 0 && dthread_skiplist_remove(&index_list, &key) != 0)
+            dthread_atomic_fetch_add_i64(&errors, 1);
+    }
+
+    return NULL;
+}
+
+typedef struct
+{
+    uint64_t previous;
+    int64_t visited;
+    int ordered;
+} Scan;
+
+int check_entry(const void* key, const void* value, void* data)
+{
+    Scan* scan = (Scan*)data;
+    uint64_t k = *(const uint64_t*)key;
+
+    scan->ordered &= (scan->visited == 0 || k > scan->previous) && *(const uint64_t*)value == k * 10;
+    scan->previous = k;
+    scan->visited++;
+
+    return 0;
+}
+
+dthread_define_routine(producer)
+{
+    int t = (int)(intptr_t)data;
+
+    // the key is the priority, the job id breaks the ties
+    for (uint64_t job = (uint64_t)t; job < NUM_JOBS; job += NUM_THREADS / 2)
+    {
+        uint64_t key[2] = {job % 100, job};
+        dthread_skiplist_put(&queue, key, NULL);
+    }
+
+    dthread_atomic_fetch_add_i32(&producers_done, 1);
+
+    return NULL;
+}
+
+dthread_define_routine(consumer)
+{
+    (void)data;
+
+    for (;;)
+    {
+        int done = dthread_atomic_load_i32(&producers_done) == NUM_THREADS / 2;
+        uint64_t key[2];
+
+        if (dthread_skiplist_pop_min(&queue, key, NULL) != 0)
+        {
+            if (done)
+                break;
+
+            continue;
+        }
+
+        // a job is taken once
+        if (key[1] >= NUM_JOBS || seen[key[1]]++)
+            dthread_atomic_fetch_add_i64(&errors, 1);
+
+        dthread_atomic_fetch_add_i64(&popped, 1);
+    }
+
+    return NULL;
+}
+
+int compare_job(const void* a, const void* b)
+{
+    const uint64_t* x = (const uint64_t*)a;
+    const uint64_t* y = (const uint64_t*)b;
+
+    return x[0] != y[0] ? (x[0] > y[0]) - (x[0] < y[0]) : (x[1] > y[1]) - (x[1] < y[1]);
+}
+
+int main(void)
+{
+    DThread threads[NUM_THREADS];
+
+    dthread_skiplist_init(&index_list, &(DThreadSkipListConfig){.key_size = sizeof(uint64_t), .value_size = sizeof(uint64_t), .compare = compare_u64});
+
+    for (int i = 0; i < NUM_THREADS; ++i)
+    {
+        threads[i] = dthread_init_thread(indexer, (void*)(intptr_t)i);
+        dthread_create(&threads[i], NULL);
+    }
+
+    for (int i = 0; i < NUM_THREADS; ++i)
+        dthread_join(&threads[i]);
+
+    Scan all = {0, 0, 1};
+    dthread_skiplist_range(&index_list, NULL, NULL, check_entry, &all);
+
+    uint64_t low = 1000, high = 1999;
+    Scan some = {0, 0, 1};
+    dthread_skiplist_range(&index_list, &low, &high, check_entry, &some);
+
+    printf("%lld entries, %lld in order, %lld between %llu and %llu\n", (long long)dthread_skiplist_get_count(&index_list),
+           (long long)all.visited, (long long)some.visited, (unsigned long long)low, (unsigned long long)high);
+
+    int ok = all.ordered && some.ordered && all.visited == NUM_KEYS - NUM_KEYS / 5 && some.visited == 800 &&
+             dthread_skiplist_get_count(&index_list) == all.visited;
+
+    // a relaxed priority queue, consumers pop among the first few entries
+    dthread_skiplist_init(&queue, &(DThreadSkipListConfig){.key_size = 2 * sizeof(uint64_t), .compare = compare_job, .relax = NUM_THREADS});
+
+    for (int i = 0; i < NUM_THREADS; ++i)
+    {
+        threads[i] = dthread_init_thread(i % 2 ? consumer : producer, (void*)(intptr_t)(i / 2));
+        dthread_create(&threads[i], NULL);
+    }
+
+    for (int i = 0; i < NUM_THREADS; ++i)
+        dthread_join(&threads[i]);
+
+    printf("%lld jobs popped, %lld errors\n", (long long)popped, (long long)errors);
+
+    ok &= popped == NUM_JOBS && errors == 0 && dthread_skiplist_get_count(&queue) == 0;
+
+    // without relaxation the priorities come out in order
+    dthread_skiplist_destroy(&queue);
+    dthread_skiplist_init(&queue, &(DThreadSkipListConfig){.key_size = 2 * sizeof(uint64_t), .compare = compare_job});
+
+    for (uint64_t job = 0; job < 100; ++job)
+    {
+        uint64_t key[2] = {(job * 37) % 100, job};
+        dthread_skiplist_put(&queue, key, NULL);
+    }
+
+    uint64_t previous = 0, key[2];
+    while (dthread_skiplist_pop_min(&queue, key, NULL) == 0)
+    {
+        ok &= key[0] >= previous;
+        previous = key[0];
+    }
+
+    dthread_skiplist_destroy(&queue);
+    dthread_skiplist_destroy(&index_list);
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,118 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: sort.c
+//    Date: 2024-09-12
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_ITEMS 1000000
+// a single worker would sort serially, four keep the sample sort and the radix passes split up on small hosts
+#define NUM_WORKERS 4
+
+static uint64_t next_random(uint64_t* state)
+{
+    *state ^= *state << 13;
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static int compare_u64(const void* a, const void* b)
+{
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static int sorted_u64(const uint64_t* items, size_t n)
+{
+    for (size_t i = 1; i < n; ++i)
+    {
+        if (items[i - 1] > items[i])
+            return 0;
+    }
+
+    return 1;
+}
+
+static void report(const char* name, uint64_t start, int ok)
+{
+    printf("%-18s %8.2fms %s\n", name, (double)(dthread_now_ns() - start) / 1e6, ok ? "sorted" : "NOT SORTED");
+}
+
+int main(void)
+{
+    DThreadPool pool;
+    DThreadPoolConfig config = {.num_workers = NUM_WORKERS};
+
+    if (dthread_pool_init(&pool, &config) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    uint64_t* items = (uint64_t*)malloc(NUM_ITEMS * sizeof(uint64_t));
+    uint64_t* values = (uint64_t*)malloc(NUM_ITEMS * sizeof(uint64_t));
+    uint32_t* small = (uint32_t*)malloc(NUM_ITEMS * sizeof(uint32_t));
+    uint64_t state = 42;
+    int ok = 1;
+
+    printf("Sorting %d items on %d workers\n", NUM_ITEMS, dthread_pool_get_num_workers(&pool));
+
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        items[i] = next_random(&state);
+
+    uint64_t start = dthread_now_ns();
+    ok &= dthread_parallel_sort(&pool, items, NUM_ITEMS, sizeof(uint64_t), compare_u64) == 0 && sorted_u64(items, NUM_ITEMS);
+    report("sample sort", start, ok);
+
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        items[i] = next_random(&state);
+
+    start = dthread_now_ns();
+    ok &= dthread_parallel_radix_sort_u64(&pool, items, NUM_ITEMS) == 0 && sorted_u64(items, NUM_ITEMS);
+    report("radix sort u64", start, ok);
+
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+        small[i] = (uint32_t)next_random(&state);
+
+    start = dthread_now_ns();
+    ok &= dthread_parallel_radix_sort_u32(&pool, small, NUM_ITEMS) == 0;
+    for (size_t i = 1; i < NUM_ITEMS; ++i)
+        ok &= small[i - 1] <= small[i];
+    report("radix sort u32", start, ok);
+
+    // few distinct keys, the values tell whether equal keys kept their order
+    for (size_t i = 0; i < NUM_ITEMS; ++i)
+    {
+        items[i] = next_random(&state) % 1000;
+        values[i] = i;
+    }
+
+    start = dthread_now_ns();
+    ok &= dthread_parallel_radix_sort_kv(&pool, items, values, NUM_ITEMS) == 0 && sorted_u64(items, NUM_ITEMS);
+    for (size_t i = 1; i < NUM_ITEMS; ++i)
+        ok &= items[i - 1] != items[i] || values[i - 1] < values[i];
+    report("radix sort kv", start, ok);
+
+    free(small);
+    free(values);
+    free(items);
+    dthread_pool_destroy(&pool);
+
+    return ok ? 0 : 1;
+}
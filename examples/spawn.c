@@ -0,0 +1,105 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: spawn.c
+//    Date: 2024-08-27
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define BURSTS 200
+#define BURST_SIZE 8
+
+dthread_define_routine(square)
+{
+    uintptr_t value = (uintptr_t)data;
+
+    return (void*)(value * value);
+}
+
+double elapsed_ms(clock_t start)
+{
+    return 1000.0 * (double)(clock() - start) / CLOCKS_PER_SEC;
+}
+
+int main(void)
+{
+    DThreadSpawnConfig config = {.idle_timeout = 200, .max_parked = BURST_SIZE};
+    DThread threads[BURST_SIZE];
+    uintptr_t expected = 0, spawned = 0, created = 0;
+
+    if (dthread_spawn_init(&config) != 0)
+    {
+        fprintf(stderr, "Spawn cache init failed\n");
+        return 1;
+    }
+
+    clock_t start = clock();
+    for (int burst = 0; burst < BURSTS; ++burst)
+    {
+        for (uintptr_t i = 0; i < BURST_SIZE; ++i)
+        {
+            threads[i] = dthread_init_thread(square, i + (uintptr_t)burst);
+            if (dthread_spawn(&threads[i]) != 0)
+            {
+                fprintf(stderr, "Spawn failed\n");
+                return 1;
+            }
+
+            expected += (i + burst) * (i + burst);
+        }
+
+        for (int i = 0; i < BURST_SIZE; ++i)
+        {
+            dthread_join(&threads[i]);
+            spawned += (uintptr_t)dthread_get_result(&threads[i]);
+        }
+    }
+    printf("dthread_spawn:  %d threads in %.2f ms (cpu)\n", BURSTS * BURST_SIZE, elapsed_ms(start));
+
+    start = clock();
+    for (int burst = 0; burst < BURSTS; ++burst)
+    {
+        for (uintptr_t i = 0; i < BURST_SIZE; ++i)
+        {
+            threads[i] = dthread_init_thread(square, i + (uintptr_t)burst);
+            dthread_create(&threads[i], NULL);
+        }
+
+        for (int i = 0; i < BURST_SIZE; ++i)
+        {
+            dthread_join(&threads[i]);
+            created += (uintptr_t)dthread_get_result(&threads[i]);
+        }
+    }
+    printf("dthread_create: %d threads in %.2f ms (cpu)\n", BURSTS * BURST_SIZE, elapsed_ms(start));
+
+    // a detached spawn gives its thread back to the cache on its own
+    DThread detached = dthread_init_thread(square, 3);
+    dthread_spawn(&detached);
+    dthread_detach(&detached);
+
+    dthread_spawn_cleanup();
+
+    if (spawned != expected || created != expected)
+    {
+        fprintf(stderr, "Wrong results: %zu, %zu, expected %zu\n", (size_t)spawned, (size_t)created, (size_t)expected);
+        return 1;
+    }
+
+    printf("Results match: %zu\n", (size_t)expected);
+
+    return 0;
+}
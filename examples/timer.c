@@ -0,0 +1,131 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: timer.c
+//    Date: 2024-09-17
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define xsleep(MS) dthread_sleep_ns((uint64_t)(MS) * 1000000ull)
+
+#define NUM_TIMERS 2000
+#define MAX_DELAY_MS 300
+#define NUM_PERIODS 10
+
+DThreadTimerWheel wheel;
+DThreadTimer timers[NUM_TIMERS];
+DThreadTimer periodic;
+
+int fired[NUM_TIMERS];
+int was_cancelled[NUM_TIMERS];
+int64_t num_fired = 0;
+int64_t num_early = 0;
+int64_t worst = 0;
+int64_t total = 0;
+int64_t periods = 0;
+int32_t ticking = 0;
+int32_t overlapped = 0;
+
+void on_timeout(DThreadTimer* timer)
+{
+    int64_t late = (int64_t)(dthread_now_ns() - timer->expires_ns);
+
+    fired[(int)(intptr_t)timer->data] = 1;
+
+    if (late < 0)
+        dthread_atomic_fetch_add_i64(&num_early, 1);
+
+    dthread_atomic_fetch_add_i64(&total, late);
+
+    int64_t seen = dthread_atomic_load_i64(&worst);
+    while (late > seen && !dthread_atomic_cas_i64(&worst, &seen, late))
+        ;
+
+    dthread_atomic_fetch_add_i64(&num_fired, 1);
+}
+
+void on_tick(DThreadTimer* timer)
+{
+    // slower than its period, yet a periodic timer never runs concurrently with itself
+    if (dthread_atomic_exchange_i32(&ticking, 1) != 0)
+        dthread_atomic_store_i32(&overlapped, 1);
+
+    xsleep(12);
+
+    // a periodic timer stops itself from its own callback
+    if (dthread_atomic_fetch_add_i64(&periods, 1) + 1 == NUM_PERIODS)
+        dthread_timer_cancel(&wheel, timer);
+
+    dthread_atomic_store_i32(&ticking, 0);
+}
+
+int main(void)
+{
+    DThreadPool pool;
+
+    if (dthread_pool_init(&pool, NULL) != 0)
+    {
+        fprintf(stderr, "Pool init failed\n");
+        return 1;
+    }
+
+    // the callbacks run on the pool, the driver thread only keeps the time
+    if (dthread_timer_wheel_init(&wheel, &(DThreadTimerConfig){.pool = &pool}) != 0)
+    {
+        fprintf(stderr, "Timer wheel init failed\n");
+        return 1;
+    }
+
+    srand(42);
+    for (int i = 0; i < NUM_TIMERS; ++i)
+    {
+        timers[i].callback = on_timeout;
+        timers[i].data = (void*)(intptr_t)i;
+
+        dthread_timer_start(&wheel, &timers[i], (uint64_t)(1 + rand() % MAX_DELAY_MS) * 1000000ull, 0);
+    }
+
+    // request timeouts are mostly cancelled long before they expire
+    int cancelled = 0;
+    for (int i = 0; i < NUM_TIMERS; i += 2)
+    {
+        was_cancelled[i] = dthread_timer_cancel(&wheel, &timers[i]) == 0;
+        cancelled += was_cancelled[i];
+    }
+
+    periodic.callback = on_tick;
+    dthread_timer_start(&wheel, &periodic, 10000000ull, 10000000ull);
+
+    xsleep(MAX_DELAY_MS + 100);
+
+    int ok = dthread_timer_cancel(&wheel, &periodic) != 0 && periods == NUM_PERIODS && !overlapped;
+
+    dthread_timer_wheel_destroy(&wheel);
+    dthread_pool_wait(&pool);
+
+    for (int i = 0; i < NUM_TIMERS; ++i)
+        ok &= fired[i] != was_cancelled[i];
+
+    printf("%lld timers fired, %d cancelled, %lld periods\n", (long long)num_fired, cancelled, (long long)periods);
+    printf("Average lateness %lldus, worst %lldus\n", (long long)(num_fired ? total / num_fired / 1000 : 0),
+           (long long)(worst / 1000));
+
+    dthread_pool_destroy(&pool);
+
+    // a timer never fires before it expires
+    return (ok && num_early == 0 && num_fired == NUM_TIMERS - cancelled) ? 0 : 1;
+}
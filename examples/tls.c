@@ -0,0 +1,118 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: tls.c
+//    Date: 2024-09-06
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define NUM_THREADS 8
+#define NUM_INCREMENTS 100000
+
+// one cache line per thread index, no atomics and no false sharing
+typedef struct
+{
+    long value;
+    char _pad[64 - sizeof(long)];
+} Counter;
+
+Counter counters[NUM_THREADS];
+
+DThreadKey buffer_key;
+DThreadMutex mutex;
+long flushed = 0;
+
+// runs when a thread that owns a buffer exits
+static void flush_buffer(void* value)
+{
+    long* buffer = (long*)value;
+
+    dthread_mutex_lock(&mutex);
+    flushed += *buffer;
+    dthread_mutex_unlock(&mutex);
+
+    free(buffer);
+}
+
+dthread_define_routine(worker)
+{
+    (void)data;
+
+    int index = dthread_index();
+    if (index < 0 || index >= NUM_THREADS)
+        return (void*)1;
+
+    long* buffer = (long*)dthread_key_get(&buffer_key);
+    if (!buffer)
+    {
+        buffer = (long*)calloc(1, sizeof(long));
+        dthread_key_set(&buffer_key, buffer);
+    }
+
+    for (int i = 0; i < NUM_INCREMENTS; ++i)
+    {
+        counters[dthread_index()].value++;
+        (*(long*)dthread_key_get(&buffer_key))++;
+    }
+
+    return NULL;
+}
+
+int main(void)
+{
+    DThread threads[NUM_THREADS];
+
+    dthread_mutex_init(&mutex, NULL);
+    dthread_key_create(&buffer_key, flush_buffer);
+
+    int ok = 1;
+
+    // the same number of threads twice, the indices of the first round are recycled
+    for (int round = 0; round < 2; ++round)
+    {
+        for (int i = 0; i < NUM_THREADS - 1; ++i)
+        {
+            threads[i] = dthread_init_thread(worker, NULL);
+            dthread_create(&threads[i], NULL);
+        }
+
+        for (int i = 0; i < NUM_THREADS - 1; ++i)
+        {
+            dthread_join(&threads[i]);
+            ok &= dthread_get_result(&threads[i]) == NULL;
+        }
+    }
+
+    // the main thread takes part too, it is just another index
+    worker(NULL);
+
+    long total = 0;
+    for (int i = 0; i < NUM_THREADS; ++i)
+        total += counters[i].value;
+
+    printf("Main thread index: %d, index limit: %d\n", dthread_index(), dthread_index_limit());
+    printf("Counted: %ld, flushed by destructors: %ld\n", total, flushed);
+
+    ok &= total == (long)(2 * (NUM_THREADS - 1) + 1) * NUM_INCREMENTS;
+    ok &= flushed == (long)2 * (NUM_THREADS - 1) * NUM_INCREMENTS;
+    ok &= dthread_index_limit() <= NUM_THREADS;
+
+    free(dthread_key_get(&buffer_key));
+    dthread_key_delete(&buffer_key);
+    dthread_mutex_destroy(&mutex);
+
+    return ok ? 0 : 1;
+}
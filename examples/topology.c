@@ -0,0 +1,89 @@
+// ***************************************************************************************
+//    Project: dthreads -> https://github.com/dezashibi-c/dthreads
+//    File: topology.c
+//    Date: 2024-08-29
+//    Author: Navid Dezashibi
+//    Contact: navid@dezashibi.com
+//    Website: https://www.dezashibi.com | https://github.com/dezashibi
+//    License:
+//     Please refer to the LICENSE file, repository or website for more information about
+//     the licensing of this work. If you have any questions or concerns,
+//     please feel free to contact me at the email address provided above.
+// ***************************************************************************************
+// *  Description: Refer to readme for documentation or dthread.h
+// ***************************************************************************************
+
+#define DTHREAD_IMPL
+#include "../dthreads/dthread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+DThreadTopology topo;
+
+dthread_define_routine(pinned)
+{
+    int index = (int)(uintptr_t)data;
+
+    if (dthread_topology_pin(&topo, index) != 0)
+        printf("CPU %d: pinning is not supported here\n", topo.cpus[index].id);
+    else
+        printf("CPU %d: thread pinned\n", topo.cpus[index].id);
+
+    return NULL;
+}
+
+void print_groups(const char* name, DThreadTopologyGroup* groups, int count)
+{
+    for (int g = 0; g < count; ++g)
+    {
+        printf("%s %d (%zu bytes):", name, g, groups[g].cache_size);
+        for (int k = 0; k < groups[g].num_cpus; ++k)
+            printf(" %d", topo.cpus[groups[g].cpus[k]].id);
+        printf("\n");
+    }
+}
+
+int main(void)
+{
+    if (dthread_topology_init(&topo) != 0)
+    {
+        fprintf(stderr, "Topology discovery failed\n");
+        return 1;
+    }
+
+    printf("%d cpus, %d cores, %d L2, %d L3, %d nodes\n", topo.num_cpus, topo.num_cores, topo.num_l2, topo.num_l3, topo.num_nodes);
+
+    print_groups("core", topo.cores, topo.num_cores);
+    print_groups("L2", topo.l2, topo.num_l2);
+    print_groups("L3", topo.l3, topo.num_l3);
+    print_groups("node", topo.nodes, topo.num_nodes);
+
+    // every CPU belongs to exactly one core and one node
+    int members = 0;
+    for (int c = 0; c < topo.num_cores; ++c)
+        members += topo.cores[c].num_cpus;
+
+    if (members != topo.num_cpus || topo.num_nodes < 1)
+    {
+        fprintf(stderr, "Inconsistent topology\n");
+        return 1;
+    }
+
+    for (int i = 0; i < topo.num_cpus; ++i)
+    {
+        if (dthread_topology_distance(&topo, i, i) != 0 || topo.cpus[i].core < 0)
+        {
+            fprintf(stderr, "Inconsistent CPU %d\n", topo.cpus[i].id);
+            return 1;
+        }
+
+        DThread thread = dthread_init_thread(pinned, (uintptr_t)i);
+        dthread_create(&thread, NULL);
+        dthread_join(&thread);
+    }
+
+    dthread_topology_destroy(&topo);
+
+    return 0;
+}